@@ -15,9 +15,14 @@
 // Include files
 //--------------------------------------------------------------------------------------------------------/
 #include <string.h>
+#include <intrinsics.h>
 #include "stm8s.h"
 #include "types.h"
 #include "delay.h"
+#include "latency.h"
+#include "trace.h"
+#include "macro.h"
+#include "selfbench.h"
 
 // Own include
 #include "amiga_key.h"
@@ -49,11 +54,27 @@
 //--------------------------------------------------------------------------------------------------------/
 // Types
 //--------------------------------------------------------------------------------------------------------/
+typedef BOOL (*AMIGA_STREAM_READ)( U8* pu8Code );  //!< Reads the code due, without removing it
+typedef void (*AMIGA_STREAM_REMOVE)( void );       //!< Removes the code, after the computer acknowledged it
+
+//! \brief Codes generated by the main cycle, sent straight to the wire, when no key is waiting in the FIFO
+typedef struct
+{
+  AMIGA_STREAM_READ   pfRead;
+  AMIGA_STREAM_REMOVE pfRemove;
+  BOOL                bMeasure;  //!< The handshake of the codes is timed by the self-benchmark
+} S_AMIGA_STREAM;
 
 
 //--------------------------------------------------------------------------------------------------------/
 // Constants
 //--------------------------------------------------------------------------------------------------------/
+//! \brief The streams, in the order of their priority -- they do not run at the same time, see SelfBench_Cycle()
+static const S_AMIGA_STREAM gcsStreamTable[] =
+{
+  { Macro_ReadCode,     Macro_RemoveCode,     FALSE },  // playback of the macro
+  { SelfBench_ReadCode, SelfBench_RemoveCode, TRUE  }   // burst of the self-benchmark
+};
 
 
 //--------------------------------------------------------------------------------------------------------/
@@ -79,12 +100,38 @@ static BOOL ReadScancodeFIFO( U8* pu8ScanCode );
 static BOOL RemoveElementFromScancodeFIFO( void );
 static void FlushScancodeFIFO( void );
 static void SynchronizeCommunication( void );
-static BOOL SendScancode( U8 u8Scancode );
+static BOOL SendScancode( U8 u8Scancode, BOOL bMeasure );
+static void WritePin( GPIO_TypeDef* psPort, GPIO_Pin_TypeDef ePin, BOOL bHigh );
 
 
 //--------------------------------------------------------------------------------------------------------/
 // Static functions
 //--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Sets a pin of the computer interface
+ * \param  psPort: port of the pin
+ * \param  ePin: the pin
+ * \param  bHigh: TRUE, if the pin is released (high), FALSE, if it is pulled low
+ * \return -
+ * \note   GPIO_WriteHigh() and GPIO_WriteLow() read, modify and write the output register, the IT routine writes the
+ *         column pins of the same ports in between (see SetColumn() in matrix.c): the interrupts are disabled meanwhile.
+ *********************************************************************/
+static void WritePin( GPIO_TypeDef* psPort, GPIO_Pin_TypeDef ePin, BOOL bHigh )
+{
+  __istate_t sState = __get_interrupt_state();
+
+  __disable_interrupt();
+  if( TRUE == bHigh )
+  {
+    GPIO_WriteHigh( psPort, ePin );
+  }
+  else
+  {
+    GPIO_WriteLow( psPort, ePin );
+  }
+  __set_interrupt_state( sState );
+}
+
 /*! *******************************************************************
  * \brief  Reads the oldest element in the FIFO
  * \param  pu8ScanCode: the element will be put here
@@ -160,13 +207,13 @@ static void SynchronizeCommunication( void )
 
   while( FALSE == gbIsSynchronized )
   {
-    GPIO_WriteLow( AMIGA_DAT_PORT, AMIGA_DAT_PIN );  // NOTE: data line is inverted!
+    WritePin( AMIGA_DAT_PORT, AMIGA_DAT_PIN, FALSE );  // NOTE: data line is inverted!
     delay_us( 20u );
-    GPIO_WriteLow( AMIGA_CLK_PORT, AMIGA_CLK_PIN );
+    WritePin( AMIGA_CLK_PORT, AMIGA_CLK_PIN, FALSE );
     delay_us( 20u );
-    GPIO_WriteHigh( AMIGA_CLK_PORT, AMIGA_CLK_PIN );
+    WritePin( AMIGA_CLK_PORT, AMIGA_CLK_PIN, TRUE );
     delay_us( 20u );
-    GPIO_WriteHigh( AMIGA_DAT_PORT, AMIGA_DAT_PIN );
+    WritePin( AMIGA_DAT_PORT, AMIGA_DAT_PIN, TRUE );
     
     for( u32Wait = 0u; u32Wait < TIMEOUT_US/6u; u32Wait++ )
     {
@@ -178,25 +225,27 @@ static void SynchronizeCommunication( void )
       delay_us( 2u );  //TODO: not correct, according to the documentation, the ACK can be as short as 1us!
     }
   }
+  TRACE( TRACE_EVENT_RESYNC, 0u );
 
   // Update the state of the Caps lock LED
   if( TRUE == gbIsCapsLockOn )
   {
-    GPIO_WriteHigh( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN );
+    WritePin( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN, TRUE );
   }
   else
   {
-    GPIO_WriteLow( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN );
+    WritePin( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN, FALSE );
   }
 }
 
 /*! *******************************************************************
  * \brief  Sends the scancode to the Amiga computer
  * \param  u8Scancode: the scancode itself
+ * \param  bMeasure: TRUE, if the handshake is timed for the self-benchmark -- its end is waited for too
  * \return TRUE, if success; FALSE, if timeout occured
  * \note   Blocking function!
  *********************************************************************/
-static BOOL SendScancode( U8 u8Scancode )
+static BOOL SendScancode( U8 u8Scancode, BOOL bMeasure )
 {
   U32 u32Wait;
   BOOL bRet = FALSE;
@@ -216,27 +265,31 @@ static BOOL SendScancode( U8 u8Scancode )
   if( TRUE == bRet )
   {
     // pulse the data line before sending
-    GPIO_WriteLow( AMIGA_DAT_PORT, AMIGA_DAT_PIN );
+    WritePin( AMIGA_DAT_PORT, AMIGA_DAT_PIN, FALSE );
     delay_us( 20u );
-    GPIO_WriteHigh( AMIGA_DAT_PORT, AMIGA_DAT_PIN );
+    WritePin( AMIGA_DAT_PORT, AMIGA_DAT_PIN, TRUE );
     delay_us( 100u );  // TODO: where this came from?
     for( u8Index = 0u; u8Index < 8u; u8Index++ )
     {
       if( 0u == ( u8Scancode & (128u>>u8Index) ) )  // NOTE: data line is inverted!
       {
-        GPIO_WriteHigh( AMIGA_DAT_PORT, AMIGA_DAT_PIN );
+        WritePin( AMIGA_DAT_PORT, AMIGA_DAT_PIN, TRUE );
       }
       else
       {
-        GPIO_WriteLow( AMIGA_DAT_PORT, AMIGA_DAT_PIN );
+        WritePin( AMIGA_DAT_PORT, AMIGA_DAT_PIN, FALSE );
       }
       delay_us( 20u );
-      GPIO_WriteLow( AMIGA_CLK_PORT, AMIGA_CLK_PIN );
+      WritePin( AMIGA_CLK_PORT, AMIGA_CLK_PIN, FALSE );
       delay_us( 20u );
-      GPIO_WriteHigh( AMIGA_CLK_PORT, AMIGA_CLK_PIN );
+      WritePin( AMIGA_CLK_PORT, AMIGA_CLK_PIN, TRUE );
       delay_us( 20u );
     }
-    GPIO_WriteHigh( AMIGA_DAT_PORT, AMIGA_DAT_PIN );
+    WritePin( AMIGA_DAT_PORT, AMIGA_DAT_PIN, TRUE );
+    if( TRUE == bMeasure )
+    {
+      SelfBench_Mark( SELFBENCH_MARK_RELEASE );
+    }
     delay_us( 2u );
 
     bRet = FALSE;
@@ -248,6 +301,26 @@ static BOOL SendScancode( U8 u8Scancode )
         u32Wait = TIMEOUT_US;
         bRet = TRUE;
       }
+      if( TRUE == bMeasure )
+      {
+        SelfBench_Mark( SELFBENCH_MARK_ACK );
+      }
+    }
+
+    // the self-benchmark times the handshake until the computer releases KDAT
+    if( ( TRUE == bRet ) && ( TRUE == bMeasure ) )
+    {
+      bRet = FALSE;
+      for( u32Wait = 0u; u32Wait < TIMEOUT_US/6u; u32Wait++ )
+      {
+        delay_us( 2u );
+        if( RESET != GPIO_ReadInputPin( AMIGA_DAT_PORT, AMIGA_DAT_PIN ) )
+        {
+          u32Wait = TIMEOUT_US;
+          bRet = TRUE;
+        }
+        SelfBench_Mark( SELFBENCH_MARK_END );
+      }
     }
   }
 
@@ -266,14 +339,19 @@ static BOOL SendScancode( U8 u8Scancode )
  *********************************************************************/
 void AmigaKey_Init( void )
 {
-  // GPIO init
+  __istate_t sState;
+
+  // GPIO init -- called by AmigaKey_Reset() too, while the IT routine runs: GPIO_Init() modifies the output register
+  sState = __get_interrupt_state();
+  __disable_interrupt();
   GPIO_Init( AMIGA_CLK_PORT, (GPIO_Pin_TypeDef)AMIGA_CLK_PIN, GPIO_MODE_OUT_OD_HIZ_FAST );
   GPIO_Init( AMIGA_DAT_PORT, (GPIO_Pin_TypeDef)AMIGA_DAT_PIN, GPIO_MODE_OUT_OD_HIZ_FAST );
   GPIO_Init( AMIGA_RST_PORT, (GPIO_Pin_TypeDef)AMIGA_RST_PIN, GPIO_MODE_OUT_OD_HIZ_FAST );
   GPIO_Init( AMIGA_CAPSLED_PORT, (GPIO_Pin_TypeDef)AMIGA_CAPSLED_PIN, GPIO_MODE_OUT_PP_HIGH_FAST );
+  __set_interrupt_state( sState );
   
   // Switching on the Caps lock LED
-  GPIO_WriteHigh( AMIGA_CAPSLED_PORT, (GPIO_Pin_TypeDef)AMIGA_CAPSLED_PIN );
+  WritePin( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN, TRUE );
   
   // TODO: configure Timer 1 as edge counter
   
@@ -297,6 +375,7 @@ void AmigaKey_Init( void )
 void AmigaKey_Cycle( void )
 {
   U8 u8Scancode;
+  U8 u8Stream;
 
   // If the keyboard is out-of-sync, then resynchronize
   if( TRUE != gbIsSynchronized )
@@ -305,23 +384,49 @@ void AmigaKey_Cycle( void )
     SynchronizeCommunication();  // blocking call!
     if( TRUE == gbReTransmit )
     {
-      gbIsSynchronized = SendScancode( (AMIGA_LAST_KEYCODE_BAD<<1u) | 0x01u );  // so the computer knows, that the last scancode was bad
+      TRACE( TRACE_EVENT_RETRANSMIT, 0u );
+      gbIsSynchronized = SendScancode( (U8)( ( AMIGA_LAST_KEYCODE_BAD << 1u ) | 0x01u ), FALSE );  // so the computer knows, that the last scancode was bad
     }
   }
 
   // Sending scancodes
   if( TRUE == ReadScancodeFIFO( &u8Scancode ) )
   {
-    if( TRUE == SendScancode( u8Scancode ) )  // if the send succeeded
+    LATENCY_TRANSMIT( gsScancodeFIFO.u8ConsumeIndex );
+    if( TRUE == SendScancode( u8Scancode, FALSE ) )  // if the send succeeded
     {
+      LATENCY_ACKNOWLEDGE( gsScancodeFIFO.u8ConsumeIndex );
       RemoveElementFromScancodeFIFO();  //TODO: if this function returns with FALSE, then there is a huge error in somewhere...
     }
     else
     {
+      TRACE( TRACE_EVENT_SYNC_LOST, u8Scancode );
       gbIsSynchronized = FALSE;
       gbReTransmit = TRUE;
     }
   }
+  else
+  {
+    // Streams: one code per call, like the FIFO, so the matrix is scanned between two codes, and the keys typed
+    // meanwhile are sent before the next code of the stream
+    for( u8Stream = 0u; u8Stream < ( sizeof( gcsStreamTable ) / sizeof( gcsStreamTable[ 0 ] ) ); u8Stream++ )
+    {
+      if( ( TRUE == gbIsSynchronized ) && ( TRUE == gcsStreamTable[ u8Stream ].pfRead( &u8Scancode ) ) )
+      {
+        if( TRUE == SendScancode( u8Scancode, gcsStreamTable[ u8Stream ].bMeasure ) )
+        {
+          gcsStreamTable[ u8Stream ].pfRemove();
+        }
+        else  // the code is sent again after the resync
+        {
+          TRACE( TRACE_EVENT_SYNC_LOST, u8Scancode );
+          gbIsSynchronized = FALSE;
+          gbReTransmit = TRUE;
+        }
+        break;
+      }
+    }
+  }
 }
 
 /*! *******************************************************************
@@ -346,11 +451,11 @@ BOOL AmigaKey_RegisterScanCode( U8 u8Code, BOOL bIsPressed )
       // Switch the LED on or off
       if( TRUE == gbIsCapsLockOn )
       {
-        GPIO_WriteHigh( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN );
+        WritePin( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN, TRUE );
       }
       else
       {
-        GPIO_WriteLow( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN );
+        WritePin( AMIGA_CAPSLED_PORT, AMIGA_CAPSLED_PIN, FALSE );
       }
     }
     else
@@ -369,10 +474,15 @@ BOOL AmigaKey_RegisterScanCode( U8 u8Code, BOOL bIsPressed )
   if( u8NewIndex != gsScancodeFIFO.u8ConsumeIndex )  // if the FIFO is not full yet
   {
     // add the new element to the FIFO
+    LATENCY_ENQUEUE( gsScancodeFIFO.u8ProduceIndex );
     gsScancodeFIFO.au8ScancodeBuffer[ gsScancodeFIFO.u8ProduceIndex ] = ( u8Code << 1u ) | ( TRUE == bIsPressed ? 0u : 1u );  // Amiga communication format
     gsScancodeFIFO.u8ProduceIndex = u8NewIndex;
     bRet = TRUE;
   }
+  else
+  {
+    TRACE( TRACE_EVENT_FIFO_FULL, u8Code );
+  }
   
   return bRet;
 }
@@ -387,22 +497,23 @@ void AmigaKey_Reset( void )
 {
   U32 u32Wait;
   
+  TRACE( TRACE_EVENT_RESET, 0u );
   FlushScancodeFIFO();
   //TODO: send reset warning, wait and pull the reset line
   
   // Pull the reset line
-  GPIO_WriteLow( AMIGA_RST_PORT, AMIGA_RST_PIN );
+  WritePin( AMIGA_RST_PORT, AMIGA_RST_PIN, FALSE );
   
-  // Wait for at least 500 ms
-  for( u32Wait = 0u; u32Wait < 10u; u32Wait++ )
+  // Wait for at least 500 ms -- in steps, that fit the 16 bit count of the delay
+  for( u32Wait = 0u; u32Wait < ( 500000u / DELAY_US_MAX ) + 1u; u32Wait++ )
   {
-    delay_us( 50000u );
+    delay_us( DELAY_US_MAX );
   }
 
   //TODO: wait for releasing Ctrl+LAmiga+RAmiga
   
   // Release the reset line
-  GPIO_WriteHigh( AMIGA_RST_PORT, AMIGA_RST_PIN );
+  WritePin( AMIGA_RST_PORT, AMIGA_RST_PIN, TRUE );
 
   // Reset self -- there is no soft reset instruction on STM8, so unconditional jump will be used
 /*  disableInterrupts();
@@ -0,0 +1,525 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file boot.c
+*
+* \brief Bootloader -- in-system update of the application over KCLK and KDAT
+*
+* \note  Separate image in the boot area (Boot_project.ewp), built with RAM_EXECUTION: the block programming of the
+*        program flash runs from RAM. It starts the application, unless the boot chord of the layout is held at
+*        power-up, or the application is not complete.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include "stm8s.h"
+#include "types.h"
+#include "delay.h"
+#include "matrix.h"
+#include "layout.h"
+
+// Own include
+#include "boot.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define BOOT_CLK_PORT       (GPIOB)  //!< Same pins as in amiga_key.c
+#define BOOT_CLK_PIN        (GPIO_PIN_0)
+#define BOOT_DAT_PORT       (GPIOB)
+#define BOOT_DAT_PIN        (GPIO_PIN_1)
+
+#define BOOT_TIMEOUT_US     143000u  //!< Handshake of the computer, as in amiga_key.c
+#define BOOT_GAP_POLLS      1000u    //!< Polls of KCLK without an edge (1..2 ms), that end a frame in progress
+#define BOOT_CHORD_SAMPLES  2u       //!< Reads of the boot chord, 5 ms apart -- all of them must find it held
+
+#if ( ( ( BOOT_APP_END - BOOT_APP_ADDRESS ) % BOOT_BLOCK_SIZE ) != 0u ) || ( BOOT_APP_END > ( BOOT_FLASH_START + BOOT_FLASH_SIZE ) )
+#error "The application must be whole blocks of the program flash"
+#endif
+
+// Start of the application. On the target, a call to its reset vector (an INT instruction, that jumps to the startup
+// code of the application). The updater of the host simulation defines the hook, and stops the simulated CPU there.
+#ifdef BOOT_START_HOOK
+void BOOT_START_HOOK( void );
+#define BOOT_START_APPLICATION()  BOOT_START_HOOK()
+#else
+#define BOOT_START_APPLICATION()  ( (BOOT_APPLICATION)BOOT_APP_ADDRESS )()
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+typedef void (*BOOT_APPLICATION)( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Keys of the boot chord (bitfield, 1 means the key must be pressed), generated with the layout
+static const U_MATRIX_BITMAP gcuBootChord = LAYOUT_CHORD_BOOT;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static U8   gau8Frame[ BOOT_FRAME_MAX ];          //!< Frame being received
+static U8   gau8FirstBlock[ BOOT_BLOCK_SIZE ];    //!< Block 0 of the application, programmed last
+static BOOL gbFirstBlockKept;                     //!< gau8FirstBlock holds a block, not programmed yet
+static BOOL gbRun;                                //!< The application is complete, and may be started
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void SetColumn( U8 u8Column );
+static BOOL IsChordHeld( void );
+static BOOL IsApplicationValid( void );
+static void Synchronize( void );
+static BOOL SendByte( U8 u8Byte );
+static void SendReply( U8 u8Reply );
+static BOOL WaitClock( BOOL bHigh, U16 u16Polls );
+static BOOL ReceiveByte( U8* pu8Byte );
+static U8   ReceiveFrame( void );
+static void SkipFrame( void );
+static U16  Crc16( const U8* pu8Data, U8 u8Length );
+static BOOL EraseBlock( U8 u8Block );
+static BOOL ProgramBlock( U8 u8Block, U8* pu8Data );
+static U8   ExecuteFrame( U8 u8Length );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Drives a column of the matrix low, the others are released -- see SetColumn() in matrix.c
+ * \param  u8Column: the column
+ * \return -
+ *********************************************************************/
+static void SetColumn( U8 u8Column )
+{
+  U8 u8Port;
+
+  for( u8Port = 0u; u8Port < LAYOUT_COLUMN_PORTS; u8Port++ )
+  {
+    GPIO_Write( gcapsColumnPorts[ u8Port ], (U8)( ( GPIO_ReadOutputData( gcapsColumnPorts[ u8Port ] ) & (U8)~gcau8ColumnPortMask[ u8Port ] )
+                                                  | gcau8ColumnPortImage[ u8Column ][ u8Port ] ) );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Is the boot chord held?
+ * \param  -
+ * \return TRUE, if every key of the chord is read pressed in every sample
+ * \note   Only the columns of the chord are driven, there is no ghost key test: the chord must not complete a
+ *         rectangle of keys on a matrix without diodes.
+ *********************************************************************/
+static BOOL IsChordHeld( void )
+{
+  U8   u8Index;
+  U8   u8Sample;
+  U8   u8Rows;
+  BOOL bRet = TRUE;
+
+  for( u8Index = 0u; u8Index < LAYOUT_ROWS; u8Index++ )
+  {
+    GPIO_Init( gcsKeyMatrixRows[ u8Index ].psGPIOPort, gcsKeyMatrixRows[ u8Index ].ePin, GPIO_MODE_IN_FL_NO_IT );
+  }
+  for( u8Index = 0u; u8Index < LAYOUT_COLS; u8Index++ )
+  {
+    GPIO_Init( gcsKeyMatrixColumns[ u8Index ].psGPIOPort, gcsKeyMatrixColumns[ u8Index ].ePin, GPIO_MODE_OUT_OD_HIZ_FAST );
+  }
+
+  for( u8Sample = 0u; u8Sample < BOOT_CHORD_SAMPLES; u8Sample++ )
+  {
+    delay_us( 5000u );
+    for( u8Index = 0u; u8Index < LAYOUT_COLS; u8Index++ )
+    {
+      if( 0u != gcuBootChord.au8Column[ u8Index ] )
+      {
+        SetColumn( u8Index );
+        delay_us( 10u );  // the row lines settle
+        u8Rows = Layout_ReadRows();
+        if( 0u != ( u8Rows & gcuBootChord.au8Column[ u8Index ] ) )  // 1 means not pressed
+        {
+          bRet = FALSE;
+        }
+      }
+    }
+  }
+
+  // every column released again
+  for( u8Index = 0u; u8Index < LAYOUT_COLS; u8Index++ )
+  {
+    GPIO_WriteHigh( gcsKeyMatrixColumns[ u8Index ].psGPIOPort, gcsKeyMatrixColumns[ u8Index ].ePin );
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Is there a complete application?
+ * \param  -
+ * \return TRUE, if its block 0 is programmed -- it is erased at the start of an update, and programmed at the end
+ *********************************************************************/
+static BOOL IsApplicationValid( void )
+{
+  return ( BOOT_APP_MARK == FLASH_ReadByte( BOOT_APP_ADDRESS ) ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Synchronizes the communication with the computer -- see SynchronizeCommunication() in amiga_key.c
+ * \param  -
+ * \return -
+ * \note   Blocking function!
+ *********************************************************************/
+static void Synchronize( void )
+{
+  U32  u32Wait;
+  BOOL bSynchronized = FALSE;
+
+  while( FALSE == bSynchronized )
+  {
+    GPIO_WriteLow( BOOT_DAT_PORT, BOOT_DAT_PIN );  // NOTE: data line is inverted!
+    delay_us( 20u );
+    GPIO_WriteLow( BOOT_CLK_PORT, BOOT_CLK_PIN );
+    delay_us( 20u );
+    GPIO_WriteHigh( BOOT_CLK_PORT, BOOT_CLK_PIN );
+    delay_us( 20u );
+    GPIO_WriteHigh( BOOT_DAT_PORT, BOOT_DAT_PIN );
+
+    for( u32Wait = 0u; u32Wait < BOOT_TIMEOUT_US/6u; u32Wait++ )
+    {
+      if( RESET == GPIO_ReadInputPin( BOOT_DAT_PORT, BOOT_DAT_PIN ) )
+      {
+        bSynchronized = TRUE;
+        u32Wait = BOOT_TIMEOUT_US;
+      }
+      delay_us( 2u );
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Sends a byte to the computer, like a key code -- see SendScancode() in amiga_key.c
+ * \param  u8Byte: the byte
+ * \return TRUE, if the computer gave the handshake; FALSE, if timeout occured
+ * \note   Blocking function!
+ *********************************************************************/
+static BOOL SendByte( U8 u8Byte )
+{
+  U32  u32Wait;
+  BOOL bRet = FALSE;
+  U8   u8Index;
+
+  for( u32Wait = 0u; u32Wait < BOOT_TIMEOUT_US/6u; u32Wait++ )
+  {
+    delay_us( 2u );
+    if( RESET != GPIO_ReadInputPin( BOOT_DAT_PORT, BOOT_DAT_PIN ) )  // the handshake of the previous byte is over
+    {
+      u32Wait = BOOT_TIMEOUT_US;
+      bRet = TRUE;
+    }
+  }
+
+  if( TRUE == bRet )
+  {
+    for( u8Index = 0u; u8Index < 8u; u8Index++ )
+    {
+      if( 0u == ( u8Byte & (128u>>u8Index) ) )  // NOTE: data line is inverted!
+      {
+        GPIO_WriteHigh( BOOT_DAT_PORT, BOOT_DAT_PIN );
+      }
+      else
+      {
+        GPIO_WriteLow( BOOT_DAT_PORT, BOOT_DAT_PIN );
+      }
+      delay_us( 20u );
+      GPIO_WriteLow( BOOT_CLK_PORT, BOOT_CLK_PIN );
+      delay_us( 20u );
+      GPIO_WriteHigh( BOOT_CLK_PORT, BOOT_CLK_PIN );
+      delay_us( 20u );
+    }
+    GPIO_WriteHigh( BOOT_DAT_PORT, BOOT_DAT_PIN );
+    delay_us( 2u );
+
+    bRet = FALSE;
+    for( u32Wait = 0u; u32Wait < BOOT_TIMEOUT_US/6u; u32Wait++ )
+    {
+      delay_us( 2u );
+      if( RESET == GPIO_ReadInputPin( BOOT_DAT_PORT, BOOT_DAT_PIN ) )
+      {
+        u32Wait = BOOT_TIMEOUT_US;
+        bRet = TRUE;
+      }
+    }
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Sends an answer to the computer
+ * \param  u8Reply: BOOT_REPLY_x
+ * \return -
+ * \note   Blocking function! Without handshake, the communication is synchronized again, and the answer repeated.
+ *********************************************************************/
+static void SendReply( U8 u8Reply )
+{
+  while( FALSE == SendByte( u8Reply ) )
+  {
+    Synchronize();
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Waits for a level of KCLK, driven by the computer
+ * \param  bHigh: TRUE for the high level
+ * \param  u16Polls: reads of the line at most
+ * \return TRUE, if the level came
+ *********************************************************************/
+static BOOL WaitClock( BOOL bHigh, U16 u16Polls )
+{
+  BOOL bLevel = ( RESET != GPIO_ReadInputPin( BOOT_CLK_PORT, BOOT_CLK_PIN ) ) ? TRUE : FALSE;
+
+  while( ( bHigh != bLevel ) && ( 0u != u16Polls ) )
+  {
+    u16Polls--;
+    bLevel = ( RESET != GPIO_ReadInputPin( BOOT_CLK_PORT, BOOT_CLK_PIN ) ) ? TRUE : FALSE;
+  }
+
+  return ( bHigh == bLevel ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Shifts in a byte sent by the computer
+ * \param  pu8Byte: the byte will be put here
+ * \return TRUE, if all the 8 bits came; FALSE, if KCLK stopped
+ *********************************************************************/
+static BOOL ReceiveByte( U8* pu8Byte )
+{
+  U8   u8Index;
+  U8   u8Byte = 0u;
+  BOOL bRet = TRUE;
+
+  for( u8Index = 0u; ( u8Index < 8u ) && ( TRUE == bRet ); u8Index++ )
+  {
+    bRet = WaitClock( FALSE, BOOT_GAP_POLLS );
+    if( TRUE == bRet )
+    {
+      bRet = WaitClock( TRUE, BOOT_GAP_POLLS );
+      u8Byte = (U8)( u8Byte << 1u ) | ( ( RESET != GPIO_ReadInputPin( BOOT_DAT_PORT, BOOT_DAT_PIN ) ) ? 1u : 0u );
+    }
+  }
+  *pu8Byte = u8Byte;
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Receives a frame of the computer
+ * \param  -
+ * \return Length of the frame in gau8Frame, 0 if it was cut
+ * \note   Blocking function! The first falling edge of KCLK starts the frame, that may take any time.
+ *********************************************************************/
+static U8 ReceiveFrame( void )
+{
+  U8   u8Length = 0u;
+  U8   u8Expected = BOOT_FRAME_SHORT;
+  BOOL bOk = TRUE;
+
+  while( FALSE == WaitClock( FALSE, BOOT_GAP_POLLS ) )
+  {
+  }
+
+  while( ( TRUE == bOk ) && ( u8Length < u8Expected ) )
+  {
+    bOk = ReceiveByte( &gau8Frame[ u8Length ] );
+    if( ( 0u == u8Length ) && ( BOOT_CMD_WRITE == gau8Frame[ 0u ] ) )
+    {
+      u8Expected = BOOT_FRAME_MAX;
+    }
+    u8Length++;
+  }
+
+  return ( TRUE == bOk ) ? u8Length : 0u;
+}
+
+/*! *******************************************************************
+ * \brief  Waits until the computer stops clocking -- the rest of a damaged frame is dropped
+ * \param  -
+ * \return -
+ *********************************************************************/
+static void SkipFrame( void )
+{
+  while( TRUE == WaitClock( FALSE, BOOT_GAP_POLLS ) )
+  {
+    WaitClock( TRUE, BOOT_GAP_POLLS );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  CRC-16/CCITT-FALSE
+ * \param  pu8Data: the bytes
+ * \param  u8Length: number of bytes
+ * \return The CRC
+ *********************************************************************/
+static U16 Crc16( const U8* pu8Data, U8 u8Length )
+{
+  U16 u16Crc = BOOT_CRC_INIT;
+  U8  u8Index;
+  U8  u8Bit;
+
+  for( u8Index = 0u; u8Index < u8Length; u8Index++ )
+  {
+    u16Crc ^= (U16)pu8Data[ u8Index ] << 8u;
+    for( u8Bit = 0u; u8Bit < 8u; u8Bit++ )
+    {
+      u16Crc = ( 0u != ( u16Crc & 0x8000u ) ) ? (U16)( ( u16Crc << 1u ) ^ BOOT_CRC_POLY ) : (U16)( u16Crc << 1u );
+    }
+  }
+
+  return u16Crc;
+}
+
+/*! *******************************************************************
+ * \brief  Erases a block of the application
+ * \param  u8Block: block of the application (0 is at BOOT_APP_ADDRESS)
+ * \return TRUE, if success
+ *********************************************************************/
+static BOOL EraseBlock( U8 u8Block )
+{
+  BOOL bRet;
+
+  FLASH_Unlock( FLASH_MEMTYPE_PROG );
+  FLASH_EraseBlock( BOOT_APP_FIRST_BLOCK + u8Block, FLASH_MEMTYPE_PROG );
+  bRet = ( FLASH_STATUS_SUCCESSFUL_OPERATION == FLASH_WaitForLastOperation( FLASH_MEMTYPE_PROG ) ) ? TRUE : FALSE;
+  FLASH_Lock( FLASH_MEMTYPE_PROG );
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Programs a block of the application, and reads it back
+ * \param  u8Block: block of the application (0 is at BOOT_APP_ADDRESS)
+ * \param  pu8Data: BOOT_BLOCK_SIZE bytes
+ * \return TRUE, if the block holds the data
+ *********************************************************************/
+static BOOL ProgramBlock( U8 u8Block, U8* pu8Data )
+{
+  U16  u16Address = BOOT_APP_ADDRESS + ( (U16)u8Block * BOOT_BLOCK_SIZE );
+  U8   u8Index;
+  BOOL bRet;
+
+  FLASH_Unlock( FLASH_MEMTYPE_PROG );
+  FLASH_ProgramBlock( BOOT_APP_FIRST_BLOCK + u8Block, FLASH_MEMTYPE_PROG, FLASH_PROGRAMMODE_STANDARD, pu8Data );
+  bRet = ( FLASH_STATUS_SUCCESSFUL_OPERATION == FLASH_WaitForLastOperation( FLASH_MEMTYPE_PROG ) ) ? TRUE : FALSE;
+  FLASH_Lock( FLASH_MEMTYPE_PROG );
+
+  for( u8Index = 0u; u8Index < BOOT_BLOCK_SIZE; u8Index++ )
+  {
+    if( pu8Data[ u8Index ] != FLASH_ReadByte( u16Address + u8Index ) )
+    {
+      bRet = FALSE;
+    }
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Checks and executes a received frame
+ * \param  u8Length: length of the frame in gau8Frame (at least BOOT_FRAME_SHORT)
+ * \return Answer to the computer, BOOT_REPLY_x
+ * \note   Block 0 holds the reset vector of the application: it is erased at its arrival, and programmed only by
+ *         BOOT_CMD_RUN -- an update cut by a power loss leaves no startable application behind.
+ *********************************************************************/
+static U8 ExecuteFrame( U8 u8Length )
+{
+  U8   u8Reply = BOOT_REPLY_BAD_CRC;
+  U8   u8Block = gau8Frame[ 1u ];
+  BOOL bOk = FALSE;
+
+  if( Crc16( gau8Frame, u8Length - 2u ) == ( ( (U16)gau8Frame[ u8Length - 2u ] << 8u ) | gau8Frame[ u8Length - 1u ] ) )
+  {
+    if( ( BOOT_CMD_WRITE == gau8Frame[ 0u ] ) && ( u8Block < BOOT_APP_BLOCKS ) )
+    {
+      if( 0u == u8Block )
+      {
+        memcpy( gau8FirstBlock, &gau8Frame[ 2u ], BOOT_BLOCK_SIZE );
+        gbFirstBlockKept = TRUE;
+        bOk = EraseBlock( 0u );
+      }
+      else
+      {
+        bOk = ProgramBlock( u8Block, &gau8Frame[ 2u ] );
+      }
+    }
+    else if( BOOT_CMD_RUN == gau8Frame[ 0u ] )
+    {
+      if( TRUE == gbFirstBlockKept )
+      {
+        gbFirstBlockKept = FALSE;
+        ProgramBlock( 0u, gau8FirstBlock );
+      }
+      bOk = IsApplicationValid();
+      gbRun = bOk;
+    }
+    else
+    {
+      // unknown command, or the block is outside the application (at or after BOOT_APP_END)
+    }
+    u8Reply = ( TRUE == bOk ) ? BOOT_REPLY_ACK : BOOT_REPLY_REFUSED;
+  }
+
+  return u8Reply;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void main( void )
+{
+  U8 u8Length;
+  U8 u8Reply;
+
+  // Clock init -- after reset, internal 2 MHz is configured as CPU clock
+  CLK_SYSCLKConfig( CLK_PRESCALER_HSIDIV1 );
+
+  GPIO_Init( BOOT_CLK_PORT, (GPIO_Pin_TypeDef)BOOT_CLK_PIN, GPIO_MODE_OUT_OD_HIZ_FAST );
+  GPIO_Init( BOOT_DAT_PORT, (GPIO_Pin_TypeDef)BOOT_DAT_PIN, GPIO_MODE_OUT_OD_HIZ_FAST );
+  gbFirstBlockKept = FALSE;
+  gbRun = FALSE;
+
+  if( ( TRUE == IsChordHeld() ) || ( FALSE == IsApplicationValid() ) )
+  {
+    Synchronize();
+    SendReply( BOOT_REPLY_READY );
+    while( FALSE == gbRun )
+    {
+      u8Length = ReceiveFrame();
+      if( 0u != u8Length )  // a cut frame is not answered: the computer sends it again after a timeout
+      {
+        u8Reply = ExecuteFrame( u8Length );
+        if( BOOT_REPLY_BAD_CRC == u8Reply )
+        {
+          SkipFrame();  // a damaged command may have shortened the frame
+        }
+        SendReply( u8Reply );
+      }
+    }
+  }
+
+  BOOT_START_APPLICATION();
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,71 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file boot.h
+*
+* \brief Bootloader -- memory layout and the update protocol over KCLK and KDAT
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef BOOT_H_INCLUDED
+#define BOOT_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Memory layout: the bootloader occupies the first BOOT_SIZE bytes of the program flash (write protected with the UBC
+// option byte), the application is linked after it, up to BOOT_APP_END, see boot.icf and ../app.icf (the regions of
+// the code there must match these)
+#define BOOT_FLASH_START        0x8000u
+#define BOOT_FLASH_SIZE         0x2000u
+#define BOOT_SIZE               0x0600u  //!< 24 blocks, UBC = 24 pages
+#define BOOT_BLOCK_SIZE         64u      //!< FLASH_BLOCK_SIZE of the STM8S003
+#define BOOT_APP_ADDRESS        ( BOOT_FLASH_START + BOOT_SIZE )              //!< Vector table of the application
+#define BOOT_APP_END            ( BOOT_FLASH_START + BOOT_FLASH_SIZE )        //!< End of the application (the first byte after it)
+#define BOOT_APP_FIRST_BLOCK    ( BOOT_SIZE / BOOT_BLOCK_SIZE )               //!< Block number of BOOT_APP_ADDRESS
+#define BOOT_APP_BLOCKS         ( ( BOOT_APP_END - BOOT_APP_ADDRESS ) / BOOT_BLOCK_SIZE )  //!< Blocks of the application, the frames of the others are refused
+#define BOOT_APP_MARK           0x82u    //!< First byte of a programmed application: INT opcode of its reset vector
+
+// Frames of the computer, shifted out by the serial port of the CIA (KCLK: clock, KDAT: data, not inverted, most
+// significant bit first, sampled at the rising edge of KCLK): command, block, data (BOOT_CMD_WRITE only), then the
+// CRC-16 of the previous bytes, most significant byte first.
+#define BOOT_CMD_WRITE          0x57u    //!< Programs a block of the application (block 0 is kept until BOOT_CMD_RUN)
+#define BOOT_CMD_RUN            0x52u    //!< Programs the kept block 0, and starts the application
+#define BOOT_FRAME_SHORT        4u       //!< Length of a frame without data
+#define BOOT_FRAME_MAX          ( BOOT_FRAME_SHORT + BOOT_BLOCK_SIZE )
+#define BOOT_CRC_INIT           0xFFFFu  //!< CRC-16/CCITT-FALSE
+#define BOOT_CRC_POLY           0x1021u
+
+// Answers of the keyboard, sent like key codes (as raw bytes, with the handshake of the computer)
+#define BOOT_REPLY_READY        0xB0u    //!< The bootloader is waiting for frames, after the synchronization
+#define BOOT_REPLY_ACK          0xB2u    //!< Frame executed
+#define BOOT_REPLY_BAD_CRC      0xB4u    //!< Frame damaged, send it again
+#define BOOT_REPLY_REFUSED      0xB6u    //!< Unknown command, block outside the application, or programming failed
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+#endif // BOOT_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,90 @@
+                NAME boot_vectors
+                
+                
+                
+                RTMODEL "__SystemLibrary", "DLib"
+                RTMODEL "__code_model", "small"
+                RTMODEL "__core", "stm8"
+                RTMODEL "__data_model", "medium"
+                RTMODEL "__rt_version", "4"
+
+                EXTERN __iar_program_start
+                
+                
+                
+                PUBLIC  __intvec
+
+                
+// Vector table of the bootloader, instead of the one of the runtime library. The reset starts the bootloader, every
+// interrupt jumps to the same entry of the vector table of the application -- see BOOT_APP_ADDRESS in boot.h.
+BOOT_APP_ADDRESS EQU 0x8600
+
+
+
+                SECTION `.intvec`:CONST:ROOT(0)
+__intvec:       DC8  0x82
+                DC24 __iar_program_start      // RESET
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 4     // TRAP
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 8     // IRQ0
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 12    // IRQ1
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 16    // IRQ2
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 20    // IRQ3
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 24    // IRQ4
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 28    // IRQ5
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 32    // IRQ6
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 36    // IRQ7
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 40    // IRQ8
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 44    // IRQ9
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 48    // IRQ10
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 52    // IRQ11
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 56    // IRQ12
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 60    // IRQ13
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 64    // IRQ14
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 68    // IRQ15
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 72    // IRQ16
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 76    // IRQ17
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 80    // IRQ18
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 84    // IRQ19
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 88    // IRQ20
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 92    // IRQ21
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 96    // IRQ22
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 100   // IRQ23
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 104   // IRQ24
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 108   // IRQ25
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 112   // IRQ26
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 116   // IRQ27
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 120   // IRQ28
+                DC8  0x82
+                DC24 BOOT_APP_ADDRESS + 124   // IRQ29
+
+                END
@@ -0,0 +1,153 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file chord.c
+*
+* \brief Key combination (chord) engine
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "types.h"
+#include "matrix.h"
+#include "amiga_key.h"
+#include "keymap.h"
+#include "macro.h"
+#include "selfbench.h"
+#include "layout.h"
+
+// Own include
+#include "chord.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define CHORD_COUNT   7u   //!< Number of key combinations in the chord table (max. 8)
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Element of the chord table
+typedef struct
+{
+  U_MATRIX_BITMAP uMask;     //!< Keys of the combination (bitfield, 1 means the key must be pressed)
+  CHORD_ACTION    pfAction;  //!< Called once, when the combination becomes pressed
+} S_CHORD_DESC;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void ActivateBaseLayer( void );
+static void ActivateSwapLayer( void );
+static void ActivateEepromLayer( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Key combinations
+//! \note  The masks are generated with the layout, see fw/layouts/
+static const S_CHORD_DESC gcsChordTable[ CHORD_COUNT ] =
+{
+  { LAYOUT_CHORD_RESET,        AmigaKey_Reset },         // Ctrl + LAmiga + RAmiga
+  { LAYOUT_CHORD_LAYER_BASE,   ActivateBaseLayer },      // LAmiga + RAmiga + F1
+  { LAYOUT_CHORD_LAYER_SWAP,   ActivateSwapLayer },      // LAmiga + RAmiga + F2
+  { LAYOUT_CHORD_LAYER_USER,   ActivateEepromLayer },    // LAmiga + RAmiga + F3
+  { LAYOUT_CHORD_MACRO_RECORD, Macro_RequestRecord },    // LAmiga + RAmiga + F9: start / stop recording
+  { LAYOUT_CHORD_MACRO_PLAY,   Macro_RequestPlay },      // LAmiga + RAmiga + F10
+  { LAYOUT_CHORD_SELFBENCH,    SelfBench_RequestRun }    // LAmiga + RAmiga + F5: handshake self-benchmark
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static U8 gu8ActiveChords;  //!< Combinations being held (bitfield, bit n belongs to the nth element of the chord table)
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Chord actions: keymap layer selection
+ * \param  -
+ * \return -
+ *********************************************************************/
+static void ActivateBaseLayer( void )
+{
+  Keymap_RequestLayer( KEYMAP_LAYER_BASE );
+}
+
+static void ActivateSwapLayer( void )
+{
+  Keymap_RequestLayer( KEYMAP_LAYER_SWAP );
+}
+
+static void ActivateEepromLayer( void )
+{
+  Keymap_RequestLayer( KEYMAP_LAYER_EEPROM );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init
+ * \param  -
+ * \return -
+ *********************************************************************/
+void Chord_Init( void )
+{
+  gu8ActiveChords = 0u;
+}
+
+/*! *******************************************************************
+ * \brief  Matches the chord table against the state of the matrix
+ * \param  puState: state of the keys after a complete scan (0 means pressed)
+ * \return -
+ * \note   Called from the IT routine, only on scans where the state has changed.
+ *         The action is called once per press of the combination.
+ *********************************************************************/
+void Chord_Evaluate( const U_MATRIX_BITMAP* puState )
+{
+  U8   u8Chord;
+  U8   u8Word;
+  U8   u8Active = 0u;
+  BOOL bMatch;
+  
+  for( u8Chord = 0u; u8Chord < CHORD_COUNT; u8Chord++ )
+  {
+    // every key of the mask must read 0 (pressed)
+    bMatch = TRUE;
+    for( u8Word = 0u; ( u8Word < ( MATRIX_COL / 2u ) ) && ( TRUE == bMatch ); u8Word++ )
+    {
+      if( 0u != ( puState->au16Word[ u8Word ] & gcsChordTable[ u8Chord ].uMask.au16Word[ u8Word ] ) )
+      {
+        bMatch = FALSE;
+      }
+    }
+    
+    if( TRUE == bMatch )
+    {
+      u8Active |= (1u<<u8Chord);
+      if( 0u == ( gu8ActiveChords & (1u<<u8Chord) ) )  // it has just been pressed
+      {
+        gcsChordTable[ u8Chord ].pfAction();
+      }
+    }
+  }
+  
+  gu8ActiveChords = u8Active;
+}
+
+/******************************<EOF>**********************************/
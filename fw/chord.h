@@ -0,0 +1,48 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file chord.h
+*
+* \brief Key combination (chord) engine
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef CHORD_H_INCLUDED
+#define CHORD_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "matrix.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Action of a key combination, called when all of its keys got pressed
+typedef void (*CHORD_ACTION)( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Chord_Init( void );
+void Chord_Evaluate( const U_MATRIX_BITMAP* puState );
+
+
+#endif // CHORD_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,301 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file config.c
+*
+* \brief Persistent configuration, stored as a log in the data EEPROM
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include "stm8s.h"
+#include "types.h"
+#include "matrix.h"
+#include "eeprom_map.h"
+
+// Own include
+#include "config.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// The configuration area is a circular log of 4-byte records, every record is written with one word program:
+//   byte 0: key (high nibble) and check (low nibble)
+//   byte 1: sequence number, incremented by every written record
+//   byte 2: value (MSB)
+//   byte 3: value (LSB)
+// The record with the newest sequence number is valid for a key. The log is written slot by slot, and the
+// slots of live records are skipped, so a live record is never overwritten (a power loss can't destroy it).
+// Rarely changed values are rewritten after CONFIG_REFRESH_AGE records, this keeps every record within a
+// window, where the 8-bit sequence numbers can be compared with wrap-around.
+#define CONFIG_RECORD_SIZE    4u
+#define CONFIG_SLOT_COUNT     ( EEPROM_CONFIG_SIZE / CONFIG_RECORD_SIZE )  //!< (must be more than CONFIG_KEY_COUNT)
+#define CONFIG_REFRESH_AGE    64u
+#define CONFIG_CHECK_SEED     0x0Au
+#define CONFIG_NO_SLOT        0xFFu
+
+#if ( CONFIG_SLOT_COUNT <= CONFIG_KEY_COUNT )
+#error "The configuration log needs a free slot besides the live records"
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+//! \brief RAM index of the log -- reads never touch the EEPROM
+static struct
+{
+  U16 au16Value[ CONFIG_KEY_COUNT ];    //!< Latest value of the keys
+  U8  au8Slot[ CONFIG_KEY_COUNT ];      //!< Slot holding the latest record of the key (CONFIG_NO_SLOT, if there is none)
+  U8  au8Sequence[ CONFIG_KEY_COUNT ];  //!< Sequence number of the latest record of the key
+  U8  u8Dirty;                          //!< Values not written to the EEPROM yet (bitfield, bit n belongs to key n)
+  U8  u8Head;                           //!< Slot of the next record
+  U8  u8Sequence;                       //!< Sequence number of the next record
+} gsConfig;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U8   CalculateCheck( U8 u8Key, U8 u8Sequence, U16 u16Value );
+static BOOL IsLiveSlot( U8 u8Slot );
+static void WriteRecord( U8 u8Key );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Calculates the check nibble of a record
+ * \param  u8Key: key of the record
+ * \param  u8Sequence: sequence number of the record
+ * \param  u16Value: value of the record
+ * \return Check nibble (0..15)
+ *********************************************************************/
+static U8 CalculateCheck( U8 u8Key, U8 u8Sequence, U16 u16Value )
+{
+  U8 u8Check;
+  
+  u8Check = u8Key ^ u8Sequence ^ (U8)( u16Value >> 8u ) ^ (U8)u16Value;
+  u8Check = ( u8Check ^ ( u8Check >> 4u ) ^ CONFIG_CHECK_SEED ) & 0x0Fu;
+  
+  return u8Check;
+}
+
+/*! *******************************************************************
+ * \brief  Checks, whether a slot holds the latest record of a key
+ * \param  u8Slot: slot to check
+ * \return TRUE, if the slot must not be overwritten
+ *********************************************************************/
+static BOOL IsLiveSlot( U8 u8Slot )
+{
+  U8   u8Key;
+  BOOL bRet = FALSE;
+  
+  for( u8Key = 1u; u8Key < CONFIG_KEY_COUNT; u8Key++ )
+  {
+    if( u8Slot == gsConfig.au8Slot[ u8Key ] )
+    {
+      bRet = TRUE;
+    }
+  }
+  
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Appends the value of a key to the log
+ * \param  u8Key: key to write
+ * \return -
+ * \note   Blocking function, one word program takes a few milliseconds!
+ *********************************************************************/
+static void WriteRecord( U8 u8Key )
+{
+  U8  u8Slot;
+  U16 u16Value;
+  U32 u32Record;
+  
+  u8Slot   = gsConfig.u8Head;
+  u16Value = gsConfig.au16Value[ u8Key ];
+  
+  u32Record = ( (U32)( ( u8Key << 4u ) | CalculateCheck( u8Key, gsConfig.u8Sequence, u16Value ) ) << 24u )
+            | ( (U32)gsConfig.u8Sequence << 16u )
+            | (U32)u16Value;
+  
+  FLASH_Unlock( FLASH_MEMTYPE_DATA );
+  FLASH_ProgramWord( EEPROM_CONFIG_ADDRESS + ( u8Slot * CONFIG_RECORD_SIZE ), u32Record );  // the first byte goes to the lowest address
+  FLASH_WaitForLastOperation( FLASH_MEMTYPE_DATA );
+  FLASH_Lock( FLASH_MEMTYPE_DATA );
+  
+  gsConfig.au8Slot[ u8Key ]     = u8Slot;
+  gsConfig.au8Sequence[ u8Key ] = gsConfig.u8Sequence;
+  gsConfig.u8Sequence++;
+  gsConfig.u8Head++;
+  if( CONFIG_SLOT_COUNT == gsConfig.u8Head )
+  {
+    gsConfig.u8Head = 0u;
+  }
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init -- scans the log and builds the RAM index
+ * \param  -
+ * \return -
+ * \note   Must be called before any other function of the module!
+ *********************************************************************/
+void Config_Init( void )
+{
+  U8   u8Slot;
+  U8   u8Key;
+  U8   u8Sequence;
+  U16  u16Value;
+  U32  u32Address;
+  U8   u8Newest = CONFIG_NO_SLOT;
+  U8   u8NewestSequence = 0u;
+  
+  memset( (void*)&gsConfig, 0x00u, sizeof( gsConfig ) );
+  memset( (void*)gsConfig.au8Slot, CONFIG_NO_SLOT, sizeof( gsConfig.au8Slot ) );
+  
+  for( u8Slot = 0u; u8Slot < CONFIG_SLOT_COUNT; u8Slot++ )
+  {
+    u32Address = EEPROM_CONFIG_ADDRESS + ( u8Slot * CONFIG_RECORD_SIZE );
+    u8Key      = FLASH_ReadByte( u32Address ) >> 4u;
+    u8Sequence = FLASH_ReadByte( u32Address + 1u );
+    u16Value   = ( (U16)FLASH_ReadByte( u32Address + 2u ) << 8u ) | FLASH_ReadByte( u32Address + 3u );
+    
+    // erased, unknown or torn records are skipped
+    if( ( 0u != u8Key ) && ( u8Key < CONFIG_KEY_COUNT )
+     && ( ( FLASH_ReadByte( u32Address ) & 0x0Fu ) == CalculateCheck( u8Key, u8Sequence, u16Value ) ) )
+    {
+      // sequence numbers are compared with wrap-around: all the records are within CONFIG_REFRESH_AGE + CONFIG_SLOT_COUNT writes
+      if( ( CONFIG_NO_SLOT == gsConfig.au8Slot[ u8Key ] ) || ( (U8)( u8Sequence - gsConfig.au8Sequence[ u8Key ] ) < 0x80u ) )
+      {
+        gsConfig.au8Slot[ u8Key ]     = u8Slot;
+        gsConfig.au8Sequence[ u8Key ] = u8Sequence;
+        gsConfig.au16Value[ u8Key ]   = u16Value;
+      }
+      if( ( CONFIG_NO_SLOT == u8Newest ) || ( (U8)( u8Sequence - u8NewestSequence ) < 0x80u ) )
+      {
+        u8Newest         = u8Slot;
+        u8NewestSequence = u8Sequence;
+      }
+    }
+  }
+  
+  // continue the log after the newest record
+  if( CONFIG_NO_SLOT != u8Newest )
+  {
+    gsConfig.u8Sequence = u8NewestSequence + 1u;
+    gsConfig.u8Head     = u8Newest + 1u;
+    if( CONFIG_SLOT_COUNT == gsConfig.u8Head )
+    {
+      gsConfig.u8Head = 0u;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Main cycle -- writes the changed values to the EEPROM
+ * \param  -
+ * \return -
+ * \note   Must be called from main cycle! Writes at most one record per call, and only when the keyboard is idle.
+ *********************************************************************/
+void Config_Cycle( void )
+{
+  U8 u8Key;
+  
+  if( ( 0u != gsConfig.u8Dirty ) && ( TRUE == Matrix_IsIdle() ) )
+  {
+    // refresh the records getting too old
+    for( u8Key = 1u; u8Key < CONFIG_KEY_COUNT; u8Key++ )
+    {
+      if( ( CONFIG_NO_SLOT != gsConfig.au8Slot[ u8Key ] )
+       && ( (U8)( gsConfig.u8Sequence - gsConfig.au8Sequence[ u8Key ] ) >= CONFIG_REFRESH_AGE ) )
+      {
+        gsConfig.u8Dirty |= (1u<<u8Key);
+      }
+    }
+    
+    // skip the slots of live records
+    while( TRUE == IsLiveSlot( gsConfig.u8Head ) )
+    {
+      gsConfig.u8Head++;
+      if( CONFIG_SLOT_COUNT == gsConfig.u8Head )
+      {
+        gsConfig.u8Head = 0u;
+      }
+    }
+    
+    // write the lowest dirty key
+    for( u8Key = 1u; 0u == ( gsConfig.u8Dirty & (1u<<u8Key) ); u8Key++ )
+    {
+    }
+    gsConfig.u8Dirty &= ~(1u<<u8Key);
+    WriteRecord( u8Key );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Reads a configuration value
+ * \param  u8Key: CONFIG_KEY_...
+ * \param  pu16Value: the value will be put here
+ * \return TRUE, if the value was ever written; FALSE, if not (pu16Value is not changed)
+ *********************************************************************/
+BOOL Config_Read( U8 u8Key, U16* pu16Value )
+{
+  BOOL bRet = FALSE;
+  
+  if( ( u8Key < CONFIG_KEY_COUNT )
+   && ( ( CONFIG_NO_SLOT != gsConfig.au8Slot[ u8Key ] ) || ( 0u != ( gsConfig.u8Dirty & (1u<<u8Key) ) ) ) )
+  {
+    *pu16Value = gsConfig.au16Value[ u8Key ];
+    bRet = TRUE;
+  }
+  
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Writes a configuration value
+ * \param  u8Key: CONFIG_KEY_...
+ * \param  u16Value: new value
+ * \return -
+ * \note   Only the RAM index is updated, the EEPROM is written later by Config_Cycle(). Unchanged values are not written.
+ *********************************************************************/
+void Config_Write( U8 u8Key, U16 u16Value )
+{
+  U16 u16Current;
+  
+  if( ( 0u != u8Key ) && ( u8Key < CONFIG_KEY_COUNT ) )
+  {
+    if( ( FALSE == Config_Read( u8Key, &u16Current ) ) || ( u16Current != u16Value ) )
+    {
+      gsConfig.au16Value[ u8Key ] = u16Value;
+      gsConfig.u8Dirty |= (1u<<u8Key);
+    }
+  }
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,52 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file config.h
+*
+* \brief Persistent configuration, stored as a log in the data EEPROM
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef CONFIG_H_INCLUDED
+#define CONFIG_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Keys of the configuration values -- 0 is reserved, it marks an erased record
+#define CONFIG_KEY_LAYER        1u  //!< Selected keymap layer
+#define CONFIG_KEY_DEBOUNCE     2u  //!< Bounds of the release hold-off in scans (high byte: min, low byte: max)
+#define CONFIG_KEY_MACRO_PACING 3u  //!< Scans between two codes of the macro playback (0: as fast as the computer acknowledges)
+#define CONFIG_KEY_COUNT        4u  //!< Number of keys including the reserved one (max. 8, less than the slots of the log)
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Config_Init( void );
+void Config_Cycle( void );
+BOOL Config_Read( U8 u8Key, U16* pu16Value );
+void Config_Write( U8 u8Key, U16 u16Value );
+
+
+#endif // CONFIG_H_INCLUDED
+/******************************<EOF>**********************************/
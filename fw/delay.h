@@ -22,7 +22,9 @@
 //--------------------------------------------------------------------------------------------------------/
 // Definitions
 //--------------------------------------------------------------------------------------------------------/
-#warning "This macro only works at 16 MHz CPU clock speed!"
+#define DELAY_F_CPU   16000000u  //!< CPU clock, that delay_us() is calibrated for -- checked against F_CPU in main.c
+#define DELAY_US_MAX  40000u     //!< Longest delay of one call: Delay_10cycle() takes a 16 bit count (40.96 ms)
+
 #define delay_us(us) (Delay_10cycle((us)*1.6))  // 1.6 = (16 MHz / (10* 1000000 ) )
 
 
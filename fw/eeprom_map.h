@@ -0,0 +1,55 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file eeprom_map.h
+*
+* \brief Partitioning of the data EEPROM
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef EEPROM_MAP_H_INCLUDED
+#define EEPROM_MAP_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// The STM8S003 has 128 bytes of data EEPROM, erased bytes read as 0x00
+#define EEPROM_START            (FLASH_DATA_START_PHYSICAL_ADDRESS)
+#define EEPROM_SIZE             128u
+
+#define EEPROM_KEYMAP_ADDRESS   (EEPROM_START + 0x00u)  //!< Keymap overlay layer, see keymap.c
+#define EEPROM_KEYMAP_SIZE      32u
+#define EEPROM_CONFIG_ADDRESS   (EEPROM_START + 0x20u)  //!< Configuration log, see config.c (must be word aligned)
+#define EEPROM_CONFIG_SIZE      32u
+#define EEPROM_KEYSTATS_ADDRESS (EEPROM_START + 0x40u)  //!< Key statistics, see keystats.h (must be word aligned)
+#define EEPROM_KEYSTATS_SIZE    32u
+#define EEPROM_MACRO_ADDRESS    (EEPROM_START + 0x60u)  //!< Recorded key sequence, see macro.c (must be word aligned)
+#define EEPROM_MACRO_SIZE       32u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+#endif // EEPROM_MAP_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,239 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file keymap.c
+*
+* \brief Matrix to scancode translation with switchable layers
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "stm8s.h"
+#include "types.h"
+#include "matrix.h"
+#include "eeprom_map.h"
+#include "config.h"
+#include "layout.h"
+
+// Own include
+#include "keymap.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Overlay layer in the data EEPROM:
+//   byte 0: number of overridden keys (N)
+//   byte 1: check byte, KEYMAP_EEPROM_CHECK XOR-ed with byte 0 and all of the pairs
+//   byte 2..2N+1: N pairs of { LAYOUT_POSITION( row, column ), scancode }
+#define KEYMAP_EEPROM_CHECK       0x5Au
+#define KEYMAP_EEPROM_MAX_PAIRS   ( ( EEPROM_KEYMAP_SIZE - 2u ) / 2u )
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief One key of an overlay layer, that differs from the base layer
+typedef struct
+{
+  U8 u8Position;  //!< Position in the matrix, see LAYOUT_POSITION()
+  U8 u8ScanCode;  //!< Scancode sent instead of the one in the base layer
+} S_KEYMAP_OVERRIDE;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Overlay layer: Ctrl and Caps Lock swapped
+static const S_KEYMAP_OVERRIDE gcasSwapLayer[] =
+{
+  { LAYOUT_KEY_CAPS, 0x63u },  // Caps --> Ctrl
+  { LAYOUT_KEY_CTRL, 0x62u }   // Ctrl --> Caps
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static U8 gu8ActiveLayer;              //!< Layer the keys are translated with
+static U8 gu8EepromPairs;              //!< Number of valid pairs of the EEPROM overlay, 0 when it is empty or corrupted
+volatile static U8 gu8RequestedLayer;  //!< Layer to be activated, when the keyboard gets idle
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U8   CheckEepromLayer( void );
+static void SelectLayer( U8 u8Layer );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Checks the overlay layer stored in the data EEPROM
+ * \param  -
+ * \return Number of pairs of the overlay, 0 when it is empty or corrupted
+ * \note   The check byte is verified first, so a half-written overlay is never applied.
+ *********************************************************************/
+static U8 CheckEepromLayer( void )
+{
+  U8 u8Count;
+  U8 u8Check;
+  U8 u8Index;
+  
+  u8Count = FLASH_ReadByte( EEPROM_KEYMAP_ADDRESS );
+  if( u8Count <= KEYMAP_EEPROM_MAX_PAIRS )
+  {
+    u8Check = KEYMAP_EEPROM_CHECK ^ u8Count;
+    for( u8Index = 0u; u8Index < 2u * u8Count; u8Index++ )
+    {
+      u8Check ^= FLASH_ReadByte( EEPROM_KEYMAP_ADDRESS + 2u + u8Index );
+    }
+    
+    if( u8Check != FLASH_ReadByte( EEPROM_KEYMAP_ADDRESS + 1u ) )
+    {
+      u8Count = 0u;
+    }
+  }
+  else
+  {
+    u8Count = 0u;
+  }
+  
+  return u8Count;
+}
+
+/*! *******************************************************************
+ * \brief  Selects the layer the keys are translated with
+ * \param  u8Layer: the layer to select
+ * \return -
+ * \note   The layers are not copied into the RAM: the overrides are looked up on every translation.
+ *********************************************************************/
+static void SelectLayer( U8 u8Layer )
+{
+  gu8EepromPairs = ( KEYMAP_LAYER_EEPROM == u8Layer ) ? CheckEepromLayer() : 0u;
+  gu8ActiveLayer = u8Layer;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init
+ * \param  -
+ * \return -
+ * \note   Must be called after Config_Init(), and before Matrix_Cycle()!
+ *********************************************************************/
+void Keymap_Init( void )
+{
+  U16 u16Layer;
+  
+  // the last selected layer is restored
+  if( ( FALSE == Config_Read( CONFIG_KEY_LAYER, &u16Layer ) ) || ( u16Layer >= KEYMAP_LAYER_COUNT ) )
+  {
+    u16Layer = KEYMAP_LAYER_BASE;
+  }
+  gu8RequestedLayer = (U8)u16Layer;
+  SelectLayer( (U8)u16Layer );
+}
+
+/*! *******************************************************************
+ * \brief  Main cycle
+ * \param  -
+ * \return -
+ * \note   Must be called from main cycle, after Matrix_Cycle()!
+ *********************************************************************/
+void Keymap_Cycle( void )
+{
+  U8 u8Layer = gu8RequestedLayer;
+  
+  // the layer is switched only when no key is held, so every release is translated with the table of its press
+  if( ( u8Layer != gu8ActiveLayer ) && ( TRUE == Matrix_IsIdle() ) )
+  {
+    SelectLayer( u8Layer );
+    Config_Write( CONFIG_KEY_LAYER, u8Layer );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Requests switching to another layer
+ * \param  u8Layer: KEYMAP_LAYER_...
+ * \return -
+ * \note   Can be called from the IT routine (eg. as a chord action).
+ *********************************************************************/
+void Keymap_RequestLayer( U8 u8Layer )
+{
+  if( u8Layer < KEYMAP_LAYER_COUNT )
+  {
+    gu8RequestedLayer = u8Layer;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Gets the active layer
+ * \param  -
+ * \return KEYMAP_LAYER_...
+ *********************************************************************/
+U8 Keymap_GetLayer( void )
+{
+  return gu8ActiveLayer;
+}
+
+/*! *******************************************************************
+ * \brief  Translates a matrix position to scancode
+ * \param  u8Row: row of the key
+ * \param  u8Column: column of the key
+ * \return Scancode of the key in the active layer
+ * \note   Called once per key event, so the short search of the overrides costs less than a RAM table.
+ *********************************************************************/
+U8 Keymap_GetScanCode( U8 u8Row, U8 u8Column )
+{
+  U8 u8Position = LAYOUT_POSITION( u8Row, u8Column );
+  U8 u8ScanCode = gcau8ScanCodeTable[ u8Row ][ u8Column ];
+  U8 u8Index;
+  
+  if( KEYMAP_LAYER_SWAP == gu8ActiveLayer )
+  {
+    for( u8Index = 0u; u8Index < ( sizeof( gcasSwapLayer ) / sizeof( gcasSwapLayer[ 0u ] ) ); u8Index++ )
+    {
+      if( u8Position == gcasSwapLayer[ u8Index ].u8Position )
+      {
+        u8ScanCode = gcasSwapLayer[ u8Index ].u8ScanCode;
+      }
+    }
+  }
+  else
+  {
+    // in order: the last pair of a key wins
+    for( u8Index = 0u; u8Index < gu8EepromPairs; u8Index++ )
+    {
+      if( u8Position == FLASH_ReadByte( EEPROM_KEYMAP_ADDRESS + 2u + 2u * u8Index ) )
+      {
+        u8ScanCode = FLASH_ReadByte( EEPROM_KEYMAP_ADDRESS + 3u + 2u * u8Index );
+      }
+    }
+  }
+  
+  return u8ScanCode;
+}
+
+/*! *******************************************************************
+ * \brief  Finds the key of a scancode in the base layer
+ * \param  u8ScanCode: scancode of the key (without the release bit)
+ * \return Position of the key, see LAYOUT_POSITION(), or LAYOUT_NO_KEY
+ * \note   One lookup in the inverse table of the layout, no search of the matrix.
+ *********************************************************************/
+U8 Keymap_FindKey( U8 u8ScanCode )
+{
+  return ( u8ScanCode < LAYOUT_SCANCODES ) ? gcau8KeyPosition[ u8ScanCode ] : LAYOUT_NO_KEY;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,54 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file keymap.h
+*
+* \brief Matrix to scancode translation with switchable layers
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef KEYMAP_H_INCLUDED
+#define KEYMAP_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Layers
+#define KEYMAP_LAYER_BASE       0u  //!< Layout as printed on the keycaps
+#define KEYMAP_LAYER_SWAP       1u  //!< Ctrl and Caps Lock swapped
+#define KEYMAP_LAYER_EEPROM     2u  //!< User defined overlay, stored in the data EEPROM
+#define KEYMAP_LAYER_COUNT      3u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Keymap_Init( void );
+void Keymap_Cycle( void );
+void Keymap_RequestLayer( U8 u8Layer );
+U8   Keymap_GetLayer( void );
+U8   Keymap_GetScanCode( U8 u8Row, U8 u8Column );
+U8   Keymap_FindKey( U8 u8ScanCode );
+
+
+#endif // KEYMAP_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,359 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file keystats.c
+*
+* \brief Per-key usage and chatter statistics, kept in the data EEPROM
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include <intrinsics.h>
+#include "stm8s.h"
+#include "types.h"
+#include "matrix.h"
+#include "eeprom_map.h"
+
+// Own include
+#include "keystats.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define KEYSTATS_FREE         0u       //!< Key number of a free entry
+#define KEYSTATS_NO_ENTRY     0xFFu
+#define KEYSTATS_FLUSH_SCANS  ( (U32)KEYSTATS_FLUSH_MINUTES * 12000uL )  //!< One scan per 5 ms
+#define KEYSTATS_LFSR_TAPS    0xB400u  //!< 16-bit Galois LFSR, maximal length
+#define KEYSTATS_RANDOM_SEED  0xACE1u
+#define KEYSTATS_CHATTER_KEYS 2u       //!< Chattering keys reported between two main cycles, the rest is dropped
+
+#if ( ( KEYSTATS_ENTRIES > 8u ) || ( ( MATRIX_COL * MATRIX_ROW ) > 255u ) )
+#error "The entries of the store must fit into a bitfield, and the key numbers into a byte"
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A counter in octave n is incremented, if the low n bits of the random number are zero: with 2^-n probability
+static const U16 gcau16StepMask[ KEYSTATS_SATURATED / KEYSTATS_LINEAR + 1u ] =
+{
+  0x0000u, 0x0001u, 0x0003u, 0x0007u, 0x000Fu, 0x001Fu, 0x003Fu, 0x007Fu,
+  0x00FFu, 0x01FFu, 0x03FFu, 0x07FFu, 0x0FFFu, 0x1FFFu, 0x3FFFu, 0x7FFFu
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+//! \brief RAM copy of the table, and the state of the store -- owned by the main cycle
+static struct
+{
+  U8  au8Key[ KEYSTATS_ENTRIES ];      //!< Number of the key of the entry (KEYSTATS_FREE, if there is none)
+  U8  au8Presses[ KEYSTATS_ENTRIES ];  //!< Logarithmic counters of the registered presses
+  U8  au8Chatter[ KEYSTATS_ENTRIES ];  //!< Logarithmic counters of the bounces seen after the presses
+  U16 u16Random;                       //!< Random numbers of the counters
+  U32 u32Scans;                        //!< Scans since the first change after the last write
+  U16 u16LastScan;                     //!< Scan count at the previous call of KeyStats_Cycle(), while timing
+  BOOL bTiming;
+  U8  u8Dirty;                         //!< Entries changed since they were written (bitfield, bit n belongs to entry n)
+  U8  u8Write;                         //!< Entries to write, one per call of KeyStats_Cycle()
+} gsKeyStats;
+
+//! \brief Keys chattering since the last call of KeyStats_Cycle() -- set by the IT routine
+volatile static U8 gau8ChatterKey[ KEYSTATS_CHATTER_KEYS ];
+volatile static U8 gu8ChatterKeys;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void Count( U8* pu8Counter );
+static U8   FindEntry( U8 u8Key, BOOL bChatter );
+static void CountEvent( U8 u8Key, BOOL bChatter );
+static void WriteEntry( U8 u8Entry );
+static U16  GetScanCount( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Counts an event in a logarithmic counter
+ * \param  pu8Counter: the counter
+ * \return -
+ * \note   Fixed cost: one step of the LFSR, one table lookup -- no loop, and no shift by a variable count.
+ *********************************************************************/
+static void Count( U8* pu8Counter )
+{
+  U16 u16Random = gsKeyStats.u16Random;
+  U8  u8Counter = *pu8Counter;
+
+  u16Random = ( u16Random >> 1u ) ^ ( ( 0u != ( u16Random & 1u ) ) ? KEYSTATS_LFSR_TAPS : 0u );
+  gsKeyStats.u16Random = u16Random;
+  if( ( KEYSTATS_SATURATED != u8Counter ) && ( 0u == ( u16Random & gcau16StepMask[ u8Counter >> 4u ] ) ) )
+  {
+    *pu8Counter = u8Counter + 1u;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Finds the entry of a key, or the entry it may take
+ * \param  u8Key: number of the key
+ * \param  bChatter: TRUE for a chatter -- it may take the entry of a chattering key, a press may not
+ * \return Entry of the key, a free entry, the entry of the key counted least, or KEYSTATS_NO_ENTRY
+ * \note   Fixed cost: one pass over the table.
+ *********************************************************************/
+static U8 FindEntry( U8 u8Key, BOOL bChatter )
+{
+  U8  u8Entry;
+  U8  u8Own = KEYSTATS_NO_ENTRY;
+  U8  u8Free = KEYSTATS_NO_ENTRY;
+  U8  u8Least = KEYSTATS_NO_ENTRY;
+  U16 u16Rank;
+  U16 u16Least = ( TRUE == bChatter ) ? 0xFFFFu : 0x00FFu;  // a press takes only the entry of a key not chattering
+
+  for( u8Entry = 0u; u8Entry < KEYSTATS_ENTRIES; u8Entry++ )
+  {
+    u16Rank = ( (U16)gsKeyStats.au8Chatter[ u8Entry ] << 8u ) | gsKeyStats.au8Presses[ u8Entry ];
+    if( u8Key == gsKeyStats.au8Key[ u8Entry ] )
+    {
+      u8Own = u8Entry;
+    }
+    else if( KEYSTATS_FREE == gsKeyStats.au8Key[ u8Entry ] )
+    {
+      u8Free = u8Entry;
+    }
+    else if( u16Rank <= u16Least )  // the least chatter, then the fewest presses
+    {
+      u16Least = u16Rank;
+      u8Least  = u8Entry;
+    }
+  }
+
+  return ( KEYSTATS_NO_ENTRY != u8Own ) ? u8Own : ( ( KEYSTATS_NO_ENTRY != u8Free ) ? u8Free : u8Least );
+}
+
+/*! *******************************************************************
+ * \brief  Counts a press or a chatter of a key in its entry
+ * \param  u8Key: number of the key
+ * \param  bChatter: TRUE for a chatter, FALSE for a press
+ * \return -
+ *********************************************************************/
+static void CountEvent( U8 u8Key, BOOL bChatter )
+{
+  U8 u8Entry;
+
+  u8Entry = FindEntry( u8Key, bChatter );
+  if( KEYSTATS_NO_ENTRY != u8Entry )
+  {
+    if( u8Key != gsKeyStats.au8Key[ u8Entry ] )
+    {
+      // a new key goes on with the press counter it replaced, see keystats.h
+      gsKeyStats.au8Key[ u8Entry ]     = u8Key;
+      gsKeyStats.au8Chatter[ u8Entry ] = 0u;
+    }
+    if( TRUE == bChatter )
+    {
+      if( 0u == gsKeyStats.au8Chatter[ u8Entry ] )  // the first chatter: the presses are counted from now on
+      {
+        gsKeyStats.au8Presses[ u8Entry ] = 0u;
+      }
+      Count( &gsKeyStats.au8Chatter[ u8Entry ] );
+    }
+    else
+    {
+      Count( &gsKeyStats.au8Presses[ u8Entry ] );
+    }
+    gsKeyStats.u8Dirty |= (1u<<u8Entry);
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Writes an entry of the table to the data EEPROM
+ * \param  u8Entry: entry to write
+ * \return -
+ * \note   Blocking function, one word program takes a few milliseconds! The program flash is not written, so the IT
+ *         routine goes on meanwhile, like with the configuration log.
+ *********************************************************************/
+static void WriteEntry( U8 u8Entry )
+{
+  U8  u8Key     = gsKeyStats.au8Key[ u8Entry ];
+  U8  u8Presses = gsKeyStats.au8Presses[ u8Entry ];
+  U8  u8Chatter = gsKeyStats.au8Chatter[ u8Entry ];
+  U32 u32Word;
+
+  u32Word = ( (U32)u8Key << 24u ) | ( (U32)( KEYSTATS_CHECK_SEED ^ u8Key ^ u8Presses ^ u8Chatter ) << 16u )
+          | ( (U32)u8Presses << 8u ) | (U32)u8Chatter;
+
+  FLASH_Unlock( FLASH_MEMTYPE_DATA );
+  FLASH_ProgramWord( EEPROM_KEYSTATS_ADDRESS + ( u8Entry * KEYSTATS_ENTRY_SIZE ), u32Word );  // the first byte goes to the lowest address
+  FLASH_WaitForLastOperation( FLASH_MEMTYPE_DATA );
+  FLASH_Lock( FLASH_MEMTYPE_DATA );
+}
+
+/*! *******************************************************************
+ * \brief  Gets the sequence number of the last complete scan -- the time base of the writes (5 ms)
+ * \param  -
+ * \return Scan count
+ *********************************************************************/
+static U16 GetScanCount( void )
+{
+  S_MATRIX_SNAPSHOT sSnapshot;
+
+  Matrix_GetSnapshot( &sSnapshot );
+
+  return sSnapshot.u16ScanCount;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init -- loads the table from the data EEPROM
+ * \param  -
+ * \return -
+ * \note   Must be called before the IT routine is started, it reports the chatter.
+ *********************************************************************/
+void KeyStats_Init( void )
+{
+  U8  u8Entry;
+  U8  u8Key;
+  U8  u8Check;
+  U8  u8Presses;
+  U8  u8Chatter;
+  U32 u32Address;
+
+  memset( (void*)&gsKeyStats, 0x00u, sizeof( gsKeyStats ) );
+  gu8ChatterKeys = 0u;
+  gsKeyStats.u16Random = KEYSTATS_RANDOM_SEED;
+
+  for( u8Entry = 0u; u8Entry < KEYSTATS_ENTRIES; u8Entry++ )
+  {
+    u32Address = EEPROM_KEYSTATS_ADDRESS + ( u8Entry * KEYSTATS_ENTRY_SIZE );
+    u8Key     = FLASH_ReadByte( u32Address );
+    u8Check   = FLASH_ReadByte( u32Address + 1u );
+    u8Presses = FLASH_ReadByte( u32Address + 2u );
+    u8Chatter = FLASH_ReadByte( u32Address + 3u );
+
+    // free, torn or corrupted entries are skipped
+    if( ( KEYSTATS_FREE != u8Key ) && ( u8Key <= ( MATRIX_COL * MATRIX_ROW ) )
+     && ( u8Check == ( KEYSTATS_CHECK_SEED ^ u8Key ^ u8Presses ^ u8Chatter ) ) )
+    {
+      gsKeyStats.au8Key[ u8Entry ]     = u8Key;
+      gsKeyStats.au8Presses[ u8Entry ] = u8Presses;
+      gsKeyStats.au8Chatter[ u8Entry ] = u8Chatter;
+    }
+
+    // a different series of random numbers after every write
+    gsKeyStats.u16Random = (U16)( ( gsKeyStats.u16Random << 1u ) ^ u8Check );
+  }
+
+  gsKeyStats.u16Random |= 1u;  // the LFSR must not be 0
+}
+
+/*! *******************************************************************
+ * \brief  Main cycle -- counts the chatter reported by the IT routine, writes the changed entries to the store
+ * \param  -
+ * \return -
+ * \note   Must be called from main cycle! Writes at most one entry per call, and only when the keyboard is idle. The
+ *         changed entries are written KEYSTATS_FLUSH_MINUTES after the first change since the previous write.
+ *********************************************************************/
+void KeyStats_Cycle( void )
+{
+  U8  au8Key[ KEYSTATS_CHATTER_KEYS ];
+  U8  u8Keys;
+  U8  u8Entry;
+  U16 u16Scan;
+  __istate_t sState;
+
+  if( 0u != gu8ChatterKeys )
+  {
+    sState = __get_interrupt_state();
+    __disable_interrupt();
+    u8Keys = gu8ChatterKeys;
+    memcpy( au8Key, (const void*)gau8ChatterKey, sizeof( au8Key ) );
+    gu8ChatterKeys = 0u;
+    __set_interrupt_state( sState );
+    for( u8Entry = 0u; u8Entry < u8Keys; u8Entry++ )
+    {
+      CountEvent( au8Key[ u8Entry ], TRUE );
+    }
+  }
+
+  if( 0u != gsKeyStats.u8Dirty )
+  {
+    u16Scan = GetScanCount();
+    gsKeyStats.u32Scans += ( TRUE == gsKeyStats.bTiming ) ? (U16)( u16Scan - gsKeyStats.u16LastScan ) : 0u;
+    gsKeyStats.u16LastScan = u16Scan;
+    gsKeyStats.bTiming = TRUE;
+    if( ( gsKeyStats.u32Scans >= KEYSTATS_FLUSH_SCANS ) && ( 0u == gsKeyStats.u8Write ) )
+    {
+      gsKeyStats.u8Write  = gsKeyStats.u8Dirty;  // the changes from now on are written next time
+      gsKeyStats.u8Dirty  = 0u;
+      gsKeyStats.bTiming  = FALSE;
+      gsKeyStats.u32Scans = 0u;
+    }
+  }
+
+  if( ( 0u != gsKeyStats.u8Write ) && ( TRUE == Matrix_IsIdle() ) )  // like the configuration log, the store is written only when the keyboard is idle
+  {
+    for( u8Entry = 0u; 0u == ( gsKeyStats.u8Write & (1u<<u8Entry) ); u8Entry++ )
+    {
+    }
+    gsKeyStats.u8Write &= ~(1u<<u8Entry);
+    WriteEntry( u8Entry );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Counts a press of a key
+ * \param  u8Row: row of the key
+ * \param  u8Column: column of the key
+ * \return -
+ * \note   Must be called from main cycle, with the presses registered to the computer!
+ *********************************************************************/
+void KeyStats_CountPress( U8 u8Row, U8 u8Column )
+{
+  CountEvent( ( u8Column * MATRIX_ROW ) + u8Row + 1u, FALSE );
+}
+
+/*! *******************************************************************
+ * \brief  Reports a chatter of a key: it closed again shortly after opening, see Debounce() in matrix.c
+ * \param  u8Row: row of the key
+ * \param  u8Column: column of the key
+ * \return -
+ * \note   Must be called from the IT routine! The key is only queued, KeyStats_Cycle() counts it: the chatter of a key
+ *         between two main cycles is counted once, and of the keys chattering meanwhile the first
+ *         KEYSTATS_CHATTER_KEYS ones -- the counters are approximate anyway, the RAM is short.
+ *********************************************************************/
+void KeyStats_CountChatter( U8 u8Row, U8 u8Column )
+{
+  U8 u8Key = ( u8Column * MATRIX_ROW ) + u8Row + 1u;
+  U8 u8Index;
+  
+  for( u8Index = 0u; ( u8Index < gu8ChatterKeys ) && ( u8Key != gau8ChatterKey[ u8Index ] ); u8Index++ )
+  {
+  }
+  if( ( u8Index == gu8ChatterKeys ) && ( gu8ChatterKeys < KEYSTATS_CHATTER_KEYS ) )
+  {
+    gau8ChatterKey[ gu8ChatterKeys ] = u8Key;
+    gu8ChatterKeys++;
+  }
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,73 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file keystats.h
+*
+* \brief Per-key usage and chatter statistics, kept in the data EEPROM
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef KEYSTATS_H_INCLUDED
+#define KEYSTATS_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "matrix.h"
+#include "eeprom_map.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// The counters are 8-bit logarithmic, saturating at 255: 0..15 count exactly, above that the upper nibble is the
+// octave (n = value >> 4), and every step of the lower nibble stands for 2^n events on average:
+//   events = 16 * ( 2^n - 1 ) + ( value & 15 ) * 2^n    (about 10^6 at 255)
+#define KEYSTATS_LINEAR         16u      //!< Counted exactly below this
+#define KEYSTATS_SATURATED      255u
+
+// The store is a table of the keys worth keeping in the data EEPROM (see eeprom_map.h), one word per key:
+//   byte 0: number of the key, column * MATRIX_ROW + row + 1 (0: free entry, erased EEPROM reads 0x00)
+//   byte 1: check byte -- KEYSTATS_CHECK_SEED XOR the other three
+//   byte 2: press counter
+//   byte 3: chatter counter
+// An entry is written with one word program: a torn one fails its check, and only that key is dropped at power-up.
+// The keys chattering most are kept, the rest of the table holds the keys pressed most. The presses of a key are
+// counted from its first chatter, so they are comparable with its chatter; a key that never chattered took over the
+// press counter of the key it replaced, its presses are an upper bound (the keys pressed most stay in the table).
+#define KEYSTATS_ENTRY_SIZE     4u
+#define KEYSTATS_ENTRIES        ( EEPROM_KEYSTATS_SIZE / KEYSTATS_ENTRY_SIZE )  //!< (max. 8)
+#define KEYSTATS_CHECK_SEED     0xC3u
+
+// The changed entries are written only when the keyboard is idle, and at most once per this many minutes: the data
+// EEPROM endures 100000 program cycles, 100000 hours of typing. Counts since the last write are lost at power-off.
+#ifndef KEYSTATS_FLUSH_MINUTES
+#define KEYSTATS_FLUSH_MINUTES  60u
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void KeyStats_Init( void );
+void KeyStats_Cycle( void );
+void KeyStats_CountPress( U8 u8Row, U8 u8Column );
+void KeyStats_CountChatter( U8 u8Row, U8 u8Column );
+
+
+#endif // KEYSTATS_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,289 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file latency.c
+*
+* \brief Keystroke latency instrumentation -- histograms from switch closure to the ACK of the computer
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include "stm8s.h"
+#include "types.h"
+#include "matrix.h"
+
+// Own include
+#include "latency.h"
+
+#if ( 0 != LATENCY_ENABLED )
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// A timestamp packs the sampling tick counter (upper 19 bits) and the TIM2 counter (lower 13 bits). It is
+// monotonic, but not linear: only differences are converted to time, in the main cycle.
+#define LATENCY_COUNTER_BITS  13u
+#define LATENCY_COUNTER_MASK  ( ( 1ul << LATENCY_COUNTER_BITS ) - 1u )
+#define LATENCY_NO_DELAY      0xFFFFu  //!< Sample --> enqueue delay of scancodes not coming from the matrix
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+typedef U32 LATENCY_TIME;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+#pragma location = LATENCY_BLOCK_ADDRESS
+__no_init S_LATENCY_BLOCK gsLatencyBlock;  //!< Histograms -- at a fixed address for the debugger
+
+//! \brief Timestamps of the scancodes on their way
+static struct
+{
+  U16                   au16Sample[ MATRIX_COL ];           //!< Sampling tick of the last change in the column
+  LATENCY_TIME          au32Enqueue[ LATENCY_SLOT_COUNT ];  //!< Scancode put into the FIFO slot
+  U16                   au16SampleUs[ LATENCY_SLOT_COUNT ]; //!< Sample --> enqueue delay of the FIFO slot
+  LATENCY_TIME          u32Transmit;                        //!< Start of the running transmission
+  U8                    u8Source;                           //!< Column of the scancode being registered
+  volatile U16          u16Ticks;                           //!< Sampling ticks
+  U16                   u16GhostStart;                      //!< TIM2 counter at the start of the ghost key test
+} gsLatency;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static LATENCY_TIME GetTime( void );
+static U32          GetElapsedUs( LATENCY_TIME u32From, LATENCY_TIME u32To );
+static void         AddSample( U8 u8Stage, U32 u32Us );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Gets a timestamp
+ * \param  -
+ * \return Sampling tick and the TIM2 counter
+ * \note   The tick counter is re-read, if the IT routine incremented it meanwhile.
+ *********************************************************************/
+static LATENCY_TIME GetTime( void )
+{
+  U16 u16Ticks;
+  U16 u16Counter;
+  
+  do
+  {
+    u16Ticks = gsLatency.u16Ticks;
+    u16Counter = TIM2_GetCounter();
+  } while( u16Ticks != gsLatency.u16Ticks );
+  
+  return ( (LATENCY_TIME)u16Ticks << LATENCY_COUNTER_BITS ) | u16Counter;
+}
+
+/*! *******************************************************************
+ * \brief  Time between two timestamps
+ * \param  u32From: earlier timestamp
+ * \param  u32To: later timestamp
+ * \return Elapsed time in us
+ *********************************************************************/
+static U32 GetElapsedUs( LATENCY_TIME u32From, LATENCY_TIME u32To )
+{
+  U16 u16Ticks = (U16)( ( u32To >> LATENCY_COUNTER_BITS ) - ( u32From >> LATENCY_COUNTER_BITS ) );
+  U32 u32Clocks = ( (U32)u16Ticks * MATRIX_TICK_CLOCKS ) + ( u32To & LATENCY_COUNTER_MASK ) - ( u32From & LATENCY_COUNTER_MASK );
+  
+  return u32Clocks >> 4u;  // 16 MHz timer clock
+}
+
+/*! *******************************************************************
+ * \brief  Adds a measurement to the histogram of a stage
+ * \param  u8Stage: LATENCY_STAGE_x
+ * \param  u32Us: latency in us
+ * \return -
+ *********************************************************************/
+static void AddSample( U8 u8Stage, U32 u32Us )
+{
+  S_LATENCY_STAGE* psStage = &gsLatencyBlock.asStage[ u8Stage ];
+  U32 u32Rest = u32Us;
+  U8  u8Bucket = 0u;
+  
+  // bucket = number of significant bits
+  while( ( 0u != u32Rest ) && ( u8Bucket < ( LATENCY_BUCKET_COUNT - 1u ) ) )
+  {
+    u32Rest >>= 1u;
+    u8Bucket++;
+  }
+  
+  if( 0xFFFFu != psStage->au16Bucket[ u8Bucket ] )
+  {
+    psStage->au16Bucket[ u8Bucket ]++;
+  }
+  if( 0xFFFFu != psStage->u16Count )
+  {
+    psStage->u16Count++;
+  }
+  if( u32Us > psStage->u32MaxUs )
+  {
+    psStage->u32MaxUs = u32Us;
+  }
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init -- clears the histograms
+ * \param  -
+ * \return -
+ * \note   Must be called before the IT routine is enabled!
+ *********************************************************************/
+void Latency_Init( void )
+{
+  memset( (void*)&gsLatency, 0x00u, sizeof( gsLatency ) );
+  memset( (void*)&gsLatencyBlock, 0x00u, sizeof( gsLatencyBlock ) );
+  gsLatency.u8Source = LATENCY_NO_SOURCE;
+  gsLatencyBlock.u8Version = LATENCY_VERSION;
+  gsLatencyBlock.u8StageCount = LATENCY_STAGE_COUNT;
+  gsLatencyBlock.u16Magic = LATENCY_MAGIC;
+}
+
+/*! *******************************************************************
+ * \brief  Sampling tick
+ * \param  -
+ * \return -
+ * \note   Must be called from the timed IT routine, before Matrix_Sample()!
+ *********************************************************************/
+void Latency_Tick( void )
+{
+  gsLatency.u16Ticks++;
+}
+
+/*! *******************************************************************
+ * \brief  A key change was sampled in the column
+ * \param  u8Column: index of the column
+ * \return -
+ * \note   Called from the IT routine. Only the tick is kept: the columns are sampled at its start, when the TIM2
+ *         counter is about zero.
+ *********************************************************************/
+void Latency_Sample( U8 u8Column )
+{
+  gsLatency.au16Sample[ u8Column ] = gsLatency.u16Ticks;
+}
+
+/*! *******************************************************************
+ * \brief  Sets the origin of the scancodes registered next
+ * \param  u8Column: index of the column, or LATENCY_NO_SOURCE
+ * \return -
+ *********************************************************************/
+void Latency_SetSource( U8 u8Column )
+{
+  gsLatency.u8Source = u8Column;
+}
+
+/*! *******************************************************************
+ * \brief  A scancode was put into a FIFO slot
+ * \param  u8Slot: index of the slot
+ * \return -
+ *********************************************************************/
+void Latency_Enqueue( U8 u8Slot )
+{
+  U32 u32Us;
+  
+  if( u8Slot < LATENCY_SLOT_COUNT )
+  {
+    gsLatency.au32Enqueue[ u8Slot ] = GetTime();
+    gsLatency.au16SampleUs[ u8Slot ] = LATENCY_NO_DELAY;
+    if( gsLatency.u8Source < MATRIX_COL )
+    {
+      u32Us = GetElapsedUs( (LATENCY_TIME)gsLatency.au16Sample[ gsLatency.u8Source ] << LATENCY_COUNTER_BITS,
+                            gsLatency.au32Enqueue[ u8Slot ] );
+      gsLatency.au16SampleUs[ u8Slot ] = ( u32Us < LATENCY_NO_DELAY ) ? (U16)u32Us : ( LATENCY_NO_DELAY - 1u );
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Transmission of the scancode in the FIFO slot starts
+ * \param  u8Slot: index of the slot
+ * \return -
+ * \note   A retransmission restarts the measurement of the wire stage.
+ *********************************************************************/
+void Latency_Transmit( U8 u8Slot )
+{
+  (void)u8Slot;
+  gsLatency.u32Transmit = GetTime();
+}
+
+/*! *******************************************************************
+ * \brief  The computer acknowledged the scancode in the FIFO slot -- the stages are recorded
+ * \param  u8Slot: index of the slot
+ * \return -
+ * \note   Must be called from main cycle!
+ *********************************************************************/
+void Latency_Acknowledge( U8 u8Slot )
+{
+  LATENCY_TIME u32Now = GetTime();
+  U32 u32QueueUs;
+  
+  if( u8Slot < LATENCY_SLOT_COUNT )
+  {
+    u32QueueUs = GetElapsedUs( gsLatency.au32Enqueue[ u8Slot ], gsLatency.u32Transmit );
+    AddSample( LATENCY_STAGE_QUEUE, u32QueueUs );
+    AddSample( LATENCY_STAGE_WIRE, GetElapsedUs( gsLatency.u32Transmit, u32Now ) );
+    if( LATENCY_NO_DELAY != gsLatency.au16SampleUs[ u8Slot ] )
+    {
+      AddSample( LATENCY_STAGE_SAMPLE, gsLatency.au16SampleUs[ u8Slot ] );
+      AddSample( LATENCY_STAGE_TOTAL, gsLatency.au16SampleUs[ u8Slot ] + GetElapsedUs( gsLatency.au32Enqueue[ u8Slot ], u32Now ) );
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  The ghost key test of Matrix_Sample() starts
+ * \param  -
+ * \return -
+ * \note   Called from the IT routine.
+ *********************************************************************/
+void Latency_GhostStart( void )
+{
+  gsLatency.u16GhostStart = TIM2_GetCounter();
+}
+
+/*! *******************************************************************
+ * \brief  The ghost key test of Matrix_Sample() is over -- the longest one is kept
+ * \param  -
+ * \return -
+ * \note   Called from the IT routine. The TIM2 clock is the CPU clock, so the result is in CPU cycles, including one
+ *         read of the counter. The counter wraps around at the end of the sampling tick, the test is shorter.
+ *********************************************************************/
+void Latency_GhostEnd( void )
+{
+  U16 u16Counter = TIM2_GetCounter();
+  U16 u16Clocks;
+
+  if( u16Counter >= gsLatency.u16GhostStart )
+  {
+    u16Clocks = u16Counter - gsLatency.u16GhostStart;
+  }
+  else
+  {
+    u16Clocks = ( MATRIX_TICK_CLOCKS - gsLatency.u16GhostStart ) + u16Counter;
+  }
+  if( u16Clocks > gsLatencyBlock.u16GhostMaxClocks )
+  {
+    gsLatencyBlock.u16GhostMaxClocks = u16Clocks;
+  }
+}
+
+#endif // LATENCY_ENABLED
+/******************************<EOF>**********************************/
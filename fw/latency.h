@@ -0,0 +1,118 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file latency.h
+*
+* \brief Keystroke latency instrumentation -- histograms from switch closure to the ACK of the computer
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef LATENCY_H_INCLUDED
+#define LATENCY_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Set to 1 (here, or as a compiler define) to build the instrumentation -- with 0, every hook compiles to nothing
+#ifndef LATENCY_ENABLED
+#define LATENCY_ENABLED         0
+#endif
+
+#define LATENCY_BLOCK_ADDRESS   0x0216u  //!< Fixed RAM address of the histograms, read it over SWIM (158 bytes, see app.icf)
+#define LATENCY_MAGIC           0x4C54u  //!< "LT"
+#define LATENCY_VERSION         2u
+
+// Stages, measured for every scancode acknowledged by the computer
+#define LATENCY_STAGE_SAMPLE    0u  //!< Key change sampled --> scancode in the FIFO
+#define LATENCY_STAGE_QUEUE     1u  //!< Scancode in the FIFO --> transmission started
+#define LATENCY_STAGE_WIRE      2u  //!< Transmission started --> ACK received
+#define LATENCY_STAGE_TOTAL     3u  //!< Key change sampled --> ACK received
+#define LATENCY_STAGE_COUNT     4u
+
+// Bucket n counts latencies of [2^(n-1), 2^n) us, bucket 0 counts 0 us, the last bucket counts everything above
+#define LATENCY_BUCKET_COUNT    16u
+
+#define LATENCY_SLOT_COUNT      20u    //!< Same as the scancode FIFO size in amiga_key.c
+#define LATENCY_NO_SOURCE       0xFFu  //!< The scancode does not come from the matrix
+
+// Hooks of the instrumented modules
+#if ( 0 != LATENCY_ENABLED )
+#define LATENCY_INIT()                      Latency_Init()
+#define LATENCY_TICK()                      Latency_Tick()
+#define LATENCY_SAMPLE( COLUMN, CHANGED )   do { if( 0u != (CHANGED) ) { Latency_Sample( COLUMN ); } } while( 0 )
+#define LATENCY_SOURCE( COLUMN )            Latency_SetSource( COLUMN )
+#define LATENCY_ENQUEUE( SLOT )             Latency_Enqueue( SLOT )
+#define LATENCY_TRANSMIT( SLOT )            Latency_Transmit( SLOT )
+#define LATENCY_ACKNOWLEDGE( SLOT )         Latency_Acknowledge( SLOT )
+#define LATENCY_GHOST_START()               Latency_GhostStart()
+#define LATENCY_GHOST_END()                 Latency_GhostEnd()
+#else
+#define LATENCY_INIT()
+#define LATENCY_TICK()
+#define LATENCY_SAMPLE( COLUMN, CHANGED )
+#define LATENCY_SOURCE( COLUMN )
+#define LATENCY_ENQUEUE( SLOT )
+#define LATENCY_TRANSMIT( SLOT )
+#define LATENCY_ACKNOWLEDGE( SLOT )
+#define LATENCY_GHOST_START()
+#define LATENCY_GHOST_END()
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Histogram of a stage
+typedef struct
+{
+  U16 au16Bucket[ LATENCY_BUCKET_COUNT ];  //!< Saturating counters
+  U16 u16Count;                            //!< Number of measurements (saturating)
+  U32 u32MaxUs;                            //!< Longest latency
+} S_LATENCY_STAGE;
+
+//! \brief The block at LATENCY_BLOCK_ADDRESS
+typedef struct
+{
+  U16             u16Magic;      //!< LATENCY_MAGIC, once initialized
+  U8              u8Version;     //!< LATENCY_VERSION
+  U8              u8StageCount;  //!< LATENCY_STAGE_COUNT
+  S_LATENCY_STAGE asStage[ LATENCY_STAGE_COUNT ];
+  U16             u16GhostMaxClocks;  //!< Longest ghost key test of Matrix_Sample() in TIM2 clocks (CPU cycles), see MATRIX_ANTIGHOST
+} S_LATENCY_BLOCK;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+#if ( 0 != LATENCY_ENABLED )
+extern S_LATENCY_BLOCK gsLatencyBlock;
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+#if ( 0 != LATENCY_ENABLED )
+void Latency_Init( void );
+void Latency_Tick( void );
+void Latency_Sample( U8 u8Column );
+void Latency_SetSource( U8 u8Column );
+void Latency_Enqueue( U8 u8Slot );
+void Latency_Transmit( U8 u8Slot );
+void Latency_Acknowledge( U8 u8Slot );
+void Latency_GhostStart( void );
+void Latency_GhostEnd( void );
+#endif
+
+
+#endif // LATENCY_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,47 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file layout.h
+*
+* \brief Keyboard layout -- selection of the matrix profile
+*
+* \note  The profiles are generated by the layout compiler (sim/layoutc.c) from layouts/\*.layout: scancode tables,
+*        pins, column port images, chords, and the scan and debounce kernels of the matrix (Layout_ReadRows(),
+*        LAYOUT_SAMPLE_OR()). Only the selected profile is built.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef LAYOUT_H_INCLUDED
+#define LAYOUT_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Matrix profiles, see layouts/
+#define LAYOUT_PROFILE_A500_DE   1u  //!< Rev. A PCB in the A500, German keycaps
+#define LAYOUT_PROFILE_A1200_US  2u  //!< Rev. A PCB on the A1200 adapter without the diodes of the switches, US keycaps
+
+// Selected profile
+#ifndef LAYOUT_PROFILE
+#define LAYOUT_PROFILE LAYOUT_PROFILE_A500_DE
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#if ( LAYOUT_PROFILE_A500_DE == LAYOUT_PROFILE )
+#include "layouts/a500_de.h"
+#elif ( LAYOUT_PROFILE_A1200_US == LAYOUT_PROFILE )
+#include "layouts/a1200_us.h"
+#else
+#error "Unknown LAYOUT_PROFILE, see layouts/"
+#endif
+
+
+#endif // LAYOUT_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,151 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file a1200_us.c
+*
+* \brief Keyboard layout profile tables -- Amiga Compatible Keyboard Rev. A on the A1200 adapter -- marked as US keyboard
+*
+* \note  Generated by the layout compiler (sim/layoutc.c) from layouts/a1200_us.layout, do not edit!
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "stm8s.h"
+#include "types.h"
+
+// Own include -- through the selection of the profile
+#include "../layout.h"
+
+#if ( LAYOUT_PROFILE_A1200_US == LAYOUT_PROFILE )
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Matrix to scancode translation table -- base layer
+//! \note  Invalid keys are marked with LAYOUT_NO_KEY
+const U8 gcau8ScanCodeTable[ LAYOUT_ROWS ][ LAYOUT_COLS ] =
+{
+//  COL0   COL1   COL2   COL3   COL4   COL5   COL6   COL7   COL8   COL9   COL10  COL11  COL12  COL13  COL14  COL15
+  { 0x2Eu, 0x3Du, 0x1Du, 0x1Eu, 0x5Au, 0x59u, 0x58u, 0x57u, 0x56u, 0x55u, 0x54u, 0x53u, 0x52u, 0x51u, 0x50u, 0x45u },  // ROW0
+  { 0x46u, 0x41u, 0x0Du, 0x0Cu, 0x0Bu, 0x0Au, 0x09u, 0x08u, 0x07u, 0x06u, 0x05u, 0x04u, 0x03u, 0x02u, 0x01u, 0x00u },  // ROW1
+  { 0x2Fu, 0x5Fu, 0x44u, 0x1Bu, 0x1Au, 0x19u, 0x18u, 0x17u, 0x16u, 0x15u, 0x14u, 0x13u, 0x12u, 0x11u, 0x10u, 0x42u },  // ROW2
+  { 0x2Du, 0x4Cu, 0x2Bu, 0x2Au, 0x29u, 0x28u, 0x27u, 0x26u, 0x25u, 0x24u, 0x23u, 0x22u, 0x21u, 0x20u, 0x62u, 0x63u },  // ROW3
+  { 0x4Eu, 0x4Du, 0x4Fu, 0x61u, 0x3Au, 0x39u, 0x38u, 0x37u, 0x36u, 0x35u, 0x34u, 0x33u, 0x32u, 0x31u, 0x30u, 0x60u },  // ROW4
+  { 0x5Eu, 0x3Eu, 0x0Fu, 0x65u, 0x67u, 0x5Bu, 0x3Cu, 0x1Fu, 0x3Fu, 0x5Cu, 0x43u, 0x4Au, 0x5Du, 0x40u, 0x66u, 0x64u }   // ROW5
+};
+//-----------------------------------------------------------------------------------------------------------------
+// The keyboard matrix looks like this (Amiga Compatible Keyboard Rev. A on the A1200 adapter -- marked as US keyboard):
+//      COL15  COL14  COL13  COL12  COL11  COL10  COL9   COL8   COL7   COL6   COL5   COL4   COL3   COL2   COL1   COL0
+// ROW0  ESC    F1     F2     F3     F4     F5     F6     F7     F8     F9     F10    N.(    N.2    N.1    N.7    N.5    ROW0
+// ROW1  `      1      2      3      4      5      6      7      8      9      0      -      =      \      Bkspc  Del    ROW1
+// ROW2  TAB    Q      W      E      R      T      Y      U      I      O      P      [      ]      Ret    Help   N.6    ROW2
+// ROW3  Ctrl   Caps   A      S      D      F      G      H      J      K      L      ;      '      Int1   Up     N.4    ROW3
+// ROW4  LShft  Int2   Z      X      C      V      B      N      M      ,      .      /      RShift Left   Down   Right  ROW4
+// ROW5  L-Alt  LAmi   Spc    N.*    N.-    N.Ent  N./    N.9    N.3    N..    N.)    RAmi   RAlt   N.0    N.8    N.+    ROW5
+//-----------------------------------------------------------------------------------------------------------------
+
+//! \brief Scancode to matrix position (LAYOUT_POSITION()) translation table -- base layer
+//! \note  Codes without key are marked with LAYOUT_NO_KEY
+const U8 gcau8KeyPosition[ LAYOUT_SCANCODES ] =
+{
+  0x1Fu, 0x1Eu, 0x1Du, 0x1Cu, 0x1Bu, 0x1Au, 0x19u, 0x18u, 0x17u, 0x16u, 0x15u, 0x14u, 0x13u, 0x12u, 0xFFu, 0x52u,  // 0x00..0x0F
+  0x2Eu, 0x2Du, 0x2Cu, 0x2Bu, 0x2Au, 0x29u, 0x28u, 0x27u, 0x26u, 0x25u, 0x24u, 0x23u, 0xFFu, 0x02u, 0x03u, 0x57u,  // 0x10..0x1F
+  0x3Du, 0x3Cu, 0x3Bu, 0x3Au, 0x39u, 0x38u, 0x37u, 0x36u, 0x35u, 0x34u, 0x33u, 0x32u, 0xFFu, 0x30u, 0x00u, 0x20u,  // 0x20..0x2F
+  0x4Eu, 0x4Du, 0x4Cu, 0x4Bu, 0x4Au, 0x49u, 0x48u, 0x47u, 0x46u, 0x45u, 0x44u, 0xFFu, 0x56u, 0x01u, 0x51u, 0x58u,  // 0x30..0x3F
+  0x5Du, 0x11u, 0x2Fu, 0x5Au, 0x22u, 0x0Fu, 0x10u, 0xFFu, 0xFFu, 0xFFu, 0x5Bu, 0xFFu, 0x31u, 0x41u, 0x40u, 0x42u,  // 0x40..0x4F
+  0x0Eu, 0x0Du, 0x0Cu, 0x0Bu, 0x0Au, 0x09u, 0x08u, 0x07u, 0x06u, 0x05u, 0x04u, 0x55u, 0x59u, 0x5Cu, 0x50u, 0x21u,  // 0x50..0x5F
+  0x4Fu, 0x43u, 0x3Eu, 0x3Fu, 0x5Fu, 0x53u, 0x5Eu, 0x54u, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu,  // 0x60..0x6F
+  0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0xFFu   // 0x70..0x7F
+};
+
+//! \brief Matrix rows
+const S_LAYOUT_PIN gcsKeyMatrixRows[ LAYOUT_ROWS ] =
+{
+  { GPIOF, GPIO_PIN_4 },   //!< ROW0
+  { GPIOB, GPIO_PIN_7 },   //!< ROW1
+  { GPIOB, GPIO_PIN_6 },   //!< ROW2
+  { GPIOB, GPIO_PIN_4 },   //!< ROW3
+  { GPIOB, GPIO_PIN_5 },   //!< ROW4
+  { GPIOB, GPIO_PIN_3 }    //!< ROW5
+};
+
+//! \brief Matrix columns
+const S_LAYOUT_PIN gcsKeyMatrixColumns[ LAYOUT_COLS ] =
+{
+  { GPIOA, GPIO_PIN_3 },   //!< COL0
+  { GPIOB, GPIO_PIN_2 },   //!< COL1
+  { GPIOD, GPIO_PIN_7 },   //!< COL2
+  { GPIOD, GPIO_PIN_6 },   //!< COL3
+  { GPIOD, GPIO_PIN_5 },   //!< COL4
+  { GPIOD, GPIO_PIN_4 },   //!< COL5
+  { GPIOD, GPIO_PIN_3 },   //!< COL6
+  { GPIOD, GPIO_PIN_2 },   //!< COL7
+  { GPIOD, GPIO_PIN_0 },   //!< COL8
+  { GPIOC, GPIO_PIN_7 },   //!< COL9
+  { GPIOC, GPIO_PIN_6 },   //!< COL10
+  { GPIOC, GPIO_PIN_5 },   //!< COL11
+  { GPIOC, GPIO_PIN_4 },   //!< COL12
+  { GPIOC, GPIO_PIN_3 },   //!< COL13
+  { GPIOC, GPIO_PIN_2 },   //!< COL14
+  { GPIOE, GPIO_PIN_5 }    //!< COL15
+};
+
+//! \brief Ports of the columns
+GPIO_TypeDef* const gcapsColumnPorts[ LAYOUT_COLUMN_PORTS ] = { GPIOA, GPIOB, GPIOC, GPIOD, GPIOE };
+
+//! \brief Column pins of the ports
+const U8 gcau8ColumnPortMask[ LAYOUT_COLUMN_PORTS ] = { 0x08u, 0x04u, 0xFCu, 0xFDu, 0x20u };
+
+//! \brief Column pins of the ports, while a column is selected (driven low, the others are released)
+const U8 gcau8ColumnPortImage[ LAYOUT_COLS ][ LAYOUT_COLUMN_PORTS ] =
+{
+//  GPIOA  GPIOB  GPIOC  GPIOD  GPIOE
+  { 0x00u, 0x04u, 0xFCu, 0xFDu, 0x20u },  // COL0
+  { 0x08u, 0x00u, 0xFCu, 0xFDu, 0x20u },  // COL1
+  { 0x08u, 0x04u, 0xFCu, 0x7Du, 0x20u },  // COL2
+  { 0x08u, 0x04u, 0xFCu, 0xBDu, 0x20u },  // COL3
+  { 0x08u, 0x04u, 0xFCu, 0xDDu, 0x20u },  // COL4
+  { 0x08u, 0x04u, 0xFCu, 0xEDu, 0x20u },  // COL5
+  { 0x08u, 0x04u, 0xFCu, 0xF5u, 0x20u },  // COL6
+  { 0x08u, 0x04u, 0xFCu, 0xF9u, 0x20u },  // COL7
+  { 0x08u, 0x04u, 0xFCu, 0xFCu, 0x20u },  // COL8
+  { 0x08u, 0x04u, 0x7Cu, 0xFDu, 0x20u },  // COL9
+  { 0x08u, 0x04u, 0xBCu, 0xFDu, 0x20u },  // COL10
+  { 0x08u, 0x04u, 0xDCu, 0xFDu, 0x20u },  // COL11
+  { 0x08u, 0x04u, 0xECu, 0xFDu, 0x20u },  // COL12
+  { 0x08u, 0x04u, 0xF4u, 0xFDu, 0x20u },  // COL13
+  { 0x08u, 0x04u, 0xF8u, 0xFDu, 0x20u },  // COL14
+  { 0x08u, 0x04u, 0xFCu, 0xFDu, 0x00u }   // COL15
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Reads the rows of the matrix -- the scan kernel of the profile
+ * \param  -
+ * \return Bit n is ROWn (1 means open), the bits of nonexistent rows are 0
+ * \note   Called from the IT routine. One read per port of the rows, instead of one per row.
+ *********************************************************************/
+U8 Layout_ReadRows( void )
+{
+  U8 u8PortB = GPIO_ReadInputData( GPIOB );
+  U8 u8PortF = GPIO_ReadInputData( GPIOF );
+
+  return (U8)( ( (U8)( u8PortF >> 4u ) & 0x01u )
+             | ( (U8)( u8PortB >> 6u ) & 0x02u )
+             | ( (U8)( u8PortB >> 4u ) & 0x04u )
+             | ( (U8)( u8PortB >> 1u ) & 0x18u )
+             | ( (U8)( u8PortB << 2u ) & 0x20u ) );
+}
+
+#endif // LAYOUT_PROFILE_A1200_US
+/******************************<EOF>**********************************/
@@ -0,0 +1,185 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file a500_de.h
+*
+* \brief Keyboard layout profile -- Amiga Compatible Keyboard Rev. A -- marked as German keyboard
+*
+* \note  Generated by the layout compiler (sim/layoutc.c) from layouts/a500_de.layout, do not edit!
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef LAYOUT_A500_DE_H_INCLUDED
+#define LAYOUT_A500_DE_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "stm8s.h"
+#include "types.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define LAYOUT_NAME           "Amiga Compatible Keyboard Rev. A -- marked as German keyboard"
+#define LAYOUT_PROFILE_NAME   "a500_de"  //!< Name of the description in layouts/
+#define LAYOUT_ROWS           6u     //!< Size of the matrix of the layout, see MATRIX_ROW and MATRIX_COL
+#define LAYOUT_COLS           16u
+#define LAYOUT_SCANCODES      128u   //!< Entries of the inverse table, one per key code
+#define LAYOUT_NO_KEY         0xFFu  //!< Code of a position without key, and position of a code without key
+#define LAYOUT_COLUMN_PORTS   5u     //!< Ports with column pins
+#define LAYOUT_SAMPLES        2u     //!< Closed samples of a press, see MATRIX_SAMPLE
+#define LAYOUT_DIODES         1u     //!< 1: a diode at each switch, 0: three keys can close a fourth one, see MATRIX_ANTIGHOST
+
+#define LAYOUT_POSITION( ROW, COL )      ( (U8)( ( (ROW) << 4u ) | (COL) ) )  //!< Packs a matrix position into one byte
+#define LAYOUT_POSITION_ROW( POSITION )  ( (U8)( (POSITION) >> 4u ) )
+#define LAYOUT_POSITION_COL( POSITION )  ( (U8)( (POSITION) & 0x0Fu ) )
+
+//! Debounce kernel: a key is closed, if it is 0 in every sample of its column (LAYOUT_SAMPLES bytes)
+#define LAYOUT_SAMPLE_OR( SAMPLES )      ( (U8)( (SAMPLES)[ 0u ] | (SAMPLES)[ 1u ] ) )
+
+// Positions of the keys
+#define LAYOUT_KEY_ESC          LAYOUT_POSITION( 0u, 15u )  //!< ESC
+#define LAYOUT_KEY_F1           LAYOUT_POSITION( 0u, 14u )  //!< F1
+#define LAYOUT_KEY_F2           LAYOUT_POSITION( 0u, 13u )  //!< F2
+#define LAYOUT_KEY_F3           LAYOUT_POSITION( 0u, 12u )  //!< F3
+#define LAYOUT_KEY_F4           LAYOUT_POSITION( 0u, 11u )  //!< F4
+#define LAYOUT_KEY_F5           LAYOUT_POSITION( 0u, 10u )  //!< F5
+#define LAYOUT_KEY_F6           LAYOUT_POSITION( 0u,  9u )  //!< F6
+#define LAYOUT_KEY_F7           LAYOUT_POSITION( 0u,  8u )  //!< F7
+#define LAYOUT_KEY_F8           LAYOUT_POSITION( 0u,  7u )  //!< F8
+#define LAYOUT_KEY_F9           LAYOUT_POSITION( 0u,  6u )  //!< F9
+#define LAYOUT_KEY_F10          LAYOUT_POSITION( 0u,  5u )  //!< F10
+#define LAYOUT_KEY_KP_LPAREN    LAYOUT_POSITION( 0u,  4u )  //!< N.(
+#define LAYOUT_KEY_KP_2         LAYOUT_POSITION( 0u,  3u )  //!< N.2
+#define LAYOUT_KEY_KP_1         LAYOUT_POSITION( 0u,  2u )  //!< N.1
+#define LAYOUT_KEY_KP_7         LAYOUT_POSITION( 0u,  1u )  //!< N.7
+#define LAYOUT_KEY_KP_5         LAYOUT_POSITION( 0u,  0u )  //!< N.5
+#define LAYOUT_KEY_GRAVE        LAYOUT_POSITION( 1u, 15u )  //!< ~
+#define LAYOUT_KEY_1            LAYOUT_POSITION( 1u, 14u )  //!< 1
+#define LAYOUT_KEY_2            LAYOUT_POSITION( 1u, 13u )  //!< 2
+#define LAYOUT_KEY_3            LAYOUT_POSITION( 1u, 12u )  //!< 3
+#define LAYOUT_KEY_4            LAYOUT_POSITION( 1u, 11u )  //!< 4
+#define LAYOUT_KEY_5            LAYOUT_POSITION( 1u, 10u )  //!< 5
+#define LAYOUT_KEY_6            LAYOUT_POSITION( 1u,  9u )  //!< 6
+#define LAYOUT_KEY_7            LAYOUT_POSITION( 1u,  8u )  //!< 7
+#define LAYOUT_KEY_8            LAYOUT_POSITION( 1u,  7u )  //!< 8
+#define LAYOUT_KEY_9            LAYOUT_POSITION( 1u,  6u )  //!< 9
+#define LAYOUT_KEY_0            LAYOUT_POSITION( 1u,  5u )  //!< 0
+#define LAYOUT_KEY_MINUS        LAYOUT_POSITION( 1u,  4u )  //!< ß
+#define LAYOUT_KEY_EQUAL        LAYOUT_POSITION( 1u,  3u )  //!< '
+#define LAYOUT_KEY_BACKSLASH    LAYOUT_POSITION( 1u,  2u )  //!< \ key
+#define LAYOUT_KEY_BACKSPACE    LAYOUT_POSITION( 1u,  1u )  //!< Bkspc
+#define LAYOUT_KEY_DEL          LAYOUT_POSITION( 1u,  0u )  //!< Del
+#define LAYOUT_KEY_TAB          LAYOUT_POSITION( 2u, 15u )  //!< TAB
+#define LAYOUT_KEY_Q            LAYOUT_POSITION( 2u, 14u )  //!< Q
+#define LAYOUT_KEY_W            LAYOUT_POSITION( 2u, 13u )  //!< W
+#define LAYOUT_KEY_E            LAYOUT_POSITION( 2u, 12u )  //!< E
+#define LAYOUT_KEY_R            LAYOUT_POSITION( 2u, 11u )  //!< R
+#define LAYOUT_KEY_T            LAYOUT_POSITION( 2u, 10u )  //!< T
+#define LAYOUT_KEY_Y            LAYOUT_POSITION( 2u,  9u )  //!< Z
+#define LAYOUT_KEY_U            LAYOUT_POSITION( 2u,  8u )  //!< U
+#define LAYOUT_KEY_I            LAYOUT_POSITION( 2u,  7u )  //!< I
+#define LAYOUT_KEY_O            LAYOUT_POSITION( 2u,  6u )  //!< O
+#define LAYOUT_KEY_P            LAYOUT_POSITION( 2u,  5u )  //!< P
+#define LAYOUT_KEY_LBRACKET     LAYOUT_POSITION( 2u,  4u )  //!< Ü
+#define LAYOUT_KEY_RBRACKET     LAYOUT_POSITION( 2u,  3u )  //!< +
+#define LAYOUT_KEY_RETURN       LAYOUT_POSITION( 2u,  2u )  //!< Ret
+#define LAYOUT_KEY_HELP         LAYOUT_POSITION( 2u,  1u )  //!< Help
+#define LAYOUT_KEY_KP_6         LAYOUT_POSITION( 2u,  0u )  //!< N.6
+#define LAYOUT_KEY_CTRL         LAYOUT_POSITION( 3u, 15u )  //!< Ctrl
+#define LAYOUT_KEY_CAPS         LAYOUT_POSITION( 3u, 14u )  //!< Caps
+#define LAYOUT_KEY_A            LAYOUT_POSITION( 3u, 13u )  //!< A
+#define LAYOUT_KEY_S            LAYOUT_POSITION( 3u, 12u )  //!< S
+#define LAYOUT_KEY_D            LAYOUT_POSITION( 3u, 11u )  //!< D
+#define LAYOUT_KEY_F            LAYOUT_POSITION( 3u, 10u )  //!< F
+#define LAYOUT_KEY_G            LAYOUT_POSITION( 3u,  9u )  //!< G
+#define LAYOUT_KEY_H            LAYOUT_POSITION( 3u,  8u )  //!< H
+#define LAYOUT_KEY_J            LAYOUT_POSITION( 3u,  7u )  //!< J
+#define LAYOUT_KEY_K            LAYOUT_POSITION( 3u,  6u )  //!< K
+#define LAYOUT_KEY_L            LAYOUT_POSITION( 3u,  5u )  //!< L
+#define LAYOUT_KEY_SEMICOLON    LAYOUT_POSITION( 3u,  4u )  //!< Ö
+#define LAYOUT_KEY_QUOTE        LAYOUT_POSITION( 3u,  3u )  //!< Ä
+#define LAYOUT_KEY_INTL1        LAYOUT_POSITION( 3u,  2u )  //!< #
+#define LAYOUT_KEY_UP           LAYOUT_POSITION( 3u,  1u )  //!< Up
+#define LAYOUT_KEY_KP_4         LAYOUT_POSITION( 3u,  0u )  //!< N.4
+#define LAYOUT_KEY_LSHIFT       LAYOUT_POSITION( 4u, 15u )  //!< LShft
+#define LAYOUT_KEY_INTL2        LAYOUT_POSITION( 4u, 14u )  //!< <>
+#define LAYOUT_KEY_Z            LAYOUT_POSITION( 4u, 13u )  //!< Y
+#define LAYOUT_KEY_X            LAYOUT_POSITION( 4u, 12u )  //!< X
+#define LAYOUT_KEY_C            LAYOUT_POSITION( 4u, 11u )  //!< C
+#define LAYOUT_KEY_V            LAYOUT_POSITION( 4u, 10u )  //!< V
+#define LAYOUT_KEY_B            LAYOUT_POSITION( 4u,  9u )  //!< B
+#define LAYOUT_KEY_N            LAYOUT_POSITION( 4u,  8u )  //!< N
+#define LAYOUT_KEY_M            LAYOUT_POSITION( 4u,  7u )  //!< M
+#define LAYOUT_KEY_COMMA        LAYOUT_POSITION( 4u,  6u )  //!< ,
+#define LAYOUT_KEY_PERIOD       LAYOUT_POSITION( 4u,  5u )  //!< .
+#define LAYOUT_KEY_SLASH        LAYOUT_POSITION( 4u,  4u )  //!< -
+#define LAYOUT_KEY_RSHIFT       LAYOUT_POSITION( 4u,  3u )  //!< RShift
+#define LAYOUT_KEY_LEFT         LAYOUT_POSITION( 4u,  2u )  //!< Left
+#define LAYOUT_KEY_DOWN         LAYOUT_POSITION( 4u,  1u )  //!< Down
+#define LAYOUT_KEY_RIGHT        LAYOUT_POSITION( 4u,  0u )  //!< Right
+#define LAYOUT_KEY_LALT         LAYOUT_POSITION( 5u, 15u )  //!< L-Alt
+#define LAYOUT_KEY_LAMIGA       LAYOUT_POSITION( 5u, 14u )  //!< LAmi
+#define LAYOUT_KEY_SPACE        LAYOUT_POSITION( 5u, 13u )  //!< Spc
+#define LAYOUT_KEY_KP_ASTERISK  LAYOUT_POSITION( 5u, 12u )  //!< N.*
+#define LAYOUT_KEY_KP_MINUS     LAYOUT_POSITION( 5u, 11u )  //!< N.-
+#define LAYOUT_KEY_KP_ENTER     LAYOUT_POSITION( 5u, 10u )  //!< N.Ent
+#define LAYOUT_KEY_KP_SLASH     LAYOUT_POSITION( 5u,  9u )  //!< N./
+#define LAYOUT_KEY_KP_9         LAYOUT_POSITION( 5u,  8u )  //!< N.9
+#define LAYOUT_KEY_KP_3         LAYOUT_POSITION( 5u,  7u )  //!< N.3
+#define LAYOUT_KEY_KP_PERIOD    LAYOUT_POSITION( 5u,  6u )  //!< N..
+#define LAYOUT_KEY_KP_RPAREN    LAYOUT_POSITION( 5u,  5u )  //!< N.)
+#define LAYOUT_KEY_RAMIGA       LAYOUT_POSITION( 5u,  4u )  //!< RAmi
+#define LAYOUT_KEY_RALT         LAYOUT_POSITION( 5u,  3u )  //!< RAlt
+#define LAYOUT_KEY_KP_0         LAYOUT_POSITION( 5u,  2u )  //!< N.0
+#define LAYOUT_KEY_KP_8         LAYOUT_POSITION( 5u,  1u )  //!< N.8
+#define LAYOUT_KEY_KP_PLUS      LAYOUT_POSITION( 5u,  0u )  //!< N.+
+
+// Key combinations: initializers of U_MATRIX_BITMAP (bit n of a column byte belongs to ROWn)
+#define LAYOUT_CHORD_RESET        { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x08u } }  //!< CTRL + LAMIGA + RAMIGA
+#define LAYOUT_CHORD_LAYER_BASE   { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x21u, 0x00u } }  //!< LAMIGA + RAMIGA + F1
+#define LAYOUT_CHORD_LAYER_SWAP   { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x01u, 0x20u, 0x00u } }  //!< LAMIGA + RAMIGA + F2
+#define LAYOUT_CHORD_LAYER_USER   { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x01u, 0x00u, 0x20u, 0x00u } }  //!< LAMIGA + RAMIGA + F3
+#define LAYOUT_CHORD_MACRO_RECORD { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u, 0x01u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u } }  //!< LAMIGA + RAMIGA + F9
+#define LAYOUT_CHORD_MACRO_PLAY   { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x01u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u } }  //!< LAMIGA + RAMIGA + F10
+#define LAYOUT_CHORD_SELFBENCH    { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x01u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u } }  //!< LAMIGA + RAMIGA + F5
+#define LAYOUT_CHORD_BOOT         { { 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x00u, 0x20u, 0x01u } }  //!< LAMIGA + RAMIGA + ESC
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Element of logic bit -- GPIO pin assignment tables
+typedef struct
+{
+  GPIO_TypeDef*    psGPIOPort;
+  GPIO_Pin_TypeDef ePin;
+} S_LAYOUT_PIN;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+extern const U8           gcau8ScanCodeTable[ LAYOUT_ROWS ][ LAYOUT_COLS ];
+extern const U8           gcau8KeyPosition[ LAYOUT_SCANCODES ];
+extern const S_LAYOUT_PIN gcsKeyMatrixRows[ LAYOUT_ROWS ];
+extern const S_LAYOUT_PIN gcsKeyMatrixColumns[ LAYOUT_COLS ];
+extern GPIO_TypeDef* const gcapsColumnPorts[ LAYOUT_COLUMN_PORTS ];
+extern const U8           gcau8ColumnPortMask[ LAYOUT_COLUMN_PORTS ];
+extern const U8           gcau8ColumnPortImage[ LAYOUT_COLS ][ LAYOUT_COLUMN_PORTS ];
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+U8 Layout_ReadRows( void );
+
+
+#endif // LAYOUT_A500_DE_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,402 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file macro.c
+*
+* \brief Key sequence recording and playback
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include "stm8s.h"
+#include "types.h"
+#include "matrix.h"
+#include "config.h"
+#include "eeprom_map.h"
+
+// Own include
+#include "macro.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Format of the macro in the data EEPROM:
+//   byte 0: number of key codes (N), 0 means no macro (erased bytes read as 0x00)
+//   byte 1: check byte -- MACRO_CHECK_SEED XOR all the other bytes
+//   byte 2..N+1: key codes in the communication format of the Amiga (code << 1, bit 0 set on release)
+// The area is written word by word, the word of the count and the check byte last.
+#define MACRO_CHECK_SEED    0x3Cu
+#define MACRO_WORD_SIZE     4u
+#define MACRO_CAPS_LOCK     0x62u  //!< Not recorded: its code depends on the state of the LED, see amiga_key.c
+
+// States
+#define MACRO_STATE_IDLE          0u
+#define MACRO_STATE_ARM_RECORD    1u  //!< Recording requested, waiting for the keys of the chord to be released
+#define MACRO_STATE_RECORDING     2u
+#define MACRO_STATE_STORE         3u  //!< Writing the data EEPROM
+#define MACRO_STATE_ARM_PLAY      4u  //!< Playback requested, waiting for the keys of the chord to be released
+#define MACRO_STATE_PLAYING       5u  //!< The codes are streamed by AmigaKey_Cycle()
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+//! \brief The macro, and the state of recording and playback -- owned by the main cycle
+static struct
+{
+  U8  au8Code[ MACRO_CODE_MAX ];  //!< Key codes in the communication format
+  U8  u8Count;                    //!< Number of key codes
+  U8  u8State;                    //!< MACRO_STATE_...
+  U8  u8Index;                    //!< Playback: next code / Store: next word to write
+  U8  u8Pacing;                   //!< Playback: scans between two codes (0: as fast as the computer acknowledges)
+  U16 u16NextScan;                //!< Playback: scan of the next code
+  U8  u8RecordRequests;           //!< Requests seen by the main cycle, see gu8RecordRequests
+  U8  u8PlayRequests;
+} gsMacro;
+
+// Incremented by the chord actions (IT routine), the main cycle only reads them: a request is never lost
+volatile static U8 gu8RecordRequests;
+volatile static U8 gu8PlayRequests;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U8   GetImageByte( U8 u8Index );
+static void Trim( void );
+static U16  GetScanCount( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Gets a byte of the EEPROM image of the macro
+ * \param  u8Index: offset in the area
+ * \return Value of the byte
+ *********************************************************************/
+static U8 GetImageByte( U8 u8Index )
+{
+  U8 u8Ret = 0u;
+  U8 u8Code;
+
+  if( 0u == u8Index )
+  {
+    u8Ret = gsMacro.u8Count;
+  }
+  else if( 1u == u8Index )
+  {
+    u8Ret = MACRO_CHECK_SEED ^ gsMacro.u8Count;
+    for( u8Code = 0u; u8Code < gsMacro.u8Count; u8Code++ )
+    {
+      u8Ret ^= gsMacro.au8Code[ u8Code ];
+    }
+  }
+  else if( ( u8Index - 2u ) < gsMacro.u8Count )
+  {
+    u8Ret = gsMacro.au8Code[ u8Index - 2u ];
+  }
+
+  return u8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  Keeps only the presses, that are released in the recording, and their releases
+ * \param  -
+ * \return -
+ * \note   Drops the keys of the chord, that stopped the recording, and the keys pressed before the buffer got full.
+ *********************************************************************/
+static void Trim( void )
+{
+  U32 u32Paired = 0u;  // bit n: the nth code is kept
+  U8  u8Press;
+  U8  u8Release;
+  U8  u8Count = 0u;
+
+  // every press is paired with the first free release of the same key after it
+  for( u8Press = 0u; u8Press < gsMacro.u8Count; u8Press++ )
+  {
+    if( 0u == ( gsMacro.au8Code[ u8Press ] & 0x01u ) )
+    {
+      for( u8Release = u8Press + 1u; u8Release < gsMacro.u8Count; u8Release++ )
+      {
+        if( ( gsMacro.au8Code[ u8Release ] == ( gsMacro.au8Code[ u8Press ] | 0x01u ) ) && ( 0u == ( u32Paired & ( 1uL << u8Release ) ) ) )
+        {
+          u32Paired |= ( 1uL << u8Press ) | ( 1uL << u8Release );
+          u8Release = gsMacro.u8Count;
+        }
+      }
+    }
+  }
+
+  for( u8Press = 0u; u8Press < gsMacro.u8Count; u8Press++ )
+  {
+    if( 0u != ( u32Paired & ( 1uL << u8Press ) ) )
+    {
+      gsMacro.au8Code[ u8Count ] = gsMacro.au8Code[ u8Press ];
+      u8Count++;
+    }
+  }
+  gsMacro.u8Count = u8Count;
+}
+
+/*! *******************************************************************
+ * \brief  Gets the sequence number of the last complete scan -- the time base of the pacing (5 ms)
+ * \param  -
+ * \return Scan count
+ *********************************************************************/
+static U16 GetScanCount( void )
+{
+  S_MATRIX_SNAPSHOT sSnapshot;
+
+  Matrix_GetSnapshot( &sSnapshot );
+
+  return sSnapshot.u16ScanCount;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init -- loads the macro stored in the data EEPROM
+ * \param  -
+ * \return -
+ * \note   An empty or corrupted macro is not played.
+ *********************************************************************/
+void Macro_Init( void )
+{
+  U8 u8Index;
+  U8 u8Check;
+
+  memset( (void*)&gsMacro, 0x00u, sizeof( gsMacro ) );
+  gsMacro.u8RecordRequests = gu8RecordRequests;
+  gsMacro.u8PlayRequests   = gu8PlayRequests;
+
+  gsMacro.u8Count = FLASH_ReadByte( EEPROM_MACRO_ADDRESS );
+  if( gsMacro.u8Count <= MACRO_CODE_MAX )
+  {
+    for( u8Index = 0u; u8Index < gsMacro.u8Count; u8Index++ )
+    {
+      gsMacro.au8Code[ u8Index ] = FLASH_ReadByte( EEPROM_MACRO_ADDRESS + 2u + u8Index );
+    }
+    u8Check = FLASH_ReadByte( EEPROM_MACRO_ADDRESS + 1u );
+    if( u8Check != GetImageByte( 1u ) )
+    {
+      gsMacro.u8Count = 0u;
+    }
+  }
+  else
+  {
+    gsMacro.u8Count = 0u;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Main cycle -- starts and stops recording and playback, stores the macro
+ * \param  -
+ * \return -
+ * \note   Must be called from main cycle! Recording and playback start, when the keys of the chord are released, so
+ *         they are neither recorded, nor held during the playback. Writes at most one word per call.
+ *********************************************************************/
+void Macro_Cycle( void )
+{
+  U8   u8Requests;
+  BOOL bRecord;
+  BOOL bPlay;
+  U32  u32Word;
+  U16  u16Pacing;
+
+  u8Requests = gu8RecordRequests;
+  bRecord = ( u8Requests != gsMacro.u8RecordRequests ) ? TRUE : FALSE;
+  gsMacro.u8RecordRequests = u8Requests;
+  u8Requests = gu8PlayRequests;
+  bPlay = ( u8Requests != gsMacro.u8PlayRequests ) ? TRUE : FALSE;
+  gsMacro.u8PlayRequests = u8Requests;
+
+  if( MACRO_STATE_IDLE == gsMacro.u8State )
+  {
+    if( TRUE == bRecord )
+    {
+      gsMacro.u8State = MACRO_STATE_ARM_RECORD;
+    }
+    else if( ( TRUE == bPlay ) && ( 0u != gsMacro.u8Count ) )
+    {
+      gsMacro.u8State = MACRO_STATE_ARM_PLAY;
+    }
+  }
+  else if( MACRO_STATE_ARM_RECORD == gsMacro.u8State )
+  {
+    if( TRUE == bRecord )  // pressed again: cancelled, the stored macro is kept
+    {
+      gsMacro.u8State = MACRO_STATE_IDLE;
+    }
+    else if( TRUE == Matrix_IsIdle() )
+    {
+      gsMacro.u8Count = 0u;
+      gsMacro.u8State = MACRO_STATE_RECORDING;
+    }
+  }
+  else if( MACRO_STATE_RECORDING == gsMacro.u8State )
+  {
+    if( TRUE == bRecord )
+    {
+      Trim();
+      gsMacro.u8Index = (U8)( ( 2u + gsMacro.u8Count - 1u ) / MACRO_WORD_SIZE );  // the last word used
+      gsMacro.u8State = MACRO_STATE_STORE;
+    }
+  }
+  else if( MACRO_STATE_STORE == gsMacro.u8State )
+  {
+    // like the configuration log, the EEPROM is written only when the keyboard is idle
+    if( TRUE == Matrix_IsIdle() )
+    {
+      u32Word = ( (U32)GetImageByte( gsMacro.u8Index * MACRO_WORD_SIZE ) << 24u )
+              | ( (U32)GetImageByte( gsMacro.u8Index * MACRO_WORD_SIZE + 1u ) << 16u )
+              | ( (U32)GetImageByte( gsMacro.u8Index * MACRO_WORD_SIZE + 2u ) << 8u )
+              | (U32)GetImageByte( gsMacro.u8Index * MACRO_WORD_SIZE + 3u );
+      FLASH_Unlock( FLASH_MEMTYPE_DATA );
+      FLASH_ProgramWord( EEPROM_MACRO_ADDRESS + ( gsMacro.u8Index * MACRO_WORD_SIZE ), u32Word );  // the first byte goes to the lowest address
+      FLASH_WaitForLastOperation( FLASH_MEMTYPE_DATA );
+      FLASH_Lock( FLASH_MEMTYPE_DATA );
+
+      if( 0u == gsMacro.u8Index )
+      {
+        gsMacro.u8State = MACRO_STATE_IDLE;
+      }
+      else
+      {
+        gsMacro.u8Index--;
+      }
+    }
+  }
+  else if( MACRO_STATE_ARM_PLAY == gsMacro.u8State )
+  {
+    if( TRUE == Matrix_IsIdle() )
+    {
+      if( ( FALSE == Config_Read( CONFIG_KEY_MACRO_PACING, &u16Pacing ) ) || ( u16Pacing > 0xFFu ) )
+      {
+        u16Pacing = 0u;
+      }
+      gsMacro.u8Pacing    = (U8)u16Pacing;
+      gsMacro.u16NextScan = GetScanCount();
+      gsMacro.u8Index     = 0u;
+      gsMacro.u8State     = MACRO_STATE_PLAYING;
+    }
+  }
+  else
+  {
+    // MACRO_STATE_PLAYING: AmigaKey_Cycle() streams the codes, the requests are ignored meanwhile
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Starts or stops recording
+ * \param  -
+ * \return -
+ * \note   Can be called from the IT routine (eg. as a chord action).
+ *********************************************************************/
+void Macro_RequestRecord( void )
+{
+  gu8RecordRequests++;
+}
+
+/*! *******************************************************************
+ * \brief  Starts the playback of the macro
+ * \param  -
+ * \return -
+ * \note   Can be called from the IT routine (eg. as a chord action).
+ *********************************************************************/
+void Macro_RequestPlay( void )
+{
+  gu8PlayRequests++;
+}
+
+/*! *******************************************************************
+ * \brief  Records a key event, while recording
+ * \param  u8Code: scancode of the key
+ * \param  bIsPressed: TRUE, if the key is pressed; FALSE, if it's released
+ * \return -
+ * \note   Must be called from main cycle, with the events registered to the computer!
+ *********************************************************************/
+void Macro_Record( U8 u8Code, BOOL bIsPressed )
+{
+  if( ( MACRO_STATE_RECORDING == gsMacro.u8State ) && ( MACRO_CAPS_LOCK != u8Code ) && ( gsMacro.u8Count < MACRO_CODE_MAX ) )
+  {
+    gsMacro.au8Code[ gsMacro.u8Count ] = (U8)( u8Code << 1u ) | ( TRUE == bIsPressed ? 0u : 1u );  // Amiga communication format
+    gsMacro.u8Count++;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Reads the next code of the playback
+ * \param  pu8Code: the code will be put here, in the communication format
+ * \return TRUE, if a code is due; FALSE, if there is none, or the pacing delays it
+ * \note   Must be called from main cycle! This function does not remove the code, see Macro_RemoveCode().
+ *********************************************************************/
+BOOL Macro_ReadCode( U8* pu8Code )
+{
+  BOOL bRet = FALSE;
+
+  if( MACRO_STATE_PLAYING == gsMacro.u8State )
+  {
+    if( ( 0u == gsMacro.u8Pacing ) || ( (U16)( GetScanCount() - gsMacro.u16NextScan ) < 0x8000u ) )
+    {
+      *pu8Code = gsMacro.au8Code[ gsMacro.u8Index ];
+      bRet = TRUE;
+    }
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Removes the code of the playback, that has been acknowledged by the computer
+ * \param  -
+ * \return -
+ *********************************************************************/
+void Macro_RemoveCode( void )
+{
+  if( MACRO_STATE_PLAYING == gsMacro.u8State )
+  {
+    gsMacro.u8Index++;
+    if( gsMacro.u8Index >= gsMacro.u8Count )
+    {
+      gsMacro.u8State = MACRO_STATE_IDLE;
+    }
+    else if( 0u != gsMacro.u8Pacing )
+    {
+      gsMacro.u16NextScan = GetScanCount() + gsMacro.u8Pacing;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Checks, whether the macro is being played
+ * \param  -
+ * \return TRUE, from the start of the playback until the last code is acknowledged
+ *********************************************************************/
+BOOL Macro_IsPlaying( void )
+{
+  return ( MACRO_STATE_PLAYING == gsMacro.u8State ) ? TRUE : FALSE;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,52 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file macro.h
+*
+* \brief Key sequence recording and playback
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef MACRO_H_INCLUDED
+#define MACRO_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define MACRO_CODE_MAX      30u  //!< Key codes of a macro (the data EEPROM area, minus the count and the check byte)
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Macro_Init( void );
+void Macro_Cycle( void );
+void Macro_RequestRecord( void );
+void Macro_RequestPlay( void );
+void Macro_Record( U8 u8Code, BOOL bIsPressed );
+BOOL Macro_ReadCode( U8* pu8Code );
+void Macro_RemoveCode( void );
+BOOL Macro_IsPlaying( void );
+
+
+#endif // MACRO_H_INCLUDED
+/******************************<EOF>**********************************/
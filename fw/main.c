@@ -36,6 +36,13 @@
 #include "types.h"
 #include "delay.h"
 #include "matrix.h"
+#include "keymap.h"
+#include "config.h"
+#include "macro.h"
+#include "keystats.h"
+#include "selfbench.h"
+#include "latency.h"
+#include "trace.h"
 #include "amiga_key.h"
 
 /* Private defines -----------------------------------------------------------*/
@@ -45,6 +52,14 @@
 #error F_CPU is not defined!
 #endif
 
+#if ( F_CPU != DELAY_F_CPU )
+#error delay_us() only works at 16 MHz CPU clock speed!
+#endif
+
+#if ( ( ( F_CPU / 1000000u ) * MATRIX_SCAN_US ) / MATRIX_COL != MATRIX_TICK_RELOAD )
+#error The sampling tick of matrix.h is calculated for 16 MHz CPU clock speed!
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
 
 /* Private functions ---------------------------------------------------------*/
@@ -57,11 +72,18 @@ void main(void)
   
   //TODO: selftests --  flash CRC, watchdog, timers, etc.
   
+  LATENCY_INIT();
+  TRACE_INIT();
+  Config_Init();
+  Keymap_Init();
+  Macro_Init();
+  KeyStats_Init();
+  SelfBench_Init();
   Matrix_Init();
   AmigaKey_Init();
   
   // Timer 2 init -- this will be used for sampling the keys
-  TIM2_TimeBaseInit( TIM2_PRESCALER_1, 5000u );  //TODO: az 5000u a 16 MHz-es órajelből, az 5 ms prellegési időből és a 16 oszlopból (column) jön ki. A konstansokból kéretik számolni!
+  TIM2_TimeBaseInit( TIM2_PRESCALER_1, MATRIX_TICK_RELOAD );  // one column per tick, a scan in MATRIX_SCAN_US
   TIM2_ITConfig( TIM2_IT_UPDATE, ENABLE );
   TIM2_Cmd( ENABLE );
   
@@ -71,7 +93,12 @@ void main(void)
   while( TRUE )
   {
     Matrix_Cycle();
+    Keymap_Cycle();
+    Macro_Cycle();
+    SelfBench_Cycle();
     AmigaKey_Cycle();
+    Config_Cycle();
+    KeyStats_Cycle();
   }
 }
 
@@ -15,9 +15,18 @@
 // Include files
 //--------------------------------------------------------------------------------------------------------/
 #include <string.h>
+#include <intrinsics.h>
 #include "stm8s.h"
 #include "types.h"
 #include "amiga_key.h"
+#include "chord.h"
+#include "config.h"
+#include "keymap.h"
+#include "keystats.h"
+#include "layout.h"
+#include "macro.h"
+#include "latency.h"
+#include "trace.h"
 
 // Own include
 #include "matrix.h"
@@ -27,79 +36,35 @@
 // Definitions
 //--------------------------------------------------------------------------------------------------------/
 // Matrix definitions
-#define MATRIX_ROW      6u    //!< Number of rows in the keyboard matrix (max. 8)
-#define MATRIX_COL      16u   //!< Number of columns in the keyboard matrix (note, that there are max. 8 rows)
-#define MATRIX_SAMPLE   2u    //!< Number of samples per key -- used for debouncing
+#define MATRIX_SAMPLE   LAYOUT_SAMPLES  //!< Number of samples per key -- used for debouncing, set by the profile
 
+// Release hold-off: a release is registered after this many open samples of the key in a row (one sample per scan,
+// 5 ms). It adapts per key to the longest bounce seen recently, within the bounds configured by CONFIG_KEY_DEBOUNCE:
+// every second clean release (an open run reaching MATRIX_BOUNCE_WINDOW) lowers the learned bounce by one scan.
+#define MATRIX_HOLDOFF_MIN      1u    //!< Default lower bound -- a fresh switch is released at its first open sample
+#define MATRIX_HOLDOFF_MAX      4u    //!< Default upper bound
+#define MATRIX_BOUNCE_WINDOW    8u    //!< Scans: a key closing again within this many open samples has bounced (max. 8)
+#define MATRIX_BOUNCE_RUN       0x0Fu //!< Bits of the open run in gau8KeyBounce -- above the window: closed once after it
+#define MATRIX_BOUNCE_LENGTH    0x70u //!< Bits of the bounce in gau8KeyBounce (max. MATRIX_BOUNCE_WINDOW - 1)
+#define MATRIX_BOUNCE_AGED      0x80u //!< Bit of gau8KeyBounce: a clean release since the last bounce, the next one lowers it
 
-//--------------------------------------------------------------------------------------------------------/
-// Types
-//--------------------------------------------------------------------------------------------------------/
-//! \brief Element of logic bit -- GPIO pin assignment tables
-typedef struct
-{
-  GPIO_TypeDef*    psGPIOPort;
-  GPIO_Pin_TypeDef ePin;
-} S_MATRIX_GPIO_DESC;
+// Cost of the ghost key test, called with the number of columns of the loop. Empty on the target (it is measured there
+// with LATENCY_ENABLED, see gsLatencyBlock), the host simulation defines the hook and consumes the CPU cycles.
+#ifdef MATRIX_GHOST_HOOK
+void MATRIX_GHOST_HOOK( U8 u8Compared );
+#define MATRIX_GHOST_COST( COMPARED )  MATRIX_GHOST_HOOK( COMPARED )
+#else
+#define MATRIX_GHOST_COST( COMPARED )
+#endif
 
-
-//--------------------------------------------------------------------------------------------------------/
-// Constants
-//--------------------------------------------------------------------------------------------------------/
-//!\brief Matrix rows -- there are max. 8 rows!
-static const S_MATRIX_GPIO_DESC gcsKeyMatrixRows[ MATRIX_ROW ] =
-{
-  { GPIOF, GPIO_PIN_4 },   //!< ROW0
-  { GPIOB, GPIO_PIN_7 },   //!< ROW1
-  { GPIOB, GPIO_PIN_6 },   //!< ROW2
-  { GPIOB, GPIO_PIN_4 },   //!< ROW3
-  { GPIOB, GPIO_PIN_5 },   //!< ROW4
-  { GPIOB, GPIO_PIN_3 }    //!< ROW5
-};
-
-//!\brief Matrix columns
-static const S_MATRIX_GPIO_DESC gcsKeyMatrixColumns[ MATRIX_COL ] =
-{
-  { GPIOA, GPIO_PIN_3 },   //!< COL0
-  { GPIOB, GPIO_PIN_2 },   //!< COL1
-  { GPIOD, GPIO_PIN_7 },   //!< COL2
-  { GPIOD, GPIO_PIN_6 },   //!< COL3
-  { GPIOD, GPIO_PIN_5 },   //!< COL4
-  { GPIOD, GPIO_PIN_4 },   //!< COL5
-  { GPIOD, GPIO_PIN_3 },   //!< COL6
-  { GPIOD, GPIO_PIN_2 },   //!< COL7
-  { GPIOD, GPIO_PIN_0 },   //!< COL8
-  { GPIOC, GPIO_PIN_7 },   //!< COL9
-  { GPIOC, GPIO_PIN_6 },   //!< COL10
-  { GPIOC, GPIO_PIN_5 },   //!< COL11
-  { GPIOC, GPIO_PIN_4 },   //!< COL12
-  { GPIOC, GPIO_PIN_3 },   //!< COL13
-  { GPIOC, GPIO_PIN_2 },   //!< COL14
-  { GPIOE, GPIO_PIN_5 }    //!< COL15
-};
-
-//! \brief Matrix to scancode translation tables
-//! \note  Invalid keys are marked with 0xFFu
-static const U8 gcau8ScanCodeTable[ MATRIX_ROW ][ MATRIX_COL ] =
-{
-//  COL0   COL1   COL2   COL3   COL4   COL5   COL6   COL7   COL8   COL9   COL10  COL11  COL12  COL13  COL14  COL15
-  { 0x2Eu, 0x3Du, 0x1Du, 0x1Eu, 0x5Au, 0x59u, 0x58u, 0x57u, 0x56u, 0x55u, 0x54u, 0x53u, 0x52u, 0x51u, 0x50u, 0x45u },  // ROW0
-  { 0x46u, 0x41u, 0x0Du, 0x0Cu, 0x0Bu, 0x0Au, 0x09u, 0x08u, 0x07u, 0x06u, 0x05u, 0x04u, 0x03u, 0x02u, 0x01u, 0x00u },  // ROW1
-  { 0x2Fu, 0x5Fu, 0x44u, 0x1Bu, 0x1Au, 0x19u, 0x18u, 0x17u, 0x16u, 0x15u, 0x14u, 0x13u, 0x12u, 0x11u, 0x10u, 0x42u },  // ROW2
-  { 0x2Du, 0x4Cu, 0x2Bu, 0x2Au, 0x29u, 0x28u, 0x27u, 0x26u, 0x25u, 0x24u, 0x23u, 0x22u, 0x21u, 0x20u, 0x62u, 0x63u },  // ROW3
-  { 0x4Eu, 0x4Du, 0x4Fu, 0x61u, 0x3Au, 0x39u, 0x38u, 0x37u, 0x36u, 0x35u, 0x34u, 0x33u, 0x32u, 0x31u, 0x30u, 0x60u },  // ROW4
-  { 0x5Eu, 0x3Eu, 0x0Fu, 0x65u, 0x67u, 0x5Bu, 0x3Cu, 0x1Fu, 0x3Fu, 0x5Cu, 0x43u, 0x4Au, 0x5Du, 0x40u, 0x66u, 0x64u }   // ROW5
-};
-//-----------------------------------------------------------------------------------------------------------------
-// Our keyboard matrix looks like this (Amiga Compatible Keyboard Rev. A) -- marked as German keyboard:
-//       COL15 COL14 COL13 COL12 COL11 COL10 COL9  COL8  COL7  COL6  COL5   COL4   COL3   COL2   COL1   COL0 
-// ROW0  ESC    F1    F2    F3    F4    F5    F6    F7    F8    F9    F10    N.(    N.2    N.1    N.7    N.5   ROW0
-// ROW1   ~     1     2     3     4     5     6     7     8     9     0      ß      '      \     Bkspc   Del   ROW1
-// ROW2  TAB    Q     W     E     R     T     Z     U     I     O     P      Ü      +      Ret   Help    N.6   ROW2
-// ROW3  Ctrl  Caps   A     S     D     F     G     H     J     K     L      Ö      Ä      #      Up     N.4   ROW3
-// ROW4  LShft  <>    Y     X     C     V     B     N     M     ,     .      -     RShift Left   Down   Right  ROW4
-// ROW5  L-Alt LAmi  Spc   N.*   N.-   N.Ent N./   N.9   N.3   N..   N.)    RAmi   RAlt    N.0    N.8    N.+   ROW5
-//-----------------------------------------------------------------------------------------------------------------
+// Points between the accesses of the main cycle to the event bitmaps and to the snapshot, where the IT routine may run. Empty on the
+// target, the interleaving explorer of the host simulation defines the hook and runs Matrix_Sample() at each point.
+#ifdef MATRIX_PREEMPTION_HOOK
+void MATRIX_PREEMPTION_HOOK( const char* pcName );
+#define MATRIX_PREEMPTION_POINT( NAME )  MATRIX_PREEMPTION_HOOK( NAME )
+#else
+#define MATRIX_PREEMPTION_POINT( NAME )
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------/
@@ -109,12 +74,25 @@ volatile static U8 gau8KeyMatrixSample[ MATRIX_COL ][ MATRIX_SAMPLE ];  //!< Use
 volatile static U8 gau8KeyMatrixState[ MATRIX_COL ];                    //!< Current state of the keys (bitfield, 0 means pressed, 1 means not pressed)
 volatile static U8 gau8KeyEventPressed[ MATRIX_COL ];                   //!< Press events of the keys (bitfield, 1 means press, 0 means no event)
 volatile static U8 gau8KeyEventReleased[ MATRIX_COL ];                  //!< Release events of the keys (bitfield, 1 means release, 0 means no event)
+volatile static S_MATRIX_SNAPSHOT gsKeyMatrixSnapshot;                  //!< State of the keys after the last complete scan
+volatile static U8 gu8SnapshotSequence;                                 //!< Seqlock of the snapshot (odd, while the IT routine is updating it)
+static U8          gau8KeyBounce[ MATRIX_COL ][ MATRIX_ROW ];           //!< Bit 7: aged, bits 4-6: bounce, bits 0-3: current open run (scans)
+static U8          gau8KeyOpenRun[ MATRIX_COL ];                        //!< Keys counting an open run (bitfield, 1 means counting)
+static U8          gu8HoldOffMin;                                       //!< Bounds of the release hold-off (scans)
+static U8          gu8HoldOffMax;
+#if ( 0 != MATRIX_ANTIGHOST )
+static U8          gau8KeyClosed[ MATRIX_COL ];                         //!< Keys closed in the last sample (bitfield, 1 means closed) -- for the ghost key test
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------/
 // Static function declarations
 //--------------------------------------------------------------------------------------------------------/
 static void SetColumn( U8 u8Column );
+static U8   Debounce( U8 u8Column, U8 u8Keys, U8 u8Open );
+#if ( 0 != MATRIX_ANTIGHOST )
+static U8   BlockGhosts( U8 u8Column, U8 u8Pressed );
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------/
@@ -124,23 +102,141 @@ static void SetColumn( U8 u8Column );
  * \brief  Sets the column of the matrix
  * \param  u8Column: value to set
  * \return -
+ * \note   One write per port, the images of the ports are generated with the layout. The other pins of the ports are
+ *         kept: the main cycle writes them with a read-modify-write of the output register (GPIO_WriteHigh() and
+ *         GPIO_WriteLow() in amiga_key.c), that disables the interrupts, so this IT routine cannot split it.
  *********************************************************************/
 static void SetColumn( U8 u8Column )
 {
+  U8 u8Port;
+  
+  for( u8Port = 0u; u8Port < LAYOUT_COLUMN_PORTS; u8Port++ )
+  {
+    GPIO_Write( gcapsColumnPorts[ u8Port ], (U8)( ( GPIO_ReadOutputData( gcapsColumnPorts[ u8Port ] ) & (U8)~gcau8ColumnPortMask[ u8Port ] )
+                                                  | gcau8ColumnPortImage[ u8Column ][ u8Port ] ) );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Release hold-off and bounce learning of the keys of a column
+ * \param  u8Column: the column
+ * \param  u8Keys: keys to process -- pressed ones sampled open, and the ones counting an open run
+ * \param  u8Open: last sample of the column (bitfield, 1 means open)
+ * \return Keys, whose release is registered (bitfield)
+ * \note   Called from the IT routine. An open run, that ends with the key closing again within MATRIX_BOUNCE_WINDOW
+ *         scans, was a bounce: its length is kept as the bounce of the key, if it is longer than the one kept. If the
+ *         release was registered already, it is a bounce only, if the key is open again at the next sample -- a
+ *         closure long enough for a press is the key pressed again, and teaches nothing. A run reaching
+ *         MATRIX_BOUNCE_WINDOW is a clean release: after two of them without a bounce, the bounce kept is lowered by
+ *         one scan, so the hold-off follows the switch, as it wears or recovers.
+ *********************************************************************/
+static U8 Debounce( U8 u8Column, U8 u8Keys, U8 u8Open )
+{
+  U8 u8Released = 0u;
   U8 u8Index;
+  U8 u8Bit = 1u;
+  U8 u8Run;
+  U8 u8Bounce;
+  U8 u8Aged;
+  U8 u8HoldOff;
   
-  for( u8Index = 0u; u8Index < MATRIX_COL; u8Index++ )  // Columns
+  for( u8Index = 0u; u8Index < MATRIX_ROW; u8Index++ )
   {
-    if( u8Column == u8Index )
+    if( 0u != ( u8Keys & u8Bit ) )
     {
-      GPIO_WriteLow( gcsKeyMatrixColumns[ u8Index ].psGPIOPort, gcsKeyMatrixColumns[ u8Index ].ePin );
+      u8Run    = gau8KeyBounce[ u8Column ][ u8Index ] & MATRIX_BOUNCE_RUN;
+      u8Bounce = ( gau8KeyBounce[ u8Column ][ u8Index ] & MATRIX_BOUNCE_LENGTH ) >> 4u;
+      u8Aged   = gau8KeyBounce[ u8Column ][ u8Index ] & MATRIX_BOUNCE_AGED;
+      if( MATRIX_BOUNCE_WINDOW < u8Run )  // closed at the last sample, after its release was registered
+      {
+        if( 0u != ( u8Open & u8Bit ) )  // open again: the closure was shorter than a press, a chatter of the switch
+        {
+          u8Run -= MATRIX_BOUNCE_WINDOW;
+          u8Bounce = ( u8Run > u8Bounce ) ? u8Run : u8Bounce;
+          u8Aged = 0u;
+          u8Run = 1u;
+          KeyStats_CountChatter( u8Index, u8Column );
+        }
+        else  // still closed: the key is pressed again
+        {
+          u8Run = 0u;
+        }
+      }
+      else if( 0u != ( u8Open & u8Bit ) )  // still open
+      {
+        u8Run++;
+        u8HoldOff = u8Bounce + 1u;
+        u8HoldOff = ( u8HoldOff < gu8HoldOffMin ) ? gu8HoldOffMin : ( ( u8HoldOff > gu8HoldOffMax ) ? gu8HoldOffMax : u8HoldOff );
+        if( ( 0u == ( gau8KeyMatrixState[ u8Column ] & u8Bit ) ) && ( u8Run >= u8HoldOff ) )
+        {
+          u8Released |= u8Bit;
+        }
+        if( MATRIX_BOUNCE_WINDOW == u8Run )  // no bounce, the key is really released
+        {
+          u8Run = 0u;
+          if( 0u != u8Aged )  // the second one: the bounce decays
+          {
+            u8Bounce = ( 0u != u8Bounce ) ? ( u8Bounce - 1u ) : 0u;
+            u8Aged = 0u;
+          }
+          else
+          {
+            u8Aged = MATRIX_BOUNCE_AGED;
+          }
+        }
+      }
+      else if( 0u == ( gau8KeyMatrixState[ u8Column ] & u8Bit ) )  // closed again, the hold-off swallowed the open run: a chatter
+      {
+        u8Bounce = ( u8Run > u8Bounce ) ? u8Run : u8Bounce;
+        u8Aged = 0u;
+        u8Run = 0u;
+        KeyStats_CountChatter( u8Index, u8Column );
+      }
+      else  // closed again after the release: a chatter, or the key pressed again -- the next sample tells
+      {
+        u8Run += MATRIX_BOUNCE_WINDOW;
+      }
+      gau8KeyBounce[ u8Column ][ u8Index ] = (U8)( u8Aged | ( u8Bounce << 4u ) | u8Run );
+      gau8KeyOpenRun[ u8Column ] = ( 0u != u8Run ) ? ( gau8KeyOpenRun[ u8Column ] | u8Bit ) : ( gau8KeyOpenRun[ u8Column ] & (U8)~u8Bit );
     }
-    else
+    u8Bit <<= 1u;
+  }
+  
+  return u8Released;
+}
+
+
+#if ( 0 != MATRIX_ANTIGHOST )
+/*! *******************************************************************
+ * \brief  Holds back the presses, that complete a rectangle of closed keys
+ * \param  u8Column: the column
+ * \param  u8Pressed: press events of the column (bitfield)
+ * \return The press events, that are not ambiguous
+ * \note   Called from the IT routine. Two columns sharing two closed rows are a rectangle: any of its corners can be
+ *         a ghost. A held back key is not registered, so it is pressed again at the next scan of its column, until
+ *         the rectangle is resolved. The other columns were sampled at most one scan ago, and a press needs
+ *         MATRIX_SAMPLE closed samples: every column has seen the key closing a rectangle by then. The cost is
+ *         bounded, MATRIX_COL turns of the loop, and only if there is a press in the column.
+ *********************************************************************/
+static U8 BlockGhosts( U8 u8Column, U8 u8Pressed )
+{
+  U8 u8Index;
+  U8 u8Common;
+  U8 u8Ghost = 0u;
+  
+  for( u8Index = 0u; u8Index < MATRIX_COL; u8Index++ )
+  {
+    u8Common = gau8KeyClosed[ u8Column ] & gau8KeyClosed[ u8Index ];
+    if( ( u8Index != u8Column ) && ( 0u != ( u8Common & (U8)( u8Common - 1u ) ) ) )  // at least two rows in common
     {
-      GPIO_WriteHigh( gcsKeyMatrixColumns[ u8Index ].psGPIOPort, gcsKeyMatrixColumns[ u8Index ].ePin );
+      u8Ghost |= u8Common;
     }
   }
+  MATRIX_GHOST_COST( MATRIX_COL );
+  
+  return u8Pressed & (U8)~u8Ghost;
 }
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------/
@@ -150,11 +246,12 @@ static void SetColumn( U8 u8Column )
  * \brief  Module init
  * \param  -
  * \return -
- * \note   Must be called before Matrix_Cycle(), or the IT routine!
+ * \note   Must be called after Config_Init(), and before Matrix_Cycle(), or the IT routine!
  *********************************************************************/
 void Matrix_Init( void )
 {
-  U8 u8Index;
+  U8  u8Index;
+  U16 u16HoldOff;
   
   // GPIO init
   for( u8Index = 0u; u8Index < MATRIX_ROW; u8Index++ )  // Rows
@@ -171,6 +268,26 @@ void Matrix_Init( void )
   memset( (void*)gau8KeyMatrixState,   0xFFu, sizeof( gau8KeyMatrixState ) );
   memset( (void*)gau8KeyEventPressed,  0x00u, sizeof( gau8KeyEventPressed ) );
   memset( (void*)gau8KeyEventReleased, 0x00u, sizeof( gau8KeyEventReleased ) );
+  memset( (void*)&gsKeyMatrixSnapshot, 0xFFu, sizeof( gsKeyMatrixSnapshot ) );
+  gsKeyMatrixSnapshot.u16ScanCount = 0u;
+  gu8SnapshotSequence = 0u;
+  memset( gau8KeyBounce,  0x00u, sizeof( gau8KeyBounce ) );   // every switch starts as a fresh one
+  memset( gau8KeyOpenRun, 0x00u, sizeof( gau8KeyOpenRun ) );
+#if ( 0 != MATRIX_ANTIGHOST )
+  memset( gau8KeyClosed,  0x00u, sizeof( gau8KeyClosed ) );
+#endif
+  
+  // bounds of the release hold-off: high byte min, low byte max
+  gu8HoldOffMin = MATRIX_HOLDOFF_MIN;
+  gu8HoldOffMax = MATRIX_HOLDOFF_MAX;
+  if( ( TRUE == Config_Read( CONFIG_KEY_DEBOUNCE, &u16HoldOff ) )
+   && ( 1u <= (U8)( u16HoldOff >> 8u ) ) && ( (U8)( u16HoldOff >> 8u ) <= (U8)u16HoldOff ) && ( (U8)u16HoldOff < MATRIX_BOUNCE_WINDOW ) )
+  {
+    gu8HoldOffMin = (U8)( u16HoldOff >> 8u );
+    gu8HoldOffMax = (U8)u16HoldOff;
+  }
+  
+  Chord_Init();
 }
 
 /*! *******************************************************************
@@ -183,20 +300,33 @@ void Matrix_Cycle( void )
 {
   U8 u8Row, u8Column;
   U8 u8ScanCode;
+  U8 u8Events;
+  __istate_t sState;
 
   // note: this cycle can be blocked by AmigaKey_Cycle()
   
   // search for new events
   for( u8Column = 0u; u8Column < MATRIX_COL; u8Column++ )
   {
+    LATENCY_SOURCE( u8Column );
     for( u8Row = 0u; u8Row < MATRIX_ROW; u8Row++ )
     {
+      MATRIX_PREEMPTION_POINT( "before the tests" );
       if( 0u != ( (1u<<u8Row) & gau8KeyEventPressed[ u8Column ] ) )  // if there is a press event
       {
-        u8ScanCode = gcau8ScanCodeTable[ u8Row ][ u8Column ];  // translating the matrix code to scancode
+        u8ScanCode = Keymap_GetScanCode( u8Row, u8Column );  // translating the matrix code to scancode
         if( TRUE == AmigaKey_RegisterScanCode( u8ScanCode, TRUE ) )
         {
-          gau8KeyEventPressed[ u8Column ] &= ~(1<<u8Row);
+          TRACE( TRACE_EVENT_KEY, TRACE_KEY( u8Row, u8Column, FALSE ) );
+          Macro_Record( u8ScanCode, TRUE );
+          KeyStats_CountPress( u8Row, u8Column );
+          MATRIX_PREEMPTION_POINT( "press registered" );
+          sState = __get_interrupt_state();  // read-modify-write (ld, and, ld on the STM8): the IT routine may set another bit of the column
+          __disable_interrupt();
+          u8Events = gau8KeyEventPressed[ u8Column ];
+          MATRIX_PREEMPTION_POINT( "press bit clear, between read and write" );
+          gau8KeyEventPressed[ u8Column ] = u8Events & (U8)~(1u<<u8Row);
+          __set_interrupt_state( sState );
         }
         else  // scancode buffer full, terminate cycle
         {
@@ -206,10 +336,18 @@ void Matrix_Cycle( void )
       }
       else if( 0u != ( (1u<<u8Row) & gau8KeyEventReleased[ u8Column ] ) )  // if there is a release event
       {
-        u8ScanCode = gcau8ScanCodeTable[ u8Row ][ u8Column ];  // translating the matrix code to scancode
+        u8ScanCode = Keymap_GetScanCode( u8Row, u8Column );  // translating the matrix code to scancode
         if( TRUE == AmigaKey_RegisterScanCode( u8ScanCode, FALSE ) )
         {
-          gau8KeyEventReleased[ u8Column ] &= ~(1<<u8Row);
+          TRACE( TRACE_EVENT_KEY, TRACE_KEY( u8Row, u8Column, TRUE ) );
+          Macro_Record( u8ScanCode, FALSE );
+          MATRIX_PREEMPTION_POINT( "release registered" );
+          sState = __get_interrupt_state();  // read-modify-write, see the press
+          __disable_interrupt();
+          u8Events = gau8KeyEventReleased[ u8Column ];
+          MATRIX_PREEMPTION_POINT( "release bit clear, between read and write" );
+          gau8KeyEventReleased[ u8Column ] = u8Events & (U8)~(1u<<u8Row);
+          __set_interrupt_state( sState );
         }
         else  // scancode buffer full, terminate cycle
         {
@@ -219,6 +357,67 @@ void Matrix_Cycle( void )
       }
     }
   }
+  LATENCY_SOURCE( LATENCY_NO_SOURCE );
+}
+
+/*! *******************************************************************
+ * \brief  Checks, whether any key is held or any event is waiting
+ * \param  -
+ * \return TRUE, if no key is pressed and all events are processed
+ * \note   Must be called from main cycle!
+ *********************************************************************/
+BOOL Matrix_IsIdle( void )
+{
+  U8   u8Column;
+  BOOL bRet = TRUE;
+  
+  for( u8Column = 0u; u8Column < MATRIX_COL; u8Column++ )
+  {
+    if( ( 0xFFu != gau8KeyMatrixState[ u8Column ] )
+     || ( 0u != gau8KeyEventPressed[ u8Column ] )
+     || ( 0u != gau8KeyEventReleased[ u8Column ] ) )
+    {
+      bRet = FALSE;
+    }
+  }
+  
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Gets a consistent copy of the key matrix
+ * \param  psSnapshot: the state of the last complete scan will be put here
+ * \return -
+ * \note   Lock-free: interrupts are not masked, the copy is retried if the IT routine published a new scan meanwhile.
+ *********************************************************************/
+void Matrix_GetSnapshot( S_MATRIX_SNAPSHOT* psSnapshot )
+{
+  U8 u8Sequence;
+  U8 u8Index;
+  
+  do
+  {
+    u8Sequence = gu8SnapshotSequence;
+    MATRIX_PREEMPTION_POINT( "snapshot: sequence read" );
+    for( u8Index = 0u; u8Index < MATRIX_COL; u8Index++ )
+    {
+      psSnapshot->uState.au8Column[ u8Index ] = gsKeyMatrixSnapshot.uState.au8Column[ u8Index ];
+      MATRIX_PREEMPTION_POINT( "snapshot: column copied" );
+    }
+    psSnapshot->u16ScanCount = gsKeyMatrixSnapshot.u16ScanCount;
+    MATRIX_PREEMPTION_POINT( "snapshot: scan count copied" );
+  } while( ( 0u != ( u8Sequence & 1u ) ) || ( u8Sequence != gu8SnapshotSequence ) );
+}
+
+/*! *******************************************************************
+ * \brief  Gets the bounce learned on a key
+ * \param  u8Row: row of the key
+ * \param  u8Column: column of the key
+ * \return Length of the bounce in scans (0: no bounce seen), the release hold-off of the key is one more
+ *********************************************************************/
+U8 Matrix_GetBounce( U8 u8Row, U8 u8Column )
+{
+  return ( gau8KeyBounce[ u8Column ][ u8Row ] & MATRIX_BOUNCE_LENGTH ) >> 4u;
 }
 
 /*! *******************************************************************
@@ -233,27 +432,42 @@ void Matrix_Sample( void )
   static U8 u8Sample = 0u;
   U8 u8Index;
   U8 u8Row;
+  U8 u8Open;
+  U8 u8Keys;
+  U8 u8Pressed;
+  U8 u8Released;
+  U8 u8Changed;
   
-  // read row pins
-  u8Row = 0u;
-  for( u8Index = 0u; u8Index < MATRIX_ROW; u8Index++ )
-  {
-    u8Row |= ( RESET != GPIO_ReadInputPin( gcsKeyMatrixRows[ u8Index ].psGPIOPort, gcsKeyMatrixRows[ u8Index ].ePin ) ) ? (1u<<u8Index) : 0u;
-  }
+  // read row pins: one read per port, see the profile
+  u8Row = (U8)( (U8)~MATRIX_ROW_MASK | Layout_ReadRows() );  // nonexistent rows are never pressed
   
   // store sampled value of rows
   gau8KeyMatrixSample[ u8Column ][ u8Sample ] = u8Row;
+  u8Open = u8Row;
 
   // generate actual state of keys based on samples
-  u8Row = 0u;
-  for( u8Index = 0u; u8Index < MATRIX_SAMPLE; u8Index++ )
+  u8Row = LAYOUT_SAMPLE_OR( gau8KeyMatrixSample[ u8Column ] );  // key presses will be registered after MATRIX_SAMPLE closed samples in a row
+  
+  // search for events: presses of released keys closed in every sample, releases after the hold-off of the key
+  u8Pressed = gau8KeyMatrixState[ u8Column ] & (U8)~u8Row;
+  u8Released = 0u;
+  u8Keys = ( (U8)~gau8KeyMatrixState[ u8Column ] & u8Open ) | gau8KeyOpenRun[ u8Column ];
+  if( 0u != u8Keys )  // most of the time, there is nothing to count
   {
-    u8Row |= gau8KeyMatrixSample[ u8Column ][ u8Index ];  // key presses are registered immediately, releases will be registered after MATRIX_SAMPLE times of the sampling period
+    u8Released = Debounce( u8Column, u8Keys, u8Open );
   }
-  
-  // search for events
-  gau8KeyEventPressed[ u8Column ]  |= ( gau8KeyMatrixState[ u8Column ] ^ u8Row ) & ~u8Row;
-  gau8KeyEventReleased[ u8Column ] |= ( gau8KeyMatrixState[ u8Column ] ^ u8Row ) & u8Row;
+#if ( 0 != MATRIX_ANTIGHOST )
+  gau8KeyClosed[ u8Column ] = (U8)~u8Open;
+  if( 0u != u8Pressed )
+  {
+    LATENCY_GHOST_START();
+    u8Pressed = BlockGhosts( u8Column, u8Pressed );
+    LATENCY_GHOST_END();
+  }
+#endif
+  LATENCY_SAMPLE( u8Column, u8Pressed | u8Released );
+  gau8KeyEventPressed[ u8Column ]  |= u8Pressed;
+  gau8KeyEventReleased[ u8Column ] |= u8Released;
   
   // the new state will be the one after the events
   gau8KeyMatrixState[ u8Column ] &= ~gau8KeyEventPressed[ u8Column ];
@@ -269,14 +483,23 @@ void Matrix_Sample( void )
     {
       u8Sample = 0u;
     }
-  }
-  
-  // look for special key combinations, eg. CTRL + LAmiga + RAmiga
-  if( ( 0u == ( gau8KeyMatrixState[ 14u ] & (1u<<5u) ) )    // ROW5 + COL14 = LAmiga
-   && ( 0u == ( gau8KeyMatrixState[  4u ] & (1u<<5u) ) )    // ROW5 + COL4  = RAmiga
-   && ( 0u == ( gau8KeyMatrixState[ 15u ] & (1u<<3u) ) ) )  // ROW3 + COL15 = Ctrl
-  {
-    AmigaKey_Reset();
+    
+    // the scan is complete: publish it for the main cycle (seqlock, the IT routine never waits for the reader)
+    u8Changed = 0u;
+    gu8SnapshotSequence++;
+    for( u8Index = 0u; u8Index < MATRIX_COL; u8Index++ )
+    {
+      u8Changed |= gsKeyMatrixSnapshot.uState.au8Column[ u8Index ] ^ gau8KeyMatrixState[ u8Index ];  // collecting changes since the previous scan
+      gsKeyMatrixSnapshot.uState.au8Column[ u8Index ] = gau8KeyMatrixState[ u8Index ];
+    }
+    gsKeyMatrixSnapshot.u16ScanCount++;
+    gu8SnapshotSequence++;
+    
+    // look for special key combinations, eg. CTRL + LAmiga + RAmiga -- only if any key has changed
+    if( 0u != u8Changed )
+    {
+      Chord_Evaluate( (const U_MATRIX_BITMAP*)&gsKeyMatrixSnapshot.uState );
+    }
   }
   
   // Increment MUX state
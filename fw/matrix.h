@@ -17,16 +17,50 @@
 //--------------------------------------------------------------------------------------------------------/
 // Include files
 //--------------------------------------------------------------------------------------------------------/
+#include "layout.h"
 
 
 //--------------------------------------------------------------------------------------------------------/
 // Definitions
 //--------------------------------------------------------------------------------------------------------/
+// Matrix definitions
+#define MATRIX_ROW      LAYOUT_ROWS  //!< Number of rows in the keyboard matrix (max. 8), set by the profile
+#define MATRIX_COL      LAYOUT_COLS  //!< Number of columns in the keyboard matrix (note, that there are max. 8 rows)
+#define MATRIX_ROW_MASK ( (U8)( ( 1u << MATRIX_ROW ) - 1u ) )  //!< Bits of a column byte, that belong to existing rows
+
+// Sampling tick: the TIM2 update interrupt samples one column, TIM2 counts the CPU clock (16 MHz, checked in main.c)
+#define MATRIX_SCAN_US      5000u                                       //!< Every column is sampled once in a scan
+#define MATRIX_TICK_RELOAD  ( ( 16u * MATRIX_SCAN_US ) / MATRIX_COL )  //!< Auto-reload value of TIM2, set by main.c
+#define MATRIX_TICK_CLOCKS  ( MATRIX_TICK_RELOAD + 1u )                 //!< TIM2 clocks of one tick: it counts 0 to the auto-reload value
+
+// Ghost key blocking, for matrices without a diode at each switch (eg. the A1200 adapter, or a cheaper build). Three
+// keys held at the corners of a rectangle close the fourth corner too: a press completing a rectangle is held back,
+// until one of the corners is released. Not needed with the diodes of the full keyboard. Default: by the profile.
+#ifndef MATRIX_ANTIGHOST
+#if ( 0u == LAYOUT_DIODES )
+#define MATRIX_ANTIGHOST 1
+#else
+#define MATRIX_ANTIGHOST 0
+#endif
+#endif
 
 
 //--------------------------------------------------------------------------------------------------------/
 // Types
 //--------------------------------------------------------------------------------------------------------/
+//! \brief One bit for every key of the matrix (MATRIX_ROW * MATRIX_COL bits)
+typedef union
+{
+  U8  au8Column[ MATRIX_COL ];      //!< One byte per column, bit n belongs to ROWn
+  U16 au16Word[ MATRIX_COL / 2u ];  //!< The same bits, two columns per word -- for word-wide operations
+} U_MATRIX_BITMAP;
+
+//! \brief Consistent copy of the whole key matrix, taken after a complete scan
+typedef struct
+{
+  U_MATRIX_BITMAP uState;        //!< State of the keys (bitfield, 0 means pressed, 1 means not pressed)
+  U16             u16ScanCount;  //!< Sequence number of the scan the state belongs to
+} S_MATRIX_SNAPSHOT;
 
 
 //--------------------------------------------------------------------------------------------------------/
@@ -40,6 +74,9 @@
 void Matrix_Init( void );
 void Matrix_Cycle( void );
 void Matrix_Sample( void );
+void Matrix_GetSnapshot( S_MATRIX_SNAPSHOT* psSnapshot );
+BOOL Matrix_IsIdle( void );
+U8   Matrix_GetBounce( U8 u8Row, U8 u8Column );
 
 
 #endif // MATRIX_H_INCLUDED
@@ -0,0 +1,274 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file selfbench.c
+*
+* \brief Self-benchmark of the handshake of the computer -- a burst of harmless codes, timed with TIM2
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include "stm8s.h"
+#include "types.h"
+#include "matrix.h"
+#include "macro.h"
+
+// Own include
+#include "selfbench.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// States
+#define SELFBENCH_STATE_IDLE     0u
+#define SELFBENCH_STATE_ARM      1u  //!< Burst requested, waiting for the keys of the chord to be released
+#define SELFBENCH_STATE_RUNNING  2u  //!< The codes are streamed by AmigaKey_Cycle()
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+#pragma location = SELFBENCH_BLOCK_ADDRESS
+__no_init S_SELFBENCH_BLOCK gsSelfBenchBlock;  //!< Results -- at a fixed address for the debugger
+
+//! \brief State of the burst -- owned by the main cycle
+static struct
+{
+  U32  u32AckClocks;                        //!< TIM2 clocks from the release of KDAT to SELFBENCH_MARK_ACK
+  U32  u32Clocks;                           //!< TIM2 clocks since the release of KDAT, at the last mark (the end)
+  U16  u16Counter;                          //!< TIM2 counter at the last mark
+  U8   u8State;                             //!< SELFBENCH_STATE_...
+  U8   u8Index;                             //!< Next code of the burst
+  U8   u8Requests;                          //!< Requests seen by the main cycle, see gu8RunRequests
+  BOOL bReleased;                           //!< The code was sent, but not acknowledged yet
+} gsSelfBench;
+
+// Incremented by the chord action (IT routine), the main cycle only reads it: a request is never lost
+volatile static U8 gu8RunRequests;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void AddSample( U8 u8Stat, U32 u32Us );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Adds the measurement of a code to a statistic
+ * \param  u8Stat: SELFBENCH_STAT_x
+ * \param  u32Us: the measurement in us
+ * \return -
+ *********************************************************************/
+static void AddSample( U8 u8Stat, U32 u32Us )
+{
+  S_SELFBENCH_STAT* psStat = &gsSelfBenchBlock.asStat[ u8Stat ];
+
+  if( u32Us < psStat->u32MinUs )
+  {
+    psStat->u32MinUs = u32Us;
+  }
+  if( u32Us > psStat->u32MaxUs )
+  {
+    psStat->u32MaxUs = u32Us;
+  }
+  psStat->u32AvgUs += u32Us;  // the sum, until the end of the burst
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init -- clears the results
+ * \param  -
+ * \return -
+ *********************************************************************/
+void SelfBench_Init( void )
+{
+  memset( (void*)&gsSelfBench, 0x00u, sizeof( gsSelfBench ) );
+  memset( (void*)&gsSelfBenchBlock, 0x00u, sizeof( gsSelfBenchBlock ) );
+  gsSelfBench.u8Requests = gu8RunRequests;
+  gsSelfBenchBlock.u8Version = SELFBENCH_VERSION;
+  gsSelfBenchBlock.u8CodeCount = SELFBENCH_CODE_COUNT;
+  gsSelfBenchBlock.u16Magic = SELFBENCH_MAGIC;
+}
+
+/*! *******************************************************************
+ * \brief  Main cycle -- starts the burst
+ * \param  -
+ * \return -
+ * \note   Must be called from main cycle! The burst starts, when the keys of the chord are released, and the macro is
+ *         not played: the codes follow each other as fast as the computer acknowledges them.
+ *********************************************************************/
+void SelfBench_Cycle( void )
+{
+  U8 u8Requests;
+  U8 u8Stat;
+  BOOL bRun;
+
+  u8Requests = gu8RunRequests;
+  bRun = ( u8Requests != gsSelfBench.u8Requests ) ? TRUE : FALSE;
+  gsSelfBench.u8Requests = u8Requests;
+
+  if( SELFBENCH_STATE_IDLE == gsSelfBench.u8State )
+  {
+    if( TRUE == bRun )
+    {
+      gsSelfBench.u8State = SELFBENCH_STATE_ARM;
+    }
+  }
+  else if( SELFBENCH_STATE_ARM == gsSelfBench.u8State )
+  {
+    if( ( TRUE == Matrix_IsIdle() ) && ( FALSE == Macro_IsPlaying() ) )
+    {
+      // the results of the previous burst are overwritten, only the number of bursts is kept
+      memset( (void*)gsSelfBenchBlock.asStat, 0x00u, sizeof( gsSelfBenchBlock.asStat ) );
+      memset( (void*)gsSelfBenchBlock.au16HandshakeUs, 0x00u, sizeof( gsSelfBenchBlock.au16HandshakeUs ) );
+      for( u8Stat = 0u; u8Stat < SELFBENCH_STAT_COUNT; u8Stat++ )
+      {
+        gsSelfBenchBlock.asStat[ u8Stat ].u32MinUs = 0xFFFFFFFFu;
+      }
+      gsSelfBenchBlock.u8Retries = 0u;
+      gsSelfBench.bReleased = FALSE;
+      gsSelfBench.u8Index = 0u;
+      gsSelfBench.u8State = SELFBENCH_STATE_RUNNING;
+    }
+  }
+  else
+  {
+    // SELFBENCH_STATE_RUNNING: AmigaKey_Cycle() streams the codes, the requests are ignored meanwhile
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Starts a burst
+ * \param  -
+ * \return -
+ * \note   Can be called from the IT routine (eg. as a chord action).
+ *********************************************************************/
+void SelfBench_RequestRun( void )
+{
+  gu8RunRequests++;
+}
+
+/*! *******************************************************************
+ * \brief  Reads the next code of the burst
+ * \param  pu8Code: the code will be put here, in the communication format
+ * \return TRUE, if a code is due; FALSE, if there is no burst running
+ * \note   Must be called from main cycle! This function does not remove the code, see SelfBench_RemoveCode().
+ *********************************************************************/
+BOOL SelfBench_ReadCode( U8* pu8Code )
+{
+  BOOL bRet = FALSE;
+
+  if( SELFBENCH_STATE_RUNNING == gsSelfBench.u8State )
+  {
+    *pu8Code = (U8)( SELFBENCH_CODE << 1u ) | 0x01u;  // released
+    bRet = TRUE;
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Timestamps a point of the transmission of the code
+ * \param  u8Mark: SELFBENCH_MARK_x -- the last call with a mark is the one kept
+ * \return -
+ * \note   Must be called from main cycle, while waiting for the handshake! The TIM2 counter wraps around at every
+ *         sampling tick, so only its changes are added up: the calls must follow each other within a tick (312 us),
+ *         the interrupt routine included.
+ *********************************************************************/
+void SelfBench_Mark( U8 u8Mark )
+{
+  U16 u16Counter = TIM2_GetCounter();
+
+  if( SELFBENCH_MARK_RELEASE == u8Mark )
+  {
+    if( ( TRUE == gsSelfBench.bReleased ) && ( 0xFFu != gsSelfBenchBlock.u8Retries ) )  // sent again after a resync
+    {
+      gsSelfBenchBlock.u8Retries++;
+    }
+    gsSelfBench.bReleased = TRUE;
+    gsSelfBench.u32Clocks = 0u;
+  }
+  else if( u16Counter >= gsSelfBench.u16Counter )
+  {
+    gsSelfBench.u32Clocks += u16Counter - gsSelfBench.u16Counter;
+  }
+  else
+  {
+    gsSelfBench.u32Clocks += ( MATRIX_TICK_CLOCKS - gsSelfBench.u16Counter ) + u16Counter;
+  }
+  gsSelfBench.u16Counter = u16Counter;
+  if( SELFBENCH_MARK_ACK == u8Mark )
+  {
+    gsSelfBench.u32AckClocks = gsSelfBench.u32Clocks;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Removes the code of the burst, that has been acknowledged by the computer -- its handshake is recorded
+ * \param  -
+ * \return -
+ * \note   Must be called from main cycle, after the marks of the code: the last one is SELFBENCH_MARK_END! The
+ *         averages are summed up in the results, and divided after the last code.
+ *********************************************************************/
+void SelfBench_RemoveCode( void )
+{
+  U32 u32HandshakeUs;
+  U8  u8Stat;
+
+  if( SELFBENCH_STATE_RUNNING == gsSelfBench.u8State )
+  {
+    u32HandshakeUs = gsSelfBench.u32Clocks >> 4u;  // 16 MHz timer clock
+    AddSample( SELFBENCH_STAT_DELAY, gsSelfBench.u32AckClocks >> 4u );
+    AddSample( SELFBENCH_STAT_WIDTH, ( gsSelfBench.u32Clocks - gsSelfBench.u32AckClocks ) >> 4u );
+    AddSample( SELFBENCH_STAT_HANDSHAKE, u32HandshakeUs );
+    gsSelfBenchBlock.au16HandshakeUs[ gsSelfBench.u8Index ] = ( u32HandshakeUs < SELFBENCH_SATURATED ) ? (U16)u32HandshakeUs : SELFBENCH_SATURATED;
+    gsSelfBench.bReleased = FALSE;
+
+    gsSelfBench.u8Index++;
+    if( gsSelfBench.u8Index >= SELFBENCH_CODE_COUNT )
+    {
+      for( u8Stat = 0u; u8Stat < SELFBENCH_STAT_COUNT; u8Stat++ )
+      {
+        gsSelfBenchBlock.asStat[ u8Stat ].u32AvgUs /= SELFBENCH_CODE_COUNT;
+      }
+      gsSelfBenchBlock.u8Runs++;
+      gsSelfBench.u8State = SELFBENCH_STATE_IDLE;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Checks, whether a burst is being sent
+ * \param  -
+ * \return TRUE, from the start of the burst until the last code is acknowledged
+ *********************************************************************/
+BOOL SelfBench_IsRunning( void )
+{
+  return ( SELFBENCH_STATE_RUNNING == gsSelfBench.u8State ) ? TRUE : FALSE;
+}
+
+/******************************<EOF>**********************************/
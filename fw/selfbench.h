@@ -0,0 +1,91 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file selfbench.h
+*
+* \brief Self-benchmark of the handshake of the computer -- a burst of harmless codes, timed with TIM2
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef SELFBENCH_H_INCLUDED
+#define SELFBENCH_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SELFBENCH_BLOCK_ADDRESS 0x02B4u  //!< Fixed RAM address of the results, read it over SWIM (76 bytes, see app.icf)
+#define SELFBENCH_MAGIC         0x5342u  //!< "SB"
+#define SELFBENCH_VERSION       1u
+
+#define SELFBENCH_CODE_COUNT    16u      //!< Codes of a burst
+#define SELFBENCH_CODE          0x0Eu    //!< Its release is sent: there is no such key on the keyboard, it is never pressed
+
+#define SELFBENCH_SATURATED     0xFFFFu  //!< Handshake of a code, 65535 us or longer
+
+// Points of the transmission of a code, see AmigaKey_Cycle() -- the marks are taken after reading KDAT
+#define SELFBENCH_MARK_RELEASE  0u  //!< The last bit is sent, the keyboard releases KDAT: the handshake can be seen
+#define SELFBENCH_MARK_ACK      1u  //!< KDAT is low: the computer started the handshake
+#define SELFBENCH_MARK_END      2u  //!< KDAT is high again: the handshake is over
+#define SELFBENCH_MARK_COUNT    3u
+
+// Statistics of a burst
+#define SELFBENCH_STAT_DELAY     0u  //!< Release of KDAT --> start of the handshake
+#define SELFBENCH_STAT_WIDTH     1u  //!< Start --> end of the handshake
+#define SELFBENCH_STAT_HANDSHAKE 2u  //!< Release of KDAT --> end of the handshake: the wait of the keyboard per byte
+#define SELFBENCH_STAT_COUNT     3u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Minimum, average and maximum of a statistic
+typedef struct
+{
+  U32 u32MinUs;
+  U32 u32AvgUs;  //!< The sum, while the burst is being sent
+  U32 u32MaxUs;
+} S_SELFBENCH_STAT;
+
+//! \brief The block at SELFBENCH_BLOCK_ADDRESS -- the results of the last burst
+typedef struct
+{
+  U16              u16Magic;      //!< SELFBENCH_MAGIC, once initialized
+  U8               u8Version;     //!< SELFBENCH_VERSION
+  U8               u8CodeCount;   //!< SELFBENCH_CODE_COUNT
+  U8               u8Runs;        //!< Bursts completed (wraps around), incremented when the results are complete
+  U8               u8Retries;     //!< Codes of the burst sent again, because the computer did not acknowledge them
+  U16              u16Reserved;
+  S_SELFBENCH_STAT asStat[ SELFBENCH_STAT_COUNT ];
+  U16              au16HandshakeUs[ SELFBENCH_CODE_COUNT ];  //!< Handshake of each code, saturated
+} S_SELFBENCH_BLOCK;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+extern S_SELFBENCH_BLOCK gsSelfBenchBlock;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void SelfBench_Init( void );
+void SelfBench_Cycle( void );
+void SelfBench_RequestRun( void );
+BOOL SelfBench_ReadCode( U8* pu8Code );
+void SelfBench_Mark( U8 u8Mark );
+void SelfBench_RemoveCode( void );
+BOOL SelfBench_IsRunning( void );
+
+
+#endif // SELFBENCH_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -31,6 +31,8 @@
 #include "stm8s_it.h"
 #include "types.h"
 #include "matrix.h"
+#include "latency.h"
+#include "trace.h"
 
 /** @addtogroup Template_Project
   * @{
@@ -278,6 +280,8 @@ INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12)
   */
  INTERRUPT_HANDLER(TIM2_UPD_OVF_BRK_IRQHandler, 13)
  {
+   LATENCY_TICK();
+   TRACE_TICK();
    Matrix_Sample();
    TIM2_ClearITPendingBit( TIM2_IT_UPDATE );
   /* In order to detect unexpected events during development,
@@ -0,0 +1,187 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file trace.c
+*
+* \brief Event trace -- compact records in a RAM ring, for debugging stalls in the field
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include <intrinsics.h>
+#include "stm8s.h"
+#include "types.h"
+
+// Own include
+#include "trace.h"
+
+#if ( 0 != TRACE_ENABLED )
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define TRACE_RECORD_MAX  3u  //!< Longest record in bytes
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+#pragma location = TRACE_BLOCK_ADDRESS
+__no_init S_TRACE_BLOCK gsTraceBlock;  //!< The ring -- at a fixed address for the debugger
+
+static volatile U16 gu16TraceDelta;    //!< Sampling ticks since the last record (saturating)
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U8 GetRecordLength( U8 u8Index );
+static U8 GetUsedBytes( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Length of the record in the ring
+ * \param  u8Index: index of the first byte of the record
+ * \return Bytes of the record
+ *********************************************************************/
+static U8 GetRecordLength( U8 u8Index )
+{
+  return ( TRACE_DELTA_EXTENDED == ( gsTraceBlock.au8Data[ u8Index ] & 0x0Fu ) ) ? 3u : 2u;
+}
+
+/*! *******************************************************************
+ * \brief  Bytes of the records in the ring
+ * \param  -
+ * \return From the tail to the head
+ *********************************************************************/
+static U8 GetUsedBytes( void )
+{
+  U8 u8Used = gsTraceBlock.u8Head - gsTraceBlock.u8Tail;
+
+  if( gsTraceBlock.u8Head < gsTraceBlock.u8Tail )
+  {
+    u8Used = gsTraceBlock.u8Head + ( TRACE_SIZE - gsTraceBlock.u8Tail );
+  }
+
+  return u8Used;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Module init -- clears the ring and records the boot
+ * \param  -
+ * \return -
+ * \note   Must be called before the IT routine is enabled!
+ *********************************************************************/
+void Trace_Init( void )
+{
+  memset( (void*)&gsTraceBlock, 0x00u, sizeof( gsTraceBlock ) );
+  gu16TraceDelta = 0u;
+  gsTraceBlock.u8Version = TRACE_VERSION;
+  gsTraceBlock.u8Size = TRACE_SIZE;
+  gsTraceBlock.u16Magic = TRACE_MAGIC;
+
+  Trace_Write( TRACE_EVENT_BOOT, TRACE_VERSION );
+}
+
+/*! *******************************************************************
+ * \brief  Sampling tick
+ * \param  -
+ * \return -
+ * \note   Must be called from the timed IT routine!
+ *********************************************************************/
+void Trace_Tick( void )
+{
+  if( 0xFFFFu != gu16TraceDelta )
+  {
+    gu16TraceDelta++;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Writes a record -- the oldest records are overwritten, if the ring is full
+ * \param  u8Event: TRACE_EVENT_x
+ * \param  u8Argument: argument of the event
+ * \return -
+ * \note   Can be called from the main cycle and from the IT routine too.
+ *********************************************************************/
+void Trace_Write( U8 u8Event, U8 u8Argument )
+{
+  U8  au8Record[ TRACE_RECORD_MAX ];
+  U8  u8Length = 2u;
+  U8  u8Index;
+  U16 u16Delta;
+  __istate_t sState = __get_interrupt_state();
+
+  __disable_interrupt();
+  u16Delta = gu16TraceDelta;
+  gu16TraceDelta = 0u;
+
+  // encode the delta
+  if( u16Delta < TRACE_DELTA_EXTENDED )
+  {
+    au8Record[ 0 ] = (U8)( u8Event << 4u ) | (U8)u16Delta;
+    au8Record[ 1 ] = u8Argument;
+  }
+  else
+  {
+    au8Record[ 0 ] = (U8)( u8Event << 4u ) | TRACE_DELTA_EXTENDED;
+    if( u16Delta <= ( TRACE_DELTA_EXTENDED + TRACE_DELTA_LINEAR ) )
+    {
+      au8Record[ 1 ] = (U8)( u16Delta - TRACE_DELTA_EXTENDED );
+    }
+    else if( ( u16Delta >> TRACE_DELTA_SCALE_SHIFT ) < TRACE_DELTA_SCALED )
+    {
+      au8Record[ 1 ] = TRACE_DELTA_SCALED | (U8)( u16Delta >> TRACE_DELTA_SCALE_SHIFT );
+    }
+    else
+    {
+      au8Record[ 1 ] = 0xFFu;
+    }
+    au8Record[ 2 ] = u8Argument;
+    u8Length = 3u;
+  }
+
+  // drop the oldest records, until the new one fits -- one byte stays free, so a full ring differs from an empty one
+  while( ( TRACE_SIZE - 1u - GetUsedBytes() ) < u8Length )
+  {
+    gsTraceBlock.u8Tail += GetRecordLength( gsTraceBlock.u8Tail );
+    if( gsTraceBlock.u8Tail >= TRACE_SIZE )
+    {
+      gsTraceBlock.u8Tail -= TRACE_SIZE;
+    }
+    if( 0xFFu != gsTraceBlock.u8Lost )
+    {
+      gsTraceBlock.u8Lost++;
+    }
+  }
+
+  // records can wrap around the end of the ring
+  for( u8Index = 0u; u8Index < u8Length; u8Index++ )
+  {
+    gsTraceBlock.au8Data[ gsTraceBlock.u8Head ] = au8Record[ u8Index ];
+    gsTraceBlock.u8Head++;
+    if( gsTraceBlock.u8Head >= TRACE_SIZE )
+    {
+      gsTraceBlock.u8Head = 0u;
+    }
+  }
+
+  __set_interrupt_state( sState );
+}
+
+#endif // TRACE_ENABLED
+/******************************<EOF>**********************************/
@@ -0,0 +1,106 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file trace.h
+*
+* \brief Event trace -- compact records in a RAM ring, for debugging stalls in the field
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Set to 1 (here, or as a compiler define) to build the trace -- with 0, every trace point compiles to nothing
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED           0
+#endif
+
+#define TRACE_BLOCK_ADDRESS     0x01AEu  //!< Fixed RAM address of the ring, read it over SWIM (104 bytes, see app.icf)
+#define TRACE_MAGIC             0x5452u  //!< "TR"
+#define TRACE_VERSION           1u
+#define TRACE_SIZE              96u      //!< Bytes of the ring (max. 255)
+
+// Record: [ event << 4 | delta ] ( [ extended delta ] ) [ argument ]
+// The delta is the number of sampling ticks since the previous record. 0..14 fits into the first byte, above
+// that the nibble is TRACE_DELTA_EXTENDED and an extra byte follows: 0x00..0x7F means 15..142 ticks,
+// 0x80 | n means n * 128 ticks (rounded down, saturated at 127 * 128).
+#define TRACE_DELTA_EXTENDED    0x0Fu
+#define TRACE_DELTA_LINEAR      0x7Fu   //!< Last extended delta in ticks, above 15
+#define TRACE_DELTA_SCALED      0x80u   //!< Flag of the extended delta, counting 128 ticks
+#define TRACE_DELTA_SCALE_SHIFT 7u
+
+// Events
+#define TRACE_EVENT_NONE        0u  //!< Never written -- a zeroed ring does not decode as events
+#define TRACE_EVENT_BOOT        1u  //!< Argument: TRACE_VERSION
+#define TRACE_EVENT_KEY         2u  //!< Key event registered, argument: TRACE_KEY()
+#define TRACE_EVENT_FIFO_FULL   3u  //!< Scancode FIFO full, argument: key code
+#define TRACE_EVENT_SYNC_LOST   4u  //!< Scancode not acknowledged, argument: the scancode sent
+#define TRACE_EVENT_RETRANSMIT  5u  //!< "Last key code bad" sent after the resync, argument: 0
+#define TRACE_EVENT_RESYNC      6u  //!< Communication synchronized, argument: 0
+#define TRACE_EVENT_RESET       7u  //!< Reset of the computer (reset chord), argument: 0
+#define TRACE_EVENT_COUNT       8u
+
+//! \brief Argument of TRACE_EVENT_KEY: row and column of the key, bit 7 set on release
+#define TRACE_KEY( ROW, COLUMN, RELEASED )  (U8)( ( (ROW) << 4u ) | ( (COLUMN) & 0x0Fu ) | ( ( TRUE == (RELEASED) ) ? 0x80u : 0x00u ) )
+
+// Trace points of the instrumented modules
+#if ( 0 != TRACE_ENABLED )
+#define TRACE_INIT()                Trace_Init()
+#define TRACE_TICK()                Trace_Tick()
+#define TRACE( EVENT, ARGUMENT )    Trace_Write( EVENT, ARGUMENT )
+#else
+#define TRACE_INIT()
+#define TRACE_TICK()
+#define TRACE( EVENT, ARGUMENT )
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief The block at TRACE_BLOCK_ADDRESS
+typedef struct
+{
+  U16 u16Magic;                 //!< TRACE_MAGIC, once initialized
+  U8  u8Version;                //!< TRACE_VERSION
+  U8  u8Size;                   //!< TRACE_SIZE
+  U8  u8Head;                   //!< Next byte to write
+  U8  u8Tail;                   //!< First byte of the oldest record
+  U8  u8Lost;                   //!< Records overwritten (saturating)
+  U8  u8Reserved;
+  U8  au8Data[ TRACE_SIZE ];    //!< Ring of the records, from u8Tail to u8Head
+} S_TRACE_BLOCK;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global functions
+//--------------------------------------------------------------------------------------------------------/
+#if ( 0 != TRACE_ENABLED )
+extern S_TRACE_BLOCK gsTraceBlock;
+#endif
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+#if ( 0 != TRACE_ENABLED )
+void Trace_Init( void );
+void Trace_Tick( void );
+void Trace_Write( U8 u8Event, U8 u8Argument );
+#endif
+
+
+#endif // TRACE_H_INCLUDED
+/******************************<EOF>**********************************/
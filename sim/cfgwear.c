@@ -0,0 +1,119 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file cfgwear.c
+*
+* \brief Host simulation -- wear of the data EEPROM caused by the configuration log
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "stm8s.h"
+#include "eeprom_map.h"
+#include "keymap.h"
+#include "sim.h"
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SWITCH_COUNT      1000u    //!< Number of layer switches
+#define ENDURANCE_CYCLES  100000u  //!< Data EEPROM endurance (datasheet)
+#define KEY_HOLD          SIM_MS( 30 )
+#define SWITCH_PERIOD     SIM_MS( 100 )
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void PressChord( U8 u8FunctionColumn );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  LAmiga + RAmiga + Fx, then releasing all of them
+ * \param  u8FunctionColumn: column of the function key in ROW0 (14: F1, 13: F2, 12: F3)
+ *********************************************************************/
+static void PressChord( U8 u8FunctionColumn )
+{
+  Sim_SetKey( 5u, 14u, TRUE );   // LAmiga
+  Sim_SetKey( 5u, 4u, TRUE );    // RAmiga
+  Sim_RunFor( KEY_HOLD );
+  Sim_SetKey( 0u, u8FunctionColumn, TRUE );
+  Sim_RunFor( KEY_HOLD );
+  Sim_SetKey( 0u, u8FunctionColumn, FALSE );
+  Sim_SetKey( 5u, 4u, FALSE );
+  Sim_SetKey( 5u, 14u, FALSE );
+  Sim_RunFor( SWITCH_PERIOD - ( 2u * KEY_HOLD ) );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( void )
+{
+  static S_SIM_CIA sCia;
+  U32 u32Switches = 0u;
+  U32 u32Failed = 0u;
+  U32 u32ProgramStart;
+  U32 u32MaxWear = 0u;
+  U32 u32TotalWear = 0u;
+  U8  u8Index;
+  
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &sCia );
+  
+  Sim_RunUntil( SIM_MS( 500 ) );
+  u32ProgramStart = gsSimMemory.u32ProgramOperations;
+  
+  // alternating between the base and the swapped layer, every switch is one configuration change
+  while( u32Switches < SWITCH_COUNT )
+  {
+    PressChord( ( 0u == ( u32Switches & 1u ) ) ? 13u : 14u );
+    u32Switches++;
+    if( Keymap_GetLayer() != ( ( 0u == ( u32Switches & 1u ) ) ? KEYMAP_LAYER_BASE : KEYMAP_LAYER_SWAP ) )
+    {
+      u32Failed++;
+    }
+  }
+  
+  for( u8Index = 0u; u8Index < EEPROM_CONFIG_SIZE; u8Index++ )
+  {
+    U32 u32Wear = gsSimMemory.au32EepromWrites[ ( EEPROM_CONFIG_ADDRESS - SIM_EEPROM_ADDRESS ) + u8Index ];
+    
+    u32TotalWear += u32Wear;
+    u32MaxWear = ( u32Wear > u32MaxWear ) ? u32Wear : u32MaxWear;
+  }
+  
+  printf( "layer switches:       %lu (%lu not applied)\n", (unsigned long)u32Switches, (unsigned long)u32Failed );
+  printf( "program operations:   %lu (%.2f per switch)\n", (unsigned long)( gsSimMemory.u32ProgramOperations - u32ProgramStart ),
+          (double)( gsSimMemory.u32ProgramOperations - u32ProgramStart ) / u32Switches );
+  printf( "bytes programmed:     %lu (write amplification %.2f for a 2 byte value)\n", (unsigned long)u32TotalWear,
+          (double)u32TotalWear / ( 2.0 * u32Switches ) );
+  printf( "worst byte:           %lu cycles (%.3f per switch)\n", (unsigned long)u32MaxWear, (double)u32MaxWear / u32Switches );
+  printf( "endurance:            %.0f switches until the worst byte reaches %u cycles\n",
+          (double)ENDURANCE_CYCLES * u32Switches / ( ( 0u != u32MaxWear ) ? u32MaxWear : 1u ), ENDURANCE_CYCLES );
+  
+  return ( 0u == u32Failed ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,661 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file debounce.c
+*
+* \brief Host simulation -- debounce benchmark: a typing session with worn and stabilized switches is recorded
+*        as matrix samples once, then replayed to the fixed and to the adaptive release hold-off. False and lost
+*        key codes, and the latency of the presses and releases are compared.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "types.h"
+#include "config.h"
+#include "keymap.h"
+#include "layout.h"
+#include "matrix.h"
+#include "sim.h"
+#include "sim_cia.h"
+#include "sim_samples.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define DEBOUNCE_BOOT_TIME      SIM_S( 1 )     //!< Power-up and init key stream, before the first key
+#define DEBOUNCE_KEY_PERIOD     SIM_MS( 160 )  //!< Start of a character --> start of the next one ...
+#define DEBOUNCE_KEY_JITTER     SIM_MS( 60 )   //!< ... plus up to this much
+#define DEBOUNCE_SHIFT_LEAD     SIM_MS( 25 )   //!< Shift pressed before the key, and released after it
+#define DEBOUNCE_HOLD_TIME      SIM_MS( 70 )   //!< Key pressed ...
+#define DEBOUNCE_HOLD_JITTER    SIM_MS( 40 )   //!< ... plus up to this much
+#define DEBOUNCE_TAIL_TIME      SIM_MS( 500 )  //!< Run after the last edge, until the FIFO is empty
+#define DEBOUNCE_READ_PERIOD    SIM_MS( 10 )   //!< The host program reads the port
+#define DEBOUNCE_SCHEDULE_LEAD  SIM_MS( 10 )   //!< An edge is scheduled this long before it settles (more than its chatter)
+#define DEBOUNCE_EDGE_MAX       4096u
+#define DEBOUNCE_CODE_MAX       4096u
+#define DEBOUNCE_CHARS          300u           //!< Default length of the session
+#define DEBOUNCE_WORN_KEYS      5u             //!< Default number of worn letter keys
+#define DEBOUNCE_SCHEMES        2u
+
+// Wear of the switches
+#define DEBOUNCE_FRESH          0u  //!< Short contact chatter only
+#define DEBOUNCE_STABILIZED     1u  //!< Space, Return, Backspace and Shift: the wire of the stabilizer rattles
+#define DEBOUNCE_WORN           2u  //!< Oxidized contacts: the key drops out while held, and closes again after release
+#define DEBOUNCE_WEAR_COUNT     3u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Chatter of the switches of a wear class
+typedef struct
+{
+  const char* pcName;
+  SIM_TIME    u64Bounce;    //!< Contact chatter before the edge settles, see Sim_Keys_ScheduleEdge()
+  U32         u32Percent;   //!< Probability of a dropout after a press, and of a closure after a release
+  SIM_TIME    u64Window;    //!< The dropout or closure starts within this time after the edge ...
+  SIM_TIME    u64Length;    //!< ... and lasts 1 ms .. this long
+} S_DEBOUNCE_WEAR;
+
+//! \brief A settled edge of the session, and the key code it must give
+typedef struct
+{
+  SIM_TIME u64Time;
+  U8       u8Position;     //!< See LAYOUT_POSITION()
+  U8       u8Code;
+  BOOL     bUp;
+} S_DEBOUNCE_EDGE;
+
+//! \brief Outcome of a scheme
+typedef struct
+{
+  BOOL   bDone;
+  U32    u32Received;
+  U32    u32False;                         //!< Codes received, that are not in the session
+  U32    u32Lost;                          //!< Codes of the session not received
+  double adLatencySum[ 2 ];                //!< Press, release -- ms from the first contact change of the edge
+  double adLatencyMax[ 2 ];
+  U32    au32LatencyCount[ 2 ];
+  U8     au8Bounce[ MATRIX_ROW ][ MATRIX_COL ];  //!< Learned bounce of the keys, scans
+} S_DEBOUNCE_RESULT;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+static const S_DEBOUNCE_WEAR gcasWear[ DEBOUNCE_WEAR_COUNT ] =
+{
+  { "fresh",      SIM_US( 1000 ), 0u,  0u,            0u },
+  { "stabilized", SIM_US( 3000 ), 40u, SIM_MS( 15 ),  SIM_MS( 5 ) },
+  { "worn",       SIM_US( 5000 ), 70u, SIM_MS( 25 ),  SIM_MS( 9 ) }
+};
+
+static const U8 gcau8StabilizedCodes[] = { 0x40u, 0x41u, 0x44u, 0x60u, 0x61u };  // Space, Backspace, Return, Shifts
+
+static const char* const gcapcWords[] =
+{
+  "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "amiga", "keyboard", "switch", "contact", "bounce",
+  "release", "press", "matrix", "scan", "code", "deluxe", "paint", "workbench", "shell", "disk", "copper", "blitter"
+};
+
+static const char* const gcapcSchemeNames[ DEBOUNCE_SCHEMES ] = { "fixed", "adaptive" };
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static S_DEBOUNCE_EDGE gasEdges[ DEBOUNCE_EDGE_MAX ];
+static U32             gu32EdgeCount;
+static U8              gau8Wear[ LAYOUT_SCANCODES ];       //!< Wear class of the keys, by code
+static U32             gu32Random = 1u;
+static U16             gu16HoldOff;                        //!< Hold-off bounds of the running scheme, see CONFIG_KEY_DEBOUNCE
+static S_SIM_CIA       gsCia;
+static S_SIM_CIA_CODE  gasReceived[ DEBOUNCE_CODE_MAX ];
+static U32             gu32ReceivedCount;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U32  Random( U32 u32Range );
+static void AddEdge( SIM_TIME u64Time, U8 u8Code, BOOL bUp );
+static void PlanSession( U32 u32Chars );
+static void ScheduleEdge( void* pvContext, SIM_TIME u64Time );
+static void ReadPort( void* pvContext, SIM_TIME u64Time );
+static void Record( const char* pcFile );
+static SIM_TIME FirstContact( U32 u32Edge );
+static BOOL Pairs( U32 u32Edge, U32 u32Code );
+static void Match( S_DEBOUNCE_RESULT* psResult );
+static void Run( const char* pcFile, S_DEBOUNCE_RESULT* psResult );
+static void Usage( void );
+BOOL        __real_Config_Read( U8 u8Key, U16* pu16Value );
+BOOL        __wrap_Config_Read( U8 u8Key, U16* pu16Value );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Random number in 0..u32Range-1 -- the session has its own generator, the chatter uses the one of sim_keys.c
+ *********************************************************************/
+static U32 Random( U32 u32Range )
+{
+  gu32Random = gu32Random * 1103515245u + 12345u;
+  return ( 0u != u32Range ) ? ( ( gu32Random >> 8u ) % u32Range ) : 0u;
+}
+
+static void AddEdge( SIM_TIME u64Time, U8 u8Code, BOOL bUp )
+{
+  S_DEBOUNCE_EDGE* psEdge;
+  U32 u32Index;
+
+  if( gu32EdgeCount < DEBOUNCE_EDGE_MAX )
+  {
+    // sorted by time, the edges of a character come nearly in order
+    for( u32Index = gu32EdgeCount; ( 0u != u32Index ) && ( gasEdges[ u32Index - 1u ].u64Time > u64Time ); u32Index-- )
+    {
+      gasEdges[ u32Index ] = gasEdges[ u32Index - 1u ];
+    }
+    psEdge = &gasEdges[ u32Index ];
+    psEdge->u64Time = u64Time;
+    psEdge->u8Position = Keymap_FindKey( u8Code );
+    psEdge->u8Code = u8Code;
+    psEdge->bUp = bUp;
+    gu32EdgeCount++;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Plans the session: random words, capitals at the start of the lines
+ * \param  u32Chars: length of the session
+ * \return -
+ *********************************************************************/
+static void PlanSession( U32 u32Chars )
+{
+  static char acText[ DEBOUNCE_EDGE_MAX / 4u + 1u ];
+  SIM_TIME    u64Time = DEBOUNCE_BOOT_TIME;
+  SIM_TIME    u64Hold;
+  const char* pcWord;
+  BOOL        bCapital = TRUE;
+  BOOL        bShift;
+  U8          u8Code;
+  U32         u32Length = 0u;
+  U32         u32Index;
+
+  while( u32Length < u32Chars )
+  {
+    for( pcWord = gcapcWords[ Random( sizeof( gcapcWords ) / sizeof( gcapcWords[ 0 ] ) ) ]; ( '\0' != *pcWord ) && ( u32Length < u32Chars ); pcWord++ )
+    {
+      acText[ u32Length++ ] = ( TRUE == bCapital ) ? (char)( *pcWord - 'a' + 'A' ) : *pcWord;
+      bCapital = FALSE;
+    }
+    if( u32Length < u32Chars )
+    {
+      acText[ u32Length ] = ( 0u == Random( 8u ) ) ? '\n' : ' ';
+      bCapital = ( '\n' == acText[ u32Length++ ] ) ? TRUE : FALSE;
+    }
+  }
+
+  for( u32Index = 0u; u32Index < u32Length; u32Index++ )
+  {
+    if( ( TRUE == Sim_Keys_FromChar( acText[ u32Index ], &u8Code, &bShift ) ) && ( LAYOUT_NO_KEY != Keymap_FindKey( u8Code ) ) )
+    {
+      u64Hold = DEBOUNCE_HOLD_TIME + Random( (U32)DEBOUNCE_HOLD_JITTER );
+      if( TRUE == bShift )
+      {
+        AddEdge( u64Time, SIM_SCANCODE_LSHIFT, FALSE );
+        AddEdge( u64Time + DEBOUNCE_SHIFT_LEAD + u64Hold + DEBOUNCE_SHIFT_LEAD, SIM_SCANCODE_LSHIFT, TRUE );
+      }
+      AddEdge( u64Time + DEBOUNCE_SHIFT_LEAD, u8Code, FALSE );
+      AddEdge( u64Time + DEBOUNCE_SHIFT_LEAD + u64Hold, u8Code, TRUE );
+    }
+    u64Time += DEBOUNCE_KEY_PERIOD + Random( (U32)DEBOUNCE_KEY_JITTER );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event: schedules an edge of the session with the chatter of the switch, then the next edge
+ * \param  pvContext: index of the edge
+ * \note   The edges are scheduled one by one, shortly before they are due -- the event queue is short. A dropout
+ *         of a held key, or a closure of a released one, ends before the next edge of the key.
+ *********************************************************************/
+static void ScheduleEdge( void* pvContext, SIM_TIME u64Time )
+{
+  U32 u32Index = (U32)(uintptr_t)pvContext;
+  const S_DEBOUNCE_EDGE* psEdge = &gasEdges[ u32Index ];
+  const S_DEBOUNCE_WEAR* psWear = &gcasWear[ gau8Wear[ psEdge->u8Code ] ];
+  SIM_TIME u64Next = SIM_NEVER;
+  SIM_TIME u64Start, u64Length;
+  U32 u32Other;
+  U8  u8Row = LAYOUT_POSITION_ROW( psEdge->u8Position );
+  U8  u8Column = LAYOUT_POSITION_COL( psEdge->u8Position );
+
+  Sim_Keys_ScheduleEdge( psEdge->u64Time, u8Row, u8Column, ( TRUE == psEdge->bUp ) ? FALSE : TRUE, psWear->u64Bounce );
+  for( u32Other = u32Index + 1u; ( u32Other < gu32EdgeCount ) && ( SIM_NEVER == u64Next ); u32Other++ )
+  {
+    u64Next = ( gasEdges[ u32Other ].u8Code == psEdge->u8Code ) ? ( gasEdges[ u32Other ].u64Time - psWear->u64Bounce ) : SIM_NEVER;
+  }
+  if( ( 0u != psWear->u32Percent ) && ( Random( 100u ) < psWear->u32Percent ) )
+  {
+    u64Start = psEdge->u64Time + SIM_MS( 1 ) + Random( (U32)psWear->u64Window );
+    u64Length = SIM_MS( 1 ) + Random( (U32)( psWear->u64Length - SIM_MS( 1 ) ) );
+    if( ( u64Start + u64Length + SIM_MS( 1 ) ) < u64Next )
+    {
+      Sim_Keys_ScheduleEdge( u64Start, u8Row, u8Column, psEdge->bUp, 0u );
+      Sim_Keys_ScheduleEdge( u64Start + u64Length, u8Row, u8Column, ( TRUE == psEdge->bUp ) ? FALSE : TRUE, 0u );
+    }
+  }
+
+  if( ( u32Index + 1u ) < gu32EdgeCount )
+  {
+    u64Next = gasEdges[ u32Index + 1u ].u64Time - DEBOUNCE_SCHEDULE_LEAD;
+    Sim_Event_Schedule( ( u64Next > u64Time ) ? u64Next : u64Time, ScheduleEdge, (void*)(uintptr_t)( u32Index + 1u ) );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event: the host program reads the port
+ *********************************************************************/
+static void ReadPort( void* pvContext, SIM_TIME u64Time )
+{
+  S_SIM_CIA_CODE sCode;
+
+  (void)pvContext;
+  while( TRUE == Sim_Cia_Read( &gsCia, &sCode ) )
+  {
+    if( ( sCode.u64Time >= DEBOUNCE_BOOT_TIME ) && ( gu32ReceivedCount < DEBOUNCE_CODE_MAX ) )  // the init stream is not part of the session
+    {
+      gasReceived[ gu32ReceivedCount++ ] = sCode;
+    }
+  }
+  Sim_Event_Schedule( u64Time + DEBOUNCE_READ_PERIOD, ReadPort, NULL );
+}
+
+/*! *******************************************************************
+ * \brief  Records the session -- the samples do not depend on the debounce, one recording serves both schemes
+ * \param  pcFile: the recording is written here, the expected codes are the ones of the session
+ * \return -
+ * \note   Runs in a child process.
+ *********************************************************************/
+static void Record( const char* pcFile )
+{
+  static S_SIM_SAMPLES sSamples;
+  U32 u32Index;
+
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &gsCia );
+  Sim_Samples_Record( &sSamples );
+  Sim_Event_Schedule( gasEdges[ 0 ].u64Time - DEBOUNCE_SCHEDULE_LEAD, ScheduleEdge, (void*)(uintptr_t)0u );
+  Sim_RunUntil( gasEdges[ gu32EdgeCount - 1u ].u64Time + DEBOUNCE_TAIL_TIME );
+  for( u32Index = 0u; u32Index < gu32EdgeCount; u32Index++ )
+  {
+    Sim_Samples_AddCode( &sSamples, (U8)( ( gasEdges[ u32Index ].u8Code << 1u ) | ( ( TRUE == gasEdges[ u32Index ].bUp ) ? 1u : 0u ) ) );
+  }
+  if( FALSE == Sim_Samples_Save( &sSamples, pcFile ) )
+  {
+    fprintf( stderr, "debounce: %s: cannot write\n", pcFile );
+    _exit( EXIT_FAILURE );
+  }
+  Sim_Samples_Free( &sSamples );
+}
+
+/*! *******************************************************************
+ * \brief  Time of the first contact change of an edge of the session
+ *********************************************************************/
+static SIM_TIME FirstContact( U32 u32Edge )
+{
+  return gasEdges[ u32Edge ].u64Time - gcasWear[ gau8Wear[ gasEdges[ u32Edge ].u8Code ] ].u64Bounce;
+}
+
+/*! *******************************************************************
+ * \brief  Checks whether a received code can belong to an edge of the session
+ * \note   A code sent before the contact started to move is a false event of an earlier dropout.
+ *********************************************************************/
+static BOOL Pairs( U32 u32Edge, U32 u32Code )
+{
+  return ( ( gasEdges[ u32Edge ].u8Code == gasReceived[ u32Code ].u8Code ) && ( gasEdges[ u32Edge ].bUp == gasReceived[ u32Code ].bUp )
+        && ( gasReceived[ u32Code ].u64Time >= FirstContact( u32Edge ) ) ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Pairs the received codes with the session (longest common subsequence), and collects the latency
+ *********************************************************************/
+static void Match( S_DEBOUNCE_RESULT* psResult )
+{
+  U32  u32Columns = gu32ReceivedCount + 1u;
+  U16* pu16Table = calloc( ( gu32EdgeCount + 1u ) * u32Columns, sizeof( U16 ) );
+  U32  u32Edge, u32Code;
+  U32  u32Matched = 0u;
+  double dMs;
+  U8   u8Kind;
+
+  if( NULL == pu16Table )
+  {
+    fprintf( stderr, "debounce: out of memory\n" );
+    _exit( EXIT_FAILURE );
+  }
+  for( u32Edge = gu32EdgeCount; u32Edge-- > 0u; )
+  {
+    for( u32Code = gu32ReceivedCount; u32Code-- > 0u; )
+    {
+      if( TRUE == Pairs( u32Edge, u32Code ) )
+      {
+        pu16Table[ u32Edge * u32Columns + u32Code ] = pu16Table[ ( u32Edge + 1u ) * u32Columns + u32Code + 1u ] + 1u;
+      }
+      else
+      {
+        pu16Table[ u32Edge * u32Columns + u32Code ] = ( pu16Table[ ( u32Edge + 1u ) * u32Columns + u32Code ] > pu16Table[ u32Edge * u32Columns + u32Code + 1u ] )
+                                                      ? pu16Table[ ( u32Edge + 1u ) * u32Columns + u32Code ] : pu16Table[ u32Edge * u32Columns + u32Code + 1u ];
+      }
+    }
+  }
+
+  u32Edge = 0u;
+  u32Code = 0u;
+  while( ( u32Edge < gu32EdgeCount ) && ( u32Code < gu32ReceivedCount ) )
+  {
+    if( TRUE == Pairs( u32Edge, u32Code ) )
+    {
+      u8Kind = ( TRUE == gasEdges[ u32Edge ].bUp ) ? 1u : 0u;
+      dMs = SIM_TO_US( gasReceived[ u32Code ].u64Time - FirstContact( u32Edge ) ) / 1000.0;
+      psResult->adLatencySum[ u8Kind ] += dMs;
+      psResult->adLatencyMax[ u8Kind ] = ( dMs > psResult->adLatencyMax[ u8Kind ] ) ? dMs : psResult->adLatencyMax[ u8Kind ];
+      psResult->au32LatencyCount[ u8Kind ]++;
+      u32Matched++;
+      u32Edge++;
+      u32Code++;
+    }
+    else if( pu16Table[ ( u32Edge + 1u ) * u32Columns + u32Code ] >= pu16Table[ u32Edge * u32Columns + u32Code + 1u ] )
+    {
+      u32Edge++;
+    }
+    else
+    {
+      u32Code++;
+    }
+  }
+  free( pu16Table );
+
+  psResult->u32Received = gu32ReceivedCount;
+  psResult->u32False = gu32ReceivedCount - u32Matched;
+  psResult->u32Lost = gu32EdgeCount - u32Matched;
+}
+
+/*! *******************************************************************
+ * \brief  Replays the recording to the firmware
+ * \param  pcFile: the recording
+ * \param  psResult: the outcome will be put here (shared memory)
+ * \return -
+ * \note   Runs in a child process, the hold-off bounds are taken from gu16HoldOff.
+ *********************************************************************/
+static void Run( const char* pcFile, S_DEBOUNCE_RESULT* psResult )
+{
+  static S_SIM_SAMPLES sSamples;
+  U8 u8Row, u8Column;
+
+  if( FALSE == Sim_Samples_Load( &sSamples, pcFile ) )
+  {
+    fprintf( stderr, "debounce: %s: cannot load the recording\n", pcFile );
+    _exit( EXIT_FAILURE );
+  }
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &gsCia );
+  Sim_Samples_Replay( &sSamples );
+  Sim_Event_Schedule( DEBOUNCE_READ_PERIOD, ReadPort, NULL );
+  while( TRUE == Sim_Samples_IsReplaying( &sSamples ) )
+  {
+    Sim_RunFor( SIM_MS( 100 ) );
+  }
+  Sim_RunFor( DEBOUNCE_TAIL_TIME );
+  ReadPort( NULL, Sim_GetTime() );
+
+  Match( psResult );
+  for( u8Row = 0u; u8Row < MATRIX_ROW; u8Row++ )
+  {
+    for( u8Column = 0u; u8Column < MATRIX_COL; u8Column++ )
+    {
+      psResult->au8Bounce[ u8Row ][ u8Column ] = Matrix_GetBounce( u8Row, u8Column );
+    }
+  }
+  psResult->bDone = TRUE;
+  Sim_Samples_Free( &sSamples );
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: debounce [-n chars] [-w worn_keys] [-s seed] [-m min:max] [-o recording]\n"
+                   "  -n  length of the typing session (default %u characters)\n"
+                   "  -w  number of worn letter keys (default %u)\n"
+                   "  -s  seed of the session and of the chatter\n"
+                   "  -m  bounds of the adaptive release hold-off in scans (default: the ones of the firmware)\n"
+                   "  -o  keeps the recording, it can be checked with replay\n", DEBOUNCE_CHARS, DEBOUNCE_WORN_KEYS );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Bounds of the release hold-off of the running scheme, the rest of the configuration is untouched
+BOOL __wrap_Config_Read( U8 u8Key, U16* pu16Value )
+{
+  BOOL bRet;
+
+  if( ( CONFIG_KEY_DEBOUNCE == u8Key ) && ( 0u != gu16HoldOff ) )
+  {
+    *pu16Value = gu16HoldOff;
+    bRet = TRUE;
+  }
+  else
+  {
+    bRet = __real_Config_Read( u8Key, pu16Value );
+  }
+
+  return bRet;
+}
+
+int main( int argc, char* argv[] )
+{
+  static const char  acLetters[] = "etaoinsrhdlcumwfgypbvk";
+  S_DEBOUNCE_RESULT* psResults;
+  S_DEBOUNCE_RESULT* psResult;
+  char   acFile[] = "/tmp/debounceXXXXXX";
+  const char* pcFile = NULL;
+  U32    u32Chars = DEBOUNCE_CHARS;
+  U32    u32Worn = DEBOUNCE_WORN_KEYS;
+  U32    u32Seed = 1u;
+  U16    u16Adaptive = 0u;
+  U32    u32Index;
+  U8     u8Code, u8Row, u8Column, u8Scheme;
+  BOOL   bShift;
+  unsigned int uMin, uMax;
+  pid_t  iChild;
+  int    iStatus;
+  int    iArg;
+  int    iRet = EXIT_SUCCESS;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-n" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Chars = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-w" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Worn = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-s" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Seed = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-m" ) ) && ( ( iArg + 1 ) < argc ) && ( 2 == sscanf( argv[ iArg + 1 ], "%u:%u", &uMin, &uMax ) )
+          && ( 1u <= uMin ) && ( uMin <= uMax ) && ( uMax < 0x100u ) )
+    {
+      u16Adaptive = (U16)( ( uMin << 8u ) | uMax );
+      iArg++;
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-o" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcFile = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  if( ( 0u == u32Chars ) || ( ( u32Chars * 4u ) > DEBOUNCE_EDGE_MAX ) || ( u32Worn > ( sizeof( acLetters ) - 1u ) ) )
+  {
+    Usage();
+  }
+
+  // the session and the wear of the keys
+  gu32Random = u32Seed;
+  Sim_Keys_Seed( u32Seed );
+  for( u32Index = 0u; u32Index < sizeof( gcau8StabilizedCodes ); u32Index++ )
+  {
+    gau8Wear[ gcau8StabilizedCodes[ u32Index ] ] = DEBOUNCE_STABILIZED;
+  }
+  for( u32Index = 0u; u32Index < u32Worn; )
+  {
+    Sim_Keys_FromChar( acLetters[ Random( sizeof( acLetters ) - 1u ) ], &u8Code, &bShift );
+    u32Index += ( DEBOUNCE_WORN != gau8Wear[ u8Code ] ) ? 1u : 0u;
+    gau8Wear[ u8Code ] = DEBOUNCE_WORN;
+  }
+  PlanSession( u32Chars );
+
+  // one recording, replayed to every scheme
+  if( NULL == pcFile )
+  {
+    iArg = mkstemp( acFile );
+    if( iArg < 0 )
+    {
+      perror( "debounce: mkstemp" );
+      exit( EXIT_FAILURE );
+    }
+    close( iArg );
+    pcFile = acFile;
+  }
+  fflush( stdout );
+  iChild = fork();
+  if( 0 == iChild )
+  {
+    Record( pcFile );
+    _exit( EXIT_SUCCESS );
+  }
+  waitpid( iChild, &iStatus, 0 );
+  if( ( FALSE == WIFEXITED( iStatus ) ) || ( EXIT_SUCCESS != WEXITSTATUS( iStatus ) ) )
+  {
+    exit( EXIT_FAILURE );
+  }
+
+  psResults = mmap( NULL, sizeof( S_DEBOUNCE_RESULT ) * DEBOUNCE_SCHEMES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+  if( MAP_FAILED == psResults )
+  {
+    perror( "debounce: mmap" );
+    exit( EXIT_FAILURE );
+  }
+  for( u8Scheme = 0u; u8Scheme < DEBOUNCE_SCHEMES; u8Scheme++ )
+  {
+    gu16HoldOff = ( 0u == u8Scheme ) ? 0x0101u : u16Adaptive;  // fixed: every release at the first open sample
+    fflush( stdout );
+    iChild = fork();
+    if( 0 == iChild )
+    {
+      Run( pcFile, &psResults[ u8Scheme ] );
+      _exit( EXIT_SUCCESS );
+    }
+    waitpid( iChild, NULL, 0 );
+  }
+  if( acFile == pcFile )
+  {
+    unlink( acFile );
+  }
+
+  printf( "session:        %lu characters, %lu key codes, %.1f s, seed %lu\n", (unsigned long)u32Chars, (unsigned long)gu32EdgeCount,
+          SIM_TO_US( gasEdges[ gu32EdgeCount - 1u ].u64Time - DEBOUNCE_BOOT_TIME ) / 1e6, (unsigned long)u32Seed );
+  for( u32Index = 0u; u32Index < DEBOUNCE_WEAR_COUNT; u32Index++ )
+  {
+    printf( "%-16s%.1f ms chatter", ( 0u == u32Index ) ? "switches:" : "", SIM_TO_US( gcasWear[ u32Index ].u64Bounce ) / 1000.0 );
+    if( 0u != gcasWear[ u32Index ].u32Percent )
+    {
+      printf( ", %lu %% of the edges bounce again for 1..%.0f ms", (unsigned long)gcasWear[ u32Index ].u32Percent,
+              SIM_TO_US( gcasWear[ u32Index ].u64Length ) / 1000.0 );
+    }
+    printf( " (%s)\n", gcasWear[ u32Index ].pcName );
+  }
+  printf( "worn keys:     " );
+  for( u32Index = 0u; u32Index < LAYOUT_SCANCODES; u32Index++ )
+  {
+    if( DEBOUNCE_WORN == gau8Wear[ u32Index ] )
+    {
+      printf( " 0x%02lX", (unsigned long)u32Index );
+    }
+  }
+  printf( "\n\n%-9s %9s %9s %6s %5s %20s %20s\n", "scheme", "hold-off", "received", "false", "lost", "press mean/max ms", "release mean/max ms" );
+  for( u8Scheme = 0u; u8Scheme < DEBOUNCE_SCHEMES; u8Scheme++ )
+  {
+    psResult = &psResults[ u8Scheme ];
+    printf( "%-9s", gcapcSchemeNames[ u8Scheme ] );
+    if( TRUE == psResult->bDone )
+    {
+      if( 0u == u8Scheme )
+      {
+        printf( " %9s", "1..1" );
+      }
+      else if( 0u != u16Adaptive )
+      {
+        printf( " %6u..%u", u16Adaptive >> 8u, u16Adaptive & 0xFFu );
+      }
+      else
+      {
+        printf( " %9s", "default" );
+      }
+      printf( " %9lu %6lu %5lu %9.1f / %8.1f %9.1f / %8.1f\n", (unsigned long)psResult->u32Received, (unsigned long)psResult->u32False,
+              (unsigned long)psResult->u32Lost,
+              psResult->adLatencySum[ 0 ] / ( ( 0u != psResult->au32LatencyCount[ 0 ] ) ? psResult->au32LatencyCount[ 0 ] : 1u ), psResult->adLatencyMax[ 0 ],
+              psResult->adLatencySum[ 1 ] / ( ( 0u != psResult->au32LatencyCount[ 1 ] ) ? psResult->au32LatencyCount[ 1 ] : 1u ), psResult->adLatencyMax[ 1 ] );
+    }
+    else
+    {
+      printf( " crashed\n" );
+      iRet = EXIT_FAILURE;
+    }
+  }
+
+  // what the adaptive scheme has learned
+  psResult = &psResults[ 1 ];
+  if( TRUE == psResult->bDone )
+  {
+    printf( "\nlearned bounce (adaptive, scans):" );
+    for( u8Row = 0u; u8Row < MATRIX_ROW; u8Row++ )
+    {
+      for( u8Column = 0u; u8Column < MATRIX_COL; u8Column++ )
+      {
+        if( 0u != psResult->au8Bounce[ u8Row ][ u8Column ] )
+        {
+          printf( " 0x%02X:%u", gcau8ScanCodeTable[ u8Row ][ u8Column ], psResult->au8Bounce[ u8Row ][ u8Column ] );
+        }
+      }
+    }
+    printf( "\n" );
+  }
+  munmap( psResults, sizeof( S_DEBOUNCE_RESULT ) * DEBOUNCE_SCHEMES );
+
+  return iRet;
+}
+
+/******************************<EOF>**********************************/
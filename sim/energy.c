@@ -0,0 +1,283 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file energy.c
+*
+* \brief Host simulation -- supply current and energy of the keyboard in three scenarios, one after the other:
+*        idle with the computer listening, typing, and typing with the computer absent (no handshake, so the
+*        keyboard keeps synchronizing). The estimate comes from the residency of the CPU states and the activity of
+*        the lines, see sim_energy.h for the datasheet figures and the loads.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "sim.h"
+#include "sim_cia.h"
+#include "sim_energy.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define ENERGY_BOOT_TIME      SIM_S( 1 )     //!< Power-up and init key stream, not measured
+#define ENERGY_DURATION       10u            //!< Default length of a scenario, s
+#define ENERGY_WPM            60u            //!< Default typing speed, 5 characters per word
+#define ENERGY_SHIFT_LEAD     SIM_MS( 20 )   //!< Shift pressed before the key
+#define ENERGY_HOLD_TIME      SIM_MS( 80 )   //!< Key pressed
+#define ENERGY_SLICE          SIM_S( 1 )     //!< Typing is scheduled one slice ahead
+#define ENERGY_SCENARIOS      3u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A measured scenario
+typedef struct
+{
+  const char*         pcName;
+  S_SIM_ENERGY_REPORT sReport;
+} S_ENERGY_SCENARIO;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void PlanTyping( const char* pcText, const char** ppcChar, SIM_TIME* pu64Time, SIM_TIME u64End, SIM_TIME u64Period );
+static void Measure( S_SIM_ENERGY* psEnergy, S_ENERGY_SCENARIO* psScenario, SIM_TIME u64Duration, const char* pcText, SIM_TIME u64Period );
+static void Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Schedules the edges of the characters starting before a time, the text is repeated
+ * \param  pcText: characters, see Sim_Keys_FromChar()
+ * \param  ppcChar: next character, updated
+ * \param  pu64Time: start of the next character, updated
+ * \param  u64End: no character starts at or after it
+ * \param  u64Period: start of a character --> start of the next one
+ * \return -
+ * \note   The edges are scheduled slice by slice: a long scenario would not fit into the event queue.
+ *********************************************************************/
+static void PlanTyping( const char* pcText, const char** ppcChar, SIM_TIME* pu64Time, SIM_TIME u64End, SIM_TIME u64Period )
+{
+  U8   u8ScanCode, u8Row, u8Column, u8ShiftRow, u8ShiftColumn;
+  BOOL bShift;
+
+  Sim_Keys_Find( SIM_SCANCODE_LSHIFT, &u8ShiftRow, &u8ShiftColumn );
+  while( *pu64Time < u64End )
+  {
+    if( ( TRUE == Sim_Keys_FromChar( **ppcChar, &u8ScanCode, &bShift ) ) && ( TRUE == Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column ) ) )
+    {
+      if( TRUE == bShift )
+      {
+        Sim_Keys_ScheduleEdge( *pu64Time, u8ShiftRow, u8ShiftColumn, TRUE, 0u );
+        Sim_Keys_ScheduleEdge( *pu64Time + ENERGY_SHIFT_LEAD + ENERGY_HOLD_TIME + ENERGY_SHIFT_LEAD, u8ShiftRow, u8ShiftColumn, FALSE, 0u );
+      }
+      Sim_Keys_ScheduleEdge( *pu64Time + ENERGY_SHIFT_LEAD, u8Row, u8Column, TRUE, 0u );
+      Sim_Keys_ScheduleEdge( *pu64Time + ENERGY_SHIFT_LEAD + ENERGY_HOLD_TIME, u8Row, u8Column, FALSE, 0u );
+    }
+    *pu64Time += u64Period;
+    *ppcChar = ( '\0' != (*ppcChar)[ 1 ] ) ? ( *ppcChar + 1 ) : pcText;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Runs a scenario, and estimates it
+ * \param  psEnergy: the accumulator
+ * \param  psScenario: output
+ * \param  u64Duration: length of the scenario
+ * \param  pcText: typed during the scenario, NULL: no typing
+ * \param  u64Period: start of a character --> start of the next one
+ * \return -
+ *********************************************************************/
+static void Measure( S_SIM_ENERGY* psEnergy, S_ENERGY_SCENARIO* psScenario, SIM_TIME u64Duration, const char* pcText, SIM_TIME u64Period )
+{
+  static S_SIM_ENERGY sFrom;
+  static S_SIM_ENERGY sTo;
+  const char* pcChar = pcText;
+  SIM_TIME    u64End = Sim_GetTime() + u64Duration;
+  SIM_TIME    u64Next = Sim_GetTime();
+  SIM_TIME    u64Slice;
+
+  Sim_Energy_Snapshot( psEnergy, &sFrom );
+  while( Sim_GetTime() < u64End )
+  {
+    u64Slice = ( ( u64End - Sim_GetTime() ) > ENERGY_SLICE ) ? ( Sim_GetTime() + ENERGY_SLICE ) : u64End;
+    if( NULL != pcText )  // the last character is released before the end of the scenario
+    {
+      PlanTyping( pcText, &pcChar, &u64Next, ( u64Slice < ( u64End - u64Period ) ) ? u64Slice : ( u64End - u64Period ), u64Period );
+    }
+    Sim_RunUntil( u64Slice );
+  }
+  Sim_Energy_Snapshot( psEnergy, &sTo );
+  Sim_Energy_Report( &sFrom, &sTo, &psScenario->sReport );
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: energy [-d seconds] [-w wpm] [-t text]\n"
+                   "  -d  length of each scenario (default %u s)\n"
+                   "  -w  typing speed, 5 characters per word (default %u)\n"
+                   "  -t  text typed, repeated (default \"Hello world\")\n", ENERGY_DURATION, ENERGY_WPM );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  static S_SIM_CIA         sCia;
+  static S_SIM_ENERGY      sEnergy;
+  static S_ENERGY_SCENARIO asScenarios[ ENERGY_SCENARIOS ];
+  const char* pcText = "Hello world";
+  U32      u32Seconds = ENERGY_DURATION;
+  U32      u32Wpm = ENERGY_WPM;
+  U32      u32Index;
+  U8       u8Part;
+  U8       u8Step;
+  U8       u8Line;
+  SIM_TIME u64Duration;
+  SIM_TIME u64Period;
+  double   dShare;
+  int      iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-d" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Seconds = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-w" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Wpm = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-t" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcText = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  if( ( 0u == u32Seconds ) || ( 0u == u32Wpm ) || ( '\0' == *pcText ) )
+  {
+    Usage();
+  }
+  u64Duration = SIM_S( u32Seconds );
+  u64Period = SIM_S( 60u ) / ( 5u * u32Wpm );
+
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &sCia );
+  Sim_Energy_Connect( &sEnergy );
+  Sim_RunUntil( ENERGY_BOOT_TIME );
+
+  asScenarios[ 0 ].pcName = "idle";
+  Measure( &sEnergy, &asScenarios[ 0 ], u64Duration, NULL, u64Period );
+
+  asScenarios[ 1 ].pcName = "typing";
+  Measure( &sEnergy, &asScenarios[ 1 ], u64Duration, pcText, u64Period );
+
+  // the computer stops answering: the keyboard synchronizes again and again, with the typed codes waiting
+  asScenarios[ 2 ].pcName = "absent";
+  Sim_SetLineDriver( SIM_LINE_KDAT, NULL, NULL );
+  Measure( &sEnergy, &asScenarios[ 2 ], u64Duration, pcText, u64Period );
+
+  printf( "%lu s per scenario, typing at %lu WPM, VDD %.1f V\n\n", (unsigned long)u32Seconds, (unsigned long)u32Wpm, SIM_ENERGY_VDD );
+  printf( "%-8s", "mA" );
+  for( u8Part = 0u; u8Part < SIM_ENERGY_PART_COUNT; u8Part++ )
+  {
+    printf( " %10s", Sim_Energy_GetPartName( u8Part ) );
+  }
+  printf( " %10s %10s %10s\n", "total", "mW", "mJ" );
+  for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+  {
+    printf( "%-8s", asScenarios[ u32Index ].pcName );
+    for( u8Part = 0u; u8Part < SIM_ENERGY_PART_COUNT; u8Part++ )
+    {
+      printf( " %10.4f", asScenarios[ u32Index ].sReport.adCurrentMa[ u8Part ] );
+    }
+    printf( " %10.4f %10.3f %10.2f\n", asScenarios[ u32Index ].sReport.dCurrentMa, asScenarios[ u32Index ].sReport.dCurrentMa * SIM_ENERGY_VDD,
+            asScenarios[ u32Index ].sReport.dEnergyMj );
+  }
+
+  // residency of the CPU states, only the ones used
+  printf( "\n%-16s", "cpu state %" );
+  for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+  {
+    printf( " %10s", asScenarios[ u32Index ].pcName );
+  }
+  printf( "\n" );
+  for( u8Step = 0u; u8Step < ( 2u * SIM_CPU_DIVIDER_STEPS ); u8Step++ )
+  {
+    dShare = 0.0;
+    for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+    {
+      dShare += ( u8Step < SIM_CPU_DIVIDER_STEPS ) ? asScenarios[ u32Index ].sReport.adRunShare[ u8Step ]
+                                                   : asScenarios[ u32Index ].sReport.adWaitShare[ u8Step - SIM_CPU_DIVIDER_STEPS ];
+    }
+    if( dShare > 0.0 )
+    {
+      printf( "%-5s %6.0f kHz", ( u8Step < SIM_CPU_DIVIDER_STEPS ) ? "run" : "wait", ( SIM_HSI_HZ / 1000.0 ) / (double)( 1u << ( u8Step % SIM_CPU_DIVIDER_STEPS ) ) );
+      for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+      {
+        printf( " %10.2f", 100.0 * ( ( u8Step < SIM_CPU_DIVIDER_STEPS ) ? asScenarios[ u32Index ].sReport.adRunShare[ u8Step ]
+                                                                        : asScenarios[ u32Index ].sReport.adWaitShare[ u8Step - SIM_CPU_DIVIDER_STEPS ] ) );
+      }
+      printf( "\n" );
+    }
+  }
+  printf( "%-16s", "halt" );
+  for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+  {
+    printf( " %10.2f", 100.0 * asScenarios[ u32Index ].sReport.dHaltShare );
+  }
+
+  // activity of the lines driven by the controller: rising edges per second, and the part of the time driven low
+  printf( "\n\n%-16s", "line edges/s" );
+  for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+  {
+    printf( " %10s %6s", asScenarios[ u32Index ].pcName, "low %" );
+  }
+  printf( "\n" );
+  for( u8Line = 0u; u8Line < SIM_LINE_COUNT; u8Line++ )
+  {
+    dShare = 0.0;
+    for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+    {
+      dShare += asScenarios[ u32Index ].sReport.adRisingPerSecond[ u8Line ] + asScenarios[ u32Index ].sReport.adLowShare[ u8Line ];
+    }
+    if( dShare > 0.0 )
+    {
+      printf( "%-16s", Sim_GetLineName( u8Line ) );
+      for( u32Index = 0u; u32Index < ENERGY_SCENARIOS; u32Index++ )
+      {
+        printf( " %10.1f %6.2f", asScenarios[ u32Index ].sReport.adRisingPerSecond[ u8Line ], 100.0 * asScenarios[ u32Index ].sReport.adLowShare[ u8Line ] );
+      }
+      printf( "\n" );
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,634 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file faults.c
+*
+* \brief Host simulation -- protocol fault injection: missed and short handshakes, KDAT glitches, computer
+*        reboot and silence, with the recovery time, the retransmissions and the damaged key events
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "types.h"
+#include "trace.h"
+#include "sim.h"
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define FAULTS_BOOT_TIME      SIM_S( 1 )     //!< Power-up and init key stream, before the first key
+#define FAULTS_START          SIM_MS( 3050 ) //!< The fault is injected here, after 2 s of typing -- the next code is a key press
+#define FAULTS_TYPE_AFTER     SIM_S( 3 )     //!< Typing goes on this long after the fault
+#define FAULTS_DRAIN_TIME     SIM_S( 2 )     //!< Run after the last key, until the FIFO is empty
+#define FAULTS_KEY_PERIOD     SIM_MS( 150 )  //!< One keystroke ...
+#define FAULTS_HOLD_TIME      SIM_MS( 60 )   //!< ... held this long
+#define FAULTS_BOUNCE         SIM_US( 1000 )
+#define FAULTS_READ_PERIOD    SIM_MS( 10 )   //!< The host program reads the port
+#define FAULTS_LATE_LIMIT     SIM_MS( 20 )   //!< A code received later than this after its key edge is not on time
+#define FAULTS_CODES_MAX      1024u
+#define FAULTS_SCENARIO_MAX   32u
+#define FAULTS_NAME_SIZE      24u
+#define FAULTS_NEVER          (-1.0)
+
+// Raw bytes, that are not key codes -- the computer rotates them right: 0xF3 --> 0xF9
+#define FAULTS_RAW_SYNC       0xFFu
+#define FAULTS_RAW_LOST_SYNC  0xF3u  //!< "Last key code bad" (0xF9) as shifted in
+#define FAULTS_RAW_INIT       0xFBu
+#define FAULTS_RAW_TERM       0xFDu
+
+// Faults
+#define FAULT_MISS            0u   //!< value: bytes without handshake
+#define FAULT_SHORT           1u   //!< value: handshake width [us], for the duration
+#define FAULT_GLITCH          2u   //!< value: bit of the next byte flipped to 1 by a KDAT glitch
+#define FAULT_REBOOT          3u   //!< value: reboot time [ms], starts in the middle of the next byte
+#define FAULT_SILENCE         4u   //!< value: no handshake [ms]
+#define FAULT_COUNT           5u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A line of the script
+typedef struct
+{
+  char     acName[ FAULTS_NAME_SIZE ];
+  U8       u8Fault;    //!< FAULT_x
+  U32      u32Value;
+  U32      u32Ms;      //!< Duration of FAULT_SHORT
+} S_FAULTS_SCENARIO;
+
+//! \brief Outcome of a scenario
+typedef struct
+{
+  BOOL     bDone;
+  double   dRecoveryMs;   //!< Fault --> first code of the consistent rest of the stream (FAULTS_NEVER: not recovered)
+  U32      u32Resyncs;
+  U32      u32Retransmits;
+  U32      u32LostSync;   //!< "Last key code bad" received by the computer
+  U32      u32Codes;      //!< Key codes expected
+  U32      u32Lost;
+  U32      u32Reordered;  //!< Expected, but received out of order
+  U32      u32Duplicated; //!< Repeat of the last key code in order
+  U32      u32Garbled;    //!< Other key codes, not expected
+  U32      u32AcksMissed;
+} S_FAULTS_RESULT;
+
+//! \brief A key code with its time
+typedef struct
+{
+  SIM_TIME u64Time;    //!< Expected: key edge, received: last bit
+  U8       u8Raw;
+  BOOL     bMatched;
+} S_FAULTS_CODE;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+static const char* const gcapcFaultNames[ FAULT_COUNT ] = { "miss", "short", "glitch", "reboot", "silence" };
+
+//! \brief The default suite
+static const char gcacDefaultScript[] =
+  "# name          fault    value  [duration_ms]\n"
+  "miss_1          miss     1\n"
+  "miss_3          miss     3\n"
+  "short_ack_1us   short    1      500\n"
+  "short_ack_4us   short    4      500\n"
+  "glitch_bit0     glitch   0\n"
+  "glitch_bit7     glitch   7\n"
+  "reboot_300ms    reboot   300\n"
+  "silence_1s      silence  1000\n"
+  "silence_10s     silence  10000\n"
+  "silence_60s     silence  60000\n";
+
+static const char gcacKeys[] = "abcdefghijklmnopqrstuvwxyz";
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static S_FAULTS_SCENARIO gasScenario[ FAULTS_SCENARIO_MAX ];
+static U32               gu32ScenarioCount;
+static S_SIM_CIA         gsCia;
+static S_FAULTS_CODE     gasExpected[ FAULTS_CODES_MAX ];
+static U32               gu32Expected;
+static S_FAULTS_CODE     gasReceived[ FAULTS_CODES_MAX ];
+static U32               gu32Received;
+static U32               gu32Overflow;     //!< Received codes beyond FAULTS_CODES_MAX
+static U32               gu32LostSync;
+static U32               gu32Resyncs;
+static U32               gu32Retransmits;
+static SIM_TIME          gu64TypeEnd;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U32    Random( U32 u32Range );
+static void   TypeKey( void* pvContext, SIM_TIME u64Time );
+static void   ReadPort( void* pvContext, SIM_TIME u64Time );
+static void   Inject( void* pvContext, SIM_TIME u64Time );
+static void   RestoreAckWidth( void* pvContext, SIM_TIME u64Time );
+static void   Match( void );
+static double GetRecoveryMs( void );
+static void   Run( const S_FAULTS_SCENARIO* psScenario, S_FAULTS_RESULT* psResult );
+static BOOL   ParseScript( const char* pcScript );
+static char*  ReadFile( const char* pcFile );
+static BOOL   IsSelected( const char* pcName, int argc, char* argv[], int iFirst );
+static void   Usage( void );
+void          __real_Trace_Write( U8 u8Event, U8 u8Argument );
+void          __wrap_Trace_Write( U8 u8Event, U8 u8Argument );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Random number in 0..u32Range-1
+ *********************************************************************/
+static U32 Random( U32 u32Range )
+{
+  return ( 0u != u32Range ) ? ( ( ( (U32)Sim_Keys_Random() << 15u ) | Sim_Keys_Random() ) % u32Range ) : 0u;
+}
+
+/*! *******************************************************************
+ * \brief  Event: one keystroke of a random letter, then the next one
+ *********************************************************************/
+static void TypeKey( void* pvContext, SIM_TIME u64Time )
+{
+  SIM_TIME u64Press = u64Time + FAULTS_BOUNCE;
+  U8   u8ScanCode, u8Row, u8Column;
+  BOOL bShift;
+
+  (void)pvContext;
+  Sim_Keys_FromChar( gcacKeys[ Random( sizeof( gcacKeys ) - 1u ) ], &u8ScanCode, &bShift );
+  Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column );
+  Sim_Keys_ScheduleEdge( u64Press, u8Row, u8Column, TRUE, FAULTS_BOUNCE );
+  Sim_Keys_ScheduleEdge( u64Press + FAULTS_HOLD_TIME, u8Row, u8Column, FALSE, FAULTS_BOUNCE );
+  if( ( gu32Expected + 2u ) <= FAULTS_CODES_MAX )
+  {
+    gasExpected[ gu32Expected ].u64Time = u64Press;
+    gasExpected[ gu32Expected++ ].u8Raw = (U8)( u8ScanCode << 1u );
+    gasExpected[ gu32Expected ].u64Time = u64Press + FAULTS_HOLD_TIME;
+    gasExpected[ gu32Expected++ ].u8Raw = (U8)( ( u8ScanCode << 1u ) | 0x01u );
+  }
+  if( ( u64Time + FAULTS_KEY_PERIOD ) < gu64TypeEnd )
+  {
+    Sim_Event_Schedule( u64Time + FAULTS_KEY_PERIOD, TypeKey, NULL );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event: the host program collects the received codes
+ *********************************************************************/
+static void ReadPort( void* pvContext, SIM_TIME u64Time )
+{
+  S_SIM_CIA_CODE sCode;
+
+  (void)pvContext;
+  while( TRUE == Sim_Cia_Read( &gsCia, &sCode ) )
+  {
+    if( FAULTS_RAW_LOST_SYNC == sCode.u8Raw )
+    {
+      gu32LostSync++;
+    }
+    else if( ( FAULTS_RAW_SYNC != sCode.u8Raw ) && ( FAULTS_RAW_INIT != sCode.u8Raw ) && ( FAULTS_RAW_TERM != sCode.u8Raw ) )
+    {
+      if( gu32Received < FAULTS_CODES_MAX )
+      {
+        gasReceived[ gu32Received ].u64Time = sCode.u64Time;
+        gasReceived[ gu32Received++ ].u8Raw = sCode.u8Raw;
+      }
+      else
+      {
+        gu32Overflow++;
+      }
+    }
+  }
+  Sim_Event_Schedule( u64Time + FAULTS_READ_PERIOD, ReadPort, NULL );
+}
+
+/*! *******************************************************************
+ * \brief  Event: injects the fault of the scenario
+ *********************************************************************/
+static void Inject( void* pvContext, SIM_TIME u64Time )
+{
+  const S_FAULTS_SCENARIO* psScenario = (const S_FAULTS_SCENARIO*)pvContext;
+
+  switch( psScenario->u8Fault )
+  {
+    case FAULT_MISS:
+      Sim_Cia_SkipAcks( &gsCia, (U8)psScenario->u32Value );
+      break;
+    case FAULT_SHORT:
+      Sim_Event_Schedule( u64Time + SIM_MS( psScenario->u32Ms ), RestoreAckWidth, (void*)(uintptr_t)gsCia.u64AckWidth );
+      gsCia.u64AckWidth = SIM_US( psScenario->u32Value );
+      gsCia.u64AckWidth = ( gsCia.u64AckWidth > SIM_CIA_ACK_WIDTH_MIN ) ? gsCia.u64AckWidth : SIM_CIA_ACK_WIDTH_MIN;
+      break;
+    case FAULT_GLITCH:
+      Sim_Cia_Glitch( &gsCia, (U8)psScenario->u32Value );
+      break;
+    case FAULT_REBOOT:
+      Sim_Cia_Reboot( &gsCia, 4u, SIM_MS( psScenario->u32Value ) );
+      break;
+    default:
+      Sim_Cia_Stall( &gsCia, SIM_MS( psScenario->u32Value ) );
+      break;
+  }
+}
+
+static void RestoreAckWidth( void* pvContext, SIM_TIME u64Time )
+{
+  (void)u64Time;
+  gsCia.u64AckWidth = (SIM_TIME)(uintptr_t)pvContext;
+}
+
+/*! *******************************************************************
+ * \brief  Marks the received codes, that are in the expected order -- longest common subsequence
+ *********************************************************************/
+static void Match( void )
+{
+  static U16 au16Length[ FAULTS_CODES_MAX + 1u ][ FAULTS_CODES_MAX + 1u ];
+  U32 u32E, u32R;
+
+  for( u32E = gu32Expected + 1u; u32E-- > 0u; )
+  {
+    for( u32R = gu32Received + 1u; u32R-- > 0u; )
+    {
+      if( ( gu32Expected == u32E ) || ( gu32Received == u32R ) )
+      {
+        au16Length[ u32E ][ u32R ] = 0u;
+      }
+      else if( gasExpected[ u32E ].u8Raw == gasReceived[ u32R ].u8Raw )
+      {
+        au16Length[ u32E ][ u32R ] = au16Length[ u32E + 1u ][ u32R + 1u ] + 1u;
+      }
+      else
+      {
+        au16Length[ u32E ][ u32R ] = ( au16Length[ u32E + 1u ][ u32R ] > au16Length[ u32E ][ u32R + 1u ] ) ?
+                                     au16Length[ u32E + 1u ][ u32R ] : au16Length[ u32E ][ u32R + 1u ];
+      }
+    }
+  }
+
+  // walk forward on the suffix table
+  u32E = 0u;
+  u32R = 0u;
+  while( ( u32E < gu32Expected ) && ( u32R < gu32Received ) )
+  {
+    if( gasExpected[ u32E ].u8Raw == gasReceived[ u32R ].u8Raw )
+    {
+      gasExpected[ u32E ].bMatched = TRUE;
+      gasReceived[ u32R ].bMatched = TRUE;
+      gasReceived[ u32R ].u64Time -= ( gasReceived[ u32R ].u64Time > gasExpected[ u32E ].u64Time ) ? gasExpected[ u32E ].u64Time : gasReceived[ u32R ].u64Time;  // latency
+      gasReceived[ u32R ].u64Time = ( gasReceived[ u32R ].u64Time <= FAULTS_LATE_LIMIT ) ? 0u : gasReceived[ u32R ].u64Time;
+      gasReceived[ u32R ].u64Time += gasExpected[ u32E ].u64Time;
+      u32E++;
+      u32R++;
+    }
+    else if( au16Length[ u32E + 1u ][ u32R ] >= au16Length[ u32E ][ u32R + 1u ] )
+    {
+      u32E++;
+    }
+    else
+    {
+      u32R++;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Time from the fault to the first received code, from which on the stream is consistent
+ * \return ms, 0 if the stream was not disturbed, FAULTS_NEVER if it did not recover
+ * \note   Consistent: every later code is expected, in order, on time (FAULTS_LATE_LIMIT), and nothing is
+ *         missing between them. Call after Match(): matched codes on time hold their key edge as time.
+ *********************************************************************/
+static double GetRecoveryMs( void )
+{
+  U32    u32R = gu32Received;
+  U32    u32E = gu32Expected;
+  BOOL   bConsistent = ( 0u == gu32Overflow ) ? TRUE : FALSE;
+  double dRet = FAULTS_NEVER;
+
+  // received codes on time hold the time of the key edge exactly
+  while( ( TRUE == bConsistent ) && ( 0u != u32R ) )
+  {
+    if( TRUE == gasReceived[ u32R - 1u ].bMatched )
+    {
+      // the expected codes after this one must all be matched
+      while( ( u32E > 0u ) && ( gasExpected[ u32E - 1u ].u64Time > gasReceived[ u32R - 1u ].u64Time ) && ( TRUE == bConsistent ) )
+      {
+        bConsistent = gasExpected[ u32E - 1u ].bMatched;
+        u32E--;
+      }
+      if( ( u32E > 0u ) && ( gasExpected[ u32E - 1u ].u64Time == gasReceived[ u32R - 1u ].u64Time ) && ( TRUE == bConsistent ) )
+      {
+        u32E--;
+        u32R--;
+      }
+      else
+      {
+        bConsistent = FALSE;  // matched, but late
+      }
+    }
+    else
+    {
+      bConsistent = FALSE;
+    }
+  }
+
+  if( ( u32R < gu32Received ) && ( gu32Expected > 0u ) )
+  {
+    dRet = ( gasReceived[ u32R ].u64Time > FAULTS_START ) ? ( SIM_TO_US( gasReceived[ u32R ].u64Time - FAULTS_START ) / 1000.0 ) : 0.0;
+    dRet = ( 0u == u32R ) ? 0.0 : dRet;
+  }
+
+  return dRet;
+}
+
+/*! *******************************************************************
+ * \brief  One scenario from power-up -- runs in a child process, the firmware state is global
+ * \param  psScenario: the fault
+ * \param  psResult: shared with the parent
+ * \return -
+ *********************************************************************/
+static void Run( const S_FAULTS_SCENARIO* psScenario, S_FAULTS_RESULT* psResult )
+{
+  SIM_TIME u64Duration = ( FAULT_SHORT == psScenario->u8Fault ) ? SIM_MS( psScenario->u32Ms )
+                       : ( ( FAULT_MISS == psScenario->u8Fault ) || ( FAULT_GLITCH == psScenario->u8Fault ) ) ? 0u
+                       : SIM_MS( psScenario->u32Value );
+  S_SIM_CIA_CODE sCode;
+  U32 u32Index, u32Other;
+  U8  u8LastInOrder = FAULTS_RAW_SYNC;
+
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &gsCia );
+  Sim_RunUntil( FAULTS_BOOT_TIME );  // the keymap is loaded by now
+  while( TRUE == Sim_Cia_Read( &gsCia, &sCode ) )
+  {
+    // power-up key stream, not part of the measurement
+  }
+  gu32Resyncs = 0u;
+  gu32Retransmits = 0u;
+  psResult->u32AcksMissed = gsCia.sStats.u32AcksMissed;
+  gu64TypeEnd = FAULTS_START + u64Duration + FAULTS_TYPE_AFTER;
+  Sim_Event_Schedule( Sim_GetTime(), TypeKey, NULL );
+  Sim_Event_Schedule( Sim_GetTime(), ReadPort, NULL );
+  Sim_Event_Schedule( FAULTS_START, Inject, (void*)psScenario );
+  Sim_RunUntil( gu64TypeEnd + FAULTS_DRAIN_TIME );
+  ReadPort( NULL, Sim_GetTime() );
+
+  Match();
+  psResult->dRecoveryMs = GetRecoveryMs();
+  psResult->u32Resyncs = gu32Resyncs;
+  psResult->u32Retransmits = gu32Retransmits;
+  psResult->u32LostSync = gu32LostSync;
+  psResult->u32Codes = gu32Expected;
+  psResult->u32AcksMissed = gsCia.sStats.u32AcksMissed - psResult->u32AcksMissed;
+  psResult->u32Garbled = gu32Overflow;
+  for( u32Index = 0u; u32Index < gu32Received; u32Index++ )
+  {
+    if( TRUE == gasReceived[ u32Index ].bMatched )
+    {
+      u8LastInOrder = gasReceived[ u32Index ].u8Raw;
+    }
+    else if( u8LastInOrder == gasReceived[ u32Index ].u8Raw )
+    {
+      psResult->u32Duplicated++;
+    }
+    else
+    {
+      // out of order, if an expected code of this value is still missing
+      for( u32Other = 0u; ( u32Other < gu32Expected ) && ( FALSE == gasReceived[ u32Index ].bMatched ); u32Other++ )
+      {
+        if( ( FALSE == gasExpected[ u32Other ].bMatched ) && ( gasExpected[ u32Other ].u8Raw == gasReceived[ u32Index ].u8Raw ) )
+        {
+          gasExpected[ u32Other ].bMatched = TRUE;
+          gasReceived[ u32Index ].bMatched = TRUE;
+          psResult->u32Reordered++;
+        }
+      }
+      psResult->u32Garbled += ( FALSE == gasReceived[ u32Index ].bMatched ) ? 1u : 0u;
+    }
+  }
+  for( u32Index = 0u; u32Index < gu32Expected; u32Index++ )
+  {
+    psResult->u32Lost += ( FALSE == gasExpected[ u32Index ].bMatched ) ? 1u : 0u;
+  }
+  psResult->bDone = TRUE;
+}
+
+/*! *******************************************************************
+ * \brief  Parses the scenarios: "name fault value [duration_ms]" per line, # starts a comment
+ * \return TRUE, if every line is valid
+ *********************************************************************/
+static BOOL ParseScript( const char* pcScript )
+{
+  BOOL bRet = TRUE;
+  char acLine[ 128 ];
+  char acFault[ 16 ];
+  const char* pcEnd;
+  size_t uLength;
+  S_FAULTS_SCENARIO* psScenario;
+  int  iFields;
+  U8   u8Fault;
+
+  while( ( '\0' != *pcScript ) && ( TRUE == bRet ) )
+  {
+    pcEnd = strchr( pcScript, '\n' );
+    uLength = ( NULL != pcEnd ) ? (size_t)( pcEnd - pcScript ) : strlen( pcScript );
+    uLength = ( uLength < sizeof( acLine ) ) ? uLength : ( sizeof( acLine ) - 1u );
+    memcpy( acLine, pcScript, uLength );
+    acLine[ uLength ] = '\0';
+    pcScript += ( NULL != pcEnd ) ? ( (size_t)( pcEnd - pcScript ) + 1u ) : strlen( pcScript );
+
+    psScenario = &gasScenario[ gu32ScenarioCount ];
+    psScenario->u32Ms = 0u;
+    iFields = sscanf( acLine, "%23s %15s %u %u", psScenario->acName, acFault, &psScenario->u32Value, &psScenario->u32Ms );
+    if( ( 0 < iFields ) && ( '#' != psScenario->acName[ 0 ] ) )
+    {
+      psScenario->u8Fault = FAULT_COUNT;
+      for( u8Fault = 0u; u8Fault < FAULT_COUNT; u8Fault++ )
+      {
+        psScenario->u8Fault = ( ( 2 <= iFields ) && ( 0 == strcmp( acFault, gcapcFaultNames[ u8Fault ] ) ) ) ? u8Fault : psScenario->u8Fault;
+      }
+      if( ( 3 > iFields ) || ( FAULT_COUNT == psScenario->u8Fault ) || ( FAULTS_SCENARIO_MAX == ( gu32ScenarioCount + 1u ) )
+       || ( ( FAULT_SHORT == psScenario->u8Fault ) && ( 4 > iFields ) ) )
+      {
+        fprintf( stderr, "faults: bad line: %s\n", acLine );
+        bRet = FALSE;
+      }
+      else
+      {
+        gu32ScenarioCount++;
+      }
+    }
+  }
+
+  return bRet;
+}
+
+static char* ReadFile( const char* pcFile )
+{
+  FILE*  psFile = fopen( pcFile, "r" );
+  char*  pcRet = NULL;
+  long   lSize;
+
+  if( NULL != psFile )
+  {
+    fseek( psFile, 0, SEEK_END );
+    lSize = ftell( psFile );
+    fseek( psFile, 0, SEEK_SET );
+    pcRet = (char*)calloc( (size_t)lSize + 1u, 1u );
+    if( ( NULL != pcRet ) && ( (size_t)lSize != fread( pcRet, 1u, (size_t)lSize, psFile ) ) )
+    {
+      free( pcRet );
+      pcRet = NULL;
+    }
+    fclose( psFile );
+  }
+
+  return pcRet;
+}
+
+static BOOL IsSelected( const char* pcName, int argc, char* argv[], int iFirst )
+{
+  BOOL bRet = ( iFirst >= argc ) ? TRUE : FALSE;
+
+  for( ; iFirst < argc; iFirst++ )
+  {
+    bRet = ( 0 == strcmp( pcName, argv[ iFirst ] ) ) ? TRUE : bRet;
+  }
+
+  return bRet;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: faults [-f script] [-l] [scenario...]\n"
+                   "       script lines: name fault value [duration_ms]\n"
+                   "         miss    n       no handshake for the next n bytes\n"
+                   "         short   us ms   handshake of the given width for a while\n"
+                   "         glitch  bit     KDAT glitch at a bit of the next byte (0: first, 7: up/down)\n"
+                   "         reboot  ms      the computer resets in the middle of a byte\n"
+                   "         silence ms      the computer does not answer\n"
+                   "       -l lists the scenarios of the script\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Counts the resynchronizations and retransmissions (linked with --wrap)
+ *********************************************************************/
+void __wrap_Trace_Write( U8 u8Event, U8 u8Argument )
+{
+  gu32Resyncs += ( TRACE_EVENT_RESYNC == u8Event ) ? 1u : 0u;
+  gu32Retransmits += ( TRACE_EVENT_RETRANSMIT == u8Event ) ? 1u : 0u;
+  __real_Trace_Write( u8Event, u8Argument );
+}
+
+int main( int argc, char* argv[] )
+{
+  S_FAULTS_RESULT* psResults;
+  const S_FAULTS_RESULT* psResult;
+  char*  pcScript = NULL;
+  BOOL   bList = FALSE;
+  U32    u32Index;
+  pid_t  iChild;
+  int    iArg = 1;
+  int    iRet = EXIT_SUCCESS;
+  char   acRecovery[ 16 ];
+
+  while( ( iArg < argc ) && ( '-' == argv[ iArg ][ 0 ] ) )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-f" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcScript = ReadFile( argv[ ++iArg ] );
+      if( NULL == pcScript )
+      {
+        fprintf( stderr, "faults: %s: cannot read\n", argv[ iArg ] );
+        exit( EXIT_FAILURE );
+      }
+    }
+    else if( 0 == strcmp( argv[ iArg ], "-l" ) )
+    {
+      bList = TRUE;
+    }
+    else
+    {
+      Usage();
+    }
+    iArg++;
+  }
+  if( FALSE == ParseScript( ( NULL != pcScript ) ? pcScript : gcacDefaultScript ) )
+  {
+    exit( EXIT_FAILURE );
+  }
+  free( pcScript );
+
+  psResults = mmap( NULL, sizeof( S_FAULTS_RESULT ) * FAULTS_SCENARIO_MAX, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+  if( MAP_FAILED == psResults )
+  {
+    perror( "faults: mmap" );
+    exit( EXIT_FAILURE );
+  }
+
+  printf( "%-16s %-8s %7s  %12s %7s %11s %5s %6s %5s %9s %10s %7s %11s\n", "scenario", "fault", "value", "recovery", "resyncs",
+          "retransmits", "0xF9", "codes", "lost", "reordered", "duplicated", "garbled", "acks missed" );
+  for( u32Index = 0u; u32Index < gu32ScenarioCount; u32Index++ )
+  {
+    if( TRUE == IsSelected( gasScenario[ u32Index ].acName, argc, argv, iArg ) )
+    {
+      psResult = &psResults[ u32Index ];
+      if( FALSE == bList )
+      {
+        fflush( stdout );
+        iChild = fork();
+        if( 0 == iChild )
+        {
+          Run( &gasScenario[ u32Index ], &psResults[ u32Index ] );
+          _exit( EXIT_SUCCESS );
+        }
+        waitpid( iChild, NULL, 0 );
+      }
+      printf( "%-16s %-8s %7lu", gasScenario[ u32Index ].acName, gcapcFaultNames[ gasScenario[ u32Index ].u8Fault ],
+              (unsigned long)gasScenario[ u32Index ].u32Value );
+      if( TRUE == psResult->bDone )
+      {
+        snprintf( acRecovery, sizeof( acRecovery ), ( FAULTS_NEVER == psResult->dRecoveryMs ) ? "never" : "%.1f ms", psResult->dRecoveryMs );
+        printf( "  %12s %7lu %11lu %5lu %6lu %5lu %9lu %10lu %7lu %11lu", acRecovery, (unsigned long)psResult->u32Resyncs,
+                (unsigned long)psResult->u32Retransmits, (unsigned long)psResult->u32LostSync, (unsigned long)psResult->u32Codes,
+                (unsigned long)psResult->u32Lost, (unsigned long)psResult->u32Reordered, (unsigned long)psResult->u32Duplicated, (unsigned long)psResult->u32Garbled,
+                (unsigned long)psResult->u32AcksMissed );
+      }
+      else if( FALSE == bList )
+      {
+        printf( "  crashed" );
+        iRet = EXIT_FAILURE;
+      }
+      printf( "\n" );
+    }
+  }
+  munmap( psResults, sizeof( S_FAULTS_RESULT ) * FAULTS_SCENARIO_MAX );
+
+  return iRet;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,363 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file ghost.c
+*
+* \brief Host simulation -- ghost keys of a matrix without diodes: groups of three keys on the corners of a
+*        rectangle, four keys of a real rectangle, and three keys without one are pressed on the firmware built
+*        with the ghost key blocking. Ghost codes, held back and blocked presses, and the cycles of the test.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "keymap.h"
+#include "matrix.h"
+#include "latency.h"
+#include "sim.h"
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define GHOST_BOOT_TIME         SIM_S( 1 )     //!< Power-up and init key stream, before the first group
+#define GHOST_PERIOD            SIM_MS( 300 )  //!< Start of a group --> start of the next one
+#define GHOST_PRESS_SPREAD      SIM_MS( 30 )   //!< The keys of a group are pressed within this time ...
+#define GHOST_HOLD_TIME         SIM_MS( 100 )  //!< ... held at least this long ...
+#define GHOST_HOLD_JITTER       SIM_MS( 60 )   //!< ... plus up to this much
+#define GHOST_SCHEDULE_LEAD     SIM_MS( 10 )   //!< The edges of a group are scheduled this long before its start
+#define GHOST_READ_PERIOD       SIM_MS( 10 )   //!< The host program reads the port
+#define GHOST_PRESS_LATE        SIM_MS( 20 )   //!< Two scans and the transfer: a later press was held back
+#define GHOST_GROUPS            200u           //!< Default number of key groups
+#define GHOST_GROUP_MAX         4096u
+#define GHOST_KEYS              4u             //!< Max. keys of a group
+#define GHOST_CODE_MAX          ( GHOST_GROUP_MAX * GHOST_KEYS * 2u )
+
+// Rows and columns of the groups: no chord, function or Caps lock key -- a group must not select a layer, or reset
+#define GHOST_ROW_FIRST         1u
+#define GHOST_ROW_COUNT         4u
+#define GHOST_COL_COUNT         14u
+
+// Kinds of the groups
+#define GHOST_CORNERS           0u  //!< Three corners of a rectangle, the fourth one is closed by the others
+#define GHOST_RECTANGLE         1u  //!< All four corners: a real rectangle, ambiguous without diodes
+#define GHOST_SCATTERED         2u  //!< Three keys, two of them in the same row, no rectangle
+#define GHOST_KIND_COUNT        3u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Keys pressed together
+typedef struct
+{
+  SIM_TIME u64Start;
+  U8       u8Kind;
+  U8       u8Keys;                        //!< Number of keys pressed
+  U8       au8Row[ GHOST_KEYS ];
+  U8       au8Column[ GHOST_KEYS ];
+  SIM_TIME au64Press[ GHOST_KEYS ];
+  SIM_TIME au64Release[ GHOST_KEYS ];
+} S_GHOST_GROUP;
+
+//! \brief Outcome of the groups of a kind
+typedef struct
+{
+  U32    u32Groups;
+  U32    u32Keys;                 //!< Keys pressed
+  U32    u32Ghosts;               //!< Corners closed by the other keys, without being pressed
+  U32    u32False;                //!< Codes of keys, that were not pressed
+  U32    u32Sent;                 //!< Presses received
+  U32    u32Held;                 //!< Presses received later than GHOST_PRESS_LATE
+  U32    u32Blocked;              //!< Presses not received at all -- released before the rectangle was resolved
+  double dLatencySum;             //!< Press latency, ms
+  double dLatencyMax;
+} S_GHOST_RESULT;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+static const char* const gcapcKindNames[ GHOST_KIND_COUNT ] = { "3 corners", "rectangle", "scattered" };
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static S_GHOST_GROUP   gasGroups[ GHOST_GROUP_MAX ];
+static U32             gu32GroupCount;
+static U32             gu32Random = 1u;
+static S_SIM_CIA       gsCia;
+static S_SIM_CIA_CODE  gasReceived[ GHOST_CODE_MAX ];
+static U32             gu32ReceivedCount;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U32  Random( U32 u32Range );
+static void PlanGroup( S_GHOST_GROUP* psGroup, U8 u8Kind, SIM_TIME u64Start );
+static void ScheduleGroup( void* pvContext, SIM_TIME u64Time );
+static void ReadPort( void* pvContext, SIM_TIME u64Time );
+static void Evaluate( const S_GHOST_GROUP* psGroup, BOOL bDiodes, S_GHOST_RESULT* psResult );
+static void Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Random number in 0..u32Range-1
+ *********************************************************************/
+static U32 Random( U32 u32Range )
+{
+  gu32Random = gu32Random * 1103515245u + 12345u;
+  return ( 0u != u32Range ) ? ( ( gu32Random >> 8u ) % u32Range ) : 0u;
+}
+
+/*! *******************************************************************
+ * \brief  Picks the keys of a group, and the times of their edges
+ * \param  psGroup: the group
+ * \param  u8Kind: GHOST_CORNERS, GHOST_RECTANGLE or GHOST_SCATTERED
+ * \param  u64Start: the keys are pressed within GHOST_PRESS_SPREAD from this time
+ *********************************************************************/
+static void PlanGroup( S_GHOST_GROUP* psGroup, U8 u8Kind, SIM_TIME u64Start )
+{
+  U8 au8Row[ 2 ];
+  U8 au8Column[ 3 ];
+  U8 u8Index;
+
+  // two different rows, three different columns
+  au8Row[ 0 ] = (U8)Random( GHOST_ROW_COUNT );
+  au8Row[ 1 ] = (U8)( ( au8Row[ 0 ] + 1u + Random( GHOST_ROW_COUNT - 1u ) ) % GHOST_ROW_COUNT );
+  au8Column[ 0 ] = (U8)Random( GHOST_COL_COUNT );
+  au8Column[ 1 ] = (U8)( ( au8Column[ 0 ] + 1u + Random( GHOST_COL_COUNT - 1u ) ) % GHOST_COL_COUNT );
+  do
+  {
+    au8Column[ 2 ] = (U8)Random( GHOST_COL_COUNT );
+  } while( ( au8Column[ 2 ] == au8Column[ 0 ] ) || ( au8Column[ 2 ] == au8Column[ 1 ] ) );
+
+  // the first two keys share a row, the third one is below the first one, or elsewhere
+  memset( psGroup, 0x00u, sizeof( *psGroup ) );
+  psGroup->u64Start = u64Start;
+  psGroup->u8Kind = u8Kind;
+  psGroup->u8Keys = ( GHOST_RECTANGLE == u8Kind ) ? 4u : 3u;
+  psGroup->au8Row[ 0 ] = au8Row[ 0 ];    psGroup->au8Column[ 0 ] = au8Column[ 0 ];
+  psGroup->au8Row[ 1 ] = au8Row[ 0 ];    psGroup->au8Column[ 1 ] = au8Column[ 1 ];
+  psGroup->au8Row[ 2 ] = au8Row[ 1 ];    psGroup->au8Column[ 2 ] = ( GHOST_SCATTERED == u8Kind ) ? au8Column[ 2 ] : au8Column[ 0 ];
+  psGroup->au8Row[ 3 ] = au8Row[ 1 ];    psGroup->au8Column[ 3 ] = au8Column[ 1 ];  // the fourth corner
+  for( u8Index = 0u; u8Index < psGroup->u8Keys; u8Index++ )
+  {
+    psGroup->au8Row[ u8Index ] += GHOST_ROW_FIRST;
+    psGroup->au64Press[ u8Index ] = u64Start + Random( (U32)GHOST_PRESS_SPREAD );
+    psGroup->au64Release[ u8Index ] = psGroup->au64Press[ u8Index ] + GHOST_HOLD_TIME + Random( (U32)GHOST_HOLD_JITTER );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event: schedules the edges of a group, then the next group
+ * \param  pvContext: the group
+ * \note   One group at a time -- the event queue is short.
+ *********************************************************************/
+static void ScheduleGroup( void* pvContext, SIM_TIME u64Time )
+{
+  S_GHOST_GROUP* psGroup = (S_GHOST_GROUP*)pvContext;
+  U8 u8Index;
+
+  (void)u64Time;
+  for( u8Index = 0u; u8Index < psGroup->u8Keys; u8Index++ )
+  {
+    Sim_Keys_ScheduleEdge( psGroup->au64Press[ u8Index ], psGroup->au8Row[ u8Index ], psGroup->au8Column[ u8Index ], TRUE, 0u );
+    Sim_Keys_ScheduleEdge( psGroup->au64Release[ u8Index ], psGroup->au8Row[ u8Index ], psGroup->au8Column[ u8Index ], FALSE, 0u );
+  }
+  if( ( psGroup + 1 ) < &gasGroups[ gu32GroupCount ] )
+  {
+    Sim_Event_Schedule( psGroup[ 1 ].u64Start - GHOST_SCHEDULE_LEAD, ScheduleGroup, psGroup + 1 );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event: the host program reads the port
+ *********************************************************************/
+static void ReadPort( void* pvContext, SIM_TIME u64Time )
+{
+  S_SIM_CIA_CODE sCode;
+
+  (void)pvContext;
+  while( TRUE == Sim_Cia_Read( &gsCia, &sCode ) )
+  {
+    if( ( sCode.u64Time >= GHOST_BOOT_TIME ) && ( gu32ReceivedCount < GHOST_CODE_MAX ) )  // the init stream is not part of the test
+    {
+      gasReceived[ gu32ReceivedCount++ ] = sCode;
+    }
+  }
+  Sim_Event_Schedule( u64Time + GHOST_READ_PERIOD, ReadPort, NULL );
+}
+
+/*! *******************************************************************
+ * \brief  Compares the codes received during a group with its keys
+ * \param  psGroup: the group
+ * \param  bDiodes: the matrix has diodes -- no corner is closed by the others
+ * \param  psResult: the counters of the kind of the group
+ *********************************************************************/
+static void Evaluate( const S_GHOST_GROUP* psGroup, BOOL bDiodes, S_GHOST_RESULT* psResult )
+{
+  SIM_TIME u64Start = psGroup->u64Start;
+  SIM_TIME u64Press;
+  U32  u32Code;
+  U8   au8Codes[ GHOST_KEYS ];
+  U8   u8Index;
+  BOOL bOwn;
+  double dMs;
+
+  for( u8Index = 0u; u8Index < psGroup->u8Keys; u8Index++ )
+  {
+    au8Codes[ u8Index ] = Keymap_GetScanCode( psGroup->au8Row[ u8Index ], psGroup->au8Column[ u8Index ] );
+  }
+  psResult->u32Groups++;
+  psResult->u32Keys += psGroup->u8Keys;
+  psResult->u32Ghosts += ( ( GHOST_CORNERS == psGroup->u8Kind ) && ( FALSE == bDiodes ) ) ? 1u : 0u;
+
+  for( u8Index = 0u; u8Index < psGroup->u8Keys; u8Index++ )
+  {
+    u64Press = SIM_NEVER;
+    for( u32Code = 0u; u32Code < gu32ReceivedCount; u32Code++ )
+    {
+      if( ( gasReceived[ u32Code ].u64Time >= u64Start ) && ( gasReceived[ u32Code ].u64Time < ( u64Start + GHOST_PERIOD ) )
+       && ( au8Codes[ u8Index ] == gasReceived[ u32Code ].u8Code ) && ( FALSE == gasReceived[ u32Code ].bUp ) && ( SIM_NEVER == u64Press ) )
+      {
+        u64Press = gasReceived[ u32Code ].u64Time;
+      }
+    }
+    if( SIM_NEVER != u64Press )
+    {
+      dMs = SIM_TO_US( u64Press - psGroup->au64Press[ u8Index ] ) / 1000.0;
+      psResult->u32Sent++;
+      psResult->u32Held += ( ( u64Press - psGroup->au64Press[ u8Index ] ) > GHOST_PRESS_LATE ) ? 1u : 0u;
+      psResult->dLatencySum += dMs;
+      psResult->dLatencyMax = ( dMs > psResult->dLatencyMax ) ? dMs : psResult->dLatencyMax;
+    }
+    else
+    {
+      psResult->u32Blocked++;
+    }
+  }
+
+  // codes of other keys during the group: ghosts
+  for( u32Code = 0u; u32Code < gu32ReceivedCount; u32Code++ )
+  {
+    if( ( gasReceived[ u32Code ].u64Time >= u64Start ) && ( gasReceived[ u32Code ].u64Time < ( u64Start + GHOST_PERIOD ) ) )
+    {
+      bOwn = FALSE;
+      for( u8Index = 0u; u8Index < psGroup->u8Keys; u8Index++ )
+      {
+        bOwn = ( au8Codes[ u8Index ] == gasReceived[ u32Code ].u8Code ) ? TRUE : bOwn;
+      }
+      psResult->u32False += ( FALSE == bOwn ) ? 1u : 0u;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Prints the usage, and exits
+ *********************************************************************/
+static void Usage( void )
+{
+  fprintf( stderr, "usage: ghost [-n groups] [-s seed] [-d]\n"
+                   "  -n  number of key groups (default %u)\n"
+                   "  -s  seed of the groups\n"
+                   "  -d  matrix with diodes, like the full keyboard: the cost of the blocking alone\n", GHOST_GROUPS );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  static S_GHOST_RESULT asResults[ GHOST_KIND_COUNT ];
+  S_GHOST_RESULT* psResult;
+  U32  u32Groups = GHOST_GROUPS;
+  U32  u32Index;
+  U32  u32False = 0u;
+  BOOL bDiodes = FALSE;
+  int  iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-n" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Groups = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-s" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gu32Random = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( 0 == strcmp( argv[ iArg ], "-d" ) )
+    {
+      bDiodes = TRUE;
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  if( ( 0u == u32Groups ) || ( u32Groups > GHOST_GROUP_MAX ) )
+  {
+    Usage();
+  }
+
+  // every kind in turn
+  for( u32Index = 0u; u32Index < u32Groups; u32Index++ )
+  {
+    PlanGroup( &gasGroups[ u32Index ], (U8)( u32Index % GHOST_KIND_COUNT ), GHOST_BOOT_TIME + ( u32Index * GHOST_PERIOD ) );
+  }
+  gu32GroupCount = u32Groups;
+
+  Sim_Board_Reset();
+  Sim_Board_SetDiodes( bDiodes );
+  Sim_Cia_Connect( &gsCia );
+  Sim_Event_Schedule( GHOST_BOOT_TIME - GHOST_SCHEDULE_LEAD, ScheduleGroup, &gasGroups[ 0 ] );
+  Sim_Event_Schedule( GHOST_READ_PERIOD, ReadPort, NULL );
+
+  Sim_RunUntil( GHOST_BOOT_TIME + ( u32Groups * GHOST_PERIOD ) );
+
+  for( u32Index = 0u; u32Index < u32Groups; u32Index++ )
+  {
+    Evaluate( &gasGroups[ u32Index ], bDiodes, &asResults[ gasGroups[ u32Index ].u8Kind ] );
+  }
+
+  printf( "matrix:         %s, ghost key blocking compiled in\n", ( TRUE == bDiodes ) ? "with diodes" : "without diodes" );
+  printf( "groups:         %lu, %.1f s, keys in rows %u..%u, columns 0..%u\n\n", (unsigned long)u32Groups,
+          SIM_TO_US( u32Groups * GHOST_PERIOD ) / 1e6, GHOST_ROW_FIRST, GHOST_ROW_FIRST + GHOST_ROW_COUNT - 1u, GHOST_COL_COUNT - 1u );
+  printf( "%-10s %6s %5s %7s %6s %5s %5s %8s %20s\n", "kind", "groups", "keys", "ghosts", "false", "sent", "held", "blocked", "press mean/max ms" );
+  for( u32Index = 0u; u32Index < GHOST_KIND_COUNT; u32Index++ )
+  {
+    psResult = &asResults[ u32Index ];
+    printf( "%-10s %6lu %5lu %7lu %6lu %5lu %5lu %8lu %9.1f / %8.1f\n", gcapcKindNames[ u32Index ], (unsigned long)psResult->u32Groups,
+            (unsigned long)psResult->u32Keys, (unsigned long)psResult->u32Ghosts, (unsigned long)psResult->u32False,
+            (unsigned long)psResult->u32Sent, (unsigned long)psResult->u32Held, (unsigned long)psResult->u32Blocked,
+            psResult->dLatencySum / ( ( 0u != psResult->u32Sent ) ? psResult->u32Sent : 1u ), psResult->dLatencyMax );
+    u32False += psResult->u32False;
+  }
+  printf( "\nghost key test: %lu runs, %u cycles each (%u + %u turns x %u - %u on its own column, instruction count)\n",
+          (unsigned long)Sim_GetStats()->u32GhostTests, SIM_CYCLES_GHOST_CALL + ( MATRIX_COL * SIM_CYCLES_GHOST_COLUMN ) - SIM_CYCLES_GHOST_OWN,
+          SIM_CYCLES_GHOST_CALL, MATRIX_COL, SIM_CYCLES_GHOST_COLUMN, SIM_CYCLES_GHOST_OWN );
+  printf( "latency block:  %u TIM2 clocks at most, as the target reports it (the test and one read of the counter)\n",
+          gsLatencyBlock.u16GhostMaxClocks );
+
+  return ( 0u == u32False ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,375 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file heatmap.c
+*
+* \brief Host simulation -- prints the key statistics of the firmware as a heatmap of the matrix: the presses of
+*        the keys in the store, and the chatter, that points to the failing switches. The store is read from a dump
+*        of the data EEPROM, or from a simulated typing session with some worn switches.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "keystats.h"
+#include "eeprom_map.h"
+#include "layout.h"
+#include "matrix.h"
+#include "sim.h"
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define HEATMAP_BOOT_TIME     SIM_S( 1 )     //!< Power-up and init key stream, before the first key
+#define HEATMAP_KEY_PERIOD    SIM_MS( 150 )  //!< Start of a character --> start of the next one
+#define HEATMAP_SHIFT_LEAD    SIM_MS( 20 )   //!< Shift pressed before the key
+#define HEATMAP_HOLD_TIME     SIM_MS( 80 )   //!< Key pressed
+#define HEATMAP_SLICE         SIM_S( 1 )     //!< The session is scheduled one slice ahead, the event queue is short
+#define HEATMAP_CHATTER_START SIM_MS( 3 )    //!< A worn switch closes again 3 .. 23 ms after its release ...
+#define HEATMAP_CHATTER_SPAN  SIM_MS( 20 )
+#define HEATMAP_CHATTER_MAX   SIM_MS( 4 )    //!< ... for 1 .. 4 ms, shorter than a press
+#define HEATMAP_CHARS         3000u          //!< Default length of the session
+#define HEATMAP_STORE_SIZE    EEPROM_KEYSTATS_SIZE
+#define HEATMAP_SUSPECT       20u            //!< A switch is suspect, if it chatters at every 20th press or more
+#define HEATMAP_SHADES        " .:-=+*#%@"   //!< Shades of the heatmap, by the octave of the press counter
+
+static const char gcacText[] = "the keyboard statistics count every press of every key and every bounce of the "
+                               "switches, so a failing switch shows up before it types twice. ";
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief The store, decoded
+typedef struct
+{
+  U8   u8Entries;                                //!< Valid entries
+  BOOL abStored[ MATRIX_COL ][ MATRIX_ROW ];
+  U8   au8Presses[ MATRIX_COL ][ MATRIX_ROW ];
+  U8   au8Chatter[ MATRIX_COL ][ MATRIX_ROW ];
+} S_HEATMAP_STATS;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static U32  gau32Typed[ MATRIX_COL ][ MATRIX_ROW ];  //!< Simulation: presses of the session
+static BOOL gabWorn[ MATRIX_COL ][ MATRIX_ROW ];     //!< Simulation: switches closing again after the release
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U32  Estimate( U8 u8Counter );
+static void Decode( const U8* pu8Store, S_HEATMAP_STATS* psStats );
+static void PlanTyping( U32 u32Chars, U32* pu32Char, SIM_TIME* pu64Time, SIM_TIME u64End );
+static BOOL Print( const S_HEATMAP_STATS* psStats, BOOL bSimulated );
+static void Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Expected number of events of a logarithmic counter, see keystats.h
+ * \param  u8Counter: value of the counter
+ * \return Events
+ *********************************************************************/
+static U32 Estimate( U8 u8Counter )
+{
+  U32 u32Step = 1uL << ( u8Counter / KEYSTATS_LINEAR );
+
+  return ( KEYSTATS_LINEAR * ( u32Step - 1u ) ) + ( ( u8Counter % KEYSTATS_LINEAR ) * u32Step );
+}
+
+/*! *******************************************************************
+ * \brief  Loads the valid entries of the store, like KeyStats_Init()
+ * \param  pu8Store: image of the store, HEATMAP_STORE_SIZE bytes from EEPROM_KEYSTATS_ADDRESS
+ * \param  psStats: output
+ * \return -
+ *********************************************************************/
+static void Decode( const U8* pu8Store, S_HEATMAP_STATS* psStats )
+{
+  const U8* pu8Entry;
+  U32 u32Entry;
+  U8  u8Key;
+
+  memset( psStats, 0x00u, sizeof( *psStats ) );
+  for( u32Entry = 0u; u32Entry < KEYSTATS_ENTRIES; u32Entry++ )
+  {
+    pu8Entry = &pu8Store[ u32Entry * KEYSTATS_ENTRY_SIZE ];
+    u8Key = pu8Entry[ 0 ];
+    if( ( 0u != u8Key ) && ( u8Key <= ( MATRIX_COL * MATRIX_ROW ) )
+     && ( pu8Entry[ 1 ] == ( KEYSTATS_CHECK_SEED ^ u8Key ^ pu8Entry[ 2 ] ^ pu8Entry[ 3 ] ) ) )
+    {
+      u8Key--;
+      psStats->u8Entries++;
+      psStats->abStored[ u8Key / MATRIX_ROW ][ u8Key % MATRIX_ROW ]   = TRUE;
+      psStats->au8Presses[ u8Key / MATRIX_ROW ][ u8Key % MATRIX_ROW ] = pu8Entry[ 2 ];
+      psStats->au8Chatter[ u8Key / MATRIX_ROW ][ u8Key % MATRIX_ROW ] = pu8Entry[ 3 ];
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Schedules the edges of the characters starting before a time, the text is repeated
+ * \param  u32Chars: length of the session
+ * \param  pu32Char: next character of the session, updated
+ * \param  pu64Time: start of the next character, updated
+ * \param  u64End: no character starts at or after it
+ * \return -
+ * \note   A worn switch closes again shortly after its release, at random: it is a bounce for the firmware.
+ *********************************************************************/
+static void PlanTyping( U32 u32Chars, U32* pu32Char, SIM_TIME* pu64Time, SIM_TIME u64End )
+{
+  SIM_TIME u64Release;
+  SIM_TIME u64Chatter;
+  U8   u8ScanCode, u8Row, u8Column, u8ShiftRow, u8ShiftColumn;
+  BOOL bShift;
+
+  Sim_Keys_Find( SIM_SCANCODE_LSHIFT, &u8ShiftRow, &u8ShiftColumn );
+  while( ( *pu64Time < u64End ) && ( *pu32Char < u32Chars ) )
+  {
+    if( ( TRUE == Sim_Keys_FromChar( gcacText[ *pu32Char % ( sizeof( gcacText ) - 1u ) ], &u8ScanCode, &bShift ) )
+     && ( TRUE == Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column ) ) )
+    {
+      if( TRUE == bShift )
+      {
+        Sim_Keys_ScheduleEdge( *pu64Time, u8ShiftRow, u8ShiftColumn, TRUE, 0u );
+        Sim_Keys_ScheduleEdge( *pu64Time + HEATMAP_SHIFT_LEAD + HEATMAP_HOLD_TIME + HEATMAP_SHIFT_LEAD, u8ShiftRow, u8ShiftColumn, FALSE, 0u );
+        gau32Typed[ u8ShiftColumn ][ u8ShiftRow ]++;
+      }
+      u64Release = *pu64Time + HEATMAP_SHIFT_LEAD + HEATMAP_HOLD_TIME;
+      Sim_Keys_ScheduleEdge( *pu64Time + HEATMAP_SHIFT_LEAD, u8Row, u8Column, TRUE, 0u );
+      Sim_Keys_ScheduleEdge( u64Release, u8Row, u8Column, FALSE, 0u );
+      gau32Typed[ u8Column ][ u8Row ]++;
+      if( ( TRUE == gabWorn[ u8Column ][ u8Row ] ) && ( 0u != ( Sim_Keys_Random() & 1u ) ) )
+      {
+        u64Chatter = u64Release + HEATMAP_CHATTER_START + ( Sim_Keys_Random() % HEATMAP_CHATTER_SPAN );
+        Sim_Keys_ScheduleEdge( u64Chatter, u8Row, u8Column, TRUE, 0u );
+        Sim_Keys_ScheduleEdge( u64Chatter + SIM_MS( 1 ) + ( Sim_Keys_Random() % ( HEATMAP_CHATTER_MAX - SIM_MS( 1 ) ) ), u8Row, u8Column, FALSE, 0u );
+      }
+    }
+    *pu64Time += HEATMAP_KEY_PERIOD;
+    ( *pu32Char )++;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Prints the heatmap, and the keys pressed or chattering
+ * \param  psStats: the decoded store
+ * \param  bSimulated: TRUE, if the session of the simulation is known
+ * \return TRUE, if the suspect switches are the worn ones of the simulation (always TRUE without simulation)
+ *********************************************************************/
+static BOOL Print( const S_HEATMAP_STATS* psStats, BOOL bSimulated )
+{
+  U8   u8Row, u8Column;
+  U8   u8Presses, u8Chatter;
+  U32  u32Presses = 0u;
+  U32  u32Typed = 0u;
+  BOOL bSuspect;
+  BOOL bRet = TRUE;
+
+  printf( "store: %u of %u entries, profile %s\n\n", psStats->u8Entries, KEYSTATS_ENTRIES, LAYOUT_PROFILE_NAME );
+  printf( "presses    column 0..%u, shade by octave: '%c' none or not in the store .. '%c' about 10^6\n", MATRIX_COL - 1u,
+          HEATMAP_SHADES[ 0 ], HEATMAP_SHADES[ sizeof( HEATMAP_SHADES ) - 2u ] );
+  for( u8Row = 0u; u8Row < MATRIX_ROW; u8Row++ )
+  {
+    printf( "  ROW%u     |", u8Row );
+    for( u8Column = 0u; u8Column < MATRIX_COL; u8Column++ )
+    {
+      u8Presses = psStats->au8Presses[ u8Column ][ u8Row ];
+      printf( "%c", ( 0u == u8Presses ) ? HEATMAP_SHADES[ 0 ]
+                                         : HEATMAP_SHADES[ 1u + ( ( u8Presses / KEYSTATS_LINEAR ) * ( sizeof( HEATMAP_SHADES ) - 3u ) ) / ( KEYSTATS_SATURATED / KEYSTATS_LINEAR ) ] );
+    }
+    printf( "|\n" );
+  }
+
+  printf( "\n%-8s %4s %8s %8s %8s", "key", "code", "presses", "chatter", "per 100" );
+  if( TRUE == bSimulated )
+  {
+    printf( " %8s %8s", "typed", "bounce" );
+  }
+  printf( "\n" );
+  for( u8Column = 0u; u8Column < MATRIX_COL; u8Column++ )
+  {
+    for( u8Row = 0u; u8Row < MATRIX_ROW; u8Row++ )
+    {
+      u8Presses = psStats->au8Presses[ u8Column ][ u8Row ];
+      u8Chatter = psStats->au8Chatter[ u8Column ][ u8Row ];
+      u32Presses += Estimate( u8Presses );
+      u32Typed += gau32Typed[ u8Column ][ u8Row ];
+      if( TRUE == psStats->abStored[ u8Column ][ u8Row ] )
+      {
+        bSuspect = ( ( Estimate( u8Chatter ) * HEATMAP_SUSPECT ) >= Estimate( u8Presses ) ) && ( 0u != u8Chatter ) ? TRUE : FALSE;
+        printf( "R%u C%-4u 0x%02X %8lu %8lu %8.1f", u8Row, u8Column, gcau8ScanCodeTable[ u8Row ][ u8Column ],
+                (unsigned long)Estimate( u8Presses ), (unsigned long)Estimate( u8Chatter ),
+                ( 0u != u8Presses ) ? ( 100.0 * Estimate( u8Chatter ) / Estimate( u8Presses ) ) : 0.0 );
+        if( TRUE == bSimulated )
+        {
+          printf( " %8lu %8u", (unsigned long)gau32Typed[ u8Column ][ u8Row ], Matrix_GetBounce( u8Row, u8Column ) );
+          bRet = ( bSuspect != gabWorn[ u8Column ][ u8Row ] ) ? FALSE : bRet;
+        }
+        printf( "%s\n", ( TRUE == bSuspect ) ? "  suspect" : "" );
+      }
+    }
+  }
+  printf( "\npresses in the store: %lu", (unsigned long)u32Presses );
+  if( TRUE == bSimulated )
+  {
+    printf( " (typed %lu, all the keys)", (unsigned long)u32Typed );
+  }
+  printf( "\n" );
+
+  return bRet;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: heatmap [-r dump.bin] [-n chars] [-c worn] [-s seed] [-o dump.bin]\n"
+                   "  -r  prints a dump of the store (%u bytes of the data EEPROM at 0x%04X), no simulation\n"
+                   "  -n  length of the simulated typing session (default %u characters)\n"
+                   "  -c  characters of the worn switches (default \"ey\")\n"
+                   "  -s  seed of the chatter\n"
+                   "  -o  writes the store of the simulation, in the format of -r\n",
+           HEATMAP_STORE_SIZE, (unsigned)EEPROM_KEYSTATS_ADDRESS, HEATMAP_CHARS );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  static S_SIM_CIA       sCia;
+  static S_HEATMAP_STATS sStats;
+  static U8              au8Store[ HEATMAP_STORE_SIZE ];
+  const char* pcDump = NULL;
+  const char* pcOutput = NULL;
+  const char* pcWorn = "ey";
+  FILE*    psFile;
+  U32      u32Chars = HEATMAP_CHARS;
+  U32      u32Seed = 1u;
+  U32      u32Char = 0u;
+  SIM_TIME u64Next = HEATMAP_BOOT_TIME;
+  SIM_TIME u64Slice;
+  U32      u32Index;
+  U32      u32Wear = 0u;
+  U32      u32Flushes;
+  U8       u8ScanCode, u8Row, u8Column;
+  BOOL     bShift;
+  BOOL     bOk;
+  int      iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-r" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcDump = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-n" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Chars = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-c" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcWorn = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-s" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Seed = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-o" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcOutput = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+
+  if( NULL != pcDump )
+  {
+    psFile = fopen( pcDump, "rb" );
+    if( ( NULL == psFile ) || ( sizeof( au8Store ) != fread( au8Store, 1u, sizeof( au8Store ), psFile ) ) )
+    {
+      fprintf( stderr, "heatmap: cannot read %u bytes from %s\n", HEATMAP_STORE_SIZE, pcDump );
+      exit( EXIT_FAILURE );
+    }
+    fclose( psFile );
+    Decode( au8Store, &sStats );
+    bOk = ( 0u != sStats.u8Entries ) ? Print( &sStats, FALSE ) : FALSE;
+  }
+  else
+  {
+    Sim_Board_Reset();
+    Sim_Cia_Connect( &sCia );
+    Sim_Keys_Seed( u32Seed );
+    Sim_RunUntil( HEATMAP_BOOT_TIME );  // the keys are found in the keymap of the firmware
+    for( ; '\0' != *pcWorn; pcWorn++ )
+    {
+      if( ( TRUE == Sim_Keys_FromChar( *pcWorn, &u8ScanCode, &bShift ) ) && ( TRUE == Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column ) ) )
+      {
+        gabWorn[ u8Column ][ u8Row ] = TRUE;
+      }
+    }
+
+    // the session, then idle until the last changes are written
+    while( u32Char < u32Chars )
+    {
+      u64Slice = Sim_GetTime() + HEATMAP_SLICE;
+      PlanTyping( u32Chars, &u32Char, &u64Next, u64Slice );
+      Sim_RunUntil( u64Slice );
+    }
+    Sim_RunUntil( u64Next + SIM_S( 60u * KEYSTATS_FLUSH_MINUTES ) + SIM_S( 2 ) );
+
+    memcpy( au8Store, &gsSimMemory.au8Eeprom[ EEPROM_KEYSTATS_ADDRESS - SIM_EEPROM_ADDRESS ], sizeof( au8Store ) );
+    if( NULL != pcOutput )
+    {
+      psFile = fopen( pcOutput, "wb" );
+      if( ( NULL == psFile ) || ( sizeof( au8Store ) != fwrite( au8Store, 1u, sizeof( au8Store ), psFile ) ) )
+      {
+        fprintf( stderr, "heatmap: cannot write %s\n", pcOutput );
+        exit( EXIT_FAILURE );
+      }
+      fclose( psFile );
+    }
+    Decode( au8Store, &sStats );
+    bOk = ( 0u != sStats.u8Entries ) ? Print( &sStats, TRUE ) : FALSE;
+    printf( "%s\n", ( TRUE == bOk ) ? "suspect switches are the worn ones -- ok" : "suspect switches differ from the worn ones -- FAIL" );
+
+    // an entry is programmed at most once per KEYSTATS_FLUSH_MINUTES
+    for( u32Index = 0u; u32Index < HEATMAP_STORE_SIZE; u32Index++ )
+    {
+      u32Wear = ( gsSimMemory.au32EepromWrites[ ( EEPROM_KEYSTATS_ADDRESS - SIM_EEPROM_ADDRESS ) + u32Index ] > u32Wear )
+              ? gsSimMemory.au32EepromWrites[ ( EEPROM_KEYSTATS_ADDRESS - SIM_EEPROM_ADDRESS ) + u32Index ] : u32Wear;
+    }
+    u32Flushes = (U32)( Sim_GetTime() / SIM_S( 60u * KEYSTATS_FLUSH_MINUTES ) ) + 1u;
+    printf( "store wear:     %lu program cycles of the most written byte in %lu periods of %u minutes -- %s\n",
+            (unsigned long)u32Wear, (unsigned long)u32Flushes, KEYSTATS_FLUSH_MINUTES,
+            ( u32Wear <= u32Flushes ) ? "ok" : "FAIL, an entry is programmed more than once per period" );
+    bOk = ( u32Wear <= u32Flushes ) ? bOk : FALSE;
+  }
+
+  if( 0u == sStats.u8Entries )
+  {
+    printf( "no valid entry in the store\n" );
+  }
+
+  return ( TRUE == bOk ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
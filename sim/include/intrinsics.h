@@ -0,0 +1,44 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file intrinsics.h
+*
+* \brief Host replacement of the IAR STM8 intrinsics -- routed to the simulated CPU
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef INTRINSICS_H_INCLUDED
+#define INTRINSICS_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+typedef unsigned char __istate_t;  //!< Saved interrupt mask
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Sim_EnableInterrupts( void );
+void Sim_DisableInterrupts( void );
+void Sim_WaitForInterrupt( void );
+void Sim_Halt( void );
+__istate_t Sim_GetInterruptState( void );
+void Sim_SetInterruptState( __istate_t sState );
+
+#define __enable_interrupt()      Sim_EnableInterrupts()
+#define __disable_interrupt()     Sim_DisableInterrupts()
+#define __no_operation()          ((void)0)
+#define __trap()                  ((void)0)
+#define __wait_for_interrupt()    Sim_WaitForInterrupt()
+#define __halt()                  Sim_Halt()
+#define __get_interrupt_state()   Sim_GetInterruptState()
+#define __set_interrupt_state( S ) Sim_SetInterruptState( S )
+
+
+#endif // INTRINSICS_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,614 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file interleave.c
+*
+* \brief Host simulation -- systematic interleaving of the TIM2 interrupt routine with the main cycle on the
+*        event bitmaps of the matrix: Matrix_Sample() is run at every preemption point of Matrix_Cycle(); and with the
+*        copy of the snapshot: the scan is published at every preemption point of Matrix_GetSnapshot()
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm8s.h"
+#include "types.h"
+#include "amiga_key.h"
+#include "chord.h"
+#include "keymap.h"
+#include "latency.h"
+#include "trace.h"
+#include "matrix.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define INTERLEAVE_KEY_COUNT    ( MATRIX_ROW * MATRIX_COL )
+#define INTERLEAVE_SCAN         ( 2u * MATRIX_COL )   //!< Samples, after which every key is debounced
+#define INTERLEAVE_CLASS_MAX    64u                   //!< Distinct kinds of failing schedules reported
+#define INTERLEAVE_NO_POINT     0xFFFFFFFFuL
+
+// The kinds of an event
+#define INTERLEAVE_PRESS        0u
+#define INTERLEAVE_RELEASE      1u
+
+#define INTERLEAVE_ROW( KEY )   ( (U8)( (KEY) % MATRIX_ROW ) )
+#define INTERLEAVE_COL( KEY )   ( (U8)( (KEY) / MATRIX_ROW ) )
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A pin of the matrix, as initialized by Matrix_Init()
+typedef struct
+{
+  GPIO_TypeDef*    psPort;
+  GPIO_Pin_TypeDef ePin;
+} S_INTERLEAVE_PIN;
+
+//! \brief One schedule: an event of key A waits for the main cycle, the IT routine detects an event of key B
+typedef struct
+{
+  U8   u8KeyA;
+  U8   u8KindA;
+  U8   u8KeyB;
+  U8   u8KindB;
+  U32  u32Point;      //!< Preemption point, where the IT routine runs (0: before the main cycle)
+} S_INTERLEAVE_SCHEDULE;
+
+//! \brief Outcome of a schedule
+typedef struct
+{
+  BOOL        bPreempted;   //!< FALSE: the main cycle has less points, than the one of the schedule
+  const char* pcPoint;      //!< Name of the preemption point
+  U32         u32Lost;      //!< Events of A or B not registered
+  U32         u32Extra;     //!< Events registered twice, or of keys, that did not change
+} S_INTERLEAVE_RESULT;
+
+//! \brief Outcome of a copy of the snapshot, preempted by the publication of a scan
+typedef struct
+{
+  BOOL              bPreempted;   //!< FALSE: the copy has less points, than the one of the schedule
+  const char*       pcPoint;      //!< Name of the preemption point
+  S_MATRIX_SNAPSHOT sBefore;      //!< The scan published before the copy
+  S_MATRIX_SNAPSHOT sCopy;        //!< Returned by the preempted copy
+  S_MATRIX_SNAPSHOT sAfter;       //!< The scan published by the IT routine
+  BOOL              bConsistent;  //!< The copy is one of the two scans, state and sequence number together
+} S_INTERLEAVE_SNAPSHOT;
+
+//! \brief Failing schedules of the same kind
+typedef struct
+{
+  U8                    u8KindA;
+  U8                    u8KindB;
+  BOOL                  bSameColumn;
+  const char*           pcPoint;
+  U32                   u32Count;
+  S_INTERLEAVE_SCHEDULE sExample;
+  S_INTERLEAVE_RESULT   sExampleResult;
+} S_INTERLEAVE_CLASS;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+static const char* const gcapcKindNames[ 2 ] = { "press", "release" };
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static S_INTERLEAVE_PIN   gasRows[ MATRIX_ROW ];
+static S_INTERLEAVE_PIN   gasColumns[ MATRIX_COL ];
+static U8                 gu8RowsInit;
+static U8                 gu8ColumnsInit;
+static U16                gu16ColumnsLow;                           //!< Columns driven low by the firmware
+static U16                gau16Keys[ MATRIX_ROW ];                  //!< Pressed keys, bit n belongs to COLn
+static U32                gu32Samples;                              //!< Calls of Matrix_Sample(), it has its own static column counter
+static U8                 gau8Events[ INTERLEAVE_KEY_COUNT ][ 2 ];  //!< Registered events per key and kind
+static U32                gu32Point;                                //!< Preemption points passed in the running main cycle
+static U32                gu32PreemptAt;
+static const char*        gpcPreemptedAt;
+static BOOL               gbInterruptsMasked;                       //!< The main cycle disabled the interrupts
+static BOOL               gbInterruptPending;                       //!< The IT routine waits for the main cycle to enable them
+static S_INTERLEAVE_CLASS gasClasses[ INTERLEAVE_CLASS_MAX ];
+static U32                gu32ClassCount;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void Sample( U32 u32Count );
+static void AdvanceTo( U8 u8Column );
+static void SetKey( U8 u8Key, BOOL bPressed );
+static void DriveColumns( GPIO_TypeDef* GPIOx, U8 u8PortVal );
+static void Run( const S_INTERLEAVE_SCHEDULE* psSchedule, S_INTERLEAVE_RESULT* psResult );
+static void Record( const S_INTERLEAVE_SCHEDULE* psSchedule, const S_INTERLEAVE_RESULT* psResult );
+static void PrintSchedule( const S_INTERLEAVE_SCHEDULE* psSchedule, const S_INTERLEAVE_RESULT* psResult );
+static BOOL IsSameSnapshot( const S_MATRIX_SNAPSHOT* psA, const S_MATRIX_SNAPSHOT* psB );
+static void RunSnapshot( U32 u32Point, S_INTERLEAVE_SNAPSHOT* psResult );
+static void Usage( void );
+void        Interleave_PreemptionPoint( const char* pcName );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Runs the IT routine of the matrix
+ * \param  u32Count: number of calls, one column each
+ * \return -
+ *********************************************************************/
+static void Sample( U32 u32Count )
+{
+  for( ; 0u != u32Count; u32Count-- )
+  {
+    Matrix_Sample();
+    gu32Samples++;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Runs the IT routine, until the given column is the next one to be sampled
+ *********************************************************************/
+static void AdvanceTo( U8 u8Column )
+{
+  Sample( ( u8Column + MATRIX_COL - ( gu32Samples % MATRIX_COL ) ) % MATRIX_COL );
+}
+
+static void SetKey( U8 u8Key, BOOL bPressed )
+{
+  if( TRUE == bPressed )
+  {
+    gau16Keys[ INTERLEAVE_ROW( u8Key ) ] |= (U16)( 1u << INTERLEAVE_COL( u8Key ) );
+  }
+  else
+  {
+    gau16Keys[ INTERLEAVE_ROW( u8Key ) ] &= (U16)~( 1u << INTERLEAVE_COL( u8Key ) );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Output of the column pins of a port
+ * \note   SetColumn() writes every port of the columns once, the other pins of the ports are not modelled.
+ *********************************************************************/
+static void DriveColumns( GPIO_TypeDef* GPIOx, U8 u8PortVal )
+{
+  U8 u8Column;
+
+  for( u8Column = 0u; u8Column < gu8ColumnsInit; u8Column++ )
+  {
+    if( gasColumns[ u8Column ].psPort == GPIOx )
+    {
+      gu16ColumnsLow = ( 0u == ( u8PortVal & (U8)gasColumns[ u8Column ].ePin ) ) ? ( gu16ColumnsLow | (U16)( 1u << u8Column ) )
+                                                                                   : ( gu16ColumnsLow & (U16)~( 1u << u8Column ) );
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Runs one schedule from a clean matrix
+ * \param  psSchedule: the schedule
+ * \param  psResult: the outcome will be put here
+ * \return -
+ * \note   A press is detected by the second sample of the pressed key (the samples are ORed, 0 means pressed). For
+ *         a press of B, the first one is taken before the main cycle, so the IT routine at the preemption point
+ *         detects the event.
+ *********************************************************************/
+static void Run( const S_INTERLEAVE_SCHEDULE* psSchedule, S_INTERLEAVE_RESULT* psResult )
+{
+  U8 u8Key;
+
+  // clean matrix, the events of the keys pressed beforehand are registered
+  memset( gau16Keys, 0x00u, sizeof( gau16Keys ) );
+  gu32PreemptAt = INTERLEAVE_NO_POINT;
+  Matrix_Init();
+  Sample( INTERLEAVE_SCAN );
+  SetKey( psSchedule->u8KeyA, ( INTERLEAVE_RELEASE == psSchedule->u8KindA ) ? TRUE : FALSE );
+  SetKey( psSchedule->u8KeyB, ( INTERLEAVE_RELEASE == psSchedule->u8KindB ) ? TRUE : FALSE );
+  Sample( INTERLEAVE_SCAN );
+  Matrix_Cycle();
+
+  // the event of A waits for the main cycle
+  SetKey( psSchedule->u8KeyA, ( INTERLEAVE_PRESS == psSchedule->u8KindA ) ? TRUE : FALSE );
+  Sample( INTERLEAVE_SCAN );
+
+  // the event of B is detected by the next sample of its column
+  SetKey( psSchedule->u8KeyB, ( INTERLEAVE_PRESS == psSchedule->u8KindB ) ? TRUE : FALSE );
+  AdvanceTo( INTERLEAVE_COL( psSchedule->u8KeyB ) );
+  if( INTERLEAVE_PRESS == psSchedule->u8KindB )
+  {
+    Sample( MATRIX_COL );
+  }
+
+  // the main cycle, preempted at the point of the schedule
+  memset( gau8Events, 0x00u, sizeof( gau8Events ) );
+  gu32Point = 0u;
+  gpcPreemptedAt = "before the main cycle";
+  if( 0u == psSchedule->u32Point )
+  {
+    Sample( 1u );
+  }
+  else
+  {
+    gu32PreemptAt = psSchedule->u32Point;
+    gpcPreemptedAt = NULL;
+  }
+  Matrix_Cycle();
+  gu32PreemptAt = INTERLEAVE_NO_POINT;
+  psResult->bPreempted = ( NULL != gpcPreemptedAt ) ? TRUE : FALSE;
+  psResult->pcPoint = gpcPreemptedAt;
+
+  // everything, that is left, is registered
+  Matrix_Cycle();
+  Sample( INTERLEAVE_SCAN );
+  Matrix_Cycle();
+
+  psResult->u32Lost = 0u;
+  psResult->u32Extra = 0u;
+  for( u8Key = 0u; u8Key < INTERLEAVE_KEY_COUNT; u8Key++ )
+  {
+    gau8Events[ u8Key ][ psSchedule->u8KindA ] -= ( psSchedule->u8KeyA == u8Key ) ? 1u : 0u;  // the expected ones
+    gau8Events[ u8Key ][ psSchedule->u8KindB ] -= ( psSchedule->u8KeyB == u8Key ) ? 1u : 0u;
+    psResult->u32Lost += ( 0xFFu == gau8Events[ u8Key ][ INTERLEAVE_PRESS ] ) ? 1u : 0u;
+    psResult->u32Lost += ( 0xFFu == gau8Events[ u8Key ][ INTERLEAVE_RELEASE ] ) ? 1u : 0u;
+    psResult->u32Extra += ( ( 0xFFu != gau8Events[ u8Key ][ INTERLEAVE_PRESS ] ) ? gau8Events[ u8Key ][ INTERLEAVE_PRESS ] : 0u );
+    psResult->u32Extra += ( ( 0xFFu != gau8Events[ u8Key ][ INTERLEAVE_RELEASE ] ) ? gau8Events[ u8Key ][ INTERLEAVE_RELEASE ] : 0u );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Counts a failing schedule in its class (kinds, relation of the keys, preemption point)
+ *********************************************************************/
+static void Record( const S_INTERLEAVE_SCHEDULE* psSchedule, const S_INTERLEAVE_RESULT* psResult )
+{
+  BOOL bSameColumn = ( INTERLEAVE_COL( psSchedule->u8KeyA ) == INTERLEAVE_COL( psSchedule->u8KeyB ) ) ? TRUE : FALSE;
+  S_INTERLEAVE_CLASS* psClass = NULL;
+  U32 u32Index;
+
+  for( u32Index = 0u; u32Index < gu32ClassCount; u32Index++ )
+  {
+    if( ( gasClasses[ u32Index ].u8KindA == psSchedule->u8KindA ) && ( gasClasses[ u32Index ].u8KindB == psSchedule->u8KindB )
+     && ( gasClasses[ u32Index ].bSameColumn == bSameColumn ) && ( 0 == strcmp( gasClasses[ u32Index ].pcPoint, psResult->pcPoint ) ) )
+    {
+      psClass = &gasClasses[ u32Index ];
+    }
+  }
+  if( ( NULL == psClass ) && ( gu32ClassCount < INTERLEAVE_CLASS_MAX ) )
+  {
+    psClass = &gasClasses[ gu32ClassCount++ ];
+    psClass->u8KindA = psSchedule->u8KindA;
+    psClass->u8KindB = psSchedule->u8KindB;
+    psClass->bSameColumn = bSameColumn;
+    psClass->pcPoint = psResult->pcPoint;
+    psClass->u32Count = 0u;
+    psClass->sExample = *psSchedule;
+    psClass->sExampleResult = *psResult;
+  }
+  if( NULL != psClass )
+  {
+    psClass->u32Count++;
+  }
+}
+
+static void PrintSchedule( const S_INTERLEAVE_SCHEDULE* psSchedule, const S_INTERLEAVE_RESULT* psResult )
+{
+  printf( "  %s of r%uc%u waits, the IT routine detects a %s of r%uc%u at point %lu (%s): %lu lost, %lu extra\n",
+          gcapcKindNames[ psSchedule->u8KindA ], INTERLEAVE_ROW( psSchedule->u8KeyA ), INTERLEAVE_COL( psSchedule->u8KeyA ),
+          gcapcKindNames[ psSchedule->u8KindB ], INTERLEAVE_ROW( psSchedule->u8KeyB ), INTERLEAVE_COL( psSchedule->u8KeyB ),
+          (unsigned long)psSchedule->u32Point, psResult->pcPoint, (unsigned long)psResult->u32Lost, (unsigned long)psResult->u32Extra );
+}
+
+static BOOL IsSameSnapshot( const S_MATRIX_SNAPSHOT* psA, const S_MATRIX_SNAPSHOT* psB )
+{
+  return ( ( psA->u16ScanCount == psB->u16ScanCount ) && ( 0 == memcmp( psA->uState.au8Column, psB->uState.au8Column, MATRIX_COL ) ) ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Copies the snapshot, while the IT routine publishes a scan that changed every column
+ * \param  u32Point: preemption point of Matrix_GetSnapshot(), where the last column of the scan is sampled
+ * \param  psResult: the outcome will be put here
+ * \return -
+ * \note   A key of every column is pressed at the start of a scan: the second scan detects them column by column, and
+ *         publishes them at its last column -- so a copy mixing the two scans differs in its state or its number.
+ *********************************************************************/
+static void RunSnapshot( U32 u32Point, S_INTERLEAVE_SNAPSHOT* psResult )
+{
+  U8 u8Column;
+
+  memset( gau16Keys, 0x00u, sizeof( gau16Keys ) );
+  gu32PreemptAt = INTERLEAVE_NO_POINT;
+  Matrix_Init();
+  Sample( INTERLEAVE_SCAN );
+  AdvanceTo( 0u );
+  for( u8Column = 0u; u8Column < MATRIX_COL; u8Column++ )
+  {
+    SetKey( (U8)( u8Column * MATRIX_ROW ), TRUE );
+  }
+  Sample( MATRIX_COL + MATRIX_COL - 1u );  // the first scan, and the second one without its last column
+  Matrix_GetSnapshot( &psResult->sBefore );
+
+  gu32Point = 0u;
+  gu32PreemptAt = u32Point;
+  gpcPreemptedAt = NULL;
+  Matrix_GetSnapshot( &psResult->sCopy );
+  gu32PreemptAt = INTERLEAVE_NO_POINT;
+  psResult->bPreempted = ( NULL != gpcPreemptedAt ) ? TRUE : FALSE;
+  psResult->pcPoint = gpcPreemptedAt;
+  Matrix_GetSnapshot( &psResult->sAfter );
+
+  psResult->bConsistent = ( ( TRUE == IsSameSnapshot( &psResult->sCopy, &psResult->sBefore ) )
+                         || ( TRUE == IsSameSnapshot( &psResult->sCopy, &psResult->sAfter ) ) ) ? TRUE : FALSE;
+  if( TRUE == psResult->bPreempted )  // the test is pointless, if the publication did not change the snapshot
+  {
+    psResult->bConsistent = ( ( TRUE == psResult->bConsistent ) && ( FALSE == IsSameSnapshot( &psResult->sBefore, &psResult->sAfter ) ) ) ? TRUE : FALSE;
+  }
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: interleave [-a] [-v] [-s]\n"
+                   "       -a  every pair of keys (default: keys of the same and of the next column)\n"
+                   "       -v  prints every failing schedule\n"
+                   "       -s  only the copies of the snapshot\n"
+                   "       exits with 1, if any schedule loses or duplicates an event, with 2, if any copy of the snapshot is torn\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Preemption point of Matrix_Cycle() -- MATRIX_PREEMPTION_POINT() of this build
+ * \param  pcName: the place in the main cycle
+ * \return -
+ * \note   At a point, where the main cycle disabled the interrupts, the IT routine runs when they are enabled again.
+ *********************************************************************/
+void Interleave_PreemptionPoint( const char* pcName )
+{
+  gu32Point++;
+  if( gu32Point == gu32PreemptAt )
+  {
+    gpcPreemptedAt = pcName;
+    if( TRUE == gbInterruptsMasked )
+    {
+      gbInterruptPending = TRUE;
+    }
+    else
+    {
+      Sample( 1u );
+    }
+  }
+}
+
+// Interrupt mask of the main cycle, a pending IT routine runs when it is enabled
+void Sim_DisableInterrupts( void )
+{
+  gbInterruptsMasked = TRUE;
+}
+
+void Sim_EnableInterrupts( void )
+{
+  gbInterruptsMasked = FALSE;
+  if( TRUE == gbInterruptPending )
+  {
+    gbInterruptPending = FALSE;
+    Sample( 1u );
+  }
+}
+
+__istate_t Sim_GetInterruptState( void )
+{
+  return ( FALSE == gbInterruptsMasked ) ? 1u : 0u;
+}
+
+void Sim_SetInterruptState( __istate_t sState )
+{
+  if( 0u != sState )
+  {
+    Sim_EnableInterrupts();
+  }
+  else
+  {
+    Sim_DisableInterrupts();
+  }
+}
+
+// Pins of the matrix, the rows and the columns are initialized in their order by Matrix_Init()
+void GPIO_Init( GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef GPIO_Pin, GPIO_Mode_TypeDef GPIO_Mode )
+{
+  if( ( GPIO_MODE_IN_FL_NO_IT == GPIO_Mode ) && ( gu8RowsInit < MATRIX_ROW ) )
+  {
+    gasRows[ gu8RowsInit ].psPort = GPIOx;
+    gasRows[ gu8RowsInit++ ].ePin = GPIO_Pin;
+  }
+  else if( gu8ColumnsInit < MATRIX_COL )
+  {
+    gasColumns[ gu8ColumnsInit ].psPort = GPIOx;
+    gasColumns[ gu8ColumnsInit++ ].ePin = GPIO_Pin;
+    gu16ColumnsLow |= (U16)( 1u << ( gu8ColumnsInit - 1u ) );
+  }
+}
+
+void GPIO_Write( GPIO_TypeDef* GPIOx, uint8_t PortVal )
+{
+  DriveColumns( GPIOx, PortVal );
+}
+
+//! \brief Only the column pins of the port are high, the ones not driven low
+uint8_t GPIO_ReadOutputData( GPIO_TypeDef* GPIOx )
+{
+  U8 u8Ret = 0u;
+  U8 u8Column;
+
+  for( u8Column = 0u; u8Column < gu8ColumnsInit; u8Column++ )
+  {
+    u8Ret |= ( ( gasColumns[ u8Column ].psPort == GPIOx ) && ( 0u == ( gu16ColumnsLow & (U16)( 1u << u8Column ) ) ) ) ? (U8)gasColumns[ u8Column ].ePin : 0u;
+  }
+
+  return u8Ret;
+}
+
+//! \brief A row is low, if a pressed key connects it to a column driven low, the other pins are high
+U8 GPIO_ReadInputData( GPIO_TypeDef* GPIOx )
+{
+  U8 u8Ret = 0xFFu;
+  U8 u8Row;
+
+  for( u8Row = 0u; u8Row < gu8RowsInit; u8Row++ )
+  {
+    if( ( gasRows[ u8Row ].psPort == GPIOx ) && ( 0u != ( gau16Keys[ u8Row ] & gu16ColumnsLow ) ) )
+    {
+      u8Ret &= (U8)~(U8)gasRows[ u8Row ].ePin;
+    }
+  }
+
+  return u8Ret;
+}
+
+//! \brief Every position of the matrix gets its own code
+U8 Keymap_GetScanCode( U8 u8Row, U8 u8Column )
+{
+  return (U8)( u8Column * MATRIX_ROW + u8Row );
+}
+
+BOOL AmigaKey_RegisterScanCode( U8 u8Code, BOOL bIsPressed )
+{
+  gau8Events[ u8Code ][ ( TRUE == bIsPressed ) ? INTERLEAVE_PRESS : INTERLEAVE_RELEASE ]++;
+  return TRUE;
+}
+
+// Not part of the exploration
+void Chord_Init( void ) {}
+void Chord_Evaluate( const U_MATRIX_BITMAP* puState ) { (void)puState; }
+void Latency_Sample( U8 u8Column ) { (void)u8Column; }
+void Latency_SetSource( U8 u8Column ) { (void)u8Column; }
+void Latency_GhostStart( void ) {}  // the profiles without diodes block ghosts in the scan
+void Latency_GhostEnd( void ) {}
+void Trace_Write( U8 u8Event, U8 u8Argument ) { (void)u8Event; (void)u8Argument; }
+void Macro_Record( U8 u8Code, BOOL bIsPressed ) { (void)u8Code; (void)bIsPressed; }
+void KeyStats_CountPress( U8 u8Row, U8 u8Column ) { (void)u8Row; (void)u8Column; }
+void KeyStats_CountChatter( U8 u8Row, U8 u8Column ) { (void)u8Row; (void)u8Column; }
+BOOL Config_Read( U8 u8Key, U16* pu16Value ) { (void)u8Key; (void)pu16Value; return FALSE; }  // default debounce
+
+int main( int argc, char* argv[] )
+{
+  S_INTERLEAVE_SCHEDULE sSchedule;
+  S_INTERLEAVE_RESULT   sResult;
+  S_INTERLEAVE_SNAPSHOT sSnapshot;
+  BOOL bAll = FALSE;
+  BOOL bVerbose = FALSE;
+  BOOL bSchedules = TRUE;
+  U32  u32Schedules = 0u;
+  U32  u32Failing = 0u;
+  U32  u32Copies = 0u;
+  U32  u32Torn = 0u;
+  U32  u32Index;
+  int  iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( 0 == strcmp( argv[ iArg ], "-a" ) )
+    {
+      bAll = TRUE;
+    }
+    else if( 0 == strcmp( argv[ iArg ], "-v" ) )
+    {
+      bVerbose = TRUE;
+    }
+    else if( 0 == strcmp( argv[ iArg ], "-s" ) )
+    {
+      bSchedules = FALSE;
+    }
+    else
+    {
+      Usage();
+    }
+  }
+
+  for( sSchedule.u8KeyA = 0u; ( TRUE == bSchedules ) && ( sSchedule.u8KeyA < INTERLEAVE_KEY_COUNT ); sSchedule.u8KeyA++ )
+  {
+    for( sSchedule.u8KeyB = 0u; sSchedule.u8KeyB < INTERLEAVE_KEY_COUNT; sSchedule.u8KeyB++ )
+    {
+      if( ( sSchedule.u8KeyA != sSchedule.u8KeyB )
+       && ( ( TRUE == bAll ) || ( INTERLEAVE_COL( sSchedule.u8KeyA ) == INTERLEAVE_COL( sSchedule.u8KeyB ) )
+         || ( ( ( INTERLEAVE_COL( sSchedule.u8KeyA ) + 1u ) % MATRIX_COL ) == INTERLEAVE_COL( sSchedule.u8KeyB ) ) ) )
+      {
+        for( u32Index = 0u; u32Index < 4u; u32Index++ )
+        {
+          sSchedule.u8KindA = (U8)( u32Index >> 1u );
+          sSchedule.u8KindB = (U8)( u32Index & 1u );
+          sSchedule.u32Point = 0u;
+          do
+          {
+            Run( &sSchedule, &sResult );
+            if( TRUE == sResult.bPreempted )
+            {
+              u32Schedules++;
+              if( ( 0u != sResult.u32Lost ) || ( 0u != sResult.u32Extra ) )
+              {
+                u32Failing++;
+                Record( &sSchedule, &sResult );
+                if( TRUE == bVerbose )
+                {
+                  PrintSchedule( &sSchedule, &sResult );
+                }
+              }
+            }
+            sSchedule.u32Point++;
+          } while( TRUE == sResult.bPreempted );
+        }
+      }
+    }
+  }
+
+  // the copy of the snapshot, with the scan published at each of its points
+  u32Index = 1u;
+  do
+  {
+    RunSnapshot( u32Index, &sSnapshot );
+    if( TRUE == sSnapshot.bPreempted )
+    {
+      u32Copies++;
+      if( FALSE == sSnapshot.bConsistent )
+      {
+        u32Torn++;
+        printf( "  snapshot copied at point %lu (%s): scan %u, torn or not published (before: scan %u, after: scan %u)\n",
+                (unsigned long)u32Index, sSnapshot.pcPoint, sSnapshot.sCopy.u16ScanCount, sSnapshot.sBefore.u16ScanCount,
+                sSnapshot.sAfter.u16ScanCount );
+      }
+    }
+    u32Index++;
+  } while( TRUE == sSnapshot.bPreempted );
+
+  if( TRUE == bSchedules )
+  {
+    printf( "schedules:      %lu explored, %lu lose or duplicate an event\n", (unsigned long)u32Schedules, (unsigned long)u32Failing );
+  }
+  printf( "snapshots:      %lu copies preempted by the publication of a scan, %lu torn\n", (unsigned long)u32Copies, (unsigned long)u32Torn );
+  for( u32Index = 0u; u32Index < gu32ClassCount; u32Index++ )
+  {
+    printf( "%6lu x %-7s waits, %-7s in the IT routine, %s column, at \"%s\", e.g.\n", (unsigned long)gasClasses[ u32Index ].u32Count,
+            gcapcKindNames[ gasClasses[ u32Index ].u8KindA ], gcapcKindNames[ gasClasses[ u32Index ].u8KindB ],
+            ( TRUE == gasClasses[ u32Index ].bSameColumn ) ? "same" : "other", gasClasses[ u32Index ].pcPoint );
+    PrintSchedule( &gasClasses[ u32Index ].sExample, &gasClasses[ u32Index ].sExampleResult );
+  }
+
+  if( 0u != u32Torn )
+  {
+    return 2;
+  }
+  return ( 0u == u32Failing ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
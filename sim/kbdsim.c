@@ -0,0 +1,274 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file kbdsim.c
+*
+* \brief Host simulation -- runs the firmware on the simulated board, types a key, and reports
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "matrix.h"
+#include "latency.h"
+#include "trace.h"
+#include "sim.h"
+#include "sim_cia.h"
+#include "sim_vcd.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SOAK_EDGE_PERIOD  SIM_MS( 30 )  //!< Press and release time of the soak test
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Soak test -- key edges scheduled on the event queue
+typedef struct
+{
+  U32  u32Remaining;  //!< Keystrokes still to type
+  BOOL bPressed;
+} S_SOAK;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U8   PrintReceived( S_SIM_CIA* psCia );
+static void SoakEdge( void* pvContext, SIM_TIME u64Time );
+static void PrintLatency( void );
+static void WriteTrace( const char* pcFile );
+static void Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Prints and removes the received codes
+ * \param  psCia: the computer side
+ * \return The last key code (0xFF, if none)
+ *********************************************************************/
+static U8 PrintReceived( S_SIM_CIA* psCia )
+{
+  S_SIM_CIA_CODE sCode;
+  U8 u8Last = 0xFFu;
+  
+  printf( "received:" );
+  while( TRUE == Sim_Cia_Read( psCia, &sCode ) )
+  {
+    printf( " %02X%s", sCode.u8Code, ( TRUE == sCode.bUp ) ? "u" : "d" );
+    u8Last = sCode.u8Raw;
+  }
+  printf( "\n" );
+  
+  return u8Last;
+}
+
+/*! *******************************************************************
+ * \brief  Next edge of the soak test -- 'A' pressed and released
+ *********************************************************************/
+static void SoakEdge( void* pvContext, SIM_TIME u64Time )
+{
+  S_SOAK* psSoak = (S_SOAK*)pvContext;
+  
+  psSoak->bPressed = ( TRUE == psSoak->bPressed ) ? FALSE : TRUE;
+  Sim_SetKey( 3u, 13u, psSoak->bPressed );
+  if( FALSE == psSoak->bPressed )
+  {
+    psSoak->u32Remaining--;
+  }
+  if( 0u != psSoak->u32Remaining )
+  {
+    Sim_Event_Schedule( u64Time + SOAK_EDGE_PERIOD, SoakEdge, psSoak );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Prints the latency histograms of the firmware
+ *********************************************************************/
+static void PrintLatency( void )
+{
+  static const char* const capcStages[ LATENCY_STAGE_COUNT ] = { "sample->enqueue", "enqueue->transmit", "transmit->ack", "sample->ack" };
+  const S_LATENCY_STAGE* psStage;
+  U8 u8Stage;
+  U8 u8Bucket;
+  
+  printf( "latency (us), bucket n holds [2^(n-1), 2^n), the last one everything above:\n" );
+  for( u8Stage = 0u; u8Stage < LATENCY_STAGE_COUNT; u8Stage++ )
+  {
+    psStage = &gsLatencyBlock.asStage[ u8Stage ];
+    printf( "  %-18s n=%-6u max=%-8lu |", capcStages[ u8Stage ], psStage->u16Count, (unsigned long)psStage->u32MaxUs );
+    for( u8Bucket = 0u; u8Bucket < LATENCY_BUCKET_COUNT; u8Bucket++ )
+    {
+      printf( " %u", psStage->au16Bucket[ u8Bucket ] );
+    }
+    printf( "\n" );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Writes the trace block of the firmware -- the same bytes as a SWIM dump of the ring
+ * \param  pcFile: output file, decode it with tracedec
+ *********************************************************************/
+static void WriteTrace( const char* pcFile )
+{
+  FILE* psFile = fopen( pcFile, "wb" );
+  
+  if( ( NULL == psFile ) || ( 1u != fwrite( &gsTraceBlock, sizeof( gsTraceBlock ), 1u, psFile ) ) )
+  {
+    fprintf( stderr, "kbdsim: cannot write %s\n", pcFile );
+  }
+  if( NULL != psFile )
+  {
+    fclose( psFile );
+  }
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: kbdsim [-v] [-w ack_width_us] [-d ack_delay_us] [-s stall_ms] [-n soak_keystrokes] [-t trace_file]\n"
+                   "              [-g vcd_file]\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  static S_SIM_CIA sCia;
+  static S_SIM_VCD sVcd;
+  S_SOAK sSoak = { 0u, FALSE };
+  S_SIM_CIA_CODE sCode;
+  U32 u32Codes = 0u;
+  S_MATRIX_SNAPSHOT sSnapshot;
+  const S_SIM_STATS* psStats;
+  U32 u32Stall = 0u;
+  const char* pcTrace = NULL;
+  const char* pcVcd = NULL;
+  U8  u8Last;
+  int iArg;
+  clock_t sStart;
+  double dWall;
+  
+  memset( &sCia, 0x00u, sizeof( sCia ) );
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( 0 == strcmp( argv[ iArg ], "-v" ) )
+    {
+      sCia.bVerbose = TRUE;
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-w" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      sCia.u64AckWidth = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-d" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      sCia.u64AckDelay = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-n" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      sSoak.u32Remaining = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-s" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Stall = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-t" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcTrace = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-g" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcVcd = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &sCia );
+  if( ( NULL != pcVcd ) && ( FALSE == Sim_Vcd_Open( &sVcd, pcVcd ) ) )
+  {
+    fprintf( stderr, "kbdsim: cannot write %s\n", pcVcd );
+  }
+  
+  sStart = clock();
+  
+  // power-up, synchronization, init keystream
+  Sim_RunUntil( SIM_S( 1 ) );
+  PrintReceived( &sCia );
+  
+  // 'A' (ROW3, COL13) for 100 ms
+  Sim_Cia_Stall( &sCia, SIM_MS( u32Stall ) );
+  Sim_SetKey( 3u, 13u, TRUE );
+  Sim_RunFor( SIM_MS( 50 ) );
+  Matrix_GetSnapshot( &sSnapshot );
+  printf( "snapshot: scan %u, COL13 %02X\n", sSnapshot.u16ScanCount, sSnapshot.uState.au8Column[ 13u ] );
+  Sim_RunFor( SIM_MS( 50 ) );
+  Sim_SetKey( 3u, 13u, FALSE );
+  Sim_RunFor( SIM_MS( 400 ) );
+  u8Last = PrintReceived( &sCia );
+  
+  // soak test -- runs at 400-600 times real time: every sampling tick runs the interrupt routine and a main cycle turn
+  if( 0u != sSoak.u32Remaining )
+  {
+    Sim_Event_Schedule( Sim_GetTime(), SoakEdge, &sSoak );
+    while( 0u != sSoak.u32Remaining )
+    {
+      Sim_RunFor( SIM_S( 1 ) );
+      while( TRUE == Sim_Cia_Read( &sCia, &sCode ) )
+      {
+        u32Codes++;
+        u8Last = ( 0x20u == sCode.u8Code ) ? sCode.u8Raw : 0xFFu;
+      }
+    }
+    Sim_RunFor( SIM_MS( 100 ) );
+    while( TRUE == Sim_Cia_Read( &sCia, &sCode ) )
+    {
+      u32Codes++;
+      u8Last = ( 0x20u == sCode.u8Code ) ? sCode.u8Raw : 0xFFu;
+    }
+    printf( "soak:           %lu codes received\n", (unsigned long)u32Codes );
+  }
+  
+  Sim_Vcd_Close( &sVcd );
+  dWall = (double)( clock() - sStart ) / CLOCKS_PER_SEC;
+  psStats = Sim_GetStats();
+  printf( "virtual time:   %.3f s\n", SIM_TO_US( Sim_GetTime() ) / 1e6 );
+  printf( "interrupts:     %lu (max %.1f us, %.2f %% CPU)\n", (unsigned long)psStats->u32Interrupts,
+          SIM_TO_US( psStats->u64MaxInterrupt ), 100.0 * (double)psStats->u64InterruptTime / (double)Sim_GetTime() );
+  printf( "main loops:     %lu (idle skipped %.1f %%)\n", (unsigned long)psStats->u32MainLoops,
+          100.0 * (double)psStats->u64IdleSkipped / (double)Sim_GetTime() );
+  printf( "periph access:  %lu, events %lu\n", (unsigned long)psStats->u32PeriphAccess, (unsigned long)Sim_Event_GetProcessed() );
+  printf( "port:           %lu bytes, %lu sync, %lu acks (%lu missed), %lu resets\n", (unsigned long)sCia.sStats.u32Bytes,
+          (unsigned long)sCia.sStats.u32SyncBytes, (unsigned long)sCia.sStats.u32Acks, (unsigned long)sCia.sStats.u32AcksMissed,
+          (unsigned long)sCia.sStats.u32Resets );
+  PrintLatency();
+  if( NULL != pcTrace )
+  {
+    WriteTrace( pcTrace );
+  }
+  printf( "wall time:      %.3f s (%.1fx real time)\n", dWall, ( SIM_TO_US( Sim_GetTime() ) / 1e6 ) / ( ( dWall > 0.0 ) ? dWall : 1e-9 ) );
+  
+  return ( 0x41u == u8Last ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,886 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file layoutc.c
+*
+* \brief Layout compiler -- generates the scancode, inverse scancode, pin, column port image and chord
+*        tables, and the row reading and debounce kernels of a matrix profile of the firmware from its layout
+*        description (fw/layouts/\*.layout)
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include "types.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define LAYOUTC_ROW_MAX       8u      //!< Bits of a column byte
+#define LAYOUTC_COL_MAX       16u     //!< Nibble of a packed position
+#define LAYOUTC_KEY_MAX       ( LAYOUTC_ROW_MAX * LAYOUTC_COL_MAX )
+#define LAYOUTC_CHORD_MAX     8u      //!< Bits of the active chord set of chord.c
+#define LAYOUTC_SCANCODES     128u
+#define LAYOUTC_PORTS         6u      //!< GPIOA..GPIOF
+#define LAYOUTC_NO_KEY        0xFFu
+#define LAYOUTC_ID_SIZE       24u
+#define LAYOUTC_LABEL_SIZE    16u
+#define LAYOUTC_NAME_SIZE     96u
+#define LAYOUTC_LINE_SIZE     256u
+#define LAYOUTC_TOKEN_MAX     ( LAYOUTC_COL_MAX + 2u )
+#define LAYOUTC_SAMPLES       2u      //!< Default closed samples of a press
+#define LAYOUTC_SAMPLE_MAX    4u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A port pin
+typedef struct
+{
+  U8 u8Port;   //!< 0: GPIOA
+  U8 u8Pin;
+} S_LAYOUTC_PIN;
+
+//! \brief A key of the matrix
+typedef struct
+{
+  char acId[ LAYOUTC_ID_SIZE ];
+  char acLabel[ LAYOUTC_LABEL_SIZE ];
+  U8   u8Row;
+  U8   u8Column;
+  U8   u8ScanCode;
+} S_LAYOUTC_KEY;
+
+//! \brief A key combination
+typedef struct
+{
+  char acId[ LAYOUTC_ID_SIZE ];
+  U8   au8Mask[ LAYOUTC_COL_MAX ];
+  char acKeys[ LAYOUTC_LINE_SIZE ];   //!< " + " separated, for the comment
+} S_LAYOUTC_CHORD;
+
+//! \brief The whole description
+typedef struct
+{
+  char            acName[ LAYOUTC_NAME_SIZE ];
+  char            acProfile[ LAYOUTC_ID_SIZE ];                       //!< LAYOUT_PROFILE_<profile>, from the file name
+  char            acFile[ LAYOUTC_ID_SIZE ];                          //!< The file name without extension
+  const char*     pcSource;
+  U8              u8Samples;                                          //!< Closed samples of a press
+  BOOL            bDiodes;                                            //!< A diode at each switch
+  S_LAYOUTC_PIN   asRows[ LAYOUTC_ROW_MAX ];
+  U8              u8Rows;
+  S_LAYOUTC_PIN   asColumns[ LAYOUTC_COL_MAX ];
+  U8              u8Columns;
+  S_LAYOUTC_KEY   asKeys[ LAYOUTC_KEY_MAX ];
+  U8              u8Keys;
+  S_LAYOUTC_CHORD asChords[ LAYOUTC_CHORD_MAX ];
+  U8              u8Chords;
+  U8              au8ScanCode[ LAYOUTC_ROW_MAX ][ LAYOUTC_COL_MAX ];  //!< LAYOUTC_NO_KEY: no key at the position
+  U8              au8Position[ LAYOUTC_SCANCODES ];                   //!< LAYOUTC_NO_KEY: no key of the code
+  U8              au8KeyIndex[ LAYOUTC_ROW_MAX ][ LAYOUTC_COL_MAX ];
+  U8              au8Ports[ LAYOUTC_PORTS ];                          //!< Ports with column pins
+  U8              u8Ports;
+} S_LAYOUTC;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static S_LAYOUTC  gsLayout;
+static U32        gu32Line;
+static BOOL       gbErrors;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void   Error( const char* pcFormat, ... );
+static BOOL   IsIdentifier( const char* pcText );
+static BOOL   ParsePin( const char* pcText, S_LAYOUTC_PIN* psPin );
+static BOOL   ParseNumber( const char* pcText, U32 u32Max, U32* pu32Value );
+static U8     FindKey( const char* pcId );
+static void   ParseLine( char* pcLine );
+static void   Check( void );
+static size_t DisplayWidth( const char* pcText );
+static void   PrintHeader( FILE* psFile, const char* pcFile, const char* pcBrief );
+static void   WriteReadRows( FILE* psFile );
+static void   WriteHeader( FILE* psFile, const char* pcFile );
+static void   WriteSource( FILE* psFile, const char* pcFile );
+static void   Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Prints an error of the description, the compilation goes on to find the others
+ *********************************************************************/
+static void Error( const char* pcFormat, ... )
+{
+  va_list sArgs;
+
+  fprintf( stderr, "%s:%lu: ", gsLayout.pcSource, (unsigned long)gu32Line );
+  va_start( sArgs, pcFormat );
+  vfprintf( stderr, pcFormat, sArgs );
+  va_end( sArgs );
+  fprintf( stderr, "\n" );
+  gbErrors = TRUE;
+}
+
+//! \brief Upper case letters, digits and underscore -- the identifier gets a LAYOUT_KEY_ or LAYOUT_CHORD_ prefix
+static BOOL IsIdentifier( const char* pcText )
+{
+  BOOL bRet = ( ( '\0' != *pcText ) && ( strlen( pcText ) < LAYOUTC_ID_SIZE ) ) ? TRUE : FALSE;
+
+  for( ; '\0' != *pcText; pcText++ )
+  {
+    bRet = ( ( ( 'A' <= *pcText ) && ( 'Z' >= *pcText ) ) || ( ( '0' <= *pcText ) && ( '9' >= *pcText ) ) || ( '_' == *pcText ) ) ? bRet : FALSE;
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Parses a pin, e.g. "D7" is GPIOD, GPIO_PIN_7
+ *********************************************************************/
+static BOOL ParsePin( const char* pcText, S_LAYOUTC_PIN* psPin )
+{
+  BOOL bRet = FALSE;
+
+  if( ( 2u == strlen( pcText ) ) && ( 'A' <= pcText[ 0 ] ) && ( ( 'A' + LAYOUTC_PORTS ) > pcText[ 0 ] ) && ( '0' <= pcText[ 1 ] ) && ( '7' >= pcText[ 1 ] ) )
+  {
+    psPin->u8Port = (U8)( pcText[ 0 ] - 'A' );
+    psPin->u8Pin = (U8)( pcText[ 1 ] - '0' );
+    bRet = TRUE;
+  }
+
+  return bRet;
+}
+
+static BOOL ParseNumber( const char* pcText, U32 u32Max, U32* pu32Value )
+{
+  char* pcEnd;
+  unsigned long ulValue = strtoul( pcText, &pcEnd, 0 );
+
+  *pu32Value = (U32)ulValue;
+  return ( ( '\0' != *pcText ) && ( '\0' == *pcEnd ) && ( ulValue <= u32Max ) ) ? TRUE : FALSE;
+}
+
+static U8 FindKey( const char* pcId )
+{
+  U8 u8Ret = LAYOUTC_NO_KEY;
+  U8 u8Index;
+
+  for( u8Index = 0u; u8Index < gsLayout.u8Keys; u8Index++ )
+  {
+    u8Ret = ( 0 == strcmp( gsLayout.asKeys[ u8Index ].acId, pcId ) ) ? u8Index : u8Ret;
+  }
+
+  return u8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  Parses one line of the description
+ * \param  pcLine: the line, will be split into tokens
+ * \return -
+ *********************************************************************/
+static void ParseLine( char* pcLine )
+{
+  char* apcToken[ LAYOUTC_TOKEN_MAX + 1u ];
+  char* pcQuote;
+  U32   u32Tokens = 0u;
+  U32   u32Index;
+  U32   u32Row, u32Column, u32Code;
+  S_LAYOUTC_KEY*   psKey;
+  S_LAYOUTC_CHORD* psChord;
+  U8    u8Key;
+
+  // comments are whole lines, as '#' is also the label of a key
+  pcLine[ strcspn( pcLine, "\r\n" ) ] = '\0';
+  pcLine += strspn( pcLine, " \t" );
+  pcLine[ ( '#' == pcLine[ 0 ] ) ? 0 : strlen( pcLine ) ] = '\0';
+
+  // the name is quoted, the rest is split at white space
+  pcQuote = strchr( pcLine, '"' );
+  if( ( 0 == strncmp( pcLine, "name", 4u ) ) && ( NULL != pcQuote ) )
+  {
+    if( ( NULL == strchr( pcQuote + 1, '"' ) ) || ( (size_t)( strchr( pcQuote + 1, '"' ) - pcQuote - 1 ) >= LAYOUTC_NAME_SIZE ) )
+    {
+      Error( "bad name" );
+    }
+    else
+    {
+      *strchr( pcQuote + 1, '"' ) = '\0';
+      strcpy( gsLayout.acName, pcQuote + 1 );
+    }
+  }
+  else
+  {
+    for( apcToken[ 0 ] = strtok( pcLine, " \t" ); ( NULL != apcToken[ u32Tokens ] ) && ( u32Tokens < LAYOUTC_TOKEN_MAX ); )
+    {
+      apcToken[ ++u32Tokens ] = strtok( NULL, " \t" );
+    }
+
+    if( 0u == u32Tokens )
+    {
+      // empty line or comment
+    }
+    else if( ( 0 == strcmp( apcToken[ 0 ], "rows" ) ) || ( 0 == strcmp( apcToken[ 0 ], "columns" ) ) )
+    {
+      BOOL bRows = ( 'r' == apcToken[ 0 ][ 0 ] ) ? TRUE : FALSE;
+      U32  u32Max = ( TRUE == bRows ) ? LAYOUTC_ROW_MAX : LAYOUTC_COL_MAX;
+
+      if( ( u32Tokens - 1u ) > u32Max )
+      {
+        Error( "more than %lu %s", (unsigned long)u32Max, apcToken[ 0 ] );
+      }
+      for( u32Index = 1u; ( u32Index < u32Tokens ) && ( ( u32Index - 1u ) < u32Max ); u32Index++ )
+      {
+        if( FALSE == ParsePin( apcToken[ u32Index ], ( TRUE == bRows ) ? &gsLayout.asRows[ u32Index - 1u ] : &gsLayout.asColumns[ u32Index - 1u ] ) )
+        {
+          Error( "bad pin: %s (port A..F, pin 0..7, e.g. D7)", apcToken[ u32Index ] );
+        }
+      }
+      if( TRUE == bRows )
+      {
+        gsLayout.u8Rows = (U8)( u32Index - 1u );
+      }
+      else
+      {
+        gsLayout.u8Columns = (U8)( u32Index - 1u );
+      }
+    }
+    else if( 0 == strcmp( apcToken[ 0 ], "samples" ) )
+    {
+      if( ( 2u != u32Tokens ) || ( FALSE == ParseNumber( apcToken[ 1 ], LAYOUTC_SAMPLE_MAX, &u32Code ) ) || ( 0u == u32Code ) )
+      {
+        Error( "samples: 1..%u closed samples of a press", LAYOUTC_SAMPLE_MAX );
+      }
+      else
+      {
+        gsLayout.u8Samples = (U8)u32Code;
+      }
+    }
+    else if( 0 == strcmp( apcToken[ 0 ], "diodes" ) )
+    {
+      if( ( 2u != u32Tokens ) || ( ( 0 != strcmp( apcToken[ 1 ], "yes" ) ) && ( 0 != strcmp( apcToken[ 1 ], "no" ) ) ) )
+      {
+        Error( "diodes: yes or no" );
+      }
+      else
+      {
+        gsLayout.bDiodes = ( 0 == strcmp( apcToken[ 1 ], "yes" ) ) ? TRUE : FALSE;
+      }
+    }
+    else if( 0 == strcmp( apcToken[ 0 ], "key" ) )
+    {
+      if( 6u != u32Tokens )
+      {
+        Error( "key: id row column code label" );
+      }
+      else if( FALSE == IsIdentifier( apcToken[ 1 ] ) )
+      {
+        Error( "bad key identifier: %s", apcToken[ 1 ] );
+      }
+      else if( ( FALSE == ParseNumber( apcToken[ 2 ], LAYOUTC_ROW_MAX - 1u, &u32Row ) )
+            || ( FALSE == ParseNumber( apcToken[ 3 ], LAYOUTC_COL_MAX - 1u, &u32Column ) )
+            || ( FALSE == ParseNumber( apcToken[ 4 ], LAYOUTC_SCANCODES - 1u, &u32Code ) ) )
+      {
+        Error( "key %s: bad row, column or code (0x00..0x7F)", apcToken[ 1 ] );
+      }
+      else if( strlen( apcToken[ 5 ] ) >= LAYOUTC_LABEL_SIZE )
+      {
+        Error( "key %s: label too long", apcToken[ 1 ] );
+      }
+      else if( LAYOUTC_NO_KEY != FindKey( apcToken[ 1 ] ) )
+      {
+        Error( "key %s defined twice", apcToken[ 1 ] );
+      }
+      else if( LAYOUTC_NO_KEY != gsLayout.au8KeyIndex[ u32Row ][ u32Column ] )
+      {
+        Error( "key %s: ROW%lu COL%lu is already %s", apcToken[ 1 ], (unsigned long)u32Row, (unsigned long)u32Column,
+               gsLayout.asKeys[ gsLayout.au8KeyIndex[ u32Row ][ u32Column ] ].acId );
+      }
+      else if( LAYOUTC_NO_KEY != gsLayout.au8Position[ u32Code ] )
+      {
+        Error( "key %s: code 0x%02lX is already used", apcToken[ 1 ], (unsigned long)u32Code );
+      }
+      else
+      {
+        psKey = &gsLayout.asKeys[ gsLayout.u8Keys ];
+        strcpy( psKey->acId, apcToken[ 1 ] );
+        strcpy( psKey->acLabel, apcToken[ 5 ] );
+        psKey->u8Row = (U8)u32Row;
+        psKey->u8Column = (U8)u32Column;
+        psKey->u8ScanCode = (U8)u32Code;
+        gsLayout.au8KeyIndex[ u32Row ][ u32Column ] = gsLayout.u8Keys++;
+        gsLayout.au8ScanCode[ u32Row ][ u32Column ] = (U8)u32Code;
+        gsLayout.au8Position[ u32Code ] = (U8)( ( u32Row << 4u ) | u32Column );
+      }
+    }
+    else if( 0 == strcmp( apcToken[ 0 ], "chord" ) )
+    {
+      if( ( 3u > u32Tokens ) || ( FALSE == IsIdentifier( apcToken[ 1 ] ) ) )
+      {
+        Error( "chord: id key key..." );
+      }
+      else if( LAYOUTC_CHORD_MAX == gsLayout.u8Chords )
+      {
+        Error( "more than %u chords", LAYOUTC_CHORD_MAX );
+      }
+      else
+      {
+        psChord = &gsLayout.asChords[ gsLayout.u8Chords++ ];
+        strcpy( psChord->acId, apcToken[ 1 ] );
+        for( u32Index = 2u; u32Index < u32Tokens; u32Index++ )
+        {
+          u8Key = FindKey( apcToken[ u32Index ] );
+          if( LAYOUTC_NO_KEY == u8Key )
+          {
+            Error( "chord %s: unknown key %s (keys must be defined before the chords)", psChord->acId, apcToken[ u32Index ] );
+          }
+          else
+          {
+            psChord->au8Mask[ gsLayout.asKeys[ u8Key ].u8Column ] |= (U8)( 1u << gsLayout.asKeys[ u8Key ].u8Row );
+            if( ( strlen( psChord->acKeys ) + strlen( apcToken[ u32Index ] ) + 4u ) < sizeof( psChord->acKeys ) )
+            {
+              strcat( psChord->acKeys, ( 2u == u32Index ) ? "" : " + " );
+              strcat( psChord->acKeys, apcToken[ u32Index ] );
+            }
+          }
+        }
+      }
+    }
+    else
+    {
+      Error( "unknown statement: %s", apcToken[ 0 ] );
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Checks the whole description, and collects the ports of the columns
+ *********************************************************************/
+static void Check( void )
+{
+  U8 u8Index, u8Other;
+  const S_LAYOUTC_PIN* psPin;
+  const S_LAYOUTC_PIN* psOther;
+
+  if( ( '\0' == gsLayout.acName[ 0 ] ) || ( 0u == gsLayout.u8Rows ) || ( 0u == gsLayout.u8Columns ) )
+  {
+    Error( "name, rows and columns are required" );
+  }
+  if( FALSE == IsIdentifier( gsLayout.acProfile ) )
+  {
+    Error( "the file name must give the name of the profile: letters, digits and underscore" );
+  }
+  for( u8Index = 0u; u8Index < gsLayout.u8Keys; u8Index++ )
+  {
+    if( ( gsLayout.asKeys[ u8Index ].u8Row >= gsLayout.u8Rows ) || ( gsLayout.asKeys[ u8Index ].u8Column >= gsLayout.u8Columns ) )
+    {
+      Error( "key %s is outside of the %ux%u matrix", gsLayout.asKeys[ u8Index ].acId, gsLayout.u8Rows, gsLayout.u8Columns );
+    }
+  }
+
+  // every pin is used once
+  for( u8Index = 0u; u8Index < ( gsLayout.u8Rows + gsLayout.u8Columns ); u8Index++ )
+  {
+    psPin = ( u8Index < gsLayout.u8Rows ) ? &gsLayout.asRows[ u8Index ] : &gsLayout.asColumns[ u8Index - gsLayout.u8Rows ];
+    for( u8Other = 0u; u8Other < u8Index; u8Other++ )
+    {
+      psOther = ( u8Other < gsLayout.u8Rows ) ? &gsLayout.asRows[ u8Other ] : &gsLayout.asColumns[ u8Other - gsLayout.u8Rows ];
+      if( ( psPin->u8Port == psOther->u8Port ) && ( psPin->u8Pin == psOther->u8Pin ) )
+      {
+        Error( "pin %c%u is used twice", 'A' + psPin->u8Port, psPin->u8Pin );
+      }
+    }
+  }
+
+  // ports of the columns, in alphabetical order
+  for( u8Index = 0u; u8Index < LAYOUTC_PORTS; u8Index++ )
+  {
+    for( u8Other = 0u; u8Other < gsLayout.u8Columns; u8Other++ )
+    {
+      if( ( u8Index == gsLayout.asColumns[ u8Other ].u8Port ) && ( ( 0u == gsLayout.u8Ports ) || ( u8Index != gsLayout.au8Ports[ gsLayout.u8Ports - 1u ] ) ) )
+      {
+        gsLayout.au8Ports[ gsLayout.u8Ports++ ] = u8Index;
+      }
+    }
+  }
+}
+
+//! \brief Characters of an UTF-8 string -- the labels of the keycaps may have accents
+static size_t DisplayWidth( const char* pcText )
+{
+  size_t uRet = 0u;
+
+  for( ; '\0' != *pcText; pcText++ )
+  {
+    uRet += ( 0x80u != ( (U8)*pcText & 0xC0u ) ) ? 1u : 0u;
+  }
+
+  return uRet;
+}
+
+static void PrintHeader( FILE* psFile, const char* pcFile, const char* pcBrief )
+{
+  fprintf( psFile, "/*! *******************************************************************************************************\n"
+                   "* Copyright (c) 2018 Krist\xC3\xB3" "f Szabolcs Horv\xC3\xA1" "th\n"
+                   "*\n"
+                   "* All rights reserved\n"
+                   "*\n"
+                   "* \\file %s\n"
+                   "*\n"
+                   "* \\brief %s -- %s\n"
+                   "*\n"
+                   "* \\note  Generated by the layout compiler (sim/layoutc.c) from %s, do not edit!\n"
+                   "*\n"
+                   "* \\author Krist\xC3\xB3" "f Sz. Horv\xC3\xA1" "th\n"
+                   "*\n"
+                   "**********************************************************************************************************/\n\n",
+           pcFile, pcBrief, gsLayout.acName, gsLayout.pcSource );
+}
+
+/*! *******************************************************************
+ * \brief  Writes the header of the profile: key positions, chord masks, the debounce kernel and the declarations
+ *********************************************************************/
+static void WriteHeader( FILE* psFile, const char* pcFile )
+{
+  U8 u8Index, u8Column;
+  int iWidth;
+  const char* pcLabel;
+
+  PrintHeader( psFile, pcFile, "Keyboard layout profile" );
+  fprintf( psFile, "#ifndef LAYOUT_%s_H_INCLUDED\n"
+                   "#define LAYOUT_%s_H_INCLUDED\n\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Include files\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "#include \"stm8s.h\"\n"
+                   "#include \"types.h\"\n\n\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Definitions\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "#define LAYOUT_NAME           \"%s\"\n"
+                   "#define LAYOUT_PROFILE_NAME   \"%s\"  //!< Name of the description in layouts/\n"
+                   "#define LAYOUT_ROWS           %uu     //!< Size of the matrix of the layout, see MATRIX_ROW and MATRIX_COL\n"
+                   "#define LAYOUT_COLS           %uu\n"
+                   "#define LAYOUT_SCANCODES      %uu   //!< Entries of the inverse table, one per key code\n"
+                   "#define LAYOUT_NO_KEY         0xFFu  //!< Code of a position without key, and position of a code without key\n"
+                   "#define LAYOUT_COLUMN_PORTS   %uu     //!< Ports with column pins\n"
+                   "#define LAYOUT_SAMPLES        %uu     //!< Closed samples of a press, see MATRIX_SAMPLE\n"
+                   "#define LAYOUT_DIODES         %uu     //!< 1: a diode at each switch, 0: three keys can close a fourth one, see MATRIX_ANTIGHOST\n\n"
+                   "#define LAYOUT_POSITION( ROW, COL )      ( (U8)( ( (ROW) << 4u ) | (COL) ) )  //!< Packs a matrix position into one byte\n"
+                   "#define LAYOUT_POSITION_ROW( POSITION )  ( (U8)( (POSITION) >> 4u ) )\n"
+                   "#define LAYOUT_POSITION_COL( POSITION )  ( (U8)( (POSITION) & 0x0Fu ) )\n\n"
+                   "//! Debounce kernel: a key is closed, if it is 0 in every sample of its column (LAYOUT_SAMPLES bytes)\n"
+                   "#define LAYOUT_SAMPLE_OR( SAMPLES )      ( (U8)( ",
+           gsLayout.acProfile, gsLayout.acProfile, gsLayout.acName, gsLayout.acFile, gsLayout.u8Rows, gsLayout.u8Columns, LAYOUTC_SCANCODES, gsLayout.u8Ports,
+           gsLayout.u8Samples, ( TRUE == gsLayout.bDiodes ) ? 1u : 0u );
+  for( u8Index = 0u; u8Index < gsLayout.u8Samples; u8Index++ )
+  {
+    fprintf( psFile, "%s(SAMPLES)[ %uu ]", ( 0u != u8Index ) ? " | " : "", u8Index );
+  }
+  fprintf( psFile, " ) )\n\n"
+                   "// Positions of the keys\n" );
+  for( u8Index = 0u; u8Index < gsLayout.u8Keys; u8Index++ )
+  {
+    iWidth = (int)( 12u - strlen( gsLayout.asKeys[ u8Index ].acId ) );
+    pcLabel = gsLayout.asKeys[ u8Index ].acLabel;
+    fprintf( psFile, "#define LAYOUT_KEY_%s%*s LAYOUT_POSITION( %uu, %2uu )  //!< %s%s\n", gsLayout.asKeys[ u8Index ].acId, ( iWidth > 0 ) ? iWidth : 0, "",
+             gsLayout.asKeys[ u8Index ].u8Row, gsLayout.asKeys[ u8Index ].u8Column, pcLabel,
+             ( '\\' == pcLabel[ strlen( pcLabel ) - 1u ] ) ? " key" : "" );  // a backslash at the end would continue the comment
+  }
+
+  fprintf( psFile, "\n// Key combinations: initializers of U_MATRIX_BITMAP (bit n of a column byte belongs to ROWn)\n" );
+  for( u8Index = 0u; u8Index < gsLayout.u8Chords; u8Index++ )
+  {
+    iWidth = (int)( 12u - strlen( gsLayout.asChords[ u8Index ].acId ) );
+    fprintf( psFile, "#define LAYOUT_CHORD_%s%*s { {", gsLayout.asChords[ u8Index ].acId, ( iWidth > 0 ) ? iWidth : 0, "" );
+    for( u8Column = 0u; u8Column < gsLayout.u8Columns; u8Column++ )
+    {
+      fprintf( psFile, " 0x%02Xu%s", gsLayout.asChords[ u8Index ].au8Mask[ u8Column ], ( ( u8Column + 1u ) < gsLayout.u8Columns ) ? "," : "" );
+    }
+    fprintf( psFile, " } }  //!< %s\n", gsLayout.asChords[ u8Index ].acKeys );
+  }
+
+  fprintf( psFile, "\n\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Types\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "//! \\brief Element of logic bit -- GPIO pin assignment tables\n"
+                   "typedef struct\n"
+                   "{\n"
+                   "  GPIO_TypeDef*    psGPIOPort;\n"
+                   "  GPIO_Pin_TypeDef ePin;\n"
+                   "} S_LAYOUT_PIN;\n\n\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Global variables\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "extern const U8           gcau8ScanCodeTable[ LAYOUT_ROWS ][ LAYOUT_COLS ];\n"
+                   "extern const U8           gcau8KeyPosition[ LAYOUT_SCANCODES ];\n"
+                   "extern const S_LAYOUT_PIN gcsKeyMatrixRows[ LAYOUT_ROWS ];\n"
+                   "extern const S_LAYOUT_PIN gcsKeyMatrixColumns[ LAYOUT_COLS ];\n"
+                   "extern GPIO_TypeDef* const gcapsColumnPorts[ LAYOUT_COLUMN_PORTS ];\n"
+                   "extern const U8           gcau8ColumnPortMask[ LAYOUT_COLUMN_PORTS ];\n"
+                   "extern const U8           gcau8ColumnPortImage[ LAYOUT_COLS ][ LAYOUT_COLUMN_PORTS ];\n\n\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Public functions\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "U8 Layout_ReadRows( void );\n\n\n"
+                   "#endif // LAYOUT_%s_H_INCLUDED\n"
+                   "/******************************<EOF>**********************************/\n", gsLayout.acProfile );
+}
+
+/*! *******************************************************************
+ * \brief  Writes Layout_ReadRows(): every port of the rows is read once, its bits are moved to the rows with one
+ *         shift per distance between pin and row
+ *********************************************************************/
+static void WriteReadRows( FILE* psFile )
+{
+  U8   u8Port, u8Row, u8Other, u8Mask;
+  U8   u8Ports = 0u;   // bit n: GPIOA + n has rows
+  int  iShift;
+  BOOL bFirst = TRUE;
+  BOOL bDone[ LAYOUTC_ROW_MAX ] = { FALSE };
+
+  fprintf( psFile, "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Public functions\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "/*! *******************************************************************\n"
+                   " * \\brief  Reads the rows of the matrix -- the scan kernel of the profile\n"
+                   " * \\param  -\n"
+                   " * \\return Bit n is ROWn (1 means open), the bits of nonexistent rows are 0\n"
+                   " * \\note   Called from the IT routine. One read per port of the rows, instead of one per row.\n"
+                   " *********************************************************************/\n"
+                   "U8 Layout_ReadRows( void )\n"
+                   "{\n" );
+  for( u8Row = 0u; u8Row < gsLayout.u8Rows; u8Row++ )
+  {
+    u8Ports |= (U8)( 1u << gsLayout.asRows[ u8Row ].u8Port );
+  }
+  for( u8Port = 0u; u8Port < LAYOUTC_PORTS; u8Port++ )
+  {
+    if( 0u != ( u8Ports & ( 1u << u8Port ) ) )
+    {
+      fprintf( psFile, "  U8 u8Port%c = GPIO_ReadInputData( GPIO%c );\n", 'A' + u8Port, 'A' + u8Port );
+    }
+  }
+  fprintf( psFile, "\n  return (U8)(" );
+  for( u8Row = 0u; u8Row < gsLayout.u8Rows; u8Row++ )
+  {
+    if( FALSE == bDone[ u8Row ] )
+    {
+      // the rows on the same port, at the same distance
+      iShift = (int)gsLayout.asRows[ u8Row ].u8Pin - (int)u8Row;
+      u8Mask = 0u;
+      for( u8Other = u8Row; u8Other < gsLayout.u8Rows; u8Other++ )
+      {
+        if( ( gsLayout.asRows[ u8Other ].u8Port == gsLayout.asRows[ u8Row ].u8Port ) && ( ( (int)gsLayout.asRows[ u8Other ].u8Pin - (int)u8Other ) == iShift ) )
+        {
+          u8Mask |= (U8)( 1u << u8Other );
+          bDone[ u8Other ] = TRUE;
+        }
+      }
+      fprintf( psFile, "%s", ( TRUE == bFirst ) ? " " : "\n             | " );
+      if( 0 == iShift )
+      {
+        fprintf( psFile, "( u8Port%c & 0x%02Xu )", 'A' + gsLayout.asRows[ u8Row ].u8Port, u8Mask );
+      }
+      else
+      {
+        fprintf( psFile, "( (U8)( u8Port%c %s %du ) & 0x%02Xu )", 'A' + gsLayout.asRows[ u8Row ].u8Port, ( iShift > 0 ) ? ">>" : "<<",
+                 ( iShift > 0 ) ? iShift : -iShift, u8Mask );
+      }
+      bFirst = FALSE;
+    }
+  }
+  fprintf( psFile, " );\n"
+                   "}\n\n" );
+}
+
+/*! *******************************************************************
+ * \brief  Writes the source of the profile: the tables and the scan kernel, built only if the profile is selected
+ *********************************************************************/
+static void WriteSource( FILE* psFile, const char* pcFile )
+{
+  U8     u8Row, u8Column, u8Port, u8Code, u8Image;
+  size_t uCell = 6u;   // "COL15 "
+  size_t uLength;
+  const char* pcLabel;
+
+  for( u8Row = 0u; u8Row < gsLayout.u8Keys; u8Row++ )
+  {
+    uLength = DisplayWidth( gsLayout.asKeys[ u8Row ].acLabel ) + 1u;
+    uCell = ( uLength > uCell ) ? uLength : uCell;
+  }
+
+  PrintHeader( psFile, pcFile, "Keyboard layout profile tables" );
+  fprintf( psFile, "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Include files\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "#include \"stm8s.h\"\n"
+                   "#include \"types.h\"\n\n"
+                   "// Own include -- through the selection of the profile\n"
+                   "#include \"../layout.h\"\n\n"
+                   "#if ( LAYOUT_PROFILE_%s == LAYOUT_PROFILE )\n\n\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "// Constants\n"
+                   "//--------------------------------------------------------------------------------------------------------/\n"
+                   "//! \\brief Matrix to scancode translation table -- base layer\n"
+                   "//! \\note  Invalid keys are marked with LAYOUT_NO_KEY\n"
+                   "const U8 gcau8ScanCodeTable[ LAYOUT_ROWS ][ LAYOUT_COLS ] =\n"
+                   "{\n"
+                   "//  ", gsLayout.acProfile );
+  for( u8Column = 0u; u8Column < gsLayout.u8Columns; u8Column++ )
+  {
+    fprintf( psFile, "COL%-*u", ( ( u8Column + 1u ) < gsLayout.u8Columns ) ? 4 : 0, u8Column );
+  }
+  fprintf( psFile, "\n" );
+  for( u8Row = 0u; u8Row < gsLayout.u8Rows; u8Row++ )
+  {
+    fprintf( psFile, "  {" );
+    for( u8Column = 0u; u8Column < gsLayout.u8Columns; u8Column++ )
+    {
+      fprintf( psFile, " 0x%02Xu%s", gsLayout.au8ScanCode[ u8Row ][ u8Column ], ( ( u8Column + 1u ) < gsLayout.u8Columns ) ? "," : "" );
+    }
+    fprintf( psFile, " }%s  // ROW%u\n", ( ( u8Row + 1u ) < gsLayout.u8Rows ) ? "," : " ", u8Row );
+  }
+  fprintf( psFile, "};\n" );
+
+  // the matrix as seen from the top, COL0 on the right
+  fprintf( psFile, "//-----------------------------------------------------------------------------------------------------------------\n"
+                   "// The keyboard matrix looks like this (%s):\n"
+                   "//     ", gsLayout.acName );
+  for( u8Column = gsLayout.u8Columns; u8Column-- > 0u; )
+  {
+    fprintf( psFile, " COL%-*u", ( 0u != u8Column ) ? ( (int)uCell - 4 ) : 0, u8Column );
+  }
+  fprintf( psFile, "\n" );
+  for( u8Row = 0u; u8Row < gsLayout.u8Rows; u8Row++ )
+  {
+    fprintf( psFile, "// ROW%u ", u8Row );
+    for( u8Column = gsLayout.u8Columns; u8Column-- > 0u; )
+    {
+      pcLabel = ( LAYOUTC_NO_KEY != gsLayout.au8KeyIndex[ u8Row ][ u8Column ] ) ? gsLayout.asKeys[ gsLayout.au8KeyIndex[ u8Row ][ u8Column ] ].acLabel : "-";
+      fprintf( psFile, " %s%*s", pcLabel, (int)( uCell - 1u - DisplayWidth( pcLabel ) ), "" );
+    }
+    fprintf( psFile, " ROW%u\n", u8Row );
+  }
+  fprintf( psFile, "//-----------------------------------------------------------------------------------------------------------------\n\n" );
+
+  // inverse table
+  fprintf( psFile, "//! \\brief Scancode to matrix position (LAYOUT_POSITION()) translation table -- base layer\n"
+                   "//! \\note  Codes without key are marked with LAYOUT_NO_KEY\n"
+                   "const U8 gcau8KeyPosition[ LAYOUT_SCANCODES ] =\n"
+                   "{\n" );
+  for( u8Code = 0u; u8Code < LAYOUTC_SCANCODES; u8Code++ )
+  {
+    fprintf( psFile, "%s0x%02Xu%s", ( 0u == ( u8Code % 16u ) ) ? "  " : " ", gsLayout.au8Position[ u8Code ], ( ( u8Code + 1u ) < LAYOUTC_SCANCODES ) ? "," : " " );
+    if( 15u == ( u8Code % 16u ) )
+    {
+      fprintf( psFile, "  // 0x%02X..0x%02X\n", u8Code - 15u, u8Code );
+    }
+  }
+  fprintf( psFile, "};\n\n" );
+
+  // pins
+  fprintf( psFile, "//! \\brief Matrix rows\n"
+                   "const S_LAYOUT_PIN gcsKeyMatrixRows[ LAYOUT_ROWS ] =\n"
+                   "{\n" );
+  for( u8Row = 0u; u8Row < gsLayout.u8Rows; u8Row++ )
+  {
+    fprintf( psFile, "  { GPIO%c, GPIO_PIN_%u }%s   //!< ROW%u\n", 'A' + gsLayout.asRows[ u8Row ].u8Port, gsLayout.asRows[ u8Row ].u8Pin,
+             ( ( u8Row + 1u ) < gsLayout.u8Rows ) ? "," : " ", u8Row );
+  }
+  fprintf( psFile, "};\n\n"
+                   "//! \\brief Matrix columns\n"
+                   "const S_LAYOUT_PIN gcsKeyMatrixColumns[ LAYOUT_COLS ] =\n"
+                   "{\n" );
+  for( u8Column = 0u; u8Column < gsLayout.u8Columns; u8Column++ )
+  {
+    fprintf( psFile, "  { GPIO%c, GPIO_PIN_%u }%s   //!< COL%u\n", 'A' + gsLayout.asColumns[ u8Column ].u8Port, gsLayout.asColumns[ u8Column ].u8Pin,
+             ( ( u8Column + 1u ) < gsLayout.u8Columns ) ? "," : " ", u8Column );
+  }
+  fprintf( psFile, "};\n\n" );
+
+  // port images
+  fprintf( psFile, "//! \\brief Ports of the columns\n"
+                   "GPIO_TypeDef* const gcapsColumnPorts[ LAYOUT_COLUMN_PORTS ] = {" );
+  for( u8Port = 0u; u8Port < gsLayout.u8Ports; u8Port++ )
+  {
+    fprintf( psFile, " GPIO%c%s", 'A' + gsLayout.au8Ports[ u8Port ], ( ( u8Port + 1u ) < gsLayout.u8Ports ) ? "," : "" );
+  }
+  fprintf( psFile, " };\n\n"
+                   "//! \\brief Column pins of the ports\n"
+                   "const U8 gcau8ColumnPortMask[ LAYOUT_COLUMN_PORTS ] = {" );
+  for( u8Port = 0u; u8Port < gsLayout.u8Ports; u8Port++ )
+  {
+    u8Image = 0u;
+    for( u8Column = 0u; u8Column < gsLayout.u8Columns; u8Column++ )
+    {
+      u8Image |= ( gsLayout.asColumns[ u8Column ].u8Port == gsLayout.au8Ports[ u8Port ] ) ? (U8)( 1u << gsLayout.asColumns[ u8Column ].u8Pin ) : 0u;
+    }
+    fprintf( psFile, " 0x%02Xu%s", u8Image, ( ( u8Port + 1u ) < gsLayout.u8Ports ) ? "," : "" );
+  }
+  fprintf( psFile, " };\n\n"
+                   "//! \\brief Column pins of the ports, while a column is selected (driven low, the others are released)\n"
+                   "const U8 gcau8ColumnPortImage[ LAYOUT_COLS ][ LAYOUT_COLUMN_PORTS ] =\n"
+                   "{\n"
+                   "//" );
+  for( u8Port = 0u; u8Port < gsLayout.u8Ports; u8Port++ )
+  {
+    fprintf( psFile, "  GPIO%c", 'A' + gsLayout.au8Ports[ u8Port ] );
+  }
+  fprintf( psFile, "\n" );
+  for( u8Column = 0u; u8Column < gsLayout.u8Columns; u8Column++ )
+  {
+    fprintf( psFile, "  {" );
+    for( u8Port = 0u; u8Port < gsLayout.u8Ports; u8Port++ )
+    {
+      u8Image = 0u;
+      for( u8Row = 0u; u8Row < gsLayout.u8Columns; u8Row++ )  // the other columns
+      {
+        u8Image |= ( ( u8Row != u8Column ) && ( gsLayout.asColumns[ u8Row ].u8Port == gsLayout.au8Ports[ u8Port ] ) ) ? (U8)( 1u << gsLayout.asColumns[ u8Row ].u8Pin ) : 0u;
+      }
+      fprintf( psFile, " 0x%02Xu%s", u8Image, ( ( u8Port + 1u ) < gsLayout.u8Ports ) ? "," : "" );
+    }
+    fprintf( psFile, " }%s  // COL%u\n", ( ( u8Column + 1u ) < gsLayout.u8Columns ) ? "," : " ", u8Column );
+  }
+  fprintf( psFile, "};\n\n\n" );
+
+  WriteReadRows( psFile );
+  fprintf( psFile, "#endif // LAYOUT_PROFILE_%s\n"
+                   "/******************************<EOF>**********************************/\n", gsLayout.acProfile );
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: layoutc [-c profile.c] [-h profile.h] layouts/profile.layout\n"
+                   "       without outputs, the description is only checked; the name of the file is the name of the profile\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  const char* pcSourceFile = NULL;
+  const char* pcHeaderFile = NULL;
+  const char* pcName;
+  size_t uIndex, uLength;
+  char  acLine[ LAYOUTC_LINE_SIZE ];
+  FILE* psFile;
+  int   iArg;
+  int   iRet = EXIT_SUCCESS;
+
+  for( iArg = 1; ( iArg < argc ) && ( '-' == argv[ iArg ][ 0 ] ); iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-c" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcSourceFile = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-h" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcHeaderFile = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  if( ( iArg + 1 ) != argc )
+  {
+    Usage();
+  }
+
+  // the source file is named relative to fw/ in the generated files
+  gsLayout.pcSource = ( NULL != strstr( argv[ iArg ], "layouts/" ) ) ? strstr( argv[ iArg ], "layouts/" ) : argv[ iArg ];
+  memset( gsLayout.au8ScanCode, LAYOUTC_NO_KEY, sizeof( gsLayout.au8ScanCode ) );
+  memset( gsLayout.au8Position, LAYOUTC_NO_KEY, sizeof( gsLayout.au8Position ) );
+  memset( gsLayout.au8KeyIndex, LAYOUTC_NO_KEY, sizeof( gsLayout.au8KeyIndex ) );
+  gsLayout.u8Samples = LAYOUTC_SAMPLES;
+  gsLayout.bDiodes = TRUE;
+
+  // the profile is named after the file: layouts/a500_de.layout --> LAYOUT_PROFILE_A500_DE
+  pcName = ( NULL != strrchr( argv[ iArg ], '/' ) ) ? ( strrchr( argv[ iArg ], '/' ) + 1 ) : argv[ iArg ];
+  uLength = strcspn( pcName, "." );
+  for( uIndex = 0u; ( uIndex < uLength ) && ( uIndex < ( LAYOUTC_ID_SIZE - 1u ) ); uIndex++ )
+  {
+    gsLayout.acFile[ uIndex ] = pcName[ uIndex ];
+    gsLayout.acProfile[ uIndex ] = (char)toupper( (unsigned char)pcName[ uIndex ] );
+  }
+  psFile = fopen( argv[ iArg ], "r" );
+  if( NULL == psFile )
+  {
+    perror( argv[ iArg ] );
+    exit( EXIT_FAILURE );
+  }
+  while( NULL != fgets( acLine, sizeof( acLine ), psFile ) )
+  {
+    gu32Line++;
+    ParseLine( acLine );
+  }
+  fclose( psFile );
+  Check();
+
+  if( TRUE == gbErrors )
+  {
+    iRet = EXIT_FAILURE;
+  }
+  else
+  {
+    if( NULL != pcHeaderFile )
+    {
+      psFile = fopen( pcHeaderFile, "w" );
+      if( NULL != psFile )
+      {
+        pcName = ( NULL != strrchr( pcHeaderFile, '/' ) ) ? ( strrchr( pcHeaderFile, '/' ) + 1 ) : pcHeaderFile;
+        WriteHeader( psFile, pcName );
+        fclose( psFile );
+      }
+      else
+      {
+        perror( pcHeaderFile );
+        iRet = EXIT_FAILURE;
+      }
+    }
+    if( NULL != pcSourceFile )
+    {
+      psFile = fopen( pcSourceFile, "w" );
+      if( NULL != psFile )
+      {
+        pcName = ( NULL != strrchr( pcSourceFile, '/' ) ) ? ( strrchr( pcSourceFile, '/' ) + 1 ) : pcSourceFile;
+        WriteSource( psFile, pcName );
+        fclose( psFile );
+      }
+      else
+      {
+        perror( pcSourceFile );
+        iRet = EXIT_FAILURE;
+      }
+    }
+    printf( "%s: %u keys, %u chords, %ux%u matrix, %u column ports\n", gsLayout.acName, gsLayout.u8Keys, gsLayout.u8Chords,
+            gsLayout.u8Rows, gsLayout.u8Columns, gsLayout.u8Ports );
+  }
+
+  return iRet;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,456 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file macro.c
+*
+* \brief Host simulation -- key sequence macros: a text is recorded with the record chord, then played back with the
+*        play chord at several pacings, and once more through the scancode FIFO. Sustained rate of the codes at the
+*        virtual computer, and the codes compared with the typed ones. A key typed during a playback must be sent
+*        between two codes of the macro.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "stm8s.h"
+#include "eeprom_map.h"
+#include "config.h"
+#include "macro.h"
+#include "amiga_key.h"
+#include "sim.h"
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define MACRO_BOOT_TIME       SIM_S( 1 )     //!< Power-up and init key stream, before the first key
+#define MACRO_KEY_PERIOD      SIM_MS( 150 )  //!< Start of a character --> start of the next one
+#define MACRO_SHIFT_LEAD      SIM_MS( 20 )   //!< Shift pressed before the key
+#define MACRO_HOLD_TIME       SIM_MS( 80 )   //!< Key or chord pressed
+#define MACRO_SETTLE_TIME     SIM_MS( 500 )  //!< After a chord or a playback: codes sent, EEPROM written
+#define MACRO_PLAY_TIMEOUT    SIM_S( 5 )
+#define MACRO_RUN_MAX         8u             //!< Pacings measured
+#define MACRO_CODE_BUFFER     256u
+#define MACRO_LIVE_ACK_WIDTH  SIM_MS( 2 )    //!< Slow handshake during the live key: the playback lasts ~60 ms
+#define MACRO_LIVE_LEAD       SIM_MS( 10 )   //!< Start of the playback --> the live key pressed
+
+// Amiga key codes of the chords
+#define MACRO_SCANCODE_LAMIGA 0x66u
+#define MACRO_SCANCODE_RAMIGA 0x67u
+#define MACRO_SCANCODE_F9     0x58u
+#define MACRO_SCANCODE_F10    0x59u
+#define MACRO_SCANCODE_LIVE   0x50u          //!< F1: typed during the playback, not part of any text
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Codes received during a phase
+typedef struct
+{
+  U8       au8Raw[ MACRO_CODE_BUFFER ];  //!< In the communication format: code << 1, bit 0 set on release
+  SIM_TIME au64Time[ MACRO_CODE_BUFFER ];
+  U32      u32Count;
+} S_MACRO_CODES;
+
+//! \brief Result of a playback
+typedef struct
+{
+  const char* pcPath;
+  U8       u8Pacing;      //!< Scans between two codes
+  U32      u32Codes;
+  double   dFirstMs;      //!< Start --> first code
+  double   dSpanMs;       //!< First code --> last code
+  BOOL     bMatch;        //!< The codes are the ones of the macro
+} S_MACRO_RUN;
+
+//! \brief Result of the playback with a key typed meanwhile
+typedef struct
+{
+  double   dPressMs;      //!< Start of the playback --> the key pressed
+  double   dLatencyMs;    //!< The key pressed --> its code received (negative: not received)
+  U32      u32After;      //!< Codes of the macro received after the code of the key
+  BOOL     bMatch;        //!< Without the codes of the key, the codes are the ones of the macro
+} S_MACRO_LIVE;
+
+//! \brief Codes registered into the scancode FIFO at the next matrix interrupt
+typedef struct
+{
+  const U8* pu8Code;      //!< In the communication format
+  U8       u8Count;       //!< In: codes to register; out: codes the FIFO took
+  SIM_TIME u64Time;       //!< When they were registered
+  BOOL     bDone;
+} S_MACRO_BURST;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void PressChord( U8 u8ScanCode );
+static SIM_TIME PlanText( const char* pcText, SIM_TIME u64Start );
+static BOOL IsChordCode( U8 u8Raw );
+static void Collect( S_SIM_CIA* psCia, S_MACRO_CODES* psCodes, BOOL bSkipChords );
+static void Measure( S_MACRO_RUN* psRun, const S_MACRO_CODES* psCodes, SIM_TIME u64Start, const U8* pu8Macro, U8 u8Count );
+static void RegisterBurst( void* pvContext, BOOL bEntry, SIM_TIME u64Now );
+static void MeasureLive( S_MACRO_LIVE* psLive, const S_MACRO_CODES* psCodes, SIM_TIME u64Press, const U8* pu8Macro, U8 u8Count );
+static void Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  LAmiga + RAmiga + the key, then releasing all of them
+ * \param  u8ScanCode: the third key of the chord
+ *********************************************************************/
+static void PressChord( U8 u8ScanCode )
+{
+  U8 au8Row[ 3 ], au8Column[ 3 ];
+
+  Sim_Keys_Find( MACRO_SCANCODE_LAMIGA, &au8Row[ 0 ], &au8Column[ 0 ] );
+  Sim_Keys_Find( MACRO_SCANCODE_RAMIGA, &au8Row[ 1 ], &au8Column[ 1 ] );
+  Sim_Keys_Find( u8ScanCode, &au8Row[ 2 ], &au8Column[ 2 ] );
+  Sim_SetKey( au8Row[ 0 ], au8Column[ 0 ], TRUE );
+  Sim_SetKey( au8Row[ 1 ], au8Column[ 1 ], TRUE );
+  Sim_RunFor( MACRO_HOLD_TIME );
+  Sim_SetKey( au8Row[ 2 ], au8Column[ 2 ], TRUE );
+  Sim_RunFor( MACRO_HOLD_TIME );
+  Sim_SetKey( au8Row[ 2 ], au8Column[ 2 ], FALSE );
+  Sim_SetKey( au8Row[ 1 ], au8Column[ 1 ], FALSE );
+  Sim_SetKey( au8Row[ 0 ], au8Column[ 0 ], FALSE );
+}
+
+/*! *******************************************************************
+ * \brief  Schedules the edges of a text
+ * \param  pcText: characters, see Sim_Keys_FromChar()
+ * \param  u64Start: first edge
+ * \return Time of the last edge
+ *********************************************************************/
+static SIM_TIME PlanText( const char* pcText, SIM_TIME u64Start )
+{
+  SIM_TIME u64Time = u64Start;
+  U8   u8ScanCode, u8Row, u8Column, u8ShiftRow, u8ShiftColumn;
+  BOOL bShift;
+
+  Sim_Keys_Find( SIM_SCANCODE_LSHIFT, &u8ShiftRow, &u8ShiftColumn );
+  for( ; '\0' != *pcText; pcText++ )
+  {
+    if( ( TRUE == Sim_Keys_FromChar( *pcText, &u8ScanCode, &bShift ) ) && ( TRUE == Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column ) ) )
+    {
+      if( TRUE == bShift )
+      {
+        Sim_Keys_ScheduleEdge( u64Time, u8ShiftRow, u8ShiftColumn, TRUE, 0u );
+        Sim_Keys_ScheduleEdge( u64Time + MACRO_SHIFT_LEAD + MACRO_HOLD_TIME + MACRO_SHIFT_LEAD, u8ShiftRow, u8ShiftColumn, FALSE, 0u );
+      }
+      Sim_Keys_ScheduleEdge( u64Time + MACRO_SHIFT_LEAD, u8Row, u8Column, TRUE, 0u );
+      Sim_Keys_ScheduleEdge( u64Time + MACRO_SHIFT_LEAD + MACRO_HOLD_TIME, u8Row, u8Column, FALSE, 0u );
+    }
+    else
+    {
+      fprintf( stderr, "macro: '%c' cannot be typed, skipped\n", *pcText );
+    }
+    u64Time += MACRO_KEY_PERIOD;
+  }
+
+  return u64Time;
+}
+
+/*! *******************************************************************
+ * \brief  Is the code one of the keys of the macro chords?
+ * \param  u8Raw: code in the communication format
+ * \return TRUE, if it belongs to LAmiga, RAmiga, F9 or F10
+ *********************************************************************/
+static BOOL IsChordCode( U8 u8Raw )
+{
+  U8 u8Code = u8Raw >> 1u;
+
+  return ( ( MACRO_SCANCODE_LAMIGA == u8Code ) || ( MACRO_SCANCODE_RAMIGA == u8Code )
+        || ( MACRO_SCANCODE_F9 == u8Code ) || ( MACRO_SCANCODE_F10 == u8Code ) ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Reads the codes received by the computer
+ * \param  psCia: the port
+ * \param  psCodes: the codes are appended here
+ * \param  bSkipChords: TRUE, if the codes of the keys of the chords are dropped
+ *********************************************************************/
+static void Collect( S_SIM_CIA* psCia, S_MACRO_CODES* psCodes, BOOL bSkipChords )
+{
+  S_SIM_CIA_CODE sCode;
+
+  while( TRUE == Sim_Cia_Read( psCia, &sCode ) )
+  {
+    if( ( psCodes->u32Count < MACRO_CODE_BUFFER ) && ( ( FALSE == bSkipChords ) || ( FALSE == IsChordCode( sCode.u8Raw ) ) ) )
+    {
+      psCodes->au8Raw[ psCodes->u32Count ]   = sCode.u8Raw;
+      psCodes->au64Time[ psCodes->u32Count ] = sCode.u64Time;
+      psCodes->u32Count++;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Evaluates the codes of a playback
+ * \param  psRun: the result is put here
+ * \param  psCodes: codes received during the playback
+ * \param  u64Start: start of the playback (the chord released, or the codes registered)
+ * \param  pu8Macro: expected codes
+ * \param  u8Count: number of expected codes
+ *********************************************************************/
+static void Measure( S_MACRO_RUN* psRun, const S_MACRO_CODES* psCodes, SIM_TIME u64Start, const U8* pu8Macro, U8 u8Count )
+{
+  psRun->u32Codes = psCodes->u32Count;
+  psRun->bMatch   = ( ( psCodes->u32Count == u8Count ) && ( 0 == memcmp( psCodes->au8Raw, pu8Macro, u8Count ) ) ) ? TRUE : FALSE;
+  psRun->dFirstMs = 0.0;
+  psRun->dSpanMs  = 0.0;
+  if( 0u != psCodes->u32Count )
+  {
+    psRun->dFirstMs = SIM_TO_US( psCodes->au64Time[ 0 ] - u64Start ) / 1000.0;
+    psRun->dSpanMs  = SIM_TO_US( psCodes->au64Time[ psCodes->u32Count - 1u ] - psCodes->au64Time[ 0 ] ) / 1000.0;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Interrupt hook: registers the codes of a burst, as the matrix interrupt would
+ * \param  pvContext: the burst
+ * \param  bEntry: TRUE at the entry of the interrupt
+ * \param  u64Now: current time
+ * \note   The firmware can only be called from its own context, so the host cannot register the codes.
+ *********************************************************************/
+static void RegisterBurst( void* pvContext, BOOL bEntry, SIM_TIME u64Now )
+{
+  S_MACRO_BURST* psBurst = (S_MACRO_BURST*)pvContext;
+  U8 u8Index;
+
+  if( ( TRUE == bEntry ) && ( FALSE == psBurst->bDone ) )
+  {
+    for( u8Index = 0u; u8Index < psBurst->u8Count; u8Index++ )
+    {
+      if( FALSE == AmigaKey_RegisterScanCode( psBurst->pu8Code[ u8Index ] >> 1u, ( 0u == ( psBurst->pu8Code[ u8Index ] & 1u ) ) ? TRUE : FALSE ) )
+      {
+        psBurst->u8Count = u8Index;  // the FIFO is full, only the registered codes are expected
+      }
+    }
+    psBurst->u64Time = u64Now;
+    psBurst->bDone   = TRUE;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Evaluates the codes of a playback, with the live key typed meanwhile
+ * \param  psLive: the result is put here (dPressMs is set by the caller)
+ * \param  psCodes: codes received during the playback
+ * \param  u64Press: the live key pressed
+ * \param  pu8Macro: expected codes of the macro
+ * \param  u8Count: number of expected codes
+ *********************************************************************/
+static void MeasureLive( S_MACRO_LIVE* psLive, const S_MACRO_CODES* psCodes, SIM_TIME u64Press, const U8* pu8Macro, U8 u8Count )
+{
+  U8   au8Macro[ MACRO_CODE_BUFFER ];
+  U32  u32Index;
+  U32  u32Macro = 0u;
+  BOOL bPressed = FALSE;
+
+  psLive->dLatencyMs = -1.0;
+  psLive->u32After   = 0u;
+  for( u32Index = 0u; u32Index < psCodes->u32Count; u32Index++ )
+  {
+    if( MACRO_SCANCODE_LIVE == ( psCodes->au8Raw[ u32Index ] >> 1u ) )
+    {
+      if( ( 0u == ( psCodes->au8Raw[ u32Index ] & 1u ) ) && ( FALSE == bPressed ) )
+      {
+        psLive->dLatencyMs = SIM_TO_US( psCodes->au64Time[ u32Index ] - u64Press ) / 1000.0;
+        bPressed = TRUE;
+      }
+    }
+    else
+    {
+      au8Macro[ u32Macro ] = psCodes->au8Raw[ u32Index ];
+      u32Macro++;
+      psLive->u32After += ( TRUE == bPressed ) ? 1u : 0u;
+    }
+  }
+  psLive->bMatch = ( ( u32Macro == u8Count ) && ( 0 == memcmp( au8Macro, pu8Macro, u8Count ) ) ) ? TRUE : FALSE;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: macro [-t text] [-p pacing[,pacing...]] [-a ack_us]\n"
+                   "  -t  text typed while recording (default \"Hello world\")\n"
+                   "  -p  pacings of the playbacks, in scans of 5 ms (default 0,1,4)\n"
+                   "  -a  length of the handshake of the computer (default %u us)\n", (unsigned)( SIM_CIA_ACK_WIDTH / SIM_US( 1 ) ) );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  static S_SIM_CIA     sCia;
+  static S_MACRO_CODES sCodes;
+  static S_MACRO_RUN   asRuns[ MACRO_RUN_MAX + 1u ];
+  const char* pcText = "Hello world";
+  const char* pcPacing = "0,1,4";
+  char*    pcEnd;
+  U8       au8Pacing[ MACRO_RUN_MAX ];
+  U8       au8Macro[ MACRO_CODE_MAX ] = { 0u };
+  S_MACRO_BURST sBurst;
+  S_MACRO_LIVE  sLive;
+  SIM_TIME u64Press;
+  SIM_TIME u64AckWidth;
+  U8       u8LiveRow, u8LiveColumn;
+  U32      u32Runs = 0u;
+  U32      u32Index;
+  U8       u8Count;
+  SIM_TIME u64Start;
+  BOOL     bStored;
+  BOOL     bOk;
+  int      iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-t" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcText = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-p" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcPacing = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-a" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      sCia.u64AckWidth = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  while( ( '\0' != *pcPacing ) && ( u32Runs < MACRO_RUN_MAX ) )
+  {
+    au8Pacing[ u32Runs ] = (U8)strtoul( pcPacing, &pcEnd, 0 );
+    u32Runs++;
+    pcPacing = ( ',' == *pcEnd ) ? ( pcEnd + 1 ) : pcEnd;
+    if( ( pcEnd == pcPacing ) && ( '\0' != *pcEnd ) )
+    {
+      Usage();
+    }
+  }
+
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &sCia );
+  Sim_RunUntil( MACRO_BOOT_TIME );
+  Collect( &sCia, &sCodes, FALSE );  // init key stream
+
+  // recording: the codes sent meanwhile are the reference, without the keys of the chords
+  memset( &sCodes, 0x00, sizeof( sCodes ) );
+  PressChord( MACRO_SCANCODE_F9 );
+  Sim_RunFor( MACRO_SETTLE_TIME );
+  Sim_RunUntil( PlanText( pcText, Sim_GetTime() ) + MACRO_SETTLE_TIME );
+  PressChord( MACRO_SCANCODE_F9 );
+  Sim_RunFor( MACRO_SETTLE_TIME );
+  Collect( &sCia, &sCodes, TRUE );
+
+  // the stored macro, as the firmware will load it at the next power-up
+  u8Count = gsSimMemory.au8Eeprom[ EEPROM_MACRO_ADDRESS - SIM_EEPROM_ADDRESS ];
+  bStored = ( u8Count <= MACRO_CODE_MAX ) ? TRUE : FALSE;
+  u8Count = ( TRUE == bStored ) ? u8Count : 0u;
+  memcpy( au8Macro, &gsSimMemory.au8Eeprom[ EEPROM_MACRO_ADDRESS + 2u - SIM_EEPROM_ADDRESS ], u8Count );
+  bStored = ( ( TRUE == bStored ) && ( u8Count == sCodes.u32Count ) && ( 0 == memcmp( au8Macro, sCodes.au8Raw, u8Count ) ) ) ? TRUE : FALSE;
+
+  // playbacks, streamed into the transmit engine
+  for( u32Index = 0u; u32Index < u32Runs; u32Index++ )
+  {
+    Config_Write( CONFIG_KEY_MACRO_PACING, au8Pacing[ u32Index ] );
+    Sim_RunFor( MACRO_SETTLE_TIME );
+    Collect( &sCia, &sCodes, FALSE );
+    PressChord( MACRO_SCANCODE_F10 );
+    u64Start = Sim_GetTime();  // the playback starts, when the keys of the chord are released
+    Sim_RunFor( MACRO_SETTLE_TIME );
+    while( ( TRUE == Macro_IsPlaying() ) && ( ( Sim_GetTime() - u64Start ) < MACRO_PLAY_TIMEOUT ) )
+    {
+      Sim_RunFor( MACRO_SETTLE_TIME );
+    }
+    memset( &sCodes, 0x00, sizeof( sCodes ) );
+    Collect( &sCia, &sCodes, TRUE );  // without the releases of the chord
+    asRuns[ u32Index ].pcPath   = "stream";
+    asRuns[ u32Index ].u8Pacing = au8Pacing[ u32Index ];
+    Measure( &asRuns[ u32Index ], &sCodes, u64Start, au8Macro, u8Count );
+  }
+
+  // a key typed during the playback: the matrix is scanned between two codes, so its code is sent before the next
+  // code of the macro -- with a slow handshake, so that the playback lasts longer than the debounce of the key
+  Config_Write( CONFIG_KEY_MACRO_PACING, 0u );
+  u64AckWidth = sCia.u64AckWidth;
+  sCia.u64AckWidth = MACRO_LIVE_ACK_WIDTH;
+  Sim_RunFor( MACRO_SETTLE_TIME );
+  Collect( &sCia, &sCodes, FALSE );
+  PressChord( MACRO_SCANCODE_F10 );
+  u64Start = Sim_GetTime();
+  while( ( FALSE == Macro_IsPlaying() ) && ( ( Sim_GetTime() - u64Start ) < MACRO_PLAY_TIMEOUT ) )
+  {
+    Sim_RunFor( SIM_US( 100 ) );
+  }
+  Sim_RunFor( MACRO_LIVE_LEAD );
+  Sim_Keys_Find( MACRO_SCANCODE_LIVE, &u8LiveRow, &u8LiveColumn );
+  Sim_SetKey( u8LiveRow, u8LiveColumn, TRUE );
+  u64Press = Sim_GetTime();
+  sLive.dPressMs = SIM_TO_US( u64Press - u64Start ) / 1000.0;
+  Sim_RunFor( MACRO_HOLD_TIME );
+  Sim_SetKey( u8LiveRow, u8LiveColumn, FALSE );
+  Sim_RunFor( MACRO_SETTLE_TIME );
+  memset( &sCodes, 0x00, sizeof( sCodes ) );
+  Collect( &sCia, &sCodes, TRUE );
+  MeasureLive( &sLive, &sCodes, u64Press, au8Macro, u8Count );
+  sCia.u64AckWidth = u64AckWidth;
+
+  // the same codes through the scancode FIFO, registered at once -- as many, as it can take
+  memset( &sCodes, 0x00, sizeof( sCodes ) );
+  sBurst.pu8Code = au8Macro;
+  sBurst.u8Count = u8Count;
+  sBurst.bDone   = FALSE;
+  Sim_SetInterruptHook( RegisterBurst, &sBurst );
+  Sim_RunFor( MACRO_SETTLE_TIME );
+  Sim_SetInterruptHook( NULL, NULL );
+  Collect( &sCia, &sCodes, FALSE );
+  asRuns[ u32Runs ].pcPath   = "fifo";
+  asRuns[ u32Runs ].u8Pacing = 0u;
+  Measure( &asRuns[ u32Runs ], &sCodes, sBurst.u64Time, au8Macro, sBurst.u8Count );
+
+  printf( "text:           \"%s\"\n", pcText );
+  printf( "macro:          %u codes stored in the data EEPROM at 0x%04X -- %s\n", u8Count, (unsigned)EEPROM_MACRO_ADDRESS,
+          ( TRUE == bStored ) ? "same as typed" : "DIFFERENT FROM THE TYPED CODES" );
+  printf( "handshake:      %.0f us\n\n", SIM_TO_US( ( 0u != sCia.u64AckWidth ) ? sCia.u64AckWidth : SIM_CIA_ACK_WIDTH ) );
+  printf( "%-8s %8s %6s %10s %10s %9s  %s\n", "path", "pacing", "codes", "first ms", "span ms", "codes/s", "codes" );
+  bOk = bStored;
+  for( u32Index = 0u; u32Index <= u32Runs; u32Index++ )
+  {
+    printf( "%-8s %5u ms %6lu %10.2f %10.2f %9.0f  %s\n", asRuns[ u32Index ].pcPath, asRuns[ u32Index ].u8Pacing * 5u,
+            (unsigned long)asRuns[ u32Index ].u32Codes, asRuns[ u32Index ].dFirstMs, asRuns[ u32Index ].dSpanMs,
+            ( asRuns[ u32Index ].dSpanMs > 0.0 ) ? ( 1000.0 * ( asRuns[ u32Index ].u32Codes - 1u ) / asRuns[ u32Index ].dSpanMs ) : 0.0,
+            ( TRUE == asRuns[ u32Index ].bMatch ) ? "match" : "MISMATCH" );
+    bOk = ( TRUE == asRuns[ u32Index ].bMatch ) ? bOk : FALSE;
+  }
+
+  printf( "\ntyped during the playback (%.0f us handshake): F1 pressed %.2f ms after the chord, sent %.2f ms later, "
+          "%lu codes of the macro after it -- %s\n", SIM_TO_US( MACRO_LIVE_ACK_WIDTH ), sLive.dPressMs, sLive.dLatencyMs,
+          (unsigned long)sLive.u32After,
+          ( FALSE == sLive.bMatch ) ? "MACRO MISMATCH" : ( ( sLive.dLatencyMs < 0.0 ) ? "NOT SENT" : ( ( 0u == sLive.u32After ) ? "SENT AFTER THE MACRO" : "ok" ) ) );
+  bOk = ( ( TRUE == sLive.bMatch ) && ( sLive.dLatencyMs >= 0.0 ) && ( 0u != sLive.u32After ) ) ? bOk : FALSE;
+
+  return ( ( TRUE == bOk ) && ( 0u != u8Count ) ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
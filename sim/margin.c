@@ -0,0 +1,808 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file margin.c
+*
+* \brief Host simulation -- Monte Carlo timing margin explorer: sweeps the handshake, host stall, bounce,
+*        scan period and CPU clock parameters on all cores, and maps where resyncs, missed handshakes and
+*        lost key codes start
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "stm8s.h"
+#include "types.h"
+#include "trace.h"
+#include "matrix.h"
+#include "sim.h"
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define MARGIN_BOOT_TIME      SIM_S( 1 )     //!< Power-up and init key stream, before the first key
+#define MARGIN_DRAIN_TIME     SIM_S( 1 )     //!< Run after the last key, until the FIFO is empty
+#define MARGIN_HOLD_MIN       40u            //!< Key hold time: 40..100 ms
+#define MARGIN_HOLD_SPAN      60u
+#define MARGIN_GAP_MIN        30u            //!< Settled release --> next press: 30..90 ms
+#define MARGIN_GAP_SPAN       60u
+#define MARGIN_STALL_PCT      50u            //!< Keys with a host stall during their codes
+#define MARGIN_KEYS_MAX       64u
+#define MARGIN_CODES_MAX      ( 4u * MARGIN_KEYS_MAX )  //!< Received codes compared, the rest counts as extra
+#define MARGIN_AXIS_MAX       64u            //!< Steps of a map axis
+#define MARGIN_RUN_TIMEOUT    60u            //!< A run is killed after this many seconds of wall time
+#define MARGIN_SEED_STRIDE    7919u          //!< Seed of a run: seed + run * stride
+
+// Parameters
+#define MARGIN_PARAM_WIDTH    0u   //!< Handshake length [us]
+#define MARGIN_PARAM_DELAY    1u   //!< Last bit --> handshake [us]
+#define MARGIN_PARAM_STALL    2u   //!< Host stall [ms]
+#define MARGIN_PARAM_BOUNCE   3u   //!< Contact chatter [us]
+#define MARGIN_PARAM_SCAN     4u   //!< TIM2 period, one column [us at 16 MHz]
+#define MARGIN_PARAM_FCPU     5u   //!< Real frequency of the HSI oscillator [MHz]
+#define MARGIN_PARAM_COUNT    6u
+
+// Raw bytes, that are not key codes
+#define MARGIN_RAW_SYNC       0xFFu
+#define MARGIN_RAW_LOST_SYNC  0xF3u  //!< "Last key code bad" (0xF9) as shifted in
+#define MARGIN_RAW_INIT       0xFBu
+#define MARGIN_RAW_TERM       0xFDu
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A swept parameter
+typedef struct
+{
+  const char* pcName;
+  const char* pcUnit;
+  double      dDefault;
+} S_MARGIN_PARAM;
+
+//! \brief Value range of a parameter -- a map axis is stepped, the others are drawn uniformly for every run
+typedef struct
+{
+  double dMin;
+  double dMax;
+  U32    u32Steps;
+} S_MARGIN_RANGE;
+
+//! \brief Run queue of a worker -- the owner takes from the bottom, the others steal from the top
+typedef struct
+{
+  long lTop;
+  long lBottom;
+  U32  u32First;     //!< First run of the worker in the job array
+  U32  u32Executed;
+  U32  u32Steals;
+} S_MARGIN_DEQUE;
+
+//! \brief Outcome of one run
+typedef struct
+{
+  BOOL bDone;
+  BOOL bCrashed;       //!< The simulation died or timed out
+  U32  u32Codes;       //!< Key codes expected
+  U32  u32Resyncs;     //!< Resynchronizations after the power-up
+  U32  u32Retransmits; //!< "Last key code bad" sent
+  U32  u32AcksMissed;  //!< Handshakes given, while the keyboard was not listening
+  U32  u32Lost;        //!< Expected key codes not received
+  U32  u32Extra;       //!< Received key codes not expected
+} S_MARGIN_RESULT;
+
+//! \brief Configuration and the memory shared with the workers
+typedef struct
+{
+  S_MARGIN_RANGE   asRange[ MARGIN_PARAM_COUNT ];
+  U8               u8AxisX;
+  U8               u8AxisY;
+  U32              u32Trials;  //!< Runs per cell of the map
+  U32              u32Keys;    //!< Keystrokes per run
+  U32              u32Seed;
+  U32              u32Workers;
+  U32              u32Runs;
+  S_MARGIN_DEQUE*  psDeque;    //!< Shared
+  U32*             pu32Job;    //!< Shared, runs in the order of the queues
+  S_MARGIN_RESULT* psResult;   //!< Shared, indexed by the run
+} S_MARGIN;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+static const S_MARGIN_PARAM gcasParam[ MARGIN_PARAM_COUNT ] =
+{
+  { "width",  "us",  85.0     },
+  { "delay",  "us",  1.0      },
+  { "stall",  "ms",  0.0      },
+  { "bounce", "us",  1500.0   },
+  { "scan",   "us",  MATRIX_TICK_CLOCKS / 16.0 },  // the sampling tick of main.c, 5001 clocks
+  { "fcpu",   "MHz", 16.0     }
+};
+
+static const char gcacKeys[] = "abcdefghijklmnopqrstuvwxyz";
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static S_MARGIN  gsMargin;
+static S_SIM_CIA gsCia;
+static double    gdFcpu = 16.0;       //!< Of the running simulation
+static U16       gu16Tim2Arr = MATRIX_TICK_RELOAD;
+static SIM_TIME  gu64Stall;
+static U32       gu32Resyncs;
+static U32       gu32Retransmits;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U32      Random( U32 u32Range );
+static SIM_TIME HostTime( double dUs );
+static double   GetParam( U32 u32Run, U8 u8Param );
+static void     Stall( void* pvContext, SIM_TIME u64Time );
+static U32      Compare( const U8* pu8Expected, U32 u32Expected, const U8* pu8Received, U32 u32Received );
+static void     Run( U32 u32Run, S_MARGIN_RESULT* psResult );
+static BOOL     TakeOwn( S_MARGIN_DEQUE* psDeque, U32* pu32Run );
+static BOOL     Steal( S_MARGIN_DEQUE* psDeque, U32* pu32Run );
+static void     Work( U32 u32Worker );
+static void     PrintMap( void );
+static void     WriteCsv( const char* pcFile );
+static U8       FindParam( const char* pcName );
+static void     ParseRange( const char* pcArg, U8* pu8Param, S_MARGIN_RANGE* psRange );
+static void     Usage( void );
+void            __real_Trace_Write( U8 u8Event, U8 u8Argument );
+void            __wrap_Trace_Write( U8 u8Event, U8 u8Argument );
+void            __real_TIM2_TimeBaseInit( TIM2_Prescaler_TypeDef TIM2_Prescaler, uint16_t TIM2_Period );
+void            __wrap_TIM2_TimeBaseInit( TIM2_Prescaler_TypeDef TIM2_Prescaler, uint16_t TIM2_Period );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Random number in 0..u32Range-1
+ *********************************************************************/
+static U32 Random( U32 u32Range )
+{
+  return ( 0u != u32Range ) ? ( ( ( (U32)Sim_Keys_Random() << 15u ) | Sim_Keys_Random() ) % u32Range ) : 0u;
+}
+
+/*! *******************************************************************
+ * \brief  Duration of the host side in virtual time
+ * \param  dUs: real time
+ * \return HSI periods -- the firmware counts these as 1/16 us, so a fast oscillator makes the host slower
+ *********************************************************************/
+static SIM_TIME HostTime( double dUs )
+{
+  return (SIM_TIME)( dUs * gdFcpu + 0.5 );
+}
+
+/*! *******************************************************************
+ * \brief  Value of a parameter in a run
+ * \param  u32Run: index of the run
+ * \param  u8Param: MARGIN_PARAM_x
+ * \return Step of the map axis, or a random value of the range (the generator must be seeded for the run)
+ *********************************************************************/
+static double GetParam( U32 u32Run, U8 u8Param )
+{
+  const S_MARGIN_RANGE* psRange = &gsMargin.asRange[ u8Param ];
+  U32    u32Cell = u32Run / gsMargin.u32Trials;
+  U32    u32Step = 0u;
+  double dRet = psRange->dMin;
+
+  if( ( u8Param == gsMargin.u8AxisX ) || ( u8Param == gsMargin.u8AxisY ) )
+  {
+    u32Step = ( u8Param == gsMargin.u8AxisX ) ? ( u32Cell % gsMargin.asRange[ gsMargin.u8AxisX ].u32Steps )
+                                              : ( u32Cell / gsMargin.asRange[ gsMargin.u8AxisX ].u32Steps );
+    if( 1u < psRange->u32Steps )
+    {
+      dRet += ( psRange->dMax - psRange->dMin ) * u32Step / ( psRange->u32Steps - 1u );
+    }
+  }
+  else if( psRange->dMax > psRange->dMin )
+  {
+    dRet += ( psRange->dMax - psRange->dMin ) * Random( 10001u ) / 10000.0;
+  }
+
+  return dRet;
+}
+
+/*! *******************************************************************
+ * \brief  Event: the host stops listening for a while
+ *********************************************************************/
+static void Stall( void* pvContext, SIM_TIME u64Time )
+{
+  (void)pvContext;
+  (void)u64Time;
+  Sim_Cia_Stall( &gsCia, gu64Stall );
+}
+
+/*! *******************************************************************
+ * \brief  Longest common subsequence of the expected and the received key codes
+ * \param  pu8Expected: raw codes
+ * \param  u32Expected: number of them (max. 2 * MARGIN_KEYS_MAX)
+ * \param  pu8Received: raw codes
+ * \param  u32Received: number of them (max. MARGIN_CODES_MAX)
+ * \return Number of codes received in the right order
+ *********************************************************************/
+static U32 Compare( const U8* pu8Expected, U32 u32Expected, const U8* pu8Received, U32 u32Received )
+{
+  static U16 au16Length[ 2u * MARGIN_KEYS_MAX + 1u ][ MARGIN_CODES_MAX + 1u ];
+  U32 u32E, u32R;
+
+  for( u32E = 0u; u32E <= u32Expected; u32E++ )
+  {
+    for( u32R = 0u; u32R <= u32Received; u32R++ )
+    {
+      if( ( 0u == u32E ) || ( 0u == u32R ) )
+      {
+        au16Length[ u32E ][ u32R ] = 0u;
+      }
+      else if( pu8Expected[ u32E - 1u ] == pu8Received[ u32R - 1u ] )
+      {
+        au16Length[ u32E ][ u32R ] = au16Length[ u32E - 1u ][ u32R - 1u ] + 1u;
+      }
+      else
+      {
+        au16Length[ u32E ][ u32R ] = ( au16Length[ u32E - 1u ][ u32R ] > au16Length[ u32E ][ u32R - 1u ] ) ?
+                                     au16Length[ u32E - 1u ][ u32R ] : au16Length[ u32E ][ u32R - 1u ];
+      }
+    }
+  }
+
+  return au16Length[ u32Expected ][ u32Received ];
+}
+
+/*! *******************************************************************
+ * \brief  One simulation from power-up -- runs in a child process, the firmware state is global
+ * \param  u32Run: index of the run, selects the parameters and the seed
+ * \param  psResult: shared result of the run
+ * \return -
+ * \note   Keys are typed one after the other (no rollover), so the order of the codes is known.
+ *********************************************************************/
+static void Run( U32 u32Run, S_MARGIN_RESULT* psResult )
+{
+  static U8 au8Expected[ 2u * MARGIN_KEYS_MAX ];
+  static U8 au8Received[ MARGIN_CODES_MAX ];
+  S_SIM_CIA_CODE sCode;
+  double   adParam[ MARGIN_PARAM_COUNT ];
+  SIM_TIME u64Press, u64Release, u64Bounce;
+  U32      u32Expected = 0u;
+  U32      u32Received = 0u;
+  U32      u32Extra = 0u;
+  U32      u32Key;
+  U8       u8Param, u8ScanCode, u8Row, u8Column;
+  BOOL     bShift;
+
+  Sim_Keys_Seed( gsMargin.u32Seed + u32Run * MARGIN_SEED_STRIDE );
+  for( u8Param = 0u; u8Param < MARGIN_PARAM_COUNT; u8Param++ )
+  {
+    adParam[ u8Param ] = GetParam( u32Run, u8Param );
+  }
+  gdFcpu = adParam[ MARGIN_PARAM_FCPU ];
+  gu16Tim2Arr = (U16)( adParam[ MARGIN_PARAM_SCAN ] * 16.0 + 0.5 ) - 1u;
+  gu64Stall = HostTime( adParam[ MARGIN_PARAM_STALL ] * 1000.0 );
+  u64Bounce = HostTime( adParam[ MARGIN_PARAM_BOUNCE ] );
+  gsCia.u64AckWidth = HostTime( adParam[ MARGIN_PARAM_WIDTH ] );
+  gsCia.u64AckWidth = ( 0u != gsCia.u64AckWidth ) ? gsCia.u64AckWidth : 1u;  // 0 would select the default
+  gsCia.u64AckDelay = HostTime( adParam[ MARGIN_PARAM_DELAY ] );
+
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &gsCia );
+  Sim_RunUntil( MARGIN_BOOT_TIME );  // the keymap is loaded by now
+  while( TRUE == Sim_Cia_Read( &gsCia, &sCode ) )
+  {
+    // init key stream
+  }
+  gu32Resyncs = 0u;
+  gu32Retransmits = 0u;
+  psResult->u32AcksMissed = gsCia.sStats.u32AcksMissed;
+
+  u64Press = Sim_GetTime() + HostTime( 10000.0 ) + u64Bounce;
+  for( u32Key = 0u; u32Key < gsMargin.u32Keys; u32Key++ )
+  {
+    Sim_Keys_FromChar( gcacKeys[ Random( sizeof( gcacKeys ) - 1u ) ], &u8ScanCode, &bShift );
+    Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column );
+    u64Release = u64Press + HostTime( 1000.0 * ( MARGIN_HOLD_MIN + Random( MARGIN_HOLD_SPAN ) ) );
+    Sim_Keys_ScheduleEdge( u64Press, u8Row, u8Column, TRUE, u64Bounce );
+    Sim_Keys_ScheduleEdge( u64Release, u8Row, u8Column, FALSE, u64Bounce );
+    au8Expected[ u32Expected++ ] = (U8)( u8ScanCode << 1u );
+    au8Expected[ u32Expected++ ] = (U8)( ( u8ScanCode << 1u ) | 0x01u );
+    if( ( 0u != gu64Stall ) && ( Random( 100u ) < MARGIN_STALL_PCT ) )
+    {
+      Sim_Event_Schedule( u64Press + Random( (U32)( u64Release - u64Press ) ), Stall, NULL );
+    }
+    u64Press = u64Release + u64Bounce + HostTime( 1000.0 * ( MARGIN_GAP_MIN + Random( MARGIN_GAP_SPAN ) ) );
+  }
+  Sim_RunUntil( u64Press + MARGIN_DRAIN_TIME + gu64Stall );
+
+  while( TRUE == Sim_Cia_Read( &gsCia, &sCode ) )
+  {
+    if( ( MARGIN_RAW_SYNC != sCode.u8Raw ) && ( MARGIN_RAW_LOST_SYNC != sCode.u8Raw )
+     && ( MARGIN_RAW_INIT != sCode.u8Raw ) && ( MARGIN_RAW_TERM != sCode.u8Raw ) )
+    {
+      if( u32Received < MARGIN_CODES_MAX )
+      {
+        au8Received[ u32Received++ ] = sCode.u8Raw;
+      }
+      else
+      {
+        u32Extra++;
+      }
+    }
+  }
+
+  psResult->u32Codes = u32Expected;
+  psResult->u32Resyncs = gu32Resyncs;
+  psResult->u32Retransmits = gu32Retransmits;
+  psResult->u32AcksMissed = gsCia.sStats.u32AcksMissed - psResult->u32AcksMissed;
+  psResult->u32Lost = u32Expected - Compare( au8Expected, u32Expected, au8Received, u32Received );
+  psResult->u32Extra = u32Extra + u32Received - ( u32Expected - psResult->u32Lost );
+  psResult->bDone = TRUE;
+}
+
+/*! *******************************************************************
+ * \brief  Takes a run from the bottom of the own queue
+ * \param  psDeque: queue of the worker
+ * \param  pu32Run: the run
+ * \return TRUE, if there was one
+ *********************************************************************/
+static BOOL TakeOwn( S_MARGIN_DEQUE* psDeque, U32* pu32Run )
+{
+  BOOL bRet = FALSE;
+  long lBottom = __atomic_load_n( &psDeque->lBottom, __ATOMIC_RELAXED ) - 1;
+  long lTop;
+
+  __atomic_store_n( &psDeque->lBottom, lBottom, __ATOMIC_SEQ_CST );
+  lTop = __atomic_load_n( &psDeque->lTop, __ATOMIC_SEQ_CST );
+  if( lTop < lBottom )
+  {
+    *pu32Run = gsMargin.pu32Job[ psDeque->u32First + (U32)lBottom ];
+    bRet = TRUE;
+  }
+  else
+  {
+    if( lTop == lBottom )  // the last one -- races with the thieves
+    {
+      *pu32Run = gsMargin.pu32Job[ psDeque->u32First + (U32)lBottom ];
+      bRet = ( 0 != __atomic_compare_exchange_n( &psDeque->lTop, &lTop, lTop + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) ? TRUE : FALSE;
+    }
+    __atomic_store_n( &psDeque->lBottom, lBottom + 1, __ATOMIC_SEQ_CST );  // empty: top == bottom
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Steals a run from the top of an other worker's queue
+ * \param  psDeque: queue of the victim
+ * \param  pu32Run: the run
+ * \return TRUE, if succeeded
+ * \note   There are no pushes after the start, so the entries are stable.
+ *********************************************************************/
+static BOOL Steal( S_MARGIN_DEQUE* psDeque, U32* pu32Run )
+{
+  BOOL bRet = FALSE;
+  BOOL bRetry = TRUE;
+  long lTop, lBottom;
+
+  while( TRUE == bRetry )
+  {
+    lTop = __atomic_load_n( &psDeque->lTop, __ATOMIC_SEQ_CST );
+    lBottom = __atomic_load_n( &psDeque->lBottom, __ATOMIC_SEQ_CST );
+    bRetry = FALSE;
+    if( lTop < lBottom )
+    {
+      *pu32Run = gsMargin.pu32Job[ psDeque->u32First + (U32)lTop ];
+      bRet = ( 0 != __atomic_compare_exchange_n( &psDeque->lTop, &lTop, lTop + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ) ? TRUE : FALSE;
+      bRetry = ( FALSE == bRet ) ? TRUE : FALSE;  // an other thief or the owner was faster
+    }
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Worker process: runs its own queue, then steals, until every queue is empty
+ * \param  u32Worker: index of the worker
+ * \return -
+ *********************************************************************/
+static void Work( U32 u32Worker )
+{
+  S_MARGIN_DEQUE* psOwn = &gsMargin.psDeque[ u32Worker ];
+  BOOL  bFound = TRUE;
+  U32   u32Run = 0u;
+  U32   u32Victim;
+  pid_t iChild;
+  int   iStatus;
+
+  while( TRUE == bFound )
+  {
+    bFound = TakeOwn( psOwn, &u32Run );
+    for( u32Victim = 1u; ( u32Victim < gsMargin.u32Workers ) && ( FALSE == bFound ); u32Victim++ )
+    {
+      bFound = Steal( &gsMargin.psDeque[ ( u32Worker + u32Victim ) % gsMargin.u32Workers ], &u32Run );
+      psOwn->u32Steals += ( TRUE == bFound ) ? 1u : 0u;
+    }
+
+    if( TRUE == bFound )
+    {
+      // every run starts from a fresh copy of the untouched simulation
+      iChild = fork();
+      if( 0 == iChild )
+      {
+        alarm( MARGIN_RUN_TIMEOUT );
+        Run( u32Run, &gsMargin.psResult[ u32Run ] );
+        _exit( EXIT_SUCCESS );
+      }
+      if( ( 0 > iChild ) || ( iChild != waitpid( iChild, &iStatus, 0 ) ) || ( FALSE == gsMargin.psResult[ u32Run ].bDone ) )
+      {
+        gsMargin.psResult[ u32Run ].bCrashed = TRUE;
+      }
+      psOwn->u32Executed++;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Prints the margin map: one character per cell, the worst outcome of its runs
+ * \note   X: a run crashed, L: lost or extra key codes, r: resync, m: missed handshake, .: clean
+ *********************************************************************/
+static void PrintMap( void )
+{
+  const S_MARGIN_RANGE* psX = &gsMargin.asRange[ gsMargin.u8AxisX ];
+  const S_MARGIN_RANGE* psY = &gsMargin.asRange[ gsMargin.u8AxisY ];
+  const S_MARGIN_RESULT* psResult;
+  U32  u32X, u32Y, u32Trial, u32Clean, u32First, u32Best, u32BestFirst;
+  U32  au32Count[ 4 ] = { 0u, 0u, 0u, 0u };
+  char cCell;
+  char acLabel[ 24 ];
+  U8   u8Param;
+  U8   u8Fixed = 0u;
+
+  printf( "runs:   %lu (%lu per cell, %lu keys each)\n", (unsigned long)gsMargin.u32Runs, (unsigned long)gsMargin.u32Trials,
+          (unsigned long)gsMargin.u32Keys );
+  printf( "fixed:  " );
+  for( u8Param = 0u; u8Param < MARGIN_PARAM_COUNT; u8Param++ )
+  {
+    if( ( u8Param != gsMargin.u8AxisX ) && ( u8Param != gsMargin.u8AxisY ) )
+    {
+      printf( "%s %s %g", ( 0u != u8Fixed++ ) ? "," : "", gcasParam[ u8Param ].pcName, gsMargin.asRange[ u8Param ].dMin );
+      if( gsMargin.asRange[ u8Param ].dMax > gsMargin.asRange[ u8Param ].dMin )
+      {
+        printf( "..%g", gsMargin.asRange[ u8Param ].dMax );  // random in every run
+      }
+      printf( " %s", gcasParam[ u8Param ].pcUnit );
+    }
+  }
+  snprintf( acLabel, sizeof( acLabel ), "%s [%s]", gcasParam[ gsMargin.u8AxisY ].pcName, gcasParam[ gsMargin.u8AxisY ].pcUnit );
+  printf( "\n\n%12s%s [%s] -->\n%-12s", "", gcasParam[ gsMargin.u8AxisX ].pcName, gcasParam[ gsMargin.u8AxisX ].pcUnit, acLabel );
+  for( u32X = 0u; u32X < psX->u32Steps; u32X++ )
+  {
+    printf( "%c", ( 0u == ( u32X % 5u ) ) ? '|' : ' ' );
+  }
+  printf( "  clean %s\n", gcasParam[ gsMargin.u8AxisX ].pcName );
+
+  for( u32Y = 0u; u32Y < psY->u32Steps; u32Y++ )
+  {
+    printf( "%11.4g ", GetParam( u32Y * psX->u32Steps * gsMargin.u32Trials, gsMargin.u8AxisY ) );
+    u32Clean = 0u;
+    u32First = 0u;
+    u32Best = 0u;
+    u32BestFirst = 0u;
+    for( u32X = 0u; u32X < psX->u32Steps; u32X++ )
+    {
+      cCell = '.';
+      for( u32Trial = 0u; u32Trial < gsMargin.u32Trials; u32Trial++ )
+      {
+        psResult = &gsMargin.psResult[ ( u32Y * psX->u32Steps + u32X ) * gsMargin.u32Trials + u32Trial ];
+        if( TRUE == psResult->bCrashed )
+        {
+          cCell = 'X';
+        }
+        else if( ( 0u != ( psResult->u32Lost + psResult->u32Extra ) ) && ( 'X' != cCell ) )
+        {
+          cCell = 'L';
+        }
+        else if( ( 0u != ( psResult->u32Resyncs + psResult->u32Retransmits ) ) && ( ( '.' == cCell ) || ( 'm' == cCell ) ) )
+        {
+          cCell = 'r';
+        }
+        else if( ( 0u != psResult->u32AcksMissed ) && ( '.' == cCell ) )
+        {
+          cCell = 'm';
+        }
+      }
+      au32Count[ ( 'X' == cCell ) ? 3u : ( ( 'L' == cCell ) ? 2u : ( ( '.' == cCell ) ? 0u : 1u ) ) ]++;
+
+      // longest run of clean cells in the row
+      u32First = ( 0u == u32Clean ) ? u32X : u32First;
+      u32Clean = ( '.' == cCell ) ? ( u32Clean + 1u ) : 0u;
+      if( u32Clean > u32Best )
+      {
+        u32Best = u32Clean;
+        u32BestFirst = u32First;
+      }
+      printf( "%c", cCell );
+    }
+    if( 0u != u32Best )
+    {
+      printf( "  %g..%g\n", GetParam( u32BestFirst * gsMargin.u32Trials, gsMargin.u8AxisX ),
+              GetParam( ( u32BestFirst + u32Best - 1u ) * gsMargin.u32Trials, gsMargin.u8AxisX ) );
+    }
+    else
+    {
+      printf( "  none\n" );
+    }
+  }
+  printf( "\ncells:  %lu clean (.), %lu resync or missed handshake (r, m), %lu lost or extra key codes (L), %lu crashed (X)\n",
+          (unsigned long)au32Count[ 0 ], (unsigned long)au32Count[ 1 ], (unsigned long)au32Count[ 2 ], (unsigned long)au32Count[ 3 ] );
+}
+
+/*! *******************************************************************
+ * \brief  Writes the result of every run as CSV
+ *********************************************************************/
+static void WriteCsv( const char* pcFile )
+{
+  FILE* psFile = fopen( pcFile, "w" );
+  const S_MARGIN_RESULT* psResult;
+  U32 u32Run;
+
+  if( NULL != psFile )
+  {
+    fprintf( psFile, "run,%s,%s,crashed,codes,resyncs,retransmits,acks_missed,lost,extra\n",
+             gcasParam[ gsMargin.u8AxisX ].pcName, gcasParam[ gsMargin.u8AxisY ].pcName );
+    for( u32Run = 0u; u32Run < gsMargin.u32Runs; u32Run++ )
+    {
+      psResult = &gsMargin.psResult[ u32Run ];
+      fprintf( psFile, "%lu,%g,%g,%u,%lu,%lu,%lu,%lu,%lu,%lu\n", (unsigned long)u32Run,
+               GetParam( u32Run, gsMargin.u8AxisX ), GetParam( u32Run, gsMargin.u8AxisY ), ( TRUE == psResult->bCrashed ) ? 1u : 0u,
+               (unsigned long)psResult->u32Codes, (unsigned long)psResult->u32Resyncs, (unsigned long)psResult->u32Retransmits,
+               (unsigned long)psResult->u32AcksMissed, (unsigned long)psResult->u32Lost, (unsigned long)psResult->u32Extra );
+    }
+    fclose( psFile );
+  }
+  else
+  {
+    fprintf( stderr, "margin: %s: cannot write\n", pcFile );
+  }
+}
+
+static U8 FindParam( const char* pcName )
+{
+  U8 u8Ret = MARGIN_PARAM_COUNT;
+  U8 u8Param;
+
+  for( u8Param = 0u; u8Param < MARGIN_PARAM_COUNT; u8Param++ )
+  {
+    if( 0 == strcmp( pcName, gcasParam[ u8Param ].pcName ) )
+    {
+      u8Ret = u8Param;
+    }
+  }
+
+  return u8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  Parses name=value, name=min:max or name=min:max:steps
+ *********************************************************************/
+static void ParseRange( const char* pcArg, U8* pu8Param, S_MARGIN_RANGE* psRange )
+{
+  char   acName[ 16 ];
+  double dMin, dMax;
+  unsigned uSteps = 1u;
+  int    iFields = sscanf( pcArg, "%15[a-z]=%lf:%lf:%u", acName, &dMin, &dMax, &uSteps );
+
+  *pu8Param = ( 2 <= iFields ) ? FindParam( acName ) : MARGIN_PARAM_COUNT;
+  if( ( MARGIN_PARAM_COUNT == *pu8Param ) || ( 0u == uSteps ) || ( MARGIN_AXIS_MAX < uSteps ) || ( ( 3 <= iFields ) && ( dMax < dMin ) ) )
+  {
+    Usage();
+  }
+  psRange->dMin = dMin;
+  psRange->dMax = ( 3 <= iFields ) ? dMax : dMin;
+  psRange->u32Steps = uSteps;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: margin [-x param=min:max:steps] [-y param=min:max:steps] [-p param=value|min:max]...\n"
+                   "              [-n runs_per_cell] [-k keys_per_run] [-j workers] [-s seed] [-o csv_file]\n"
+                   "       param: width [us], delay [us] (handshake), stall [ms] (host), bounce [us],\n"
+                   "              scan [us] (TIM2 period), fcpu [MHz] (real HSI frequency)\n"
+                   "       -p min:max draws the value for every run\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Counts the resynchronizations and retransmissions (linked with --wrap)
+ *********************************************************************/
+void __wrap_Trace_Write( U8 u8Event, U8 u8Argument )
+{
+  gu32Resyncs += ( TRACE_EVENT_RESYNC == u8Event ) ? 1u : 0u;
+  gu32Retransmits += ( TRACE_EVENT_RETRANSMIT == u8Event ) ? 1u : 0u;
+  __real_Trace_Write( u8Event, u8Argument );
+}
+
+/*! *******************************************************************
+ * \brief  Replaces the scan period of the firmware (linked with --wrap)
+ *********************************************************************/
+void __wrap_TIM2_TimeBaseInit( TIM2_Prescaler_TypeDef TIM2_Prescaler, uint16_t TIM2_Period )
+{
+  (void)TIM2_Period;
+  __real_TIM2_TimeBaseInit( TIM2_Prescaler, gu16Tim2Arr );
+}
+
+int main( int argc, char* argv[] )
+{
+  S_MARGIN_RANGE sRange;
+  const char* pcCsv = NULL;
+  size_t  uSize;
+  U8     *pu8Shared;
+  U32     u32Worker, u32Run, u32Cells, u32Share, u32Steals = 0u;
+  long    lWorkers = sysconf( _SC_NPROCESSORS_ONLN );
+  U8      u8Param;
+  int     iArg;
+  struct timespec sStart, sEnd;
+
+  for( u8Param = 0u; u8Param < MARGIN_PARAM_COUNT; u8Param++ )
+  {
+    gsMargin.asRange[ u8Param ].dMin = gcasParam[ u8Param ].dDefault;
+    gsMargin.asRange[ u8Param ].dMax = gcasParam[ u8Param ].dDefault;
+    gsMargin.asRange[ u8Param ].u32Steps = 1u;
+  }
+  gsMargin.u8AxisX = MARGIN_PARAM_COUNT;
+  gsMargin.u8AxisY = MARGIN_PARAM_COUNT;
+  gsMargin.u32Trials = 4u;
+  gsMargin.u32Keys = 16u;
+  gsMargin.u32Seed = 1u;
+  gsMargin.u32Workers = ( 0 < lWorkers ) ? (U32)lWorkers : 1u;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( ( 0 == strcmp( argv[ iArg ], "-x" ) ) || ( 0 == strcmp( argv[ iArg ], "-y" ) ) || ( 0 == strcmp( argv[ iArg ], "-p" ) ) )
+     && ( ( iArg + 1 ) < argc ) )
+    {
+      ParseRange( argv[ iArg + 1 ], &u8Param, &sRange );
+      gsMargin.asRange[ u8Param ] = sRange;
+      if( 'x' == argv[ iArg ][ 1 ] )
+      {
+        gsMargin.u8AxisX = u8Param;
+      }
+      else if( 'y' == argv[ iArg ][ 1 ] )
+      {
+        gsMargin.u8AxisY = u8Param;
+      }
+      else
+      {
+        gsMargin.asRange[ u8Param ].u32Steps = 1u;
+      }
+      iArg++;
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-n" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsMargin.u32Trials = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-k" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsMargin.u32Keys = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-j" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsMargin.u32Workers = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-s" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsMargin.u32Seed = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-o" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcCsv = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+
+  // default map: handshake width against its delay
+  if( MARGIN_PARAM_COUNT == gsMargin.u8AxisX )
+  {
+    gsMargin.u8AxisX = ( MARGIN_PARAM_WIDTH != gsMargin.u8AxisY ) ? MARGIN_PARAM_WIDTH : MARGIN_PARAM_DELAY;
+    gsMargin.asRange[ gsMargin.u8AxisX ] = (S_MARGIN_RANGE){ 0.0, 40.0, 21u };
+  }
+  if( MARGIN_PARAM_COUNT == gsMargin.u8AxisY )
+  {
+    gsMargin.u8AxisY = ( MARGIN_PARAM_DELAY != gsMargin.u8AxisX ) ? MARGIN_PARAM_DELAY : MARGIN_PARAM_WIDTH;
+    gsMargin.asRange[ gsMargin.u8AxisY ] = (S_MARGIN_RANGE){ 0.0, 40.0, 11u };
+  }
+  if( ( gsMargin.u8AxisX == gsMargin.u8AxisY ) || ( 0u == gsMargin.u32Trials ) || ( 0u == gsMargin.u32Keys )
+   || ( MARGIN_KEYS_MAX < gsMargin.u32Keys ) || ( 0u == gsMargin.u32Workers ) )
+  {
+    Usage();
+  }
+
+  // queues, jobs and results are shared with the workers
+  u32Cells = gsMargin.asRange[ gsMargin.u8AxisX ].u32Steps * gsMargin.asRange[ gsMargin.u8AxisY ].u32Steps;
+  gsMargin.u32Runs = u32Cells * gsMargin.u32Trials;
+  gsMargin.u32Workers = ( gsMargin.u32Workers < gsMargin.u32Runs ) ? gsMargin.u32Workers : gsMargin.u32Runs;
+  uSize = gsMargin.u32Workers * sizeof( S_MARGIN_DEQUE ) + gsMargin.u32Runs * ( sizeof( U32 ) + sizeof( S_MARGIN_RESULT ) );
+  pu8Shared = mmap( NULL, uSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+  if( MAP_FAILED == pu8Shared )
+  {
+    perror( "margin: mmap" );
+    return EXIT_FAILURE;
+  }
+  gsMargin.psDeque = (S_MARGIN_DEQUE*)pu8Shared;
+  gsMargin.psResult = (S_MARGIN_RESULT*)( gsMargin.psDeque + gsMargin.u32Workers );
+  gsMargin.pu32Job = (U32*)( gsMargin.psResult + gsMargin.u32Runs );
+
+  // neighbouring cells cost about the same, so every worker gets a contiguous band -- the stealing evens it out
+  u32Share = ( gsMargin.u32Runs + gsMargin.u32Workers - 1u ) / gsMargin.u32Workers;
+  for( u32Run = 0u; u32Run < gsMargin.u32Runs; u32Run++ )
+  {
+    gsMargin.pu32Job[ u32Run ] = u32Run;
+  }
+  for( u32Worker = 0u; u32Worker < gsMargin.u32Workers; u32Worker++ )
+  {
+    gsMargin.psDeque[ u32Worker ].u32First = u32Worker * u32Share;
+    gsMargin.psDeque[ u32Worker ].lTop = 0;
+    gsMargin.psDeque[ u32Worker ].lBottom = ( ( u32Worker + 1u ) * u32Share <= gsMargin.u32Runs ) ? (long)u32Share
+                                          : ( ( u32Worker * u32Share < gsMargin.u32Runs ) ? (long)( gsMargin.u32Runs - u32Worker * u32Share ) : 0 );
+  }
+
+  clock_gettime( CLOCK_MONOTONIC, &sStart );
+  fflush( stdout );
+  for( u32Worker = 0u; u32Worker < gsMargin.u32Workers; u32Worker++ )
+  {
+    if( 0 == fork() )
+    {
+      Work( u32Worker );
+      _exit( EXIT_SUCCESS );
+    }
+  }
+  while( 0 < wait( NULL ) )
+  {
+    // all workers
+  }
+  clock_gettime( CLOCK_MONOTONIC, &sEnd );
+
+  PrintMap();
+  for( u32Worker = 0u; u32Worker < gsMargin.u32Workers; u32Worker++ )
+  {
+    u32Steals += gsMargin.psDeque[ u32Worker ].u32Steals;
+  }
+  printf( "workers: %lu, %lu runs stolen, %.1f s wall time\n", (unsigned long)gsMargin.u32Workers, (unsigned long)u32Steals,
+          (double)( sEnd.tv_sec - sStart.tv_sec ) + (double)( sEnd.tv_nsec - sStart.tv_nsec ) / 1e9 );
+  if( NULL != pcCsv )
+  {
+    WriteCsv( pcCsv );
+  }
+  munmap( pu8Shared, uSize );
+
+  return EXIT_SUCCESS;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,210 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file replay.c
+*
+* \brief Host simulation -- records a typing session as matrix samples, or replays a recording and checks
+*        the key codes received by the computer against the recorded ones
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "latency.h"
+#include "matrix.h"
+#include "sim.h"
+#include "sim_cia.h"
+#include "sim_samples.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define REPLAY_BOOT_TIME      SIM_S( 1 )     //!< Power-up and init key stream, before the first key
+#define REPLAY_KEY_PERIOD     SIM_MS( 150 )  //!< Start of a character --> start of the next one
+#define REPLAY_SHIFT_LEAD     SIM_MS( 20 )   //!< Shift pressed before the key
+#define REPLAY_HOLD_TIME      SIM_MS( 80 )   //!< Key pressed
+#define REPLAY_TAIL_TIME      SIM_MS( 500 )  //!< Run after the last edge, until the FIFO is empty
+#define REPLAY_TICK_CLOCKS    ( (unsigned long long)MATRIX_TICK_CLOCKS )  //!< One sample: TIM2 period
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static SIM_TIME PlanText( const char* pcText, SIM_TIME u64Start, SIM_TIME u64Bounce );
+static void     Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Schedules the edges of a text
+ * \param  pcText: characters, see Sim_Keys_FromChar()
+ * \param  u64Start: first edge
+ * \param  u64Bounce: chatter time of the contacts
+ * \return Time of the last edge
+ *********************************************************************/
+static SIM_TIME PlanText( const char* pcText, SIM_TIME u64Start, SIM_TIME u64Bounce )
+{
+  SIM_TIME u64Time = u64Start;
+  U8   u8ScanCode, u8Row, u8Column, u8ShiftRow, u8ShiftColumn;
+  BOOL bShift;
+
+  Sim_Keys_Find( SIM_SCANCODE_LSHIFT, &u8ShiftRow, &u8ShiftColumn );
+  for( ; '\0' != *pcText; pcText++ )
+  {
+    if( ( TRUE == Sim_Keys_FromChar( *pcText, &u8ScanCode, &bShift ) ) && ( TRUE == Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column ) ) )
+    {
+      if( TRUE == bShift )
+      {
+        Sim_Keys_ScheduleEdge( u64Time, u8ShiftRow, u8ShiftColumn, TRUE, u64Bounce );
+        Sim_Keys_ScheduleEdge( u64Time + REPLAY_SHIFT_LEAD + REPLAY_HOLD_TIME + REPLAY_SHIFT_LEAD, u8ShiftRow, u8ShiftColumn, FALSE, u64Bounce );
+      }
+      Sim_Keys_ScheduleEdge( u64Time + REPLAY_SHIFT_LEAD, u8Row, u8Column, TRUE, u64Bounce );
+      Sim_Keys_ScheduleEdge( u64Time + REPLAY_SHIFT_LEAD + REPLAY_HOLD_TIME, u8Row, u8Column, FALSE, u64Bounce );
+    }
+    else
+    {
+      fprintf( stderr, "replay: '%c' cannot be typed, skipped\n", *pcText );
+    }
+    u64Time += REPLAY_KEY_PERIOD;
+  }
+
+  return u64Time;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: replay -r file [-b bounce_us] text    records typing the text\n"
+                   "       replay file                           replays, exit status 1 on different key codes\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  static S_SIM_CIA     sCia;
+  static S_SIM_SAMPLES sSamples;
+  S_SIM_CIA_CODE sCode;
+  const char* pcFile = NULL;
+  const char* pcText = NULL;
+  BOOL     bRecord = FALSE;
+  SIM_TIME u64Bounce = 0u;
+  SIM_TIME u64End;
+  U32  u32Received = 0u;
+  U32  u32Mismatch = 0xFFFFFFFFu;
+  int  iArg;
+  int  iRet = EXIT_SUCCESS;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-r" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      bRecord = TRUE;
+      pcFile = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-b" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u64Bounce = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( FALSE == bRecord ) && ( NULL == pcFile ) )
+    {
+      pcFile = argv[ iArg ];
+    }
+    else if( ( TRUE == bRecord ) && ( NULL == pcText ) )
+    {
+      pcText = argv[ iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  if( ( NULL == pcFile ) || ( ( TRUE == bRecord ) && ( NULL == pcText ) ) )
+  {
+    Usage();
+  }
+  if( ( FALSE == bRecord ) && ( FALSE == Sim_Samples_Load( &sSamples, pcFile ) ) )
+  {
+    fprintf( stderr, "replay: %s: cannot load the recording\n", pcFile );
+    return EXIT_FAILURE;
+  }
+
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &sCia );
+  if( TRUE == bRecord )
+  {
+    Sim_Samples_Record( &sSamples );
+    Sim_RunUntil( REPLAY_BOOT_TIME );  // the keymap is loaded by now
+    u64End = PlanText( pcText, REPLAY_BOOT_TIME, u64Bounce );
+    Sim_RunUntil( u64End + REPLAY_TAIL_TIME );
+    while( TRUE == Sim_Cia_Read( &sCia, &sCode ) )
+    {
+      Sim_Samples_AddCode( &sSamples, sCode.u8Raw );
+      u32Received++;
+    }
+    if( FALSE == Sim_Samples_Save( &sSamples, pcFile ) )
+    {
+      fprintf( stderr, "replay: %s: cannot write\n", pcFile );
+      iRet = EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    Sim_Samples_Replay( &sSamples );
+    while( TRUE == Sim_Samples_IsReplaying( &sSamples ) )
+    {
+      Sim_RunFor( SIM_MS( 100 ) );
+    }
+    Sim_RunFor( REPLAY_TAIL_TIME );
+    while( TRUE == Sim_Cia_Read( &sCia, &sCode ) )
+    {
+      if( ( 0xFFFFFFFFu == u32Mismatch )
+       && ( ( u32Received >= sSamples.u32CodeCount ) || ( sCode.u8Raw != sSamples.pu8Codes[ u32Received ] ) ) )
+      {
+        u32Mismatch = u32Received;
+      }
+      u32Received++;
+    }
+    if( ( 0xFFFFFFFFu == u32Mismatch ) && ( u32Received != sSamples.u32CodeCount ) )
+    {
+      u32Mismatch = u32Received;
+    }
+    iRet = ( 0xFFFFFFFFu == u32Mismatch ) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  printf( "samples:        %lu (%.1f s), %lu bytes encoded (%.1fx smaller than raw)\n", (unsigned long)sSamples.u32Ticks,
+          SIM_TO_US( sSamples.u32Ticks * REPLAY_TICK_CLOCKS ) / 1e6, (unsigned long)sSamples.u32StreamSize,
+          (double)sSamples.u32Ticks / (double)( ( 0u != sSamples.u32StreamSize ) ? sSamples.u32StreamSize : 1u ) );
+  printf( "key codes:      %lu received", (unsigned long)u32Received );
+  if( FALSE == bRecord )
+  {
+    printf( ", %lu expected -- %s", (unsigned long)sSamples.u32CodeCount, ( EXIT_SUCCESS == iRet ) ? "match" : "MISMATCH" );
+    if( EXIT_SUCCESS != iRet )
+    {
+      printf( " at code %lu", (unsigned long)u32Mismatch );
+    }
+  }
+  printf( "\n" );
+  printf( "latency:        sample->ack max %lu us over %u codes\n", (unsigned long)gsLatencyBlock.asStage[ LATENCY_STAGE_TOTAL ].u32MaxUs,
+          gsLatencyBlock.asStage[ LATENCY_STAGE_TOTAL ].u16Count );
+
+  Sim_Samples_Free( &sSamples );
+
+  return iRet;
+}
+
+/******************************<EOF>**********************************/
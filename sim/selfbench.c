@@ -0,0 +1,272 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file selfbench.c
+*
+* \brief Host simulation -- the handshake self-benchmark of the firmware against computers of known timing: the burst
+*        is started with its chord, the results are read from the RAM block, as over SWIM, and the handshake of each
+*        code is compared with the one the virtual computer gave.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "selfbench.h"
+#include "sim.h"
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SELFBENCH_BOOT_TIME       SIM_S( 1 )     //!< Power-up and init key stream, before the chord
+#define SELFBENCH_HOLD_TIME       SIM_MS( 80 )   //!< Key of the chord pressed
+#define SELFBENCH_SETTLE_TIME     SIM_MS( 100 )
+#define SELFBENCH_RUN_TIMEOUT     SIM_S( 10 )
+#define SELFBENCH_SCENARIO_MAX    16u
+#define SELFBENCH_RELEASE_MAX     1024u          //!< KDAT releases of the controller recorded during a burst
+#define SELFBENCH_TOLERANCE_US    20.0           //!< Measured --> given: polling of KDAT, matrix interrupt before the timestamp
+
+// Amiga key codes of the chord
+#define SELFBENCH_SCANCODE_LAMIGA 0x66u
+#define SELFBENCH_SCANCODE_RAMIGA 0x67u
+#define SELFBENCH_SCANCODE_F5     0x54u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Rising edges of KDAT driven by the controller
+typedef struct
+{
+  SIM_TIME au64Time[ SELFBENCH_RELEASE_MAX ];
+  U32      u32Count;
+  U8       u8Level;
+} S_SELFBENCH_RELEASES;
+
+//! \brief A computer, and what the keyboard measured of it
+typedef struct
+{
+  U32               u32DelayUs;    //!< Last bit --> start of the handshake
+  U32               u32WidthUs;    //!< Length of the handshake
+  S_SELFBENCH_BLOCK sBlock;        //!< As read over SWIM
+  U32               u32Codes;      //!< Codes of the burst received by the computer
+  double            dReferenceUs;  //!< Average handshake given, from the release of KDAT
+  double            dErrorUs;      //!< Largest difference of the handshake of a code
+  BOOL              bOk;
+} S_SELFBENCH_SCENARIO;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void ObserveLine( void* pvContext, U8 u8Line, U8 u8Level, SIM_TIME u64Now );
+static void PressChord( void );
+static void Run( S_SIM_CIA* psCia, S_SELFBENCH_RELEASES* psReleases, S_SELFBENCH_SCENARIO* psScenario );
+static void Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Line observer -- records the releases of KDAT by the controller
+ * \param  pvContext: the releases
+ * \param  u8Line: SIM_LINE_x
+ * \param  u8Level: level driven by the controller
+ * \param  u64Now: the virtual time
+ *********************************************************************/
+static void ObserveLine( void* pvContext, U8 u8Line, U8 u8Level, SIM_TIME u64Now )
+{
+  S_SELFBENCH_RELEASES* psReleases = (S_SELFBENCH_RELEASES*)pvContext;
+
+  if( SIM_LINE_KDAT == u8Line )
+  {
+    if( ( 0u == psReleases->u8Level ) && ( 0u != u8Level ) && ( psReleases->u32Count < SELFBENCH_RELEASE_MAX ) )
+    {
+      psReleases->au64Time[ psReleases->u32Count ] = u64Now;
+      psReleases->u32Count++;
+    }
+    psReleases->u8Level = u8Level;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  LAmiga + RAmiga + F5, then releasing all of them
+ *********************************************************************/
+static void PressChord( void )
+{
+  U8 au8Row[ 3 ], au8Column[ 3 ];
+
+  Sim_Keys_Find( SELFBENCH_SCANCODE_LAMIGA, &au8Row[ 0 ], &au8Column[ 0 ] );
+  Sim_Keys_Find( SELFBENCH_SCANCODE_RAMIGA, &au8Row[ 1 ], &au8Column[ 1 ] );
+  Sim_Keys_Find( SELFBENCH_SCANCODE_F5, &au8Row[ 2 ], &au8Column[ 2 ] );
+  Sim_SetKey( au8Row[ 0 ], au8Column[ 0 ], TRUE );
+  Sim_SetKey( au8Row[ 1 ], au8Column[ 1 ], TRUE );
+  Sim_RunFor( SELFBENCH_HOLD_TIME );
+  Sim_SetKey( au8Row[ 2 ], au8Column[ 2 ], TRUE );
+  Sim_RunFor( SELFBENCH_HOLD_TIME );
+  Sim_SetKey( au8Row[ 2 ], au8Column[ 2 ], FALSE );
+  Sim_SetKey( au8Row[ 1 ], au8Column[ 1 ], FALSE );
+  Sim_SetKey( au8Row[ 0 ], au8Column[ 0 ], FALSE );
+}
+
+/*! *******************************************************************
+ * \brief  Runs a burst against a computer, and compares the results with its handshake
+ * \param  psCia: the port, it is set to the handshake of the computer
+ * \param  psReleases: releases of KDAT, recorded by the line observer
+ * \param  psScenario: the computer, the results are put here
+ * \note   The handshake given to a code lasts from the release of KDAT by the keyboard (the earliest point it can be
+ *         seen), to the last bit + the delay + the width.
+ *********************************************************************/
+static void Run( S_SIM_CIA* psCia, S_SELFBENCH_RELEASES* psReleases, S_SELFBENCH_SCENARIO* psScenario )
+{
+  S_SIM_CIA_CODE sCode;
+  SIM_TIME u64Start;
+  SIM_TIME u64End;
+  U32      u32Release = 0u;
+  U8       u8Runs = gsSelfBenchBlock.u8Runs;
+  double   dGivenUs;
+  double   dErrorUs;
+
+  psCia->u64AckDelay = SIM_US( psScenario->u32DelayUs );
+  psCia->u64AckWidth = ( SIM_US( psScenario->u32WidthUs ) < SIM_CIA_ACK_WIDTH_MIN ) ? SIM_CIA_ACK_WIDTH_MIN : SIM_US( psScenario->u32WidthUs );
+  psReleases->u32Count = 0u;
+
+  PressChord();
+  u64Start = Sim_GetTime();
+  while( ( u8Runs == gsSelfBenchBlock.u8Runs ) && ( ( Sim_GetTime() - u64Start ) < SELFBENCH_RUN_TIMEOUT ) )
+  {
+    Sim_RunFor( SELFBENCH_SETTLE_TIME );
+  }
+  Sim_RunFor( SELFBENCH_SETTLE_TIME );
+  psScenario->sBlock = gsSelfBenchBlock;  // pure RAM, as read over SWIM
+
+  // every code of the burst against the release of KDAT after its last bit
+  psScenario->bOk = ( SELFBENCH_MAGIC == psScenario->sBlock.u16Magic ) && ( u8Runs != psScenario->sBlock.u8Runs ) ? TRUE : FALSE;
+  while( TRUE == Sim_Cia_Read( psCia, &sCode ) )
+  {
+    if( sCode.u8Raw == (U8)( ( SELFBENCH_CODE << 1u ) | 0x01u ) )
+    {
+      while( ( u32Release < psReleases->u32Count ) && ( psReleases->au64Time[ u32Release ] <= sCode.u64Time ) )
+      {
+        u32Release++;
+      }
+          u64End = sCode.u64Time + psCia->u64AckDelay + psCia->u64AckWidth;
+      if( ( u32Release < psReleases->u32Count ) && ( psScenario->u32Codes < SELFBENCH_CODE_COUNT ) )
+      {
+        dGivenUs = SIM_TO_US( u64End - psReleases->au64Time[ u32Release ] );
+        dErrorUs = (double)psScenario->sBlock.au16HandshakeUs[ psScenario->u32Codes ] - dGivenUs;
+        dErrorUs = ( dErrorUs < 0.0 ) ? -dErrorUs : dErrorUs;
+        psScenario->dReferenceUs += dGivenUs / SELFBENCH_CODE_COUNT;
+        psScenario->dErrorUs = ( dErrorUs > psScenario->dErrorUs ) ? dErrorUs : psScenario->dErrorUs;
+      }
+      psScenario->u32Codes++;
+    }
+  }
+  psScenario->bOk = ( ( TRUE == psScenario->bOk ) && ( SELFBENCH_CODE_COUNT == psScenario->u32Codes )
+                   && ( 0u == psScenario->sBlock.u8Retries ) && ( psScenario->dErrorUs <= SELFBENCH_TOLERANCE_US ) ) ? TRUE : FALSE;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: selfbench [-c delay:width[,delay:width...]]\n"
+                   "  -c  handshakes of the computers, in us: last bit --> handshake, length of the handshake\n"
+                   "      (default 1:85,40:85,300:85,1:400,2000:150,20000:85 -- idle to heavily loaded)\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  static S_SIM_CIA            sCia;
+  static S_SELFBENCH_RELEASES sReleases;
+  static S_SELFBENCH_SCENARIO asScenarios[ SELFBENCH_SCENARIO_MAX ];
+  S_SIM_CIA_CODE sCode;
+  const char* pcComputers = "1:85,40:85,300:85,1:400,2000:150,20000:85";
+  const S_SELFBENCH_STAT* psStat;
+  char*    pcEnd;
+  U32      u32Count = 0u;
+  U32      u32Index;
+  U8       u8Stat;
+  BOOL     bOk = TRUE;
+  int      iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-c" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcComputers = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  while( ( '\0' != *pcComputers ) && ( u32Count < SELFBENCH_SCENARIO_MAX ) )
+  {
+    asScenarios[ u32Count ].u32DelayUs = strtoul( pcComputers, &pcEnd, 0 );
+    if( ':' != *pcEnd )
+    {
+      Usage();
+    }
+    asScenarios[ u32Count ].u32WidthUs = strtoul( pcEnd + 1, &pcEnd, 0 );
+    if( ( ',' != *pcEnd ) && ( '\0' != *pcEnd ) )
+    {
+      Usage();
+    }
+    u32Count++;
+    pcComputers = ( ',' == *pcEnd ) ? ( pcEnd + 1 ) : pcEnd;
+  }
+
+  // one keyboard, the load of the computer changes between the bursts
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &sCia );
+  sReleases.u8Level = 1u;
+  Sim_AddLineObserver( ObserveLine, &sReleases );
+  Sim_RunUntil( SELFBENCH_BOOT_TIME );  // the keys are found in the keymap of the firmware
+  while( TRUE == Sim_Cia_Read( &sCia, &sCode ) );  // init key stream
+  for( u32Index = 0u; u32Index < u32Count; u32Index++ )
+  {
+    Run( &sCia, &sReleases, &asScenarios[ u32Index ] );
+  }
+
+  printf( "burst:          %u releases of key code 0x%02X, started with LAmiga + RAmiga + F5\n", SELFBENCH_CODE_COUNT, SELFBENCH_CODE );
+  printf( "results:        %u bytes at 0x%04X in RAM, min / avg / max in us, from the release of KDAT by the keyboard\n\n",
+          (unsigned)sizeof( S_SELFBENCH_BLOCK ), (unsigned)SELFBENCH_BLOCK_ADDRESS );
+  printf( "%-15s %-22s %-22s %-22s %6s %7s %9s %8s\n", "computer us", "ack delay", "ack width", "handshake", "codes", "retries",
+          "given", "error" );
+  for( u32Index = 0u; u32Index < u32Count; u32Index++ )
+  {
+    printf( "%6lu : %-6lu", (unsigned long)asScenarios[ u32Index ].u32DelayUs, (unsigned long)asScenarios[ u32Index ].u32WidthUs );
+    for( u8Stat = 0u; u8Stat < SELFBENCH_STAT_COUNT; u8Stat++ )
+    {
+      psStat = &asScenarios[ u32Index ].sBlock.asStat[ u8Stat ];
+      printf( " %6lu %6lu %6lu   ", (unsigned long)psStat->u32MinUs, (unsigned long)psStat->u32AvgUs, (unsigned long)psStat->u32MaxUs );
+    }
+    printf( "%4lu %7u %9.1f %8.1f  %s\n", (unsigned long)asScenarios[ u32Index ].u32Codes, asScenarios[ u32Index ].sBlock.u8Retries,
+            asScenarios[ u32Index ].dReferenceUs, asScenarios[ u32Index ].dErrorUs, ( TRUE == asScenarios[ u32Index ].bOk ) ? "ok" : "FAILED" );
+    bOk = ( TRUE == asScenarios[ u32Index ].bOk ) ? bOk : FALSE;
+  }
+
+  return ( ( TRUE == bOk ) && ( 0u != u32Count ) ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,172 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim.h
+*
+* \brief Host simulation of the keyboard controller -- virtual time, CPU and board model
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef SIM_H_INCLUDED
+#define SIM_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "types.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// Virtual time is counted in periods of the 16 MHz HSI oscillator
+#define SIM_HSI_HZ              16000000u
+#define SIM_US( X )             ( (SIM_TIME)(X) * 16u )
+#define SIM_MS( X )             ( (SIM_TIME)(X) * 16000u )
+#define SIM_S( X )              ( (SIM_TIME)(X) * 16000000u )
+#define SIM_TO_US( T )          ( (double)(T) / 16.0 )
+#define SIM_NEVER               ( (SIM_TIME)~0ull )
+
+// CPU cycle estimates of the simulated firmware parts, that have no peripheral access of their own
+#define SIM_CYCLES_IT_ENTRY     20u    //!< Interrupt entry and exit (context save, IRET)
+#define SIM_CYCLES_MAIN_LOOP    3000u  //!< One turn of the main cycle without peripheral access
+#define SIM_CYCLES_GHOST_COLUMN 20u    //!< One turn of the loop of the ghost key test, two rows in common, see Sim_Matrix_GhostTest()
+#define SIM_CYCLES_GHOST_OWN    6u     //!< Its turn on its own column is shorter: the first jreq is taken
+#define SIM_CYCLES_GHOST_CALL   24u    //!< Call, loading the column, the result and the return
+
+#define SIM_CPU_DIVIDER_STEPS   8u     //!< Residency buckets of the run and wait modes: fCPU = fHSI / 2^n
+
+// Lines of the board
+#define SIM_LINE_KCLK           0u
+#define SIM_LINE_KDAT           1u
+#define SIM_LINE_RESET          2u
+#define SIM_LINE_CAPSLED        3u
+#define SIM_LINE_ROW0           4u    //!< ROW0..ROW5
+#define SIM_LINE_COL0           10u   //!< COL0..COL15
+#define SIM_LINE_COUNT          26u
+#define SIM_LINE_NONE           0xFFu
+
+#define SIM_ROW_COUNT           6u
+#define SIM_COL_COUNT           16u
+#define SIM_SCANCODE_LSHIFT     0x60u
+
+#define SIM_EEPROM_ADDRESS      0x4000u
+#define SIM_EEPROM_SIZE         128u
+#define SIM_FLASH_ADDRESS       0x8000u
+#define SIM_FLASH_SIZE          8192u
+#define SIM_PROGRAM_TIME        SIM_MS( 6 )  //!< Standard programming time of a byte/word/block (datasheet)
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+typedef unsigned long long SIM_TIME;
+
+//! \brief Level driven by an external device on an open drain line (0: pulled low, 1: released)
+typedef U8 (*SIM_LINE_DRIVER)( void* pvContext, SIM_TIME u64Now );
+
+//! \brief Scheduled call of the event kernel
+typedef void (*SIM_EVENT_HANDLER)( void* pvContext, SIM_TIME u64Time );
+
+//! \brief Called, when the level driven by the controller on a line changes
+typedef void (*SIM_LINE_OBSERVER)( void* pvContext, U8 u8Line, U8 u8Level, SIM_TIME u64Now );
+
+//! \brief Called at the entry (bEntry: TRUE) and at the exit of the TIM2 interrupt routine
+typedef void (*SIM_INTERRUPT_HOOK)( void* pvContext, BOOL bEntry, SIM_TIME u64Now );
+
+//! \brief Called, when the level of a line may have changed -- by the controller, a key or an external device
+typedef void (*SIM_WIRE_HOOK)( void* pvContext, SIM_TIME u64Now );
+
+//! \brief Statistics of the simulated CPU
+typedef struct
+{
+  U32      u32Interrupts;     //!< Number of TIM2 update interrupts served
+  U32      u32MainLoops;      //!< Number of main cycle turns
+  U32      u32PeriphAccess;   //!< Number of peripheral library calls and delays
+  SIM_TIME u64IdleSkipped;    //!< Virtual time skipped, while the main cycle had nothing to do
+  SIM_TIME u64InterruptTime;  //!< Virtual time spent in the interrupt routine
+  SIM_TIME u64MaxInterrupt;   //!< Longest interrupt routine
+  U32      u32GhostTests;     //!< Ghost key tests run by Matrix_Sample(), see MATRIX_ANTIGHOST
+  SIM_TIME au64RunTime[ SIM_CPU_DIVIDER_STEPS ];  //!< Virtual time in run mode, per fCPU = fHSI / 2^index
+  SIM_TIME au64WaitTime[ SIM_CPU_DIVIDER_STEPS ]; //!< Virtual time in wait mode (WFI), per fCPU = fHSI / 2^index
+  SIM_TIME u64HaltTime;       //!< Virtual time in halt mode
+} S_SIM_STATS;
+
+//! \brief Data EEPROM and program flash model
+typedef struct
+{
+  U8  au8Eeprom[ SIM_EEPROM_SIZE ];
+  U32 au32EepromWrites[ SIM_EEPROM_SIZE ];  //!< Program cycles of every byte
+  U32 u32ProgramOperations;                 //!< Number of byte/word/block program operations
+  U8  au8Flash[ SIM_FLASH_SIZE ];
+} S_SIM_MEMORY;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+extern S_SIM_MEMORY gsSimMemory;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+// sim_core.c -- virtual time and CPU
+void        Sim_RunUntil( SIM_TIME u64Time );
+void        Sim_RunFor( SIM_TIME u64Duration );
+SIM_TIME    Sim_GetTime( void );
+const S_SIM_STATS* Sim_GetStats( void );
+void        Sim_Consume( U32 u32Cycles );
+void        Sim_PeriphAccess( U32 u32Cycles );
+void        Sim_Matrix_GhostTest( U8 u8Compared );
+void        Sim_WaitUntil( SIM_TIME u64Time );
+void        Sim_SetClockDividers( U8 u8MasterDivider, U8 u8CpuDivider );
+U8          Sim_GetMasterDivider( void );
+U8          Sim_GetCpuDivider( void );
+void        Sim_SetInterruptHook( SIM_INTERRUPT_HOOK pfHook, void* pvContext );
+
+// sim_event.c -- discrete event scheduler
+U32         Sim_Event_Schedule( SIM_TIME u64Time, SIM_EVENT_HANDLER pfHandler, void* pvContext );
+BOOL        Sim_Event_Cancel( U32 u32Id );
+SIM_TIME    Sim_Event_NextTime( void );
+void        Sim_Event_RunDue( SIM_TIME u64Now );
+U32         Sim_Event_GetProcessed( void );
+
+// sim_periph.c -- peripheral register models
+void        Sim_Periph_Reset( void );
+BOOL        Sim_Tim2_IsInterruptPending( void );
+U8          Sim_Gpio_GetDrive( U8 u8Port, U8 u8Pin );
+
+// sim_board.c -- keyboard matrix and connector
+void        Sim_Board_Reset( void );
+void        Sim_SetKey( U8 u8Row, U8 u8Column, BOOL bPressed );
+BOOL        Sim_IsKeyPressed( U8 u8Row, U8 u8Column );
+void        Sim_SetLineDriver( U8 u8Line, SIM_LINE_DRIVER pfDriver, void* pvContext );
+void        Sim_AddLineObserver( SIM_LINE_OBSERVER pfObserver, void* pvContext );
+U8          Sim_GetLineLevel( U8 u8Line );
+U8          Sim_GetLineDrive( U8 u8Line );
+U8          Sim_Board_GetInput( U8 u8Port, U8 u8Pin );
+void        Sim_Board_OutputChanged( U8 u8Port, U8 u8Mask );
+const char* Sim_GetLineName( U8 u8Line );
+U8          Sim_Board_GetRows( void );
+void        Sim_Board_FreezeRows( BOOL bFrozen, U8 u8Rows );
+void        Sim_Board_SetDiodes( BOOL bDiodes );
+void        Sim_SetWireHook( SIM_WIRE_HOOK pfHook, void* pvContext );
+void        Sim_Board_ExternalChanged( void );
+U8          Sim_Board_PeekLineLevel( U8 u8Line );
+BOOL        Sim_Board_IsPeeking( void );
+
+// sim_keys.c -- text to keys, through the keymap of the firmware, and switch edges
+BOOL        Sim_Keys_Find( U8 u8ScanCode, U8* pu8Row, U8* pu8Column );
+BOOL        Sim_Keys_FromChar( char cChar, U8* pu8ScanCode, BOOL* pbShift );
+U16         Sim_Keys_Random( void );
+void        Sim_Keys_Seed( U32 u32Seed );
+void        Sim_Keys_ScheduleEdge( SIM_TIME u64Time, U8 u8Row, U8 u8Column, BOOL bPressed, SIM_TIME u64Bounce );
+
+
+#endif // SIM_H_INCLUDED
+/******************************<EOF>**********************************/
@@ -0,0 +1,460 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_board.c
+*
+* \brief Host simulation -- wiring of the controller, the key matrix and the keyboard connector
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include "types.h"
+
+// Own include
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_OBSERVER_COUNT  8u
+
+#define PORT_A  0u
+#define PORT_B  1u
+#define PORT_C  2u
+#define PORT_D  3u
+#define PORT_E  4u
+#define PORT_F  5u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Pin of a board line
+typedef struct
+{
+  U8          u8Port;
+  U8          u8Pin;
+  const char* pcName;
+} S_SIM_LINE_DESC;
+
+//! \brief External device on a line
+typedef struct
+{
+  SIM_LINE_DRIVER pfDriver;
+  void*           pvContext;
+} S_SIM_DRIVER;
+
+//! \brief Observer of the lines
+typedef struct
+{
+  SIM_LINE_OBSERVER pfObserver;
+  void*             pvContext;
+} S_SIM_OBSERVER;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief The wiring -- same as in amiga_key.c and matrix.c
+static const S_SIM_LINE_DESC gcsSimLines[ SIM_LINE_COUNT ] =
+{
+  { PORT_B, 0u, "KCLK"    },
+  { PORT_B, 1u, "KDAT"    },
+  { PORT_A, 1u, "RESET"   },
+  { PORT_A, 2u, "CAPSLED" },
+  { PORT_F, 4u, "ROW0"    },
+  { PORT_B, 7u, "ROW1"    },
+  { PORT_B, 6u, "ROW2"    },
+  { PORT_B, 4u, "ROW3"    },
+  { PORT_B, 5u, "ROW4"    },
+  { PORT_B, 3u, "ROW5"    },
+  { PORT_A, 3u, "COL0"    },
+  { PORT_B, 2u, "COL1"    },
+  { PORT_D, 7u, "COL2"    },
+  { PORT_D, 6u, "COL3"    },
+  { PORT_D, 5u, "COL4"    },
+  { PORT_D, 4u, "COL5"    },
+  { PORT_D, 3u, "COL6"    },
+  { PORT_D, 2u, "COL7"    },
+  { PORT_D, 0u, "COL8"    },
+  { PORT_C, 7u, "COL9"    },
+  { PORT_C, 6u, "COL10"   },
+  { PORT_C, 5u, "COL11"   },
+  { PORT_C, 4u, "COL12"   },
+  { PORT_C, 3u, "COL13"   },
+  { PORT_C, 2u, "COL14"   },
+  { PORT_E, 5u, "COL15"   }
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static struct
+{
+  U16            au16Keys[ SIM_ROW_COUNT ];            //!< Pressed keys, bit n is COLn
+  S_SIM_DRIVER   asDriver[ SIM_LINE_COUNT ];
+  S_SIM_OBSERVER asObserver[ SIM_OBSERVER_COUNT ];
+  U8             u8ObserverCount;
+  U8             au8LineOfPin[ 6u ][ 8u ];              //!< Reverse lookup of gcsSimLines
+  BOOL           bNoDiodes;                            //!< Switches without diodes: current flows both ways through them
+  BOOL           bRowsFrozen;                          //!< The key matrix is replaced by u8FrozenRows
+  U8             u8FrozenRows;
+  SIM_WIRE_HOOK  pfWireHook;
+  void*          pvWireHookContext;
+  BOOL           bPeeking;                             //!< The level is read by the host program, not the controller
+} gsSimBoard;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U16  GetConnectedColumns( U8 u8Row, U16 u16Keys );
+static U8   GetRowLevel( U8 u8Row );
+static void NotifyWire( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Columns connected to a row through the pressed keys of a matrix without diodes
+ * \param  u8Row: index of the row
+ * \param  u16Keys: columns of the pressed keys of the row
+ * \return Bit n is COLn
+ *********************************************************************/
+static U16 GetConnectedColumns( U8 u8Row, U16 u16Keys )
+{
+  U16 u16Columns = 0u;
+  U8  u8Rows = (U8)(1u<<u8Row);
+  U8  u8Index;
+  
+  while( u16Columns != u16Keys )  // grows, until no row adds a new column
+  {
+    u16Columns = u16Keys;
+    for( u8Index = 0u; u8Index < SIM_ROW_COUNT; u8Index++ )
+    {
+      if( 0u != ( gsSimBoard.au16Keys[ u8Index ] & u16Columns ) )
+      {
+        u8Rows |= (U8)(1u<<u8Index);
+      }
+      if( 0u != ( u8Rows & (1u<<u8Index) ) )
+      {
+        u16Keys |= gsSimBoard.au16Keys[ u8Index ];
+      }
+    }
+  }
+  
+  return u16Columns;
+}
+
+/*! *******************************************************************
+ * \brief  Level of a row line through the key matrix
+ * \param  u8Row: index of the row
+ * \return 0, if a pressed key connects it to a column driven low
+ *********************************************************************/
+static U8 GetRowLevel( U8 u8Row )
+{
+  U16 u16Keys = gsSimBoard.au16Keys[ u8Row ];
+  U8  u8Column;
+  U8  u8Ret = 1u;
+  
+  if( TRUE == gsSimBoard.bRowsFrozen )
+  {
+    u16Keys = 0u;
+    u8Ret = ( gsSimBoard.u8FrozenRows >> u8Row ) & 1u;
+  }
+  
+  // without diodes, the row reaches every column connected through the pressed keys -- also through other rows
+  if( TRUE == gsSimBoard.bNoDiodes )
+  {
+    u16Keys = GetConnectedColumns( u8Row, u16Keys );
+  }
+  
+  // only the columns of the pressed keys matter
+  for( u8Column = 0u; ( 0u != u16Keys ) && ( 0u != u8Ret ); u8Column++ )
+  {
+    if( ( 0u != ( u16Keys & 1u ) ) && ( 0u == Sim_GetLineLevel( SIM_LINE_COL0 + u8Column ) ) )
+    {
+      u8Ret = 0u;
+    }
+    u16Keys >>= 1u;
+  }
+  
+  return u8Ret;
+}
+
+
+/*! *******************************************************************
+ * \brief  Calls the wire hook -- a level may have changed
+ * \param  -
+ * \return -
+ *********************************************************************/
+static void NotifyWire( void )
+{
+  if( NULL != gsSimBoard.pfWireHook )
+  {
+    gsSimBoard.pfWireHook( gsSimBoard.pvWireHookContext, Sim_GetTime() );
+  }
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Releases all keys, removes the external devices and the observers
+ * \param  -
+ * \return -
+ *********************************************************************/
+void Sim_Board_Reset( void )
+{
+  U8 u8Line;
+  
+  memset( &gsSimBoard, 0x00u, sizeof( gsSimBoard ) );
+  memset( gsSimBoard.au8LineOfPin, SIM_LINE_NONE, sizeof( gsSimBoard.au8LineOfPin ) );
+  for( u8Line = 0u; u8Line < SIM_LINE_COUNT; u8Line++ )
+  {
+    gsSimBoard.au8LineOfPin[ gcsSimLines[ u8Line ].u8Port ][ gcsSimLines[ u8Line ].u8Pin ] = u8Line;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Presses or releases a key of the matrix
+ * \param  u8Row: index of the row (0..5)
+ * \param  u8Column: index of the column (0..15)
+ * \param  bPressed: TRUE, if pressed
+ * \return -
+ *********************************************************************/
+void Sim_SetKey( U8 u8Row, U8 u8Column, BOOL bPressed )
+{
+  if( TRUE == bPressed )
+  {
+    gsSimBoard.au16Keys[ u8Row ] |= (U16)(1u<<u8Column);
+  }
+  else
+  {
+    gsSimBoard.au16Keys[ u8Row ] &= (U16)~(1u<<u8Column);
+  }
+  NotifyWire();
+}
+
+/*! *******************************************************************
+ * \brief  Is the key pressed?
+ * \param  u8Row: index of the row (0..5)
+ * \param  u8Column: index of the column (0..15)
+ * \return TRUE, if pressed
+ *********************************************************************/
+BOOL Sim_IsKeyPressed( U8 u8Row, U8 u8Column )
+{
+  return ( 0u != ( gsSimBoard.au16Keys[ u8Row ] & (1u<<u8Column) ) ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Connects an external open drain driver to a line
+ * \param  u8Line: SIM_LINE_x
+ * \param  pfDriver: called on every read of the line, NULL disconnects
+ * \param  pvContext: passed to the driver
+ * \return -
+ *********************************************************************/
+void Sim_SetLineDriver( U8 u8Line, SIM_LINE_DRIVER pfDriver, void* pvContext )
+{
+  gsSimBoard.asDriver[ u8Line ].pfDriver  = pfDriver;
+  gsSimBoard.asDriver[ u8Line ].pvContext = pvContext;
+}
+
+/*! *******************************************************************
+ * \brief  Registers an observer of the lines driven by the controller
+ * \param  pfObserver: called after every level change
+ * \param  pvContext: passed to the observer
+ * \return -
+ *********************************************************************/
+void Sim_AddLineObserver( SIM_LINE_OBSERVER pfObserver, void* pvContext )
+{
+  if( gsSimBoard.u8ObserverCount < SIM_OBSERVER_COUNT )
+  {
+    gsSimBoard.asObserver[ gsSimBoard.u8ObserverCount ].pfObserver = pfObserver;
+    gsSimBoard.asObserver[ gsSimBoard.u8ObserverCount ].pvContext  = pvContext;
+    gsSimBoard.u8ObserverCount++;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Level of a line -- wired AND of the controller, the external device and the key matrix
+ * \param  u8Line: SIM_LINE_x
+ * \return 0 or 1
+ *********************************************************************/
+U8 Sim_GetLineLevel( U8 u8Line )
+{
+  U8 u8Ret = Sim_Gpio_GetDrive( gcsSimLines[ u8Line ].u8Port, gcsSimLines[ u8Line ].u8Pin );
+  
+  if( NULL != gsSimBoard.asDriver[ u8Line ].pfDriver )
+  {
+    u8Ret &= gsSimBoard.asDriver[ u8Line ].pfDriver( gsSimBoard.asDriver[ u8Line ].pvContext, Sim_GetTime() );
+  }
+  if( ( u8Line >= SIM_LINE_ROW0 ) && ( u8Line < ( SIM_LINE_ROW0 + SIM_ROW_COUNT ) ) && ( 0u != u8Ret ) )
+  {
+    u8Ret = GetRowLevel( u8Line - SIM_LINE_ROW0 );
+  }
+  
+  return u8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  Level driven by the controller on a line -- the external devices are not asked
+ * \param  u8Line: SIM_LINE_x
+ * \return 0 or 1
+ *********************************************************************/
+U8 Sim_GetLineDrive( U8 u8Line )
+{
+  return Sim_Gpio_GetDrive( gcsSimLines[ u8Line ].u8Port, gcsSimLines[ u8Line ].u8Pin );
+}
+
+/*! *******************************************************************
+ * \brief  External level of a pin, as seen by the input buffer of the controller
+ * \param  u8Port: index of the port (0 is GPIOA)
+ * \param  u8Pin: number of the pin (0..7)
+ * \return 0 or 1 -- unconnected pins read high
+ *********************************************************************/
+U8 Sim_Board_GetInput( U8 u8Port, U8 u8Pin )
+{
+  U8 u8Line = gsSimBoard.au8LineOfPin[ u8Port ][ u8Pin ];
+  
+  return ( SIM_LINE_NONE != u8Line ) ? Sim_GetLineLevel( u8Line ) : 1u;
+}
+
+/*! *******************************************************************
+ * \brief  Notifies the observers about the pins changed by the controller
+ * \param  u8Port: index of the port (0 is GPIOA)
+ * \param  u8Mask: the changed pins
+ * \return -
+ *********************************************************************/
+void Sim_Board_OutputChanged( U8 u8Port, U8 u8Mask )
+{
+  U8 u8Pin;
+  U8 u8Line;
+  U8 u8Index;
+  
+  for( u8Pin = 0u; u8Pin < 8u; u8Pin++ )
+  {
+    u8Line = gsSimBoard.au8LineOfPin[ u8Port ][ u8Pin ];
+    if( ( 0u != ( u8Mask & (1u<<u8Pin) ) ) && ( SIM_LINE_NONE != u8Line ) )
+    {
+      for( u8Index = 0u; u8Index < gsSimBoard.u8ObserverCount; u8Index++ )
+      {
+        gsSimBoard.asObserver[ u8Index ].pfObserver( gsSimBoard.asObserver[ u8Index ].pvContext, u8Line, Sim_GetLineDrive( u8Line ), Sim_GetTime() );
+      }
+    }
+  }
+  NotifyWire();
+}
+
+/*! *******************************************************************
+ * \brief  Name of a line
+ * \param  u8Line: SIM_LINE_x
+ * \return e.g. "KCLK"
+ *********************************************************************/
+const char* Sim_GetLineName( U8 u8Line )
+{
+  return ( u8Line < SIM_LINE_COUNT ) ? gcsSimLines[ u8Line ].pcName : "?";
+}
+
+/*! *******************************************************************
+ * \brief  Levels of the row lines, as Matrix_Sample() reads them
+ * \param  -
+ * \return Bit n is ROWn, the bits of nonexistent rows are 1
+ *********************************************************************/
+U8 Sim_Board_GetRows( void )
+{
+  U8 u8Row;
+  U8 u8Ret = (U8)~( ( 1u << SIM_ROW_COUNT ) - 1u );
+  
+  for( u8Row = 0u; u8Row < SIM_ROW_COUNT; u8Row++ )
+  {
+    u8Ret |= (U8)( Sim_GetLineLevel( SIM_LINE_ROW0 + u8Row ) << u8Row );
+  }
+  
+  return u8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  Selects the matrix with or without a diode at each switch
+ * \param  bDiodes: TRUE, like the full keyboard (default); FALSE, three keys of a rectangle close the fourth corner
+ * \return -
+ *********************************************************************/
+void Sim_Board_SetDiodes( BOOL bDiodes )
+{
+  gsSimBoard.bNoDiodes = ( TRUE == bDiodes ) ? FALSE : TRUE;
+}
+
+/*! *******************************************************************
+ * \brief  Replaces the key matrix with fixed row levels -- for replaying recorded samples
+ * \param  bFrozen: TRUE, to use u8Rows; FALSE, to return to the keys
+ * \param  u8Rows: bit n is the level of ROWn
+ * \return -
+ *********************************************************************/
+void Sim_Board_FreezeRows( BOOL bFrozen, U8 u8Rows )
+{
+  gsSimBoard.bRowsFrozen = bFrozen;
+  gsSimBoard.u8FrozenRows = u8Rows;
+  NotifyWire();
+}
+
+/*! *******************************************************************
+ * \brief  Sets the hook called after every possible change of the line levels (only one at a time)
+ * \param  pfHook: called after the outputs of the controller, a key or an external device changed, NULL removes it
+ * \param  pvContext: passed to the hook
+ * \return -
+ * \note   Removed by Sim_Board_Reset(). The hook should read the levels with Sim_Board_PeekLineLevel().
+ *********************************************************************/
+void Sim_SetWireHook( SIM_WIRE_HOOK pfHook, void* pvContext )
+{
+  gsSimBoard.pfWireHook = pfHook;
+  gsSimBoard.pvWireHookContext = pvContext;
+}
+
+/*! *******************************************************************
+ * \brief  An external device changed the level it drives
+ * \param  -
+ * \return -
+ *********************************************************************/
+void Sim_Board_ExternalChanged( void )
+{
+  NotifyWire();
+}
+
+/*! *******************************************************************
+ * \brief  Level of a line for the host program -- the external devices do not take it as a read of the controller
+ * \param  u8Line: SIM_LINE_x
+ * \return 0 or 1
+ *********************************************************************/
+U8 Sim_Board_PeekLineLevel( U8 u8Line )
+{
+  U8 u8Ret;
+
+  gsSimBoard.bPeeking = TRUE;
+  u8Ret = Sim_GetLineLevel( u8Line );
+  gsSimBoard.bPeeking = FALSE;
+
+  return u8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  Is the line read by Sim_Board_PeekLineLevel()?
+ * \param  -
+ * \return TRUE, if the driver is called for the host program, not for the controller
+ *********************************************************************/
+BOOL Sim_Board_IsPeeking( void )
+{
+  return gsSimBoard.bPeeking;
+}
+
+/******************************<EOF>**********************************/
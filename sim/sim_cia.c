@@ -0,0 +1,513 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_cia.c
+*
+* \brief Host simulation -- keyboard port of the CIA-A, as the computer side of the connector
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <string.h>
+#include "types.h"
+
+// Own include
+#include "sim_cia.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U8   DriveKdat( void* pvContext, SIM_TIME u64Now );
+static U8   DriveKclk( void* pvContext, SIM_TIME u64Now );
+static void ObserveLine( void* pvContext, U8 u8Line, U8 u8Level, SIM_TIME u64Now );
+static void CloseAck( S_SIM_CIA* psCia, SIM_TIME u64Now );
+static void AckStart( void* pvContext, SIM_TIME u64Time );
+static void AckEnd( void* pvContext, SIM_TIME u64Time );
+static void ScheduleAck( S_SIM_CIA* psCia, SIM_TIME u64Start );
+static void ReceiveByte( S_SIM_CIA* psCia, SIM_TIME u64Now );
+static void GlitchEnd( void* pvContext, SIM_TIME u64Time );
+static void ShiftBit( S_SIM_CIA* psCia, SIM_TIME u64Now );
+static void ArmFault( S_SIM_CIA* psCia, U8 u8Bit );
+static void SendEdge( void* pvContext, SIM_TIME u64Time );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Evaluates the handshake after its end
+ * \param  psCia: the port
+ * \param  u64Now: the virtual time
+ * \return -
+ *********************************************************************/
+static void CloseAck( S_SIM_CIA* psCia, SIM_TIME u64Now )
+{
+  if( ( TRUE == psCia->bAckOpen ) && ( u64Now >= ( psCia->u64AckStart + psCia->u64AckWidth ) ) )
+  {
+    psCia->bAckOpen = FALSE;
+    if( FALSE == psCia->bAckSampled )
+    {
+      psCia->sStats.u32AcksMissed++;
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event at the start of the handshake -- only for the wire hook, KDAT is driven by DriveKdat()
+ * \param  pvContext: the port
+ * \param  u64Time: the virtual time
+ * \return -
+ *********************************************************************/
+static void AckStart( void* pvContext, SIM_TIME u64Time )
+{
+  S_SIM_CIA* psCia = (S_SIM_CIA*)pvContext;
+  
+  (void)u64Time;
+  psCia->u32AckStartEvent = 0u;
+  Sim_Board_ExternalChanged();
+}
+
+/*! *******************************************************************
+ * \brief  Event at the end of the handshake
+ * \param  pvContext: the port
+ * \param  u64Time: the virtual time
+ * \return -
+ *********************************************************************/
+static void AckEnd( void* pvContext, SIM_TIME u64Time )
+{
+  S_SIM_CIA* psCia = (S_SIM_CIA*)pvContext;
+  
+  psCia->u32AckEvent = 0u;
+  CloseAck( psCia, u64Time );
+  Sim_Board_ExternalChanged();
+}
+
+/*! *******************************************************************
+ * \brief  (Re)schedules the handshake
+ * \param  psCia: the port
+ * \param  u64Start: start of the low pulse on KDAT
+ * \return -
+ *********************************************************************/
+static void ScheduleAck( S_SIM_CIA* psCia, SIM_TIME u64Start )
+{
+  if( 0u != psCia->u32AckEvent )
+  {
+    Sim_Event_Cancel( psCia->u32AckEvent );
+  }
+  if( 0u != psCia->u32AckStartEvent )
+  {
+    Sim_Event_Cancel( psCia->u32AckStartEvent );
+  }
+  psCia->u64AckStart = u64Start;
+  psCia->u32AckStartEvent = Sim_Event_Schedule( u64Start, AckStart, psCia );
+  psCia->u32AckEvent = Sim_Event_Schedule( u64Start + psCia->u64AckWidth, AckEnd, psCia );
+}
+
+/*! *******************************************************************
+ * \brief  KDAT driver -- called on every read of the line by the keyboard
+ * \param  pvContext: the port
+ * \param  u64Now: the virtual time
+ * \return 0 during the handshake, 1 otherwise
+ *********************************************************************/
+static U8 DriveKdat( void* pvContext, SIM_TIME u64Now )
+{
+  S_SIM_CIA* psCia = (S_SIM_CIA*)pvContext;
+  U8 u8Ret = 1u;
+  
+  if( ( TRUE == psCia->bAckOpen ) && ( u64Now >= psCia->u64AckStart ) && ( u64Now < ( psCia->u64AckStart + psCia->u64AckWidth ) ) )
+  {
+    psCia->bAckSampled = ( FALSE == Sim_Board_IsPeeking() ) ? TRUE : psCia->bAckSampled;
+    u8Ret = 0u;
+  }
+  if( u64Now < psCia->u64GlitchEnd )
+  {
+    u8Ret = 0u;
+  }
+  if( ( 0u != psCia->u16SendLength ) && ( 0u == psCia->u8SendData ) )
+  {
+    u8Ret = 0u;
+  }
+  
+  return u8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  KCLK driver -- the serial port drives the clock only in output mode
+ * \param  pvContext: the port
+ * \param  u64Now: the virtual time
+ * \return 0 during the low half of a bit, 1 otherwise
+ *********************************************************************/
+static U8 DriveKclk( void* pvContext, SIM_TIME u64Now )
+{
+  S_SIM_CIA* psCia = (S_SIM_CIA*)pvContext;
+  
+  (void)u64Now;
+  return ( ( 0u != psCia->u16SendLength ) && ( TRUE == psCia->bSendClockLow ) ) ? 0u : 1u;
+}
+
+/*! *******************************************************************
+ * \brief  A complete byte was shifted in -- queues it, and schedules the handshake
+ * \param  psCia: the port
+ * \param  u64Now: the virtual time
+ * \return -
+ *********************************************************************/
+static void ReceiveByte( S_SIM_CIA* psCia, SIM_TIME u64Now )
+{
+  S_SIM_CIA_CODE* psCode;
+  
+  psCia->sStats.u32Bytes++;
+  if( 0xFFu == psCia->u8Shift )
+  {
+    psCia->sStats.u32SyncBytes++;
+  }
+  
+  if( psCia->u16QueueCount < SIM_CIA_QUEUE_SIZE )
+  {
+    psCode = &psCia->asQueue[ ( psCia->u16QueueHead + psCia->u16QueueCount ) % SIM_CIA_QUEUE_SIZE ];
+    psCode->u64Time = u64Now;
+    psCode->u8Raw   = psCia->u8Shift;
+    psCode->u8Code  = psCia->u8Shift >> 1u;
+    psCode->bUp     = ( 0u != ( psCia->u8Shift & 0x01u ) ) ? TRUE : FALSE;
+    psCia->u16QueueCount++;
+  }
+  else
+  {
+    psCia->sStats.u32Overflows++;
+  }
+  
+  // handshake -- a stalled computer answers late
+  CloseAck( psCia, SIM_NEVER );
+  if( 0u == psCia->u8AcksToSkip )
+  {
+    ScheduleAck( psCia, ( ( u64Now + psCia->u64AckDelay ) < psCia->u64StallEnd ) ? psCia->u64StallEnd : ( u64Now + psCia->u64AckDelay ) );
+    psCia->bAckOpen    = TRUE;
+    psCia->bAckSampled = FALSE;
+    psCia->sStats.u32Acks++;
+  }
+  else
+  {
+    psCia->u8AcksToSkip--;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event at the end of a glitch on KDAT
+ * \param  pvContext: -
+ * \param  u64Time: the virtual time
+ * \return -
+ *********************************************************************/
+static void GlitchEnd( void* pvContext, SIM_TIME u64Time )
+{
+  (void)pvContext;
+  (void)u64Time;
+  Sim_Board_ExternalChanged();
+}
+
+/*! *******************************************************************
+ * \brief  Rising edge of KCLK -- applies the armed fault, then shifts in KDAT
+ * \param  psCia: the port
+ * \param  u64Now: the virtual time
+ * \return -
+ *********************************************************************/
+static void ShiftBit( S_SIM_CIA* psCia, SIM_TIME u64Now )
+{
+  BOOL bFaultBit = ( ( psCia->u32FaultByte == psCia->sStats.u32Bytes ) && ( psCia->u8FaultBit == psCia->u8BitCount ) ) ? TRUE : FALSE;
+
+  if( ( TRUE == psCia->bGlitchArmed ) && ( TRUE == bFaultBit ) )
+  {
+    psCia->bGlitchArmed = FALSE;
+    psCia->u64GlitchEnd = u64Now + SIM_CIA_GLITCH_WIDTH;
+    Sim_Event_Schedule( psCia->u64GlitchEnd, GlitchEnd, psCia );
+    Sim_Board_ExternalChanged();
+  }
+  if( ( TRUE == psCia->bRebootArmed ) && ( TRUE == bFaultBit ) )
+  {
+    // the serial port is reset, and nobody answers until the computer is up again
+    psCia->bRebootArmed = FALSE;
+    psCia->u8Shift = 0u;
+    psCia->u8BitCount = 0u;
+    psCia->bAckOpen = FALSE;
+    if( 0u != psCia->u32AckEvent )
+    {
+      Sim_Event_Cancel( psCia->u32AckEvent );
+      psCia->u32AckEvent = 0u;
+    }
+    if( 0u != psCia->u32AckStartEvent )
+    {
+      Sim_Event_Cancel( psCia->u32AckStartEvent );
+      psCia->u32AckStartEvent = 0u;
+    }
+    psCia->u64RebootEnd = u64Now + psCia->u64RebootDuration;
+    psCia->u64StallEnd = psCia->u64RebootEnd;
+    Sim_Board_ExternalChanged();
+  }
+
+  if( u64Now >= psCia->u64RebootEnd )
+  {
+    psCia->sStats.u32Bits++;
+    psCia->u8Shift = (U8)( psCia->u8Shift << 1u ) | ( ( ( 0u == Sim_GetLineDrive( SIM_LINE_KDAT ) ) || ( u64Now < psCia->u64GlitchEnd ) ) ? 1u : 0u );  // KDAT is inverted
+    psCia->u8BitCount++;
+    if( 8u == psCia->u8BitCount )
+    {
+      psCia->u8BitCount = 0u;
+      ReceiveByte( psCia, u64Now );
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Selects the bit of the fault: in the next byte, or in the current one, if it has not reached the bit yet
+ * \param  psCia: the port
+ * \param  u8Bit: 0..7
+ * \return -
+ *********************************************************************/
+static void ArmFault( S_SIM_CIA* psCia, U8 u8Bit )
+{
+  psCia->u8FaultBit = u8Bit % 8u;
+  psCia->u32FaultByte = psCia->sStats.u32Bytes + ( ( psCia->u8BitCount > psCia->u8FaultBit ) ? 1u : 0u );
+}
+
+/*! *******************************************************************
+ * \brief  Line observer -- the serial port shifts in KDAT on the rising edge of KCLK
+ * \param  pvContext: the port
+ * \param  u8Line: SIM_LINE_x
+ * \param  u8Level: level driven by the keyboard
+ * \param  u64Now: the virtual time
+ * \return -
+ *********************************************************************/
+static void ObserveLine( void* pvContext, U8 u8Line, U8 u8Level, SIM_TIME u64Now )
+{
+  S_SIM_CIA* psCia = (S_SIM_CIA*)pvContext;
+  
+  if( TRUE == psCia->bVerbose )
+  {
+    printf( "%12.1f us  %-8s %u\n", SIM_TO_US( u64Now ), Sim_GetLineName( u8Line ), u8Level );
+  }
+  
+  if( ( SIM_LINE_KCLK == u8Line ) && ( 1u == u8Level ) )
+  {
+    ShiftBit( psCia, u64Now );
+  }
+  else if( ( SIM_LINE_RESET == u8Line ) && ( 0u == u8Level ) )
+  {
+    psCia->sStats.u32Resets++;
+  }
+  else
+  {
+    // other lines are not connected to the CIA
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event of the output mode: falling KCLK edge with the next bit on KDAT, or rising edge, where the keyboard
+ *         samples it
+ * \param  pvContext: the port
+ * \param  u64Time: the virtual time
+ * \return -
+ *********************************************************************/
+static void SendEdge( void* pvContext, SIM_TIME u64Time )
+{
+  S_SIM_CIA* psCia = (S_SIM_CIA*)pvContext;
+  SIM_TIME u64Next = u64Time + ( psCia->u64SendPeriod / 2u );
+  
+  if( psCia->u16SendIndex >= psCia->u16SendLength )
+  {
+    // half a bit after the last rising edge: KDAT is released
+    psCia->u16SendLength = 0u;
+  }
+  else if( FALSE == psCia->bSendClockLow )
+  {
+    psCia->u8SendData = ( psCia->au8Send[ psCia->u16SendIndex ] >> ( 7u - psCia->u8SendBit ) ) & 0x01u;
+    psCia->bSendClockLow = TRUE;
+  }
+  else
+  {
+    psCia->bSendClockLow = FALSE;
+    psCia->u8SendBit++;
+    if( 8u == psCia->u8SendBit )
+    {
+      psCia->u8SendBit = 0u;
+      psCia->u16SendIndex++;
+      psCia->sStats.u32BytesSent++;
+      u64Next += ( psCia->u16SendIndex < psCia->u16SendLength ) ? SIM_CIA_SEND_GAP : 0u;
+    }
+  }
+  
+  if( 0u != psCia->u16SendLength )
+  {
+    Sim_Event_Schedule( u64Next, SendEdge, psCia );
+  }
+  Sim_Board_ExternalChanged();
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Connects the port to the keyboard connector
+ * \param  psCia: the port -- the configuration fields are kept, if already set
+ * \return -
+ * \note   Call after Sim_Board_Reset(), before powering up the keyboard.
+ *********************************************************************/
+void Sim_Cia_Connect( S_SIM_CIA* psCia )
+{
+  SIM_TIME u64AckDelay = ( 0u != psCia->u64AckDelay ) ? psCia->u64AckDelay : SIM_CIA_ACK_DELAY;
+  SIM_TIME u64AckWidth = ( 0u != psCia->u64AckWidth ) ? psCia->u64AckWidth : SIM_CIA_ACK_WIDTH;
+  BOOL     bVerbose    = psCia->bVerbose;
+  
+  memset( psCia, 0x00u, sizeof( *psCia ) );
+  psCia->u64AckDelay = u64AckDelay;
+  psCia->u64AckWidth = ( u64AckWidth < SIM_CIA_ACK_WIDTH_MIN ) ? SIM_CIA_ACK_WIDTH_MIN : u64AckWidth;
+  psCia->bVerbose    = ( TRUE == bVerbose ) ? TRUE : FALSE;
+  
+  Sim_SetLineDriver( SIM_LINE_KDAT, DriveKdat, psCia );
+  Sim_SetLineDriver( SIM_LINE_KCLK, DriveKclk, psCia );
+  Sim_AddLineObserver( ObserveLine, psCia );
+}
+
+/*! *******************************************************************
+ * \brief  Takes the oldest received byte
+ * \param  psCia: the port
+ * \param  psCode: output
+ * \return TRUE, if there was one
+ *********************************************************************/
+BOOL Sim_Cia_Read( S_SIM_CIA* psCia, S_SIM_CIA_CODE* psCode )
+{
+  BOOL bRet = FALSE;
+  
+  if( 0u != psCia->u16QueueCount )
+  {
+    *psCode = psCia->asQueue[ psCia->u16QueueHead ];
+    psCia->u16QueueHead = ( psCia->u16QueueHead + 1u ) % SIM_CIA_QUEUE_SIZE;
+    psCia->u16QueueCount--;
+    bRet = TRUE;
+  }
+  
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  The computer is busy -- no handshake is given until the end of the stall
+ * \param  psCia: the port
+ * \param  u64Duration: length of the stall from now
+ * \return -
+ * \note   A stall longer than 143 ms makes the keyboard resynchronize.
+ *********************************************************************/
+void Sim_Cia_Stall( S_SIM_CIA* psCia, SIM_TIME u64Duration )
+{
+  psCia->u64StallEnd = Sim_GetTime() + u64Duration;
+  if( ( TRUE == psCia->bAckOpen ) && ( psCia->u64AckStart > Sim_GetTime() ) && ( psCia->u64AckStart < psCia->u64StallEnd ) )
+  {
+    ScheduleAck( psCia, psCia->u64StallEnd );  // the scheduled handshake is postponed too
+  }
+}
+
+/*! *******************************************************************
+ * \brief  The serial port misses clock pulses, so the bit alignment is lost
+ * \param  psCia: the port
+ * \param  u8Bits: number of missed KCLK pulses
+ * \return -
+ * \note   The keyboard recovers by resynchronizing, when the handshake does not arrive in time.
+ *********************************************************************/
+void Sim_Cia_DropSync( S_SIM_CIA* psCia, U8 u8Bits )
+{
+  psCia->u8BitCount = (U8)( ( psCia->u8BitCount + 8u - ( u8Bits % 8u ) ) % 8u );
+}
+
+/*! *******************************************************************
+ * \brief  The computer does not answer the next bytes
+ * \param  psCia: the port
+ * \param  u8Count: number of bytes without handshake
+ * \return -
+ *********************************************************************/
+void Sim_Cia_SkipAcks( S_SIM_CIA* psCia, U8 u8Count )
+{
+  psCia->u8AcksToSkip = u8Count;
+}
+
+/*! *******************************************************************
+ * \brief  KDAT is pulled low for SIM_CIA_GLITCH_WIDTH at a rising edge of KCLK, so the port reads a 1 bit
+ * \param  psCia: the port
+ * \param  u8Bit: bit of the byte (0: first, 7: up/down flag), the next byte, that has not passed it yet
+ * \return -
+ *********************************************************************/
+void Sim_Cia_Glitch( S_SIM_CIA* psCia, U8 u8Bit )
+{
+  ArmFault( psCia, u8Bit );
+  psCia->bGlitchArmed = TRUE;
+}
+
+/*! *******************************************************************
+ * \brief  The computer resets in the middle of a byte: the bits shifted in so far and the handshake are lost
+ * \param  psCia: the port
+ * \param  u8Bit: the reset comes at this bit of the next byte, that has not passed it yet
+ * \param  u64Duration: the port does not shift and answer during the reboot
+ * \return -
+ *********************************************************************/
+void Sim_Cia_Reboot( S_SIM_CIA* psCia, U8 u8Bit, SIM_TIME u64Duration )
+{
+  ArmFault( psCia, u8Bit );
+  psCia->u64RebootDuration = u64Duration;
+  psCia->bRebootArmed = TRUE;
+}
+
+/*! *******************************************************************
+ * \brief  Output mode: the serial port shifts bytes out to the keyboard (KCLK: clock, KDAT: data, not inverted, most
+ *         significant bit first, stable at the rising edge of KCLK)
+ * \param  psCia: the port
+ * \param  pu8Data: the bytes
+ * \param  u16Length: number of bytes, at most SIM_CIA_SEND_SIZE
+ * \param  u64BitPeriod: length of a bit
+ * \return -
+ * \note   Only the bootloader listens to it. Received bytes are not shifted in meanwhile.
+ *********************************************************************/
+void Sim_Cia_Send( S_SIM_CIA* psCia, const U8* pu8Data, U16 u16Length, SIM_TIME u64BitPeriod )
+{
+  if( ( 0u == psCia->u16SendLength ) && ( 0u != u16Length ) )
+  {
+    psCia->u16SendLength = ( u16Length < SIM_CIA_SEND_SIZE ) ? u16Length : SIM_CIA_SEND_SIZE;
+    memcpy( psCia->au8Send, pu8Data, psCia->u16SendLength );
+    psCia->u16SendIndex  = 0u;
+    psCia->u8SendBit     = 0u;
+    psCia->u8SendData    = 1u;
+    psCia->bSendClockLow = FALSE;
+    psCia->u64SendPeriod = u64BitPeriod;
+    Sim_Event_Schedule( Sim_GetTime(), SendEdge, psCia );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Is the output mode still shifting?
+ * \param  psCia: the port
+ * \return TRUE, until KDAT is released after the last bit
+ *********************************************************************/
+BOOL Sim_Cia_IsSending( const S_SIM_CIA* psCia )
+{
+  return ( 0u != psCia->u16SendLength ) ? TRUE : FALSE;
+}
+
+/******************************<EOF>**********************************/
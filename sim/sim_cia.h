@@ -0,0 +1,123 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_cia.h
+*
+* \brief Host simulation -- keyboard port of the CIA-A, as the computer side of the connector
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+#ifndef SIM_CIA_H_INCLUDED
+#define SIM_CIA_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_CIA_ACK_DELAY       SIM_US( 1 )    //!< Default: last KCLK rising edge --> start of the handshake
+#define SIM_CIA_ACK_WIDTH       SIM_US( 85 )   //!< Default: the computer pulls KDAT low for at least 85 us
+#define SIM_CIA_ACK_WIDTH_MIN   SIM_US( 1 )    //!< Shortest handshake allowed by the documentation
+#define SIM_CIA_QUEUE_SIZE      256u           //!< Received codes not read yet by the host program
+#define SIM_CIA_GLITCH_WIDTH    SIM_US( 2 )    //!< KDAT pulled low by a glitch
+#define SIM_CIA_SEND_SIZE       128u           //!< Output mode: longest transfer to the keyboard
+#define SIM_CIA_SEND_GAP        SIM_US( 10 )   //!< Output mode: last bit of a byte --> first bit of the next one
+
+// Special codes of the keyboard (raw byte >> 1)
+#define SIM_CIA_CODE_LOST_SYNC  0x7Cu  //!< 0xF9 -- last key code bad, next code is the same code retransmitted
+#define SIM_CIA_CODE_INIT       0x7Eu  //!< 0xFD -- initiate power-up key stream
+#define SIM_CIA_CODE_TERM       0x7Fu  //!< 0xFE -- terminate power-up key stream
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief One byte received from the keyboard
+typedef struct
+{
+  SIM_TIME u64Time;  //!< Rising KCLK edge of the last bit
+  U8       u8Raw;    //!< As shifted in (KDAT inverted): 7 bit code, then the up/down bit
+  U8       u8Code;   //!< Key code
+  BOOL     bUp;      //!< TRUE, if released
+} S_SIM_CIA_CODE;
+
+//! \brief Counters of the port
+typedef struct
+{
+  U32 u32Bits;       //!< KCLK rising edges
+  U32 u32Bytes;      //!< Complete bytes
+  U32 u32Acks;       //!< Handshakes given
+  U32 u32AcksMissed; //!< Handshake started, while the keyboard was not listening (sampled no low level)
+  U32 u32SyncBytes;  //!< Bytes of only 1 bits -- the synchronization pulses of the keyboard
+  U32 u32Overflows;  //!< Received codes dropped, because the queue was full
+  U32 u32Resets;     //!< Falling edges of the reset line
+  U32 u32BytesSent;  //!< Bytes shifted out to the keyboard in output mode
+} S_SIM_CIA_STATS;
+
+//! \brief State of the port
+typedef struct
+{
+  // Configuration -- may be changed between two runs
+  SIM_TIME        u64AckDelay;  //!< Last bit --> start of the handshake
+  SIM_TIME        u64AckWidth;  //!< Length of the handshake (at least SIM_CIA_ACK_WIDTH_MIN)
+  BOOL            bVerbose;     //!< Prints the line changes
+  
+  // Internal
+  U8              u8Shift;
+  U8              u8BitCount;
+  SIM_TIME        u64AckStart;
+  SIM_TIME        u64StallEnd;  //!< No handshake before this time
+  BOOL            bAckOpen;     //!< Handshake given, not evaluated yet
+  U32             u32AckEvent;  //!< End of the handshake
+  U32             u32AckStartEvent;
+  U8              u8AcksToSkip; //!< Fault: bytes left without handshake
+  BOOL            bGlitchArmed; //!< Fault: KDAT is pulled low at a bit of a coming byte
+  BOOL            bRebootArmed; //!< Fault: the computer resets at a bit of a coming byte
+  U32             u32FaultByte; //!< Byte of the armed fault (value of sStats.u32Bytes)
+  U8              u8FaultBit;   //!< Bit of the armed fault, 0 is the first one
+  SIM_TIME        u64GlitchEnd;
+  SIM_TIME        u64RebootDuration;
+  SIM_TIME        u64RebootEnd; //!< The port does not shift before this time
+  BOOL            bAckSampled;  //!< The keyboard read KDAT low during the handshake
+  S_SIM_CIA_CODE  asQueue[ SIM_CIA_QUEUE_SIZE ];
+  U16             u16QueueHead;
+  U16             u16QueueCount;
+  U8              au8Send[ SIM_CIA_SEND_SIZE ];  //!< Output mode: bytes to shift out
+  U16             u16SendLength;                 //!< Output mode: 0, if not sending
+  U16             u16SendIndex;
+  U8              u8SendBit;                     //!< Bit of the byte, 0 is the most significant one
+  U8              u8SendData;                    //!< Level driven on KDAT
+  BOOL            bSendClockLow;                 //!< KCLK is driven low
+  SIM_TIME        u64SendPeriod;                 //!< Length of a bit
+  S_SIM_CIA_STATS sStats;
+} S_SIM_CIA;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Sim_Cia_Connect( S_SIM_CIA* psCia );
+BOOL Sim_Cia_Read( S_SIM_CIA* psCia, S_SIM_CIA_CODE* psCode );
+void Sim_Cia_Stall( S_SIM_CIA* psCia, SIM_TIME u64Duration );
+void Sim_Cia_DropSync( S_SIM_CIA* psCia, U8 u8Bits );
+void Sim_Cia_SkipAcks( S_SIM_CIA* psCia, U8 u8Count );
+void Sim_Cia_Glitch( S_SIM_CIA* psCia, U8 u8Bit );
+void Sim_Cia_Reboot( S_SIM_CIA* psCia, U8 u8Bit, SIM_TIME u64Duration );
+void Sim_Cia_Send( S_SIM_CIA* psCia, const U8* pu8Data, U16 u16Length, SIM_TIME u64BitPeriod );
+BOOL Sim_Cia_IsSending( const S_SIM_CIA* psCia );
+
+
+#endif // SIM_CIA_H_INCLUDED
+/******************************<EOF>**********************************/
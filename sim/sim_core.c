@@ -0,0 +1,477 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_core.c
+*
+* \brief Host simulation -- virtual time and the CPU running the unchanged firmware
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "types.h"
+
+// Own include
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_STACK_SIZE    ( 1024u * 1024u )  //!< Stack of the firmware context
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+//! \brief State of the simulated CPU
+static struct
+{
+  SIM_TIME    u64Now;              //!< Virtual time
+  SIM_TIME    u64RunEnd;           //!< The firmware context gives back control at this time
+  BOOL        bStarted;            //!< Firmware context created
+  BOOL        bInterruptsEnabled;  //!< Global interrupt mask of the CPU (RIM/SIM)
+  BOOL        bInInterrupt;        //!< Interrupt routine running
+  BOOL        bHalted;             //!< CPU stopped by HALT
+  BOOL        bWaiting;            //!< CPU stopped by WFI
+  U8          u8MasterDivider;     //!< fHSI / fMASTER
+  U8          u8CpuDivider;        //!< fHSI / fCPU
+  U32         u32LoopActivity;     //!< Peripheral access counter at the start of the last main cycle turn
+  U32         u32LoopInterrupts;   //!< Interrupt counter at the start of the last main cycle turn
+  SIM_INTERRUPT_HOOK pfInterruptHook;
+  void*       pvInterruptHookContext;
+  S_SIM_STATS sStats;
+  ucontext_t  sHostContext;
+  ucontext_t  sFirmwareContext;
+} gsSimCpu;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void FirmwareEntry( void );
+static void Yield( void );
+static void DispatchInterrupts( void );
+static void Advance( SIM_TIME u64Time );
+
+// Firmware entry points (fw/main.c is compiled with main renamed, fw/stm8s_it.c unchanged)
+void Firmware_Main( void );
+void TIM2_UPD_OVF_BRK_IRQHandler( void );
+void __real_Matrix_Cycle( void );
+void __wrap_Matrix_Cycle( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Entry of the firmware context -- power-up of the controller
+ * \param  -
+ * \return -
+ *********************************************************************/
+static void FirmwareEntry( void )
+{
+  Firmware_Main();
+  
+  // main() of the firmware never returns
+  fprintf( stderr, "sim: firmware main() returned\n" );
+  exit( EXIT_FAILURE );
+}
+
+/*! *******************************************************************
+ * \brief  Gives back control to the host, if the run has ended
+ * \param  -
+ * \return -
+ *********************************************************************/
+static void Yield( void )
+{
+  while( gsSimCpu.u64Now >= gsSimCpu.u64RunEnd )
+  {
+    swapcontext( &gsSimCpu.sFirmwareContext, &gsSimCpu.sHostContext );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Serves the pending interrupts
+ * \param  -
+ * \return -
+ * \note   Interrupts are not nested, like on the STM8 with equal priorities.
+ *********************************************************************/
+static void DispatchInterrupts( void )
+{
+  SIM_TIME u64Start;
+  
+  while( ( TRUE == gsSimCpu.bInterruptsEnabled ) && ( FALSE == gsSimCpu.bInInterrupt ) && ( TRUE == Sim_Tim2_IsInterruptPending() ) )
+  {
+    gsSimCpu.bInInterrupt = TRUE;
+    gsSimCpu.bHalted = FALSE;
+    gsSimCpu.bWaiting = FALSE;
+    u64Start = gsSimCpu.u64Now;
+    
+    if( NULL != gsSimCpu.pfInterruptHook )
+    {
+      gsSimCpu.pfInterruptHook( gsSimCpu.pvInterruptHookContext, TRUE, u64Start );
+    }
+    Sim_Consume( SIM_CYCLES_IT_ENTRY );
+    TIM2_UPD_OVF_BRK_IRQHandler();
+    if( NULL != gsSimCpu.pfInterruptHook )
+    {
+      gsSimCpu.pfInterruptHook( gsSimCpu.pvInterruptHookContext, FALSE, gsSimCpu.u64Now );
+    }
+    
+    gsSimCpu.sStats.u32Interrupts++;
+    gsSimCpu.sStats.u64InterruptTime += gsSimCpu.u64Now - u64Start;
+    if( ( gsSimCpu.u64Now - u64Start ) > gsSimCpu.sStats.u64MaxInterrupt )
+    {
+      gsSimCpu.sStats.u64MaxInterrupt = gsSimCpu.u64Now - u64Start;
+    }
+    gsSimCpu.bInInterrupt = FALSE;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Moves the virtual time forward, and accounts it to the state of the CPU
+ * \param  u64Time: the new time, nothing happens if it is not later
+ * \return -
+ *********************************************************************/
+static void Advance( SIM_TIME u64Time )
+{
+  U8 u8Step = 0u;
+  
+  if( u64Time > gsSimCpu.u64Now )
+  {
+    while( ( ( 2u << u8Step ) <= gsSimCpu.u8CpuDivider ) && ( u8Step < ( SIM_CPU_DIVIDER_STEPS - 1u ) ) )
+    {
+      u8Step++;
+    }
+    if( TRUE == gsSimCpu.bHalted )
+    {
+      gsSimCpu.sStats.u64HaltTime += u64Time - gsSimCpu.u64Now;
+    }
+    else if( TRUE == gsSimCpu.bWaiting )
+    {
+      gsSimCpu.sStats.au64WaitTime[ u8Step ] += u64Time - gsSimCpu.u64Now;
+    }
+    else
+    {
+      gsSimCpu.sStats.au64RunTime[ u8Step ] += u64Time - gsSimCpu.u64Now;
+    }
+    gsSimCpu.u64Now = u64Time;
+  }
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Runs the firmware until the given virtual time
+ * \param  u64Time: end of the run
+ * \return -
+ * \note   The first call powers up the controller. The firmware keeps its state between the calls,
+ *         so the host can change the inputs and check the outputs between them.
+ *********************************************************************/
+void Sim_RunUntil( SIM_TIME u64Time )
+{
+  static U8* pu8Stack = NULL;
+  
+  if( FALSE == gsSimCpu.bStarted )
+  {
+    gsSimCpu.bStarted        = TRUE;
+    Sim_Periph_Reset();
+    gsSimCpu.u8MasterDivider = 8u;  // after reset, fMASTER = fHSI / 8
+    gsSimCpu.u8CpuDivider    = 8u;
+    
+    pu8Stack = malloc( SIM_STACK_SIZE );
+    getcontext( &gsSimCpu.sFirmwareContext );
+    gsSimCpu.sFirmwareContext.uc_stack.ss_sp   = pu8Stack;
+    gsSimCpu.sFirmwareContext.uc_stack.ss_size = SIM_STACK_SIZE;
+    gsSimCpu.sFirmwareContext.uc_link          = NULL;
+    makecontext( &gsSimCpu.sFirmwareContext, FirmwareEntry, 0 );
+  }
+  
+  if( u64Time > gsSimCpu.u64Now )
+  {
+    gsSimCpu.u64RunEnd = u64Time;
+    swapcontext( &gsSimCpu.sHostContext, &gsSimCpu.sFirmwareContext );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Runs the firmware for the given virtual time
+ * \param  u64Duration: length of the run
+ * \return -
+ *********************************************************************/
+void Sim_RunFor( SIM_TIME u64Duration )
+{
+  Sim_RunUntil( gsSimCpu.u64Now + u64Duration );
+}
+
+/*! *******************************************************************
+ * \brief  Gets the virtual time
+ * \param  -
+ * \return Periods of the HSI oscillator since power-up
+ *********************************************************************/
+SIM_TIME Sim_GetTime( void )
+{
+  return gsSimCpu.u64Now;
+}
+
+/*! *******************************************************************
+ * \brief  Gets the statistics of the simulated CPU
+ * \param  -
+ * \return Pointer to the statistics
+ *********************************************************************/
+const S_SIM_STATS* Sim_GetStats( void )
+{
+  return &gsSimCpu.sStats;
+}
+
+/*! *******************************************************************
+ * \brief  Lets the firmware use CPU cycles -- interrupts are served meanwhile, and they add to the time
+ * \param  u32Cycles: number of CPU cycles
+ * \return -
+ *********************************************************************/
+void Sim_Consume( U32 u32Cycles )
+{
+  SIM_TIME u64Target = gsSimCpu.u64Now + ( (SIM_TIME)u32Cycles * gsSimCpu.u8CpuDivider );
+  SIM_TIME u64Interrupts = gsSimCpu.sStats.u64InterruptTime;
+  
+  Sim_WaitUntil( u64Target );
+  
+  // the interrupts served meanwhile delay the end
+  while( u64Interrupts != gsSimCpu.sStats.u64InterruptTime )
+  {
+    u64Target += gsSimCpu.sStats.u64InterruptTime - u64Interrupts;
+    u64Interrupts = gsSimCpu.sStats.u64InterruptTime;
+    Sim_WaitUntil( u64Target );
+  }
+}
+/*! *******************************************************************
+ * \brief  Used by the peripheral models, counts as activity of the firmware
+ * \param  u32Cycles: number of CPU cycles of the access
+ * \return -
+ *********************************************************************/
+void Sim_PeriphAccess( U32 u32Cycles )
+{
+  gsSimCpu.sStats.u32PeriphAccess++;
+  Sim_Consume( u32Cycles );
+}
+
+/*! *******************************************************************
+ * \brief  Cost of the ghost key test of Matrix_Sample(), see MATRIX_GHOST_HOOK
+ * \param  u8Compared: turns of the loop, its own column included
+ * \return -
+ * \note   The worst case: every other column has two rows in common. Cycles of the STM8 instructions of a turn (PM0044),
+ *         the index in XL, the own column and its closed rows, the common rows and the ghosts in virtual registers:
+ *           clrw x; ld xl,a; ld a,(gau8KeyClosed,x); and a,?b2; ld ?b4,a         5
+ *           ld a,xl; cp a,?b0; jreq next                                        3 (4, if taken: own column)
+ *           ld a,?b4; dec a; and a,?b4; jreq next                               4
+ *           ld a,?b3; or a,?b4; ld ?b3,a                                        3
+ *     next: ld a,xl; inc a; cp a,#MATRIX_COL; jrc loop                          5 (taken)
+ *         20 cycles, 14 on the own column; the call (4), ret (4) and 16 cycles of setup and result around the loop.
+ *         The instructions fit the 32 bit fetch of the core, so there are no fetch stalls. On the target,
+ *         gsLatencyBlock.u16GhostMaxClocks reports the measured cost (LATENCY_ENABLED).
+ *********************************************************************/
+void Sim_Matrix_GhostTest( U8 u8Compared )
+{
+  gsSimCpu.sStats.u32GhostTests++;
+  Sim_Consume( SIM_CYCLES_GHOST_CALL + ( (U32)u8Compared * SIM_CYCLES_GHOST_COLUMN ) - SIM_CYCLES_GHOST_OWN );
+}
+
+/*! *******************************************************************
+ * \brief  Advances the virtual time -- interrupts are served meanwhile
+ * \param  u64Time: the time to advance to
+ * \return -
+ *********************************************************************/
+void Sim_WaitUntil( SIM_TIME u64Time )
+{
+  SIM_TIME u64Next;
+  
+  // fast path: nothing happens until the time -- interrupts get pending only by events
+  if( ( u64Time < Sim_Event_NextTime() ) && ( u64Time < gsSimCpu.u64RunEnd ) )
+  {
+    Advance( u64Time );
+  }
+  else
+  {
+    do
+    {
+      // jump to the next point, where something can happen
+      u64Next = u64Time;
+      if( Sim_Event_NextTime() < u64Next )
+      {
+        u64Next = Sim_Event_NextTime();
+      }
+      if( gsSimCpu.u64RunEnd < u64Next )
+      {
+        u64Next = gsSimCpu.u64RunEnd;
+      }
+      Advance( u64Next );
+      
+      Sim_Event_RunDue( gsSimCpu.u64Now );
+      Yield();
+      DispatchInterrupts();
+    } while( gsSimCpu.u64Now < u64Time );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Sets the clock tree
+ * \param  u8MasterDivider: fHSI / fMASTER
+ * \param  u8CpuDivider: fHSI / fCPU
+ * \return -
+ *********************************************************************/
+void Sim_SetClockDividers( U8 u8MasterDivider, U8 u8CpuDivider )
+{
+  gsSimCpu.u8MasterDivider = u8MasterDivider;
+  gsSimCpu.u8CpuDivider    = u8CpuDivider;
+}
+
+/*! *******************************************************************
+ * \brief  Gets fHSI / fMASTER
+ * \param  -
+ * \return Divider of the master clock
+ *********************************************************************/
+U8 Sim_GetMasterDivider( void )
+{
+  return gsSimCpu.u8MasterDivider;
+}
+
+/*! *******************************************************************
+ * \brief  Gets fHSI / fCPU
+ * \param  -
+ * \return Divider of the CPU clock
+ *********************************************************************/
+U8 Sim_GetCpuDivider( void )
+{
+  return gsSimCpu.u8CpuDivider;
+}
+
+/*! *******************************************************************
+ * \brief  Sets the hook of the TIM2 interrupt routine (only one at a time)
+ * \param  pfHook: called at the entry and at the exit, NULL removes it
+ * \param  pvContext: passed to the hook
+ * \return -
+ *********************************************************************/
+void Sim_SetInterruptHook( SIM_INTERRUPT_HOOK pfHook, void* pvContext )
+{
+  gsSimCpu.pfInterruptHook = pfHook;
+  gsSimCpu.pvInterruptHookContext = pvContext;
+}
+
+/*! *******************************************************************
+ * \brief  RIM instruction
+ *********************************************************************/
+void Sim_EnableInterrupts( void )
+{
+  gsSimCpu.bInterruptsEnabled = TRUE;
+  DispatchInterrupts();
+}
+
+/*! *******************************************************************
+ * \brief  SIM instruction
+ *********************************************************************/
+void Sim_DisableInterrupts( void )
+{
+  gsSimCpu.bInterruptsEnabled = FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  WFI instruction -- sleeps until the next interrupt
+ *********************************************************************/
+void Sim_WaitForInterrupt( void )
+{
+  U32 u32Interrupts = gsSimCpu.sStats.u32Interrupts;
+  
+  gsSimCpu.bInterruptsEnabled = TRUE;
+  gsSimCpu.bWaiting = TRUE;  // cleared by the interrupt
+  while( u32Interrupts == gsSimCpu.sStats.u32Interrupts )
+  {
+    Sim_WaitUntil( ( SIM_NEVER != Sim_Event_NextTime() ) ? Sim_Event_NextTime() : gsSimCpu.u64RunEnd );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  PUSH CC -- the interrupt mask, for __get_interrupt_state()
+ *********************************************************************/
+U8 Sim_GetInterruptState( void )
+{
+  return ( TRUE == gsSimCpu.bInterruptsEnabled ) ? 1u : 0u;
+}
+
+/*! *******************************************************************
+ * \brief  POP CC -- restores the interrupt mask, for __set_interrupt_state()
+ *********************************************************************/
+void Sim_SetInterruptState( U8 u8State )
+{
+  if( 0u != u8State )
+  {
+    Sim_EnableInterrupts();
+  }
+  else
+  {
+    Sim_DisableInterrupts();
+  }
+}
+
+/*! *******************************************************************
+ * \brief  HALT instruction -- there is no wake-up source in the model, the CPU stops
+ *********************************************************************/
+void Sim_Halt( void )
+{
+  gsSimCpu.bHalted = TRUE;
+  while( TRUE == gsSimCpu.bHalted )
+  {
+    Sim_WaitUntil( gsSimCpu.u64RunEnd );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Main cycle hook (linked with --wrap=Matrix_Cycle)
+ * \param  -
+ * \return -
+ * \note   If the previous turn touched no peripheral and was not interrupted, then the next turns will
+ *         do the same until the next event (the timer, or a change made by the host), so the virtual
+ *         time jumps there.
+ *********************************************************************/
+void __wrap_Matrix_Cycle( void )
+{
+  SIM_TIME u64Next;
+  
+  if( ( 0u != gsSimCpu.sStats.u32MainLoops )
+   && ( gsSimCpu.u32LoopActivity   == gsSimCpu.sStats.u32PeriphAccess )
+   && ( gsSimCpu.u32LoopInterrupts == gsSimCpu.sStats.u32Interrupts ) )
+  {
+    u64Next = Sim_Event_NextTime();
+    if( gsSimCpu.u64RunEnd < u64Next )
+    {
+      u64Next = gsSimCpu.u64RunEnd;
+    }
+    gsSimCpu.sStats.u64IdleSkipped += u64Next - gsSimCpu.u64Now;
+    Sim_WaitUntil( u64Next );
+  }
+  
+  gsSimCpu.sStats.u32MainLoops++;
+  gsSimCpu.u32LoopActivity   = gsSimCpu.sStats.u32PeriphAccess;
+  gsSimCpu.u32LoopInterrupts = gsSimCpu.sStats.u32Interrupts;
+  
+  Sim_Consume( SIM_CYCLES_MAIN_LOOP );
+  __real_Matrix_Cycle();
+}
+
+/******************************<EOF>**********************************/
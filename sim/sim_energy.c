@@ -0,0 +1,212 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_energy.c
+*
+* \brief Host simulation -- supply current estimate from the CPU state residency and the activity of the lines
+*
+* \note  The lines are followed by a line observer: the time each one is driven low, its rising edges, and the keys
+*        pressed in the driven columns (sampled at the changes of the lines, the keys change much slower).
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include "types.h"
+
+// Own include
+#include "sim_energy.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static const char* const gcapcPartNames[ SIM_ENERGY_PART_COUNT ] = { "cpu", "matrix", "led", "lines", "switching" };
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void   Account( S_SIM_ENERGY* psEnergy, SIM_TIME u64Now );
+static void   ObserveLine( void* pvContext, U8 u8Line, U8 u8Level, SIM_TIME u64Now );
+static double Interpolate( double dHighMa, double dLowMa, U8 u8Step );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Adds the time since the last change to the lines driven low, and to the pressed keys of the driven columns
+ * \param  psEnergy: the accumulator
+ * \param  u64Now: the virtual time
+ * \return -
+ *********************************************************************/
+static void Account( S_SIM_ENERGY* psEnergy, SIM_TIME u64Now )
+{
+  SIM_TIME u64Elapsed = u64Now - psEnergy->u64Last;
+  U8       u8Line;
+  U8       u8Row;
+
+  for( u8Line = 0u; u8Line < SIM_LINE_COUNT; u8Line++ )
+  {
+    if( 0u == psEnergy->au8Drive[ u8Line ] )
+    {
+      psEnergy->au64Low[ u8Line ] += u64Elapsed;
+      if( ( u8Line >= SIM_LINE_COL0 ) && ( u8Line < ( SIM_LINE_COL0 + SIM_COL_COUNT ) ) )
+      {
+        for( u8Row = 0u; u8Row < SIM_ROW_COUNT; u8Row++ )
+        {
+          psEnergy->u64KeyLowTime += ( TRUE == Sim_IsKeyPressed( u8Row, u8Line - SIM_LINE_COL0 ) ) ? u64Elapsed : 0u;
+        }
+      }
+    }
+  }
+  psEnergy->u64Last = u64Now;
+}
+
+/*! *******************************************************************
+ * \brief  Line observer -- a line driven by the controller changed
+ * \param  pvContext: the accumulator
+ * \param  u8Line: SIM_LINE_x
+ * \param  u8Level: level driven by the controller
+ * \param  u64Now: the virtual time
+ * \return -
+ *********************************************************************/
+static void ObserveLine( void* pvContext, U8 u8Line, U8 u8Level, SIM_TIME u64Now )
+{
+  S_SIM_ENERGY* psEnergy = (S_SIM_ENERGY*)pvContext;
+
+  Account( psEnergy, u64Now );
+  if( u8Level != psEnergy->au8Drive[ u8Line ] )
+  {
+    psEnergy->au32Rising[ u8Line ] += ( 0u != u8Level ) ? 1u : 0u;
+    psEnergy->au8Drive[ u8Line ] = u8Level;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Supply current at a clock, linear between the two datasheet points
+ * \param  dHighMa: at SIM_ENERGY_HIGH_MHZ
+ * \param  dLowMa: at SIM_ENERGY_LOW_MHZ
+ * \param  u8Step: fCPU = 16 MHz / 2^u8Step
+ * \return mA
+ *********************************************************************/
+static double Interpolate( double dHighMa, double dLowMa, U8 u8Step )
+{
+  double dMhz = ( (double)SIM_HSI_HZ / 1e6 ) / (double)( 1u << u8Step );
+
+  return dLowMa + ( ( dHighMa - dLowMa ) * ( dMhz - SIM_ENERGY_LOW_MHZ ) / ( SIM_ENERGY_HIGH_MHZ - SIM_ENERGY_LOW_MHZ ) );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Starts following the lines
+ * \param  psEnergy: the accumulator, it must live until the end of the simulation
+ * \return -
+ * \note   Call after Sim_Board_Reset(), before powering up the keyboard.
+ *********************************************************************/
+void Sim_Energy_Connect( S_SIM_ENERGY* psEnergy )
+{
+  memset( psEnergy, 0x00u, sizeof( *psEnergy ) );
+  memset( psEnergy->au8Drive, 1u, sizeof( psEnergy->au8Drive ) );  // every pin is an input after reset
+  psEnergy->u64Last = Sim_GetTime();
+  Sim_AddLineObserver( ObserveLine, psEnergy );
+}
+
+/*! *******************************************************************
+ * \brief  Copies the activity so far
+ * \param  psEnergy: the accumulator
+ * \param  psSnapshot: output, the start or the end of a period
+ * \return -
+ *********************************************************************/
+void Sim_Energy_Snapshot( S_SIM_ENERGY* psEnergy, S_SIM_ENERGY* psSnapshot )
+{
+  Account( psEnergy, Sim_GetTime() );
+  *psSnapshot = *psEnergy;
+  psSnapshot->u64Time = Sim_GetTime();
+  psSnapshot->sCpu = *Sim_GetStats();
+}
+
+/*! *******************************************************************
+ * \brief  Estimate of the period between two snapshots
+ * \param  psFrom: the start
+ * \param  psTo: the end
+ * \param  psReport: output
+ * \return -
+ *********************************************************************/
+void Sim_Energy_Report( const S_SIM_ENERGY* psFrom, const S_SIM_ENERGY* psTo, S_SIM_ENERGY_REPORT* psReport )
+{
+  double dTicks = (double)( psTo->u64Time - psFrom->u64Time );
+  double dCharge = 0.0;  // mA x ticks
+  U32    u32Rising = 0u;
+  U8     u8Index;
+
+  memset( psReport, 0x00u, sizeof( *psReport ) );
+  dTicks = ( dTicks > 0.0 ) ? dTicks : 1.0;
+  psReport->dSeconds = dTicks / (double)SIM_HSI_HZ;
+
+  // the controller
+  for( u8Index = 0u; u8Index < SIM_CPU_DIVIDER_STEPS; u8Index++ )
+  {
+    psReport->adRunShare[ u8Index ]  = (double)( psTo->sCpu.au64RunTime[ u8Index ] - psFrom->sCpu.au64RunTime[ u8Index ] ) / dTicks;
+    psReport->adWaitShare[ u8Index ] = (double)( psTo->sCpu.au64WaitTime[ u8Index ] - psFrom->sCpu.au64WaitTime[ u8Index ] ) / dTicks;
+    dCharge += psReport->adRunShare[ u8Index ]  * Interpolate( SIM_ENERGY_RUN_HIGH_MA, SIM_ENERGY_RUN_LOW_MA, u8Index );
+    dCharge += psReport->adWaitShare[ u8Index ] * Interpolate( SIM_ENERGY_WAIT_HIGH_MA, SIM_ENERGY_WAIT_LOW_MA, u8Index );
+  }
+  psReport->dHaltShare = (double)( psTo->sCpu.u64HaltTime - psFrom->sCpu.u64HaltTime ) / dTicks;
+  psReport->adCurrentMa[ SIM_ENERGY_PART_CPU ] = dCharge + ( psReport->dHaltShare * SIM_ENERGY_HALT_MA );
+
+  // the lines
+  for( u8Index = 0u; u8Index < SIM_LINE_COUNT; u8Index++ )
+  {
+    psReport->adLowShare[ u8Index ] = (double)( psTo->au64Low[ u8Index ] - psFrom->au64Low[ u8Index ] ) / dTicks;
+    psReport->adRisingPerSecond[ u8Index ] = (double)( psTo->au32Rising[ u8Index ] - psFrom->au32Rising[ u8Index ] ) / psReport->dSeconds;
+    u32Rising += psTo->au32Rising[ u8Index ] - psFrom->au32Rising[ u8Index ];
+  }
+  psReport->adCurrentMa[ SIM_ENERGY_PART_MATRIX ] = (double)( psTo->u64KeyLowTime - psFrom->u64KeyLowTime ) / dTicks
+                                                  * 1000.0 * ( SIM_ENERGY_VDD - SIM_ENERGY_DIODE_V ) / SIM_ENERGY_ROW_PULLUP_OHM;
+  psReport->adCurrentMa[ SIM_ENERGY_PART_LED ] = ( 1.0 - psReport->adLowShare[ SIM_LINE_CAPSLED ] )
+                                               * 1000.0 * ( SIM_ENERGY_VDD - SIM_ENERGY_LED_V ) / SIM_ENERGY_LED_OHM;
+  psReport->adCurrentMa[ SIM_ENERGY_PART_LINES ] = ( psReport->adLowShare[ SIM_LINE_KCLK ] + psReport->adLowShare[ SIM_LINE_KDAT ]
+                                                   + psReport->adLowShare[ SIM_LINE_RESET ] )
+                                                 * 1000.0 * SIM_ENERGY_VDD / SIM_ENERGY_HOST_PULLUP_OHM;
+  psReport->adCurrentMa[ SIM_ENERGY_PART_SWITCHING ] = (double)u32Rising * SIM_ENERGY_LINE_PF * 1e-12 * SIM_ENERGY_VDD * 1000.0
+                                                     / psReport->dSeconds;
+
+  for( u8Index = 0u; u8Index < SIM_ENERGY_PART_COUNT; u8Index++ )
+  {
+    psReport->dCurrentMa += psReport->adCurrentMa[ u8Index ];
+  }
+  psReport->dEnergyMj = psReport->dCurrentMa * SIM_ENERGY_VDD * psReport->dSeconds;
+}
+
+/*! *******************************************************************
+ * \brief  Name of a part of the estimate
+ * \param  u8Part: SIM_ENERGY_PART_x
+ * \return e.g. "cpu"
+ *********************************************************************/
+const char* Sim_Energy_GetPartName( U8 u8Part )
+{
+  return ( u8Part < SIM_ENERGY_PART_COUNT ) ? gcapcPartNames[ u8Part ] : "?";
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,94 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_energy.h
+*
+* \brief Host simulation -- supply current estimate from the CPU state residency and the activity of the lines
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+#ifndef SIM_ENERGY_H_INCLUDED
+#define SIM_ENERGY_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_ENERGY_VDD            5.0      //!< V, supply of the connector
+
+// STM8S003K3 datasheet, typical values at VDD = 5 V, 25 C, code executed from the flash, HSI clock. The current of
+// the run and the wait mode is interpolated linearly between the two clock frequencies.
+#define SIM_ENERGY_RUN_HIGH_MA    3.7      //!< IDD(RUN), fCPU = 16 MHz
+#define SIM_ENERGY_RUN_LOW_MA     0.7      //!< IDD(RUN), fCPU = fMASTER / 128 = 125 kHz
+#define SIM_ENERGY_WAIT_HIGH_MA   0.89     //!< IDD(WFI), fCPU = 16 MHz
+#define SIM_ENERGY_WAIT_LOW_MA    0.45     //!< IDD(WFI), fCPU = fMASTER / 128 = 125 kHz
+#define SIM_ENERGY_HALT_MA        0.00055  //!< IDD(H), main regulator off, flash powered down
+#define SIM_ENERGY_HIGH_MHZ       16.0
+#define SIM_ENERGY_LOW_MHZ        0.125
+
+// Loads of the lines (BOM of revision B, and the computer side)
+#define SIM_ENERGY_ROW_PULLUP_OHM 4700.0   //!< R98..R103, a pressed key in a driven column pulls its row low
+#define SIM_ENERGY_DIODE_V        0.7      //!< Forward voltage of the matrix diodes at about 1 mA
+#define SIM_ENERGY_LED_OHM        1000.0   //!< Series resistor of the Caps Lock LED, lit at high level
+#define SIM_ENERGY_LED_V          2.1      //!< Forward voltage of the LED
+#define SIM_ENERGY_HOST_PULLUP_OHM 1000.0  //!< KCLK, KDAT and RESET pull-ups in the computer (assumed)
+#define SIM_ENERGY_LINE_PF        30.0     //!< Pin, trace and diode capacitance of a line, charged at every rising edge
+
+// Parts of the estimate
+#define SIM_ENERGY_PART_CPU       0u       //!< The controller: run, wait and halt modes
+#define SIM_ENERGY_PART_MATRIX    1u       //!< Row pull-ups through the pressed keys
+#define SIM_ENERGY_PART_LED       2u       //!< Caps Lock LED
+#define SIM_ENERGY_PART_LINES     3u       //!< Pull-ups of the computer, while the keyboard drives a line low
+#define SIM_ENERGY_PART_SWITCHING 4u       //!< Charging the line capacitances
+#define SIM_ENERGY_PART_COUNT     5u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Accumulated activity since the power-up -- the difference of two snapshots gives a period
+typedef struct
+{
+  SIM_TIME    u64Time;                          //!< Virtual time of the snapshot
+  S_SIM_STATS sCpu;                             //!< Residency of the CPU states
+  SIM_TIME    au64Low[ SIM_LINE_COUNT ];        //!< Time driven low by the controller
+  U32         au32Rising[ SIM_LINE_COUNT ];     //!< Released or driven high by the controller
+  SIM_TIME    u64KeyLowTime;                    //!< Sum of the pressed keys of the driven column over the time
+  U8          au8Drive[ SIM_LINE_COUNT ];       //!< Internal: last level driven by the controller
+  SIM_TIME    u64Last;                          //!< Internal: last accounted time
+} S_SIM_ENERGY;
+
+//! \brief Estimate of a period
+typedef struct
+{
+  double      dSeconds;
+  double      adCurrentMa[ SIM_ENERGY_PART_COUNT ];  //!< Average supply current of each part
+  double      dCurrentMa;                            //!< Sum of the parts
+  double      dEnergyMj;                             //!< dCurrentMa x VDD x dSeconds
+  double      adRunShare[ SIM_CPU_DIVIDER_STEPS ];   //!< Part of the period in run mode, per fCPU = 16 MHz / 2^index
+  double      adWaitShare[ SIM_CPU_DIVIDER_STEPS ];
+  double      dHaltShare;
+  double      adLowShare[ SIM_LINE_COUNT ];          //!< Part of the period, when the line was driven low
+  double      adRisingPerSecond[ SIM_LINE_COUNT ];
+} S_SIM_ENERGY_REPORT;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Sim_Energy_Connect( S_SIM_ENERGY* psEnergy );
+void Sim_Energy_Snapshot( S_SIM_ENERGY* psEnergy, S_SIM_ENERGY* psSnapshot );
+void Sim_Energy_Report( const S_SIM_ENERGY* psFrom, const S_SIM_ENERGY* psTo, S_SIM_ENERGY_REPORT* psReport );
+const char* Sim_Energy_GetPartName( U8 u8Part );
+
+
+#endif // SIM_ENERGY_H_INCLUDED
+/******************************<EOF>**********************************/
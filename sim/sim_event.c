@@ -0,0 +1,219 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_event.c
+*
+* \brief Host simulation -- discrete event scheduler of the virtual time
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include "types.h"
+
+// Own include
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_EVENT_COUNT   1024u  //!< Capacity of the queue
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Scheduled event
+typedef struct
+{
+  SIM_TIME          u64Time;
+  U32               u32Id;       //!< Also orders the events of the same time (first scheduled runs first)
+  SIM_EVENT_HANDLER pfHandler;
+  void*             pvContext;
+} S_SIM_EVENT;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Binary min-heap of the events
+static struct
+{
+  S_SIM_EVENT asHeap[ SIM_EVENT_COUNT ];
+  U32         u32Count;
+  U32         u32NextId;
+  U32         u32Processed;
+} gsSimEvents = { .u32NextId = 1u };
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static BOOL IsEarlier( const S_SIM_EVENT* psA, const S_SIM_EVENT* psB );
+static void SiftUp( U32 u32Index );
+static void SiftDown( U32 u32Index );
+static void Remove( U32 u32Index );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+static BOOL IsEarlier( const S_SIM_EVENT* psA, const S_SIM_EVENT* psB )
+{
+  return ( ( psA->u64Time < psB->u64Time ) || ( ( psA->u64Time == psB->u64Time ) && ( psA->u32Id < psB->u32Id ) ) ) ? TRUE : FALSE;
+}
+
+static void SiftUp( U32 u32Index )
+{
+  S_SIM_EVENT sEvent = gsSimEvents.asHeap[ u32Index ];
+  
+  while( ( 0u != u32Index ) && ( TRUE == IsEarlier( &sEvent, &gsSimEvents.asHeap[ ( u32Index - 1u ) / 2u ] ) ) )
+  {
+    gsSimEvents.asHeap[ u32Index ] = gsSimEvents.asHeap[ ( u32Index - 1u ) / 2u ];
+    u32Index = ( u32Index - 1u ) / 2u;
+  }
+  gsSimEvents.asHeap[ u32Index ] = sEvent;
+}
+
+static void SiftDown( U32 u32Index )
+{
+  S_SIM_EVENT sEvent = gsSimEvents.asHeap[ u32Index ];
+  U32  u32Child;
+  BOOL bMoved = TRUE;
+  
+  while( TRUE == bMoved )
+  {
+    bMoved = FALSE;
+    u32Child = ( 2u * u32Index ) + 1u;
+    if( u32Child < gsSimEvents.u32Count )
+    {
+      if( ( ( u32Child + 1u ) < gsSimEvents.u32Count ) && ( TRUE == IsEarlier( &gsSimEvents.asHeap[ u32Child + 1u ], &gsSimEvents.asHeap[ u32Child ] ) ) )
+      {
+        u32Child++;
+      }
+      if( TRUE == IsEarlier( &gsSimEvents.asHeap[ u32Child ], &sEvent ) )
+      {
+        gsSimEvents.asHeap[ u32Index ] = gsSimEvents.asHeap[ u32Child ];
+        u32Index = u32Child;
+        bMoved = TRUE;
+      }
+    }
+  }
+  gsSimEvents.asHeap[ u32Index ] = sEvent;
+}
+
+static void Remove( U32 u32Index )
+{
+  gsSimEvents.u32Count--;
+  if( u32Index < gsSimEvents.u32Count )
+  {
+    gsSimEvents.asHeap[ u32Index ] = gsSimEvents.asHeap[ gsSimEvents.u32Count ];
+    SiftUp( u32Index );
+    SiftDown( u32Index );
+  }
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Schedules a call at the given virtual time
+ * \param  u64Time: time of the event -- if already passed, it runs at the next step of the time
+ * \param  pfHandler: called with the context and the time of the event
+ * \param  pvContext: passed to the handler
+ * \return Identifier of the event for Sim_Event_Cancel()
+ *********************************************************************/
+U32 Sim_Event_Schedule( SIM_TIME u64Time, SIM_EVENT_HANDLER pfHandler, void* pvContext )
+{
+  S_SIM_EVENT* psEvent;
+  U32 u32Id = gsSimEvents.u32NextId;
+  
+  if( gsSimEvents.u32Count >= SIM_EVENT_COUNT )
+  {
+    fprintf( stderr, "sim: event queue full\n" );
+    exit( EXIT_FAILURE );
+  }
+  
+  psEvent = &gsSimEvents.asHeap[ gsSimEvents.u32Count ];
+  psEvent->u64Time   = u64Time;
+  psEvent->u32Id     = u32Id;
+  psEvent->pfHandler = pfHandler;
+  psEvent->pvContext = pvContext;
+  gsSimEvents.u32Count++;
+  SiftUp( gsSimEvents.u32Count - 1u );
+  gsSimEvents.u32NextId++;
+  
+  return u32Id;
+}
+
+/*! *******************************************************************
+ * \brief  Removes a scheduled event
+ * \param  u32Id: returned by Sim_Event_Schedule()
+ * \return TRUE, if the event was still in the queue
+ *********************************************************************/
+BOOL Sim_Event_Cancel( U32 u32Id )
+{
+  U32  u32Index;
+  BOOL bRet = FALSE;
+  
+  for( u32Index = 0u; ( u32Index < gsSimEvents.u32Count ) && ( FALSE == bRet ); u32Index++ )
+  {
+    if( u32Id == gsSimEvents.asHeap[ u32Index ].u32Id )
+    {
+      Remove( u32Index );
+      bRet = TRUE;
+    }
+  }
+  
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Time of the earliest event
+ * \param  -
+ * \return Virtual time, SIM_NEVER if the queue is empty
+ *********************************************************************/
+SIM_TIME Sim_Event_NextTime( void )
+{
+  return ( 0u != gsSimEvents.u32Count ) ? gsSimEvents.asHeap[ 0u ].u64Time : SIM_NEVER;
+}
+
+/*! *******************************************************************
+ * \brief  Runs the events due, in the order of their time and scheduling
+ * \param  u64Now: the virtual time
+ * \return -
+ * \note   Handlers may schedule further events, the ones due are run too.
+ *********************************************************************/
+void Sim_Event_RunDue( SIM_TIME u64Now )
+{
+  S_SIM_EVENT sEvent;
+  
+  while( ( 0u != gsSimEvents.u32Count ) && ( gsSimEvents.asHeap[ 0u ].u64Time <= u64Now ) )
+  {
+    sEvent = gsSimEvents.asHeap[ 0u ];
+    Remove( 0u );
+    gsSimEvents.u32Processed++;
+    sEvent.pfHandler( sEvent.pvContext, sEvent.u64Time );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Number of events run so far
+ * \param  -
+ * \return Counter
+ *********************************************************************/
+U32 Sim_Event_GetProcessed( void )
+{
+  return gsSimEvents.u32Processed;
+}
+
+/******************************<EOF>**********************************/
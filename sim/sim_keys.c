@@ -0,0 +1,201 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_keys.c
+*
+* \brief Host simulation -- text to keys of the matrix, through the keymap of the firmware
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+#include "types.h"
+#include "keymap.h"
+#include "layout.h"
+
+// Own include
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_KEYS_BOUNCE_COUNT   4u  //!< Extra contact changes of a bouncing edge
+
+// The edge is passed to the event handler in the context pointer
+#define SIM_KEYS_EDGE( ROW, COL, PRESSED )  ( (void*)(uintptr_t)( ( (ROW) << 8u ) | ( (COL) << 1u ) | ( ( TRUE == (PRESSED) ) ? 1u : 0u ) ) )
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Characters of the US layout without shift, in the order of their scancodes
+static const struct
+{
+  char cChar;
+  U8   u8ScanCode;
+} gcasSimKeyChars[] =
+{
+  { '`', 0x00u }, { '1', 0x01u }, { '2', 0x02u }, { '3', 0x03u }, { '4', 0x04u }, { '5', 0x05u }, { '6', 0x06u },
+  { '7', 0x07u }, { '8', 0x08u }, { '9', 0x09u }, { '0', 0x0Au }, { '-', 0x0Bu }, { '=', 0x0Cu }, { '\\', 0x0Du },
+  { 'q', 0x10u }, { 'w', 0x11u }, { 'e', 0x12u }, { 'r', 0x13u }, { 't', 0x14u }, { 'y', 0x15u }, { 'u', 0x16u },
+  { 'i', 0x17u }, { 'o', 0x18u }, { 'p', 0x19u }, { '[', 0x1Au }, { ']', 0x1Bu },
+  { 'a', 0x20u }, { 's', 0x21u }, { 'd', 0x22u }, { 'f', 0x23u }, { 'g', 0x24u }, { 'h', 0x25u }, { 'j', 0x26u },
+  { 'k', 0x27u }, { 'l', 0x28u }, { ';', 0x29u }, { '\'', 0x2Au },
+  { 'z', 0x31u }, { 'x', 0x32u }, { 'c', 0x33u }, { 'v', 0x34u }, { 'b', 0x35u }, { 'n', 0x36u }, { 'm', 0x37u },
+  { ',', 0x38u }, { '.', 0x39u }, { '/', 0x3Au },
+  { ' ', 0x40u }, { '\t', 0x42u }, { '\n', 0x44u }
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static U32 gu32SimKeysRandom = 1u;  //!< State of the bounce generator -- fixed seed, runs are reproducible
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void ApplyEdge( void* pvContext, SIM_TIME u64Time );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+static void ApplyEdge( void* pvContext, SIM_TIME u64Time )
+{
+  uintptr_t uEdge = (uintptr_t)pvContext;
+
+  (void)u64Time;
+  Sim_SetKey( (U8)( uEdge >> 8u ), (U8)( ( uEdge >> 1u ) & 0x7Fu ), ( 0u != ( uEdge & 1u ) ) ? TRUE : FALSE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Searches the key of a scancode in the active layer of the firmware
+ * \param  u8ScanCode: Amiga key code
+ * \param  pu8Row: row of the key
+ * \param  pu8Column: column of the key
+ * \return TRUE, if found
+ * \note   The keymap is valid only after the init of the firmware. The inverse table of the base layer is tried
+ *         first, the matrix is searched only for the keys moved by an overlay layer.
+ *********************************************************************/
+BOOL Sim_Keys_Find( U8 u8ScanCode, U8* pu8Row, U8* pu8Column )
+{
+  BOOL bRet = FALSE;
+  U8   u8Row, u8Column;
+  U8   u8Position = Keymap_FindKey( u8ScanCode );
+
+  if( ( LAYOUT_NO_KEY != u8Position )
+   && ( u8ScanCode == Keymap_GetScanCode( LAYOUT_POSITION_ROW( u8Position ), LAYOUT_POSITION_COL( u8Position ) ) ) )
+  {
+    *pu8Row = LAYOUT_POSITION_ROW( u8Position );
+    *pu8Column = LAYOUT_POSITION_COL( u8Position );
+    bRet = TRUE;
+  }
+  for( u8Row = 0u; ( u8Row < SIM_ROW_COUNT ) && ( FALSE == bRet ); u8Row++ )
+  {
+    for( u8Column = 0u; ( u8Column < SIM_COL_COUNT ) && ( FALSE == bRet ); u8Column++ )
+    {
+      if( u8ScanCode == Keymap_GetScanCode( u8Row, u8Column ) )
+      {
+        *pu8Row = u8Row;
+        *pu8Column = u8Column;
+        bRet = TRUE;
+      }
+    }
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Scancode of a character
+ * \param  cChar: letters, digits, space, tab, newline and the unshifted punctuation of the US layout
+ * \param  pu8ScanCode: Amiga key code
+ * \param  pbShift: TRUE, if the character needs the shift (capital letters)
+ * \return TRUE, if the character can be typed
+ *********************************************************************/
+BOOL Sim_Keys_FromChar( char cChar, U8* pu8ScanCode, BOOL* pbShift )
+{
+  BOOL bRet = FALSE;
+  U8   u8Index;
+  char cLower = (char)tolower( (unsigned char)cChar );
+
+  for( u8Index = 0u; ( u8Index < ( sizeof( gcasSimKeyChars ) / sizeof( gcasSimKeyChars[ 0 ] ) ) ) && ( FALSE == bRet ); u8Index++ )
+  {
+    if( cLower == gcasSimKeyChars[ u8Index ].cChar )
+    {
+      *pu8ScanCode = gcasSimKeyChars[ u8Index ].u8ScanCode;
+      *pbShift = ( cLower != cChar ) ? TRUE : FALSE;
+      bRet = TRUE;
+    }
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Pseudo random number -- shared by the bounce model and the load generators
+ * \param  -
+ * \return 0..32767
+ *********************************************************************/
+U16 Sim_Keys_Random( void )
+{
+  gu32SimKeysRandom = gu32SimKeysRandom * 1103515245u + 12345u;
+  return (U16)( ( gu32SimKeysRandom >> 16u ) & 0x7FFFu );
+}
+
+/*! *******************************************************************
+ * \brief  Seeds Sim_Keys_Random()
+ * \param  u32Seed: the same seed gives the same edges
+ * \return -
+ *********************************************************************/
+void Sim_Keys_Seed( U32 u32Seed )
+{
+  gu32SimKeysRandom = u32Seed;
+}
+
+/*! *******************************************************************
+ * \brief  Schedules a change of a switch
+ * \param  u64Time: the contact settles at this time
+ * \param  u8Row: row of the key
+ * \param  u8Column: column of the key
+ * \param  bPressed: final state
+ * \param  u64Bounce: the contact chatters this long before u64Time (0: clean edge)
+ * \return -
+ *********************************************************************/
+void Sim_Keys_ScheduleEdge( SIM_TIME u64Time, U8 u8Row, U8 u8Column, BOOL bPressed, SIM_TIME u64Bounce )
+{
+  U8       u8Bounce;
+  SIM_TIME u64Edge;
+  BOOL     bLevel = bPressed;
+
+  for( u8Bounce = 0u; u8Bounce <= SIM_KEYS_BOUNCE_COUNT; u8Bounce++ )
+  {
+    if( ( 0u == u8Bounce ) || ( 0u != u64Bounce ) )
+    {
+      u64Edge = u64Time - ( u64Bounce * u8Bounce ) / SIM_KEYS_BOUNCE_COUNT;
+      if( 0u != u8Bounce )
+      {
+        u64Edge += Sim_Keys_Random() % ( u64Bounce / ( 2u * SIM_KEYS_BOUNCE_COUNT ) + 1u );
+      }
+      Sim_Event_Schedule( u64Edge, ApplyEdge, SIM_KEYS_EDGE( u8Row, u8Column, bLevel ) );
+    }
+    bLevel = ( TRUE == bLevel ) ? FALSE : TRUE;  // going backwards in time: the chatter alternates
+  }
+}
+
+/******************************<EOF>**********************************/
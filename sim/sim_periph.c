@@ -0,0 +1,625 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_periph.c
+*
+* \brief Host simulation -- register models of the peripherals, behind the StdPeriph library API
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <string.h>
+#include <stdint.h>
+#include "stm8s.h"
+#include "types.h"
+#include "delay.h"
+
+// Own include
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_GPIO_PORTS        6u    //!< GPIOA..GPIOF
+
+// CPU cycles of the library calls (call, argument passing, read-modify-write of the register, return)
+#define SIM_CYCLES_GPIO_INIT  60u
+#define SIM_CYCLES_GPIO_WRITE 12u
+#define SIM_CYCLES_GPIO_READ  14u
+#define SIM_CYCLES_TIM        20u
+#define SIM_CYCLES_CLK        30u
+#define SIM_CYCLES_FLASH      30u
+#define SIM_CYCLES_DELAY_CALL 4u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+S_SIM_MEMORY gsSimMemory;  //!< Data EEPROM and program flash
+
+//! \brief Register images of the peripherals
+static struct
+{
+  GPIO_TypeDef  asGpio[ SIM_GPIO_PORTS ];
+  TIM2_TypeDef  sTim2;
+  SIM_TIME      u64Tim2Start;       //!< Time of the last counter restart
+  U32           u32Tim2Event;       //!< Scheduled update event (0, if stopped)
+  U8            u8ClkDivider;       //!< CLK_CKDIVR
+  U8            u8FlashStatus;      //!< FLASH_IAPSR
+  SIM_TIME      u64FlashBusyUntil;  //!< End of the running program operation
+} gsSimPeriph;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U8       GetPortIndex( GPIO_TypeDef* GPIOx );
+static void     WriteOutput( GPIO_TypeDef* GPIOx, U8 u8Odr, U8 u8Ddr, U8 u8Cr1 );
+static U8       ReadPins( GPIO_TypeDef* GPIOx, U8 u8Mask );
+static SIM_TIME GetTim2Period( void );
+static void     Tim2Update( void* pvContext, SIM_TIME u64Time );
+static void     Tim2Restart( SIM_TIME u64Start );
+static U8*      GetMemory( uint32_t Address );
+static void     StartProgram( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Converts the address of a port to its index
+ * \param  GPIOx: address of the port as in stm8s.h
+ * \return 0 for GPIOA, 1 for GPIOB...
+ *********************************************************************/
+static U8 GetPortIndex( GPIO_TypeDef* GPIOx )
+{
+  return (U8)( ( (uintptr_t)GPIOx - GPIOA_BaseAddress ) / ( GPIOB_BaseAddress - GPIOA_BaseAddress ) );
+}
+
+/*! *******************************************************************
+ * \brief  Updates the output registers of a port and notifies the board about the changed pins
+ * \param  GPIOx: the port
+ * \param  u8Odr, u8Ddr, u8Cr1: new register values
+ * \return -
+ *********************************************************************/
+static void WriteOutput( GPIO_TypeDef* GPIOx, U8 u8Odr, U8 u8Ddr, U8 u8Cr1 )
+{
+  U8 u8Port = GetPortIndex( GPIOx );
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ u8Port ];
+  U8 u8Before = (U8)~( psPort->DDR & (U8)~psPort->ODR );  // see Sim_Gpio_GetDrive()
+  U8 u8After  = (U8)~( u8Ddr & (U8)~u8Odr );
+  
+  psPort->ODR = u8Odr;
+  psPort->DDR = u8Ddr;
+  psPort->CR1 = u8Cr1;
+  
+  if( u8Before != u8After )
+  {
+    Sim_Board_OutputChanged( u8Port, u8Before ^ u8After );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Input buffer of the given pins
+ * \param  GPIOx: the port
+ * \param  u8Mask: pins to read -- only these are evaluated, the board model is not cheap
+ * \return IDR masked
+ *********************************************************************/
+static U8 ReadPins( GPIO_TypeDef* GPIOx, U8 u8Mask )
+{
+  U8 u8Port = GetPortIndex( GPIOx );
+  U8 u8Pin;
+  U8 u8Idr = 0u;
+  
+  // the pin level is the wired AND of the own driver and the board
+  for( u8Pin = 0u; u8Pin < 8u; u8Pin++ )
+  {
+    if( 0u != ( u8Mask & (1u<<u8Pin) ) )
+    {
+      u8Idr |= (U8)( ( Sim_Gpio_GetDrive( u8Port, u8Pin ) & Sim_Board_GetInput( u8Port, u8Pin ) ) << u8Pin );
+    }
+  }
+  gsSimPeriph.asGpio[ u8Port ].IDR = ( gsSimPeriph.asGpio[ u8Port ].IDR & (U8)~u8Mask ) | u8Idr;
+  
+  return u8Idr;
+}
+
+/*! *******************************************************************
+ * \brief  Period of the TIM2 update event
+ * \param  -
+ * \return Virtual time between two update events
+ *********************************************************************/
+static SIM_TIME GetTim2Period( void )
+{
+  U16 u16Arr = ( (U16)gsSimPeriph.sTim2.ARRH << 8u ) | gsSimPeriph.sTim2.ARRL;
+  
+  return ( (SIM_TIME)u16Arr + 1u ) * ( 1ull << ( gsSimPeriph.sTim2.PSCR & 0x0Fu ) ) * Sim_GetMasterDivider();
+}
+
+/*! *******************************************************************
+ * \brief  Update event of TIM2 -- counter overflow
+ * \param  pvContext: -
+ * \param  u64Time: time of the overflow
+ * \return -
+ *********************************************************************/
+static void Tim2Update( void* pvContext, SIM_TIME u64Time )
+{
+  (void)pvContext;
+  
+  gsSimPeriph.sTim2.SR1 |= TIM2_SR1_UIF;
+  Tim2Restart( u64Time );
+}
+
+/*! *******************************************************************
+ * \brief  Restarts the counter from 0, schedules the next update event
+ * \param  u64Start: time of the restart
+ * \return -
+ *********************************************************************/
+static void Tim2Restart( SIM_TIME u64Start )
+{
+  if( 0u != gsSimPeriph.u32Tim2Event )
+  {
+    Sim_Event_Cancel( gsSimPeriph.u32Tim2Event );
+  }
+  gsSimPeriph.u64Tim2Start = u64Start;
+  gsSimPeriph.u32Tim2Event = Sim_Event_Schedule( u64Start + GetTim2Period(), Tim2Update, NULL );
+}
+
+/*! *******************************************************************
+ * \brief  Maps a physical address to the memory model
+ * \param  Address: physical address
+ * \return Pointer to the byte, NULL if there is no memory there
+ *********************************************************************/
+static U8* GetMemory( uint32_t Address )
+{
+  U8* pu8Ret = NULL;
+  
+  if( ( Address >= SIM_EEPROM_ADDRESS ) && ( Address < ( SIM_EEPROM_ADDRESS + SIM_EEPROM_SIZE ) ) )
+  {
+    pu8Ret = &gsSimMemory.au8Eeprom[ Address - SIM_EEPROM_ADDRESS ];
+    gsSimMemory.au32EepromWrites[ Address - SIM_EEPROM_ADDRESS ]++;  // callers only ask for writes
+  }
+  else if( ( Address >= SIM_FLASH_ADDRESS ) && ( Address < ( SIM_FLASH_ADDRESS + SIM_FLASH_SIZE ) ) )
+  {
+    pu8Ret = &gsSimMemory.au8Flash[ Address - SIM_FLASH_ADDRESS ];
+  }
+  
+  return pu8Ret;
+}
+
+/*! *******************************************************************
+ * \brief  Starts a program operation -- the memory is busy for the programming time
+ * \param  -
+ * \return -
+ *********************************************************************/
+static void StartProgram( void )
+{
+  gsSimMemory.u32ProgramOperations++;
+  gsSimPeriph.u8FlashStatus &= (U8)~FLASH_IAPSR_EOP;
+  gsSimPeriph.u64FlashBusyUntil = Sim_GetTime() + SIM_PROGRAM_TIME;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions -- simulation
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Reset values of the registers
+ * \param  -
+ * \return -
+ *********************************************************************/
+void Sim_Periph_Reset( void )
+{
+  if( 0u != gsSimPeriph.u32Tim2Event )
+  {
+    Sim_Event_Cancel( gsSimPeriph.u32Tim2Event );
+  }
+  memset( &gsSimPeriph, 0x00u, sizeof( gsSimPeriph ) );
+  gsSimPeriph.sTim2.ARRH = 0xFFu;
+  gsSimPeriph.sTim2.ARRL = 0xFFu;
+  gsSimPeriph.u8ClkDivider = 0x18u;  // fHSI / 8
+  gsSimPeriph.u8FlashStatus = FLASH_IAPSR_RESET_VALUE;
+}
+
+/*! *******************************************************************
+ * \brief  Is there a TIM2 interrupt request?
+ * \param  -
+ * \return TRUE, if the update interrupt is enabled and flagged
+ *********************************************************************/
+BOOL Sim_Tim2_IsInterruptPending( void )
+{
+  return ( 0u != ( gsSimPeriph.sTim2.SR1 & gsSimPeriph.sTim2.IER & TIM2_IER_UIE ) ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Level driven by the controller on a pin
+ * \param  u8Port: index of the port (0 is GPIOA)
+ * \param  u8Pin: number of the pin (0..7)
+ * \return 0, if driven low; 1, if driven high or released (input, open drain high)
+ *********************************************************************/
+U8 Sim_Gpio_GetDrive( U8 u8Port, U8 u8Pin )
+{
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ u8Port ];
+  U8 u8Ret = 1u;
+  
+  if( ( 0u != ( psPort->DDR & (1u<<u8Pin) ) ) && ( 0u == ( psPort->ODR & (1u<<u8Pin) ) ) )
+  {
+    u8Ret = 0u;  // push-pull and open drain outputs pull low the same way
+  }
+  
+  return u8Ret;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions -- GPIO
+//--------------------------------------------------------------------------------------------------------/
+void GPIO_DeInit( GPIO_TypeDef* GPIOx )
+{
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_INIT );
+  WriteOutput( GPIOx, 0x00u, 0x00u, 0x00u );
+  gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ].CR2 = 0x00u;
+}
+
+void GPIO_Init( GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef GPIO_Pin, GPIO_Mode_TypeDef GPIO_Mode )
+{
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ];
+  U8 u8Odr = psPort->ODR;
+  U8 u8Ddr = psPort->DDR;
+  U8 u8Cr1 = psPort->CR1;
+  
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_INIT );
+  
+  // same register sequence as the library
+  if( 0u != ( (U8)GPIO_Mode & 0x80u ) )  // output
+  {
+    u8Odr = ( 0u != ( (U8)GPIO_Mode & 0x10u ) ) ? ( u8Odr | (U8)GPIO_Pin ) : ( u8Odr & (U8)~GPIO_Pin );
+    u8Ddr |= (U8)GPIO_Pin;
+  }
+  else
+  {
+    u8Ddr &= (U8)~GPIO_Pin;
+  }
+  u8Cr1 = ( 0u != ( (U8)GPIO_Mode & 0x40u ) ) ? ( u8Cr1 | (U8)GPIO_Pin ) : ( u8Cr1 & (U8)~GPIO_Pin );
+  psPort->CR2 = ( 0u != ( (U8)GPIO_Mode & 0x20u ) ) ? ( psPort->CR2 | (U8)GPIO_Pin ) : ( psPort->CR2 & (U8)~GPIO_Pin );
+  
+  WriteOutput( GPIOx, u8Odr, u8Ddr, u8Cr1 );
+}
+
+void GPIO_Write( GPIO_TypeDef* GPIOx, uint8_t PortVal )
+{
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ];
+  
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_WRITE );
+  WriteOutput( GPIOx, PortVal, psPort->DDR, psPort->CR1 );
+}
+
+void GPIO_WriteHigh( GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef PortPins )
+{
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ];
+  
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_WRITE );
+  WriteOutput( GPIOx, psPort->ODR | (U8)PortPins, psPort->DDR, psPort->CR1 );
+}
+
+void GPIO_WriteLow( GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef PortPins )
+{
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ];
+  
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_WRITE );
+  WriteOutput( GPIOx, psPort->ODR & (U8)~PortPins, psPort->DDR, psPort->CR1 );
+}
+
+void GPIO_WriteReverse( GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef PortPins )
+{
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ];
+  
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_WRITE );
+  WriteOutput( GPIOx, psPort->ODR ^ (U8)PortPins, psPort->DDR, psPort->CR1 );
+}
+
+uint8_t GPIO_ReadOutputData( GPIO_TypeDef* GPIOx )
+{
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_READ );
+  return gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ].ODR;
+}
+
+uint8_t GPIO_ReadInputData( GPIO_TypeDef* GPIOx )
+{
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_READ );
+  
+  return ReadPins( GPIOx, 0xFFu );
+}
+
+BitStatus GPIO_ReadInputPin( GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef GPIO_Pin )
+{
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_READ );
+  
+  return ( 0u != ReadPins( GPIOx, (U8)GPIO_Pin ) ) ? SET : RESET;
+}
+
+void GPIO_ExternalPullUpConfig( GPIO_TypeDef* GPIOx, GPIO_Pin_TypeDef GPIO_Pin, FunctionalState NewState )
+{
+  GPIO_TypeDef* psPort = &gsSimPeriph.asGpio[ GetPortIndex( GPIOx ) ];
+  
+  Sim_PeriphAccess( SIM_CYCLES_GPIO_WRITE );
+  psPort->CR1 = ( DISABLE != NewState ) ? ( psPort->CR1 | (U8)GPIO_Pin ) : ( psPort->CR1 & (U8)~GPIO_Pin );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions -- TIM2
+//--------------------------------------------------------------------------------------------------------/
+void TIM2_TimeBaseInit( TIM2_Prescaler_TypeDef TIM2_Prescaler, uint16_t TIM2_Period )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  gsSimPeriph.sTim2.PSCR = (U8)TIM2_Prescaler;
+  gsSimPeriph.sTim2.ARRH = (U8)( TIM2_Period >> 8u );
+  gsSimPeriph.sTim2.ARRL = (U8)TIM2_Period;
+}
+
+void TIM2_Cmd( FunctionalState NewState )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  if( DISABLE != NewState )
+  {
+    if( 0u == ( gsSimPeriph.sTim2.CR1 & TIM2_CR1_CEN ) )
+    {
+      Tim2Restart( Sim_GetTime() );
+    }
+    gsSimPeriph.sTim2.CR1 |= TIM2_CR1_CEN;
+  }
+  else
+  {
+    gsSimPeriph.sTim2.CR1 &= (U8)~TIM2_CR1_CEN;
+    if( 0u != gsSimPeriph.u32Tim2Event )
+    {
+      Sim_Event_Cancel( gsSimPeriph.u32Tim2Event );
+      gsSimPeriph.u32Tim2Event = 0u;
+    }
+  }
+}
+
+void TIM2_ITConfig( TIM2_IT_TypeDef TIM2_IT, FunctionalState NewState )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  gsSimPeriph.sTim2.IER = ( DISABLE != NewState ) ? ( gsSimPeriph.sTim2.IER | (U8)TIM2_IT ) : ( gsSimPeriph.sTim2.IER & (U8)~TIM2_IT );
+}
+
+void TIM2_SetCounter( uint16_t Counter )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  if( 0u != ( gsSimPeriph.sTim2.CR1 & TIM2_CR1_CEN ) )
+  {
+    Tim2Restart( Sim_GetTime() - ( (SIM_TIME)Counter * ( GetTim2Period() / ( ( ( (U16)gsSimPeriph.sTim2.ARRH << 8u ) | gsSimPeriph.sTim2.ARRL ) + 1u ) ) ) );
+  }
+}
+
+uint16_t TIM2_GetCounter( void )
+{
+  SIM_TIME u64Tick;
+  
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  u64Tick = GetTim2Period() / ( ( ( (U16)gsSimPeriph.sTim2.ARRH << 8u ) | gsSimPeriph.sTim2.ARRL ) + 1u );
+  
+  return ( 0u != ( gsSimPeriph.sTim2.CR1 & TIM2_CR1_CEN ) ) ? (U16)( ( Sim_GetTime() - gsSimPeriph.u64Tim2Start ) / u64Tick ) : 0u;
+}
+
+FlagStatus TIM2_GetFlagStatus( TIM2_FLAG_TypeDef TIM2_FLAG )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  return ( 0u != ( gsSimPeriph.sTim2.SR1 & (U8)TIM2_FLAG ) ) ? SET : RESET;
+}
+
+void TIM2_ClearFlag( TIM2_FLAG_TypeDef TIM2_FLAG )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  gsSimPeriph.sTim2.SR1 &= (U8)~TIM2_FLAG;
+}
+
+ITStatus TIM2_GetITStatus( TIM2_IT_TypeDef TIM2_IT )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  return ( 0u != ( gsSimPeriph.sTim2.SR1 & gsSimPeriph.sTim2.IER & (U8)TIM2_IT ) ) ? SET : RESET;
+}
+
+void TIM2_ClearITPendingBit( TIM2_IT_TypeDef TIM2_IT )
+{
+  Sim_PeriphAccess( SIM_CYCLES_TIM );
+  gsSimPeriph.sTim2.SR1 &= (U8)~TIM2_IT;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions -- CLK
+//--------------------------------------------------------------------------------------------------------/
+void CLK_SYSCLKConfig( CLK_Prescaler_TypeDef CLK_Prescaler )
+{
+  Sim_PeriphAccess( SIM_CYCLES_CLK );
+  if( 0u == ( (U8)CLK_Prescaler & 0x80u ) )
+  {
+    gsSimPeriph.u8ClkDivider = ( gsSimPeriph.u8ClkDivider & (U8)~CLK_CKDIVR_HSIDIV ) | ( (U8)CLK_Prescaler & CLK_CKDIVR_HSIDIV );
+  }
+  else
+  {
+    gsSimPeriph.u8ClkDivider = ( gsSimPeriph.u8ClkDivider & (U8)~CLK_CKDIVR_CPUDIV ) | ( (U8)CLK_Prescaler & CLK_CKDIVR_CPUDIV );
+  }
+  
+  Sim_SetClockDividers( (U8)( 1u << ( ( gsSimPeriph.u8ClkDivider & CLK_CKDIVR_HSIDIV ) >> 3u ) ),
+                        (U8)( ( 1u << ( ( gsSimPeriph.u8ClkDivider & CLK_CKDIVR_HSIDIV ) >> 3u ) ) << ( gsSimPeriph.u8ClkDivider & CLK_CKDIVR_CPUDIV ) ) );
+}
+
+ErrorStatus CLK_ClockSwitchConfig( CLK_SwitchMode_TypeDef CLK_SwitchMode, CLK_Source_TypeDef CLK_NewClock, FunctionalState ITState, CLK_CurrentClockState_TypeDef CLK_CurrentClockState )
+{
+  (void)CLK_SwitchMode;
+  (void)ITState;
+  (void)CLK_CurrentClockState;
+  
+  Sim_PeriphAccess( SIM_CYCLES_CLK );
+  
+  return ( CLK_SOURCE_HSI == CLK_NewClock ) ? SUCCESS : ERROR;  // only the HSI is modelled
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions -- FLASH
+//--------------------------------------------------------------------------------------------------------/
+void FLASH_Unlock( FLASH_MemType_TypeDef FLASH_MemType )
+{
+  Sim_PeriphAccess( SIM_CYCLES_FLASH );
+  gsSimPeriph.u8FlashStatus |= ( FLASH_MEMTYPE_PROG == FLASH_MemType ) ? FLASH_IAPSR_PUL : FLASH_IAPSR_DUL;
+}
+
+void FLASH_Lock( FLASH_MemType_TypeDef FLASH_MemType )
+{
+  Sim_PeriphAccess( SIM_CYCLES_FLASH );
+  gsSimPeriph.u8FlashStatus &= (U8)FLASH_MemType;
+}
+
+uint8_t FLASH_ReadByte( uint32_t Address )
+{
+  U8 u8Ret = 0x00u;
+  
+  Sim_PeriphAccess( SIM_CYCLES_FLASH );
+  if( ( Address >= SIM_EEPROM_ADDRESS ) && ( Address < ( SIM_EEPROM_ADDRESS + SIM_EEPROM_SIZE ) ) )
+  {
+    u8Ret = gsSimMemory.au8Eeprom[ Address - SIM_EEPROM_ADDRESS ];
+  }
+  else if( ( Address >= SIM_FLASH_ADDRESS ) && ( Address < ( SIM_FLASH_ADDRESS + SIM_FLASH_SIZE ) ) )
+  {
+    u8Ret = gsSimMemory.au8Flash[ Address - SIM_FLASH_ADDRESS ];
+  }
+  
+  return u8Ret;
+}
+
+void FLASH_ProgramByte( uint32_t Address, uint8_t Data )
+{
+  U8* pu8Byte;
+  
+  Sim_PeriphAccess( SIM_CYCLES_FLASH );
+  if( 0u != ( gsSimPeriph.u8FlashStatus & ( ( Address < SIM_FLASH_ADDRESS ) ? FLASH_IAPSR_DUL : FLASH_IAPSR_PUL ) ) )
+  {
+    pu8Byte = GetMemory( Address );
+    if( NULL != pu8Byte )
+    {
+      *pu8Byte = Data;
+      StartProgram();
+    }
+  }
+  else
+  {
+    gsSimPeriph.u8FlashStatus |= FLASH_IAPSR_WR_PG_DIS;
+  }
+}
+
+void FLASH_EraseByte( uint32_t Address )
+{
+  FLASH_ProgramByte( Address, 0x00u );
+}
+
+void FLASH_ProgramWord( uint32_t Address, uint32_t Data )
+{
+  U8* pu8Byte;
+  U8  u8Index;
+  
+  Sim_PeriphAccess( SIM_CYCLES_FLASH );
+  if( 0u != ( gsSimPeriph.u8FlashStatus & ( ( Address < SIM_FLASH_ADDRESS ) ? FLASH_IAPSR_DUL : FLASH_IAPSR_PUL ) ) )
+  {
+    // the STM8 is big endian: the most significant byte goes to the lowest address
+    for( u8Index = 0u; u8Index < 4u; u8Index++ )
+    {
+      pu8Byte = GetMemory( Address + u8Index );
+      if( NULL != pu8Byte )
+      {
+        *pu8Byte = (U8)( Data >> ( 24u - ( 8u * u8Index ) ) );
+      }
+    }
+    StartProgram();
+  }
+  else
+  {
+    gsSimPeriph.u8FlashStatus |= FLASH_IAPSR_WR_PG_DIS;
+  }
+}
+
+void FLASH_ProgramBlock( uint16_t BlockNum, FLASH_MemType_TypeDef FLASH_MemType, FLASH_ProgramMode_TypeDef FLASH_ProgMode, uint8_t* Buffer )
+{
+  uint32_t u32Address;
+  U8* pu8Byte;
+  U8  u8Index;
+  
+  (void)FLASH_ProgMode;
+  
+  Sim_PeriphAccess( SIM_CYCLES_FLASH + ( 4u * FLASH_BLOCK_SIZE ) );
+  u32Address = ( ( FLASH_MEMTYPE_PROG == FLASH_MemType ) ? SIM_FLASH_ADDRESS : SIM_EEPROM_ADDRESS ) + ( (uint32_t)BlockNum * FLASH_BLOCK_SIZE );
+  if( 0u != ( gsSimPeriph.u8FlashStatus & ( ( FLASH_MEMTYPE_PROG == FLASH_MemType ) ? FLASH_IAPSR_PUL : FLASH_IAPSR_DUL ) ) )
+  {
+    for( u8Index = 0u; u8Index < FLASH_BLOCK_SIZE; u8Index++ )
+    {
+      pu8Byte = GetMemory( u32Address + u8Index );
+      if( NULL != pu8Byte )
+      {
+        *pu8Byte = Buffer[ u8Index ];
+      }
+    }
+    StartProgram();
+  }
+  else
+  {
+    gsSimPeriph.u8FlashStatus |= FLASH_IAPSR_WR_PG_DIS;
+  }
+}
+
+void FLASH_EraseBlock( uint16_t BlockNum, FLASH_MemType_TypeDef FLASH_MemType )
+{
+  static const U8 cau8Erased[ FLASH_BLOCK_SIZE ] = { 0x00u };  // erased bytes read as 0x00
+
+  FLASH_ProgramBlock( BlockNum, FLASH_MemType, FLASH_PROGRAMMODE_STANDARD, (uint8_t*)cau8Erased );
+}
+
+FLASH_Status_TypeDef FLASH_WaitForLastOperation( FLASH_MemType_TypeDef FLASH_MemType )
+{
+  U8 u8Status;
+  
+  (void)FLASH_MemType;
+  
+  Sim_PeriphAccess( SIM_CYCLES_FLASH );
+  if( Sim_GetTime() < gsSimPeriph.u64FlashBusyUntil )
+  {
+    Sim_WaitUntil( gsSimPeriph.u64FlashBusyUntil );
+  }
+  gsSimPeriph.u8FlashStatus |= FLASH_IAPSR_EOP;
+  
+  // reading IAPSR clears the flags
+  u8Status = gsSimPeriph.u8FlashStatus & ( FLASH_IAPSR_EOP | FLASH_IAPSR_WR_PG_DIS );
+  gsSimPeriph.u8FlashStatus &= (U8)~( FLASH_IAPSR_EOP | FLASH_IAPSR_WR_PG_DIS );
+  
+  return ( 0u != ( u8Status & FLASH_IAPSR_WR_PG_DIS ) ) ? FLASH_STATUS_WRITE_PROTECTION_ERROR : FLASH_STATUS_SUCCESSFUL_OPERATION;
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions -- delay.s
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Busy loop of the given number of 10 cycle periods -- see delay.s
+ *********************************************************************/
+void Delay_10cycle( U16 u16cyc )
+{
+  Sim_PeriphAccess( SIM_CYCLES_DELAY_CALL + ( 10u * (U32)u16cyc ) );
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,371 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_samples.c
+*
+* \brief Host simulation -- record and replay of the row bytes sampled by Matrix_Sample()
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+
+// Own include
+#include "sim_samples.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void Append( U8** ppu8Buffer, U32* pu32Size, U32* pu32Capacity, U8 u8Byte );
+static void FlushRun( S_SIM_SAMPLES* psSamples );
+static void Encode( S_SIM_SAMPLES* psSamples, U8 u8Column, U8 u8Rows );
+static U8   Decode( S_SIM_SAMPLES* psSamples, U8 u8Column );
+static void InterruptHook( void* pvContext, BOOL bEntry, SIM_TIME u64Now );
+static void Start( S_SIM_SAMPLES* psSamples, U8 u8Mode );
+static void PutU32( U8* pu8Buffer, U32 u32Value );
+static U32  GetU32( const U8* pu8Buffer );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Appends a byte to a growing buffer
+ *********************************************************************/
+static void Append( U8** ppu8Buffer, U32* pu32Size, U32* pu32Capacity, U8 u8Byte )
+{
+  if( *pu32Size == *pu32Capacity )
+  {
+    *pu32Capacity = ( 0u != *pu32Capacity ) ? ( *pu32Capacity * 2u ) : 256u;
+    *ppu8Buffer = (U8*)realloc( *ppu8Buffer, *pu32Capacity );
+    if( NULL == *ppu8Buffer )
+    {
+      fprintf( stderr, "sim: out of memory\n" );
+      exit( EXIT_FAILURE );
+    }
+  }
+  (*ppu8Buffer)[ (*pu32Size)++ ] = u8Byte;
+}
+
+/*! *******************************************************************
+ * \brief  Writes the pending unchanged samples into the stream
+ *********************************************************************/
+static void FlushRun( S_SIM_SAMPLES* psSamples )
+{
+  U32 u32Units;
+
+  while( psSamples->u32Run >= SIM_SAMPLES_RUN_MAX )
+  {
+    u32Units = psSamples->u32Run / SIM_SAMPLES_RUN_MAX;
+    u32Units = ( u32Units > SIM_SAMPLES_GROUP_MAX ) ? SIM_SAMPLES_GROUP_MAX : u32Units;
+    Append( &psSamples->pu8Stream, &psSamples->u32StreamSize, &psSamples->u32StreamCapacity, (U8)( SIM_SAMPLES_LONG_RUN | ( u32Units - 1u ) ) );
+    psSamples->u32Run -= u32Units * SIM_SAMPLES_RUN_MAX;
+  }
+  if( 0u != psSamples->u32Run )
+  {
+    Append( &psSamples->pu8Stream, &psSamples->u32StreamSize, &psSamples->u32StreamCapacity, (U8)( SIM_SAMPLES_RUN | ( psSamples->u32Run - 1u ) ) );
+    psSamples->u32Run = 0u;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Adds a sample to the stream
+ * \param  psSamples: the recording
+ * \param  u8Column: column of the sample
+ * \param  u8Rows: row byte
+ * \return -
+ *********************************************************************/
+static void Encode( S_SIM_SAMPLES* psSamples, U8 u8Column, U8 u8Rows )
+{
+  if( u8Rows == psSamples->au8Last[ u8Column ] )
+  {
+    psSamples->u32Run++;
+    psSamples->u8Literals = 0u;  // closes the literal group
+  }
+  else
+  {
+    FlushRun( psSamples );
+    if( ( 0u == psSamples->u8Literals ) || ( SIM_SAMPLES_GROUP_MAX == psSamples->u8Literals ) )
+    {
+      psSamples->u32GroupIndex = psSamples->u32StreamSize;
+      psSamples->u8Literals = 0u;
+      Append( &psSamples->pu8Stream, &psSamples->u32StreamSize, &psSamples->u32StreamCapacity, SIM_SAMPLES_LITERAL );
+    }
+    Append( &psSamples->pu8Stream, &psSamples->u32StreamSize, &psSamples->u32StreamCapacity, u8Rows );
+    psSamples->pu8Stream[ psSamples->u32GroupIndex ] = SIM_SAMPLES_LITERAL | psSamples->u8Literals;
+    psSamples->u8Literals++;
+    psSamples->au8Last[ u8Column ] = u8Rows;
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Takes the next sample from the stream
+ * \param  psSamples: the recording
+ * \param  u8Column: column of the sample
+ * \return Row byte
+ *********************************************************************/
+static U8 Decode( S_SIM_SAMPLES* psSamples, U8 u8Column )
+{
+  U8 u8Control;
+
+  while( ( 0u == psSamples->u32Run ) && ( 0u == psSamples->u8Literals ) && ( psSamples->u32Position < psSamples->u32StreamSize ) )
+  {
+    u8Control = psSamples->pu8Stream[ psSamples->u32Position++ ];
+    if( u8Control < SIM_SAMPLES_LITERAL )
+    {
+      psSamples->u32Run = (U32)u8Control + 1u;
+    }
+    else if( u8Control < SIM_SAMPLES_LONG_RUN )
+    {
+      psSamples->u8Literals = (U8)( u8Control & ~SIM_SAMPLES_LITERAL ) + 1u;
+    }
+    else
+    {
+      psSamples->u32Run = ( (U32)( u8Control & ~SIM_SAMPLES_LONG_RUN ) + 1u ) * SIM_SAMPLES_RUN_MAX;
+    }
+  }
+
+  if( 0u != psSamples->u32Run )
+  {
+    psSamples->u32Run--;
+  }
+  else if( ( 0u != psSamples->u8Literals ) && ( psSamples->u32Position < psSamples->u32StreamSize ) )
+  {
+    psSamples->u8Literals--;
+    psSamples->au8Last[ u8Column ] = psSamples->pu8Stream[ psSamples->u32Position++ ];
+  }
+
+  return psSamples->au8Last[ u8Column ];
+}
+
+/*! *******************************************************************
+ * \brief  TIM2 interrupt hook -- the rows are frozen for the whole routine, so the firmware reads exactly the
+ *         recorded byte, even if a key changes meanwhile
+ *********************************************************************/
+static void InterruptHook( void* pvContext, BOOL bEntry, SIM_TIME u64Now )
+{
+  S_SIM_SAMPLES* psSamples = (S_SIM_SAMPLES*)pvContext;
+  U8 u8Column = (U8)( psSamples->u32Tick % SIM_COL_COUNT );
+  U8 u8Rows;
+
+  (void)u64Now;
+  if( FALSE == bEntry )
+  {
+    Sim_Board_FreezeRows( FALSE, SIM_SAMPLES_IDLE );
+  }
+  else if( SIM_SAMPLES_RECORDING == psSamples->u8Mode )
+  {
+    u8Rows = Sim_Board_GetRows();
+    Sim_Board_FreezeRows( TRUE, u8Rows );
+    Encode( psSamples, u8Column, u8Rows );
+    psSamples->u32Tick++;
+  }
+  else if( psSamples->u32Tick < psSamples->u32Ticks )
+  {
+    Sim_Board_FreezeRows( TRUE, Decode( psSamples, u8Column ) );
+    psSamples->u32Tick++;
+  }
+  else
+  {
+    Sim_Samples_Stop( psSamples );  // end of the replay, the keys of the board are sampled again
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Resets the coder and connects the hook
+ *********************************************************************/
+static void Start( S_SIM_SAMPLES* psSamples, U8 u8Mode )
+{
+  memset( psSamples->au8Last, SIM_SAMPLES_IDLE, sizeof( psSamples->au8Last ) );
+  psSamples->u32Tick = 0u;
+  psSamples->u32Position = 0u;
+  psSamples->u32Run = 0u;
+  psSamples->u8Literals = 0u;
+  psSamples->u8Mode = u8Mode;
+  Sim_SetInterruptHook( InterruptHook, psSamples );
+}
+
+static void PutU32( U8* pu8Buffer, U32 u32Value )
+{
+  pu8Buffer[ 0 ] = (U8)u32Value;
+  pu8Buffer[ 1 ] = (U8)( u32Value >> 8u );
+  pu8Buffer[ 2 ] = (U8)( u32Value >> 16u );
+  pu8Buffer[ 3 ] = (U8)( u32Value >> 24u );
+}
+
+static U32 GetU32( const U8* pu8Buffer )
+{
+  return (U32)pu8Buffer[ 0 ] | ( (U32)pu8Buffer[ 1 ] << 8u ) | ( (U32)pu8Buffer[ 2 ] << 16u ) | ( (U32)pu8Buffer[ 3 ] << 24u );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Starts recording -- previous samples and codes are dropped
+ * \param  psSamples: the recording (zeroed, or loaded before)
+ * \return -
+ * \note   Must be called before the first run of the simulation: the column of a sample is given by its
+ *         position in the stream, so recording and replay both start with the first sample after the reset.
+ *********************************************************************/
+void Sim_Samples_Record( S_SIM_SAMPLES* psSamples )
+{
+  psSamples->u32StreamSize = 0u;
+  psSamples->u32Ticks = 0u;
+  psSamples->u32CodeCount = 0u;
+  Start( psSamples, SIM_SAMPLES_RECORDING );
+}
+
+/*! *******************************************************************
+ * \brief  Starts replaying -- the key matrix of the board is ignored, until the end of the samples
+ * \param  psSamples: the recording
+ * \return -
+ * \note   Must be called before the first run of the simulation, see Sim_Samples_Record().
+ *********************************************************************/
+void Sim_Samples_Replay( S_SIM_SAMPLES* psSamples )
+{
+  Start( psSamples, SIM_SAMPLES_REPLAYING );
+}
+
+/*! *******************************************************************
+ * \brief  Stops recording or replaying
+ * \param  psSamples: the recording
+ * \return -
+ *********************************************************************/
+void Sim_Samples_Stop( S_SIM_SAMPLES* psSamples )
+{
+  if( SIM_SAMPLES_RECORDING == psSamples->u8Mode )
+  {
+    FlushRun( psSamples );
+    psSamples->u32Ticks = psSamples->u32Tick;
+  }
+  if( SIM_SAMPLES_STOPPED != psSamples->u8Mode )
+  {
+    Sim_SetInterruptHook( NULL, NULL );
+    Sim_Board_FreezeRows( FALSE, SIM_SAMPLES_IDLE );
+  }
+  psSamples->u8Mode = SIM_SAMPLES_STOPPED;
+}
+
+/*! *******************************************************************
+ * \brief  Are there samples left to replay?
+ * \param  psSamples: the recording
+ * \return TRUE, if the replay is running
+ *********************************************************************/
+BOOL Sim_Samples_IsReplaying( const S_SIM_SAMPLES* psSamples )
+{
+  return ( SIM_SAMPLES_REPLAYING == psSamples->u8Mode ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Adds a code received by the computer to the expected ones
+ * \param  psSamples: the recording
+ * \param  u8Raw: the byte, as received (S_SIM_CIA_CODE::u8Raw)
+ * \return -
+ *********************************************************************/
+void Sim_Samples_AddCode( S_SIM_SAMPLES* psSamples, U8 u8Raw )
+{
+  Append( &psSamples->pu8Codes, &psSamples->u32CodeCount, &psSamples->u32CodeCapacity, u8Raw );
+}
+
+/*! *******************************************************************
+ * \brief  Writes the recording into a file
+ * \param  psSamples: the recording, stopped
+ * \param  pcFile: name of the file
+ * \return TRUE, if success
+ *********************************************************************/
+BOOL Sim_Samples_Save( S_SIM_SAMPLES* psSamples, const char* pcFile )
+{
+  U8    au8Header[ SIM_SAMPLES_HEADER_SIZE ];
+  FILE* psFile = fopen( pcFile, "wb" );
+  BOOL  bRet = FALSE;
+
+  Sim_Samples_Stop( psSamples );
+  memcpy( au8Header, SIM_SAMPLES_MAGIC, 4u );
+  au8Header[ 4 ] = SIM_SAMPLES_VERSION;
+  au8Header[ 5 ] = SIM_COL_COUNT;
+  au8Header[ 6 ] = SIM_ROW_COUNT;
+  au8Header[ 7 ] = 0u;
+  PutU32( &au8Header[ 8 ], psSamples->u32Ticks );
+  PutU32( &au8Header[ 12 ], psSamples->u32StreamSize );
+  PutU32( &au8Header[ 16 ], psSamples->u32CodeCount );
+  if( NULL != psFile )
+  {
+    bRet = ( ( 1u == fwrite( au8Header, sizeof( au8Header ), 1u, psFile ) )
+          && ( psSamples->u32StreamSize == fwrite( psSamples->pu8Stream, 1u, psSamples->u32StreamSize, psFile ) )
+          && ( psSamples->u32CodeCount == fwrite( psSamples->pu8Codes, 1u, psSamples->u32CodeCount, psFile ) ) ) ? TRUE : FALSE;
+    bRet = ( ( 0 == fclose( psFile ) ) && ( TRUE == bRet ) ) ? TRUE : FALSE;
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Reads a recording from a file
+ * \param  psSamples: the recording (zeroed, or used before)
+ * \param  pcFile: name of the file
+ * \return TRUE, if success; FALSE, if the file cannot be read, or it was recorded on another matrix
+ *********************************************************************/
+BOOL Sim_Samples_Load( S_SIM_SAMPLES* psSamples, const char* pcFile )
+{
+  U8    au8Header[ SIM_SAMPLES_HEADER_SIZE ];
+  FILE* psFile = fopen( pcFile, "rb" );
+  BOOL  bRet = FALSE;
+  U32   u32Index;
+  int   iByte;
+
+  Sim_Samples_Stop( psSamples );
+  if( NULL != psFile )
+  {
+    if( ( 1u == fread( au8Header, sizeof( au8Header ), 1u, psFile ) )
+     && ( 0 == memcmp( au8Header, SIM_SAMPLES_MAGIC, 4u ) ) && ( SIM_SAMPLES_VERSION == au8Header[ 4 ] )
+     && ( SIM_COL_COUNT == au8Header[ 5 ] ) && ( SIM_ROW_COUNT == au8Header[ 6 ] ) )
+    {
+      psSamples->u32Ticks = GetU32( &au8Header[ 8 ] );
+      psSamples->u32StreamSize = 0u;
+      psSamples->u32CodeCount = 0u;
+      bRet = TRUE;
+      for( u32Index = GetU32( &au8Header[ 12 ] ); ( 0u != u32Index ) && ( TRUE == bRet ); u32Index-- )
+      {
+        iByte = fgetc( psFile );
+        bRet = ( EOF != iByte ) ? TRUE : FALSE;
+        Append( &psSamples->pu8Stream, &psSamples->u32StreamSize, &psSamples->u32StreamCapacity, (U8)iByte );
+      }
+      for( u32Index = GetU32( &au8Header[ 16 ] ); ( 0u != u32Index ) && ( TRUE == bRet ); u32Index-- )
+      {
+        iByte = fgetc( psFile );
+        bRet = ( EOF != iByte ) ? TRUE : FALSE;
+        Sim_Samples_AddCode( psSamples, (U8)iByte );
+      }
+    }
+    fclose( psFile );
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Releases the buffers of the recording
+ * \param  psSamples: the recording
+ * \return -
+ *********************************************************************/
+void Sim_Samples_Free( S_SIM_SAMPLES* psSamples )
+{
+  Sim_Samples_Stop( psSamples );
+  free( psSamples->pu8Stream );
+  free( psSamples->pu8Codes );
+  memset( psSamples, 0x00u, sizeof( *psSamples ) );
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,90 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_samples.h
+*
+* \brief Host simulation -- record and replay of the row bytes sampled by Matrix_Sample()
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef SIM_SAMPLES_H_INCLUDED
+#define SIM_SAMPLES_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+// File: header (little-endian), the sample stream, then the expected key codes
+//
+//   "AMSP" | version | columns | rows | reserved | U32 ticks | U32 stream bytes | U32 code count
+//   stream: one sample per TIM2 tick, column 0 first -- each compared to the previous one of its column
+//     0x00..0x7F  1..128 unchanged samples
+//     0x80..0xBF  1..64 literal samples follow
+//     0xC0..0xFF  1..64 times 128 unchanged samples
+//   codes: raw bytes received by the computer, while the samples were recorded
+#define SIM_SAMPLES_MAGIC       "AMSP"
+#define SIM_SAMPLES_VERSION     1u
+#define SIM_SAMPLES_HEADER_SIZE 20u
+
+#define SIM_SAMPLES_RUN         0x00u  //!< Control byte of a short run of unchanged samples
+#define SIM_SAMPLES_LITERAL     0x80u  //!< Control byte of literal samples
+#define SIM_SAMPLES_LONG_RUN    0xC0u  //!< Control byte of a long run of unchanged samples
+#define SIM_SAMPLES_RUN_MAX     128u
+#define SIM_SAMPLES_GROUP_MAX   64u
+#define SIM_SAMPLES_IDLE        0xFFu  //!< Row byte of a column without pressed keys
+
+// Mode
+#define SIM_SAMPLES_STOPPED     0u
+#define SIM_SAMPLES_RECORDING   1u
+#define SIM_SAMPLES_REPLAYING   2u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A recording
+typedef struct
+{
+  U8*  pu8Stream;                       //!< Encoded samples
+  U32  u32StreamSize;
+  U32  u32StreamCapacity;
+  U32  u32Ticks;                        //!< Samples in the stream
+  U8*  pu8Codes;                        //!< Expected key codes (raw bytes)
+  U32  u32CodeCount;
+  U32  u32CodeCapacity;
+
+  // Internal
+  U8   u8Mode;                          //!< SIM_SAMPLES_x
+  U8   au8Last[ SIM_COL_COUNT ];        //!< Last sample of every column
+  U32  u32Tick;                         //!< Samples recorded or replayed so far
+  U32  u32Position;                     //!< Replay: next byte of the stream
+  U32  u32Run;                          //!< Unchanged samples pending (recording) or left (replay)
+  U32  u32GroupIndex;                   //!< Recording: control byte of the open literal group
+  U8   u8Literals;                      //!< Literals in the open group (recording) or left (replay)
+} S_SIM_SAMPLES;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+void Sim_Samples_Record( S_SIM_SAMPLES* psSamples );
+void Sim_Samples_Replay( S_SIM_SAMPLES* psSamples );
+void Sim_Samples_Stop( S_SIM_SAMPLES* psSamples );
+BOOL Sim_Samples_IsReplaying( const S_SIM_SAMPLES* psSamples );
+void Sim_Samples_AddCode( S_SIM_SAMPLES* psSamples, U8 u8Raw );
+BOOL Sim_Samples_Save( S_SIM_SAMPLES* psSamples, const char* pcFile );
+BOOL Sim_Samples_Load( S_SIM_SAMPLES* psSamples, const char* pcFile );
+void Sim_Samples_Free( S_SIM_SAMPLES* psSamples );
+
+
+#endif // SIM_SAMPLES_H_INCLUDED
+/******************************<EOF>**********************************/
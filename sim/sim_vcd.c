@@ -0,0 +1,137 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_vcd.c
+*
+* \brief Host simulation -- Value Change Dump of the board lines, for GTKWave
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include "types.h"
+
+// Own include
+#include "sim_vcd.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_VCD_ID( LINE )  ( (char)( '!' + (LINE) ) )  //!< One character identifier of a line
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static void WireHook( void* pvContext, SIM_TIME u64Now );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Writes the lines, that changed since the last call
+ * \param  pvContext: the capture
+ * \param  u64Now: the virtual time
+ * \return -
+ *********************************************************************/
+static void WireHook( void* pvContext, SIM_TIME u64Now )
+{
+  S_SIM_VCD* psVcd = (S_SIM_VCD*)pvContext;
+  U8 u8Line, u8Level;
+
+  for( u8Line = 0u; u8Line < SIM_LINE_COUNT; u8Line++ )
+  {
+    u8Level = Sim_Board_PeekLineLevel( u8Line );
+    if( u8Level != psVcd->au8Level[ u8Line ] )
+    {
+      if( u64Now != psVcd->u64LastTime )
+      {
+        fprintf( psVcd->psFile, "#%llu\n", u64Now * SIM_VCD_TICK_UNITS );
+        psVcd->u64LastTime = u64Now;
+      }
+      fprintf( psVcd->psFile, "%u%c\n", u8Level, SIM_VCD_ID( u8Line ) );
+      psVcd->au8Level[ u8Line ] = u8Level;
+      psVcd->u32Changes++;
+    }
+  }
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Starts a capture of all lines of the board
+ * \param  psVcd: the capture
+ * \param  pcFile: output, written while the simulation runs
+ * \return TRUE, if the file could be created
+ * \note   Call after Sim_Board_Reset() and Sim_Cia_Connect(), the capture uses the wire hook of the board.
+ *********************************************************************/
+BOOL Sim_Vcd_Open( S_SIM_VCD* psVcd, const char* pcFile )
+{
+  BOOL bRet = FALSE;
+  U8   u8Line;
+
+  psVcd->psFile = fopen( pcFile, "w" );
+  psVcd->pcBuffer = (char*)malloc( SIM_VCD_BUFFER_SIZE );
+  if( ( NULL != psVcd->psFile ) && ( NULL != psVcd->pcBuffer ) )
+  {
+    setvbuf( psVcd->psFile, psVcd->pcBuffer, _IOFBF, SIM_VCD_BUFFER_SIZE );
+    fprintf( psVcd->psFile, "$comment Amiga keyboard controller, host simulation $end\n"
+                            "$timescale %u ps $end\n"
+                            "$scope module keyboard $end\n", SIM_VCD_TIMESCALE_PS );
+    for( u8Line = 0u; u8Line < SIM_LINE_COUNT; u8Line++ )
+    {
+      fprintf( psVcd->psFile, "$var wire 1 %c %s $end\n", SIM_VCD_ID( u8Line ), Sim_GetLineName( u8Line ) );
+    }
+    fprintf( psVcd->psFile, "$upscope $end\n$enddefinitions $end\n#%llu\n$dumpvars\n", Sim_GetTime() * SIM_VCD_TICK_UNITS );
+    for( u8Line = 0u; u8Line < SIM_LINE_COUNT; u8Line++ )
+    {
+      psVcd->au8Level[ u8Line ] = Sim_Board_PeekLineLevel( u8Line );
+      fprintf( psVcd->psFile, "%u%c\n", psVcd->au8Level[ u8Line ], SIM_VCD_ID( u8Line ) );
+    }
+    fprintf( psVcd->psFile, "$end\n" );
+    psVcd->u64LastTime = Sim_GetTime();
+    psVcd->u32Changes = 0u;
+    Sim_SetWireHook( WireHook, psVcd );
+    bRet = TRUE;
+  }
+  else
+  {
+    Sim_Vcd_Close( psVcd );
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Ends the capture at the current virtual time
+ * \param  psVcd: the capture
+ * \return -
+ *********************************************************************/
+void Sim_Vcd_Close( S_SIM_VCD* psVcd )
+{
+  if( NULL != psVcd->psFile )
+  {
+    Sim_SetWireHook( NULL, NULL );
+    if( Sim_GetTime() != psVcd->u64LastTime )
+    {
+      fprintf( psVcd->psFile, "#%llu\n", Sim_GetTime() * SIM_VCD_TICK_UNITS );  // length of the capture
+    }
+    fclose( psVcd->psFile );
+    psVcd->psFile = NULL;
+  }
+  free( psVcd->pcBuffer );
+  psVcd->pcBuffer = NULL;
+}
+
+/******************************<EOF>**********************************/
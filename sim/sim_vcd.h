@@ -0,0 +1,54 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file sim_vcd.h
+*
+* \brief Host simulation -- Value Change Dump of the board lines, for GTKWave
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+#ifndef SIM_VCD_H_INCLUDED
+#define SIM_VCD_H_INCLUDED
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include "sim.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define SIM_VCD_TIMESCALE_PS    100u    //!< Unit of the time stamps (VCD allows 1, 10 or 100 of a unit)
+#define SIM_VCD_TICK_UNITS      625u    //!< One period of the 16 MHz HSI: 62.5 ns
+#define SIM_VCD_BUFFER_SIZE     65536u  //!< Output buffer -- the memory use does not grow with the capture
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A capture
+typedef struct
+{
+  FILE*    psFile;
+  char*    pcBuffer;
+  U8       au8Level[ SIM_LINE_COUNT ];  //!< Last written levels
+  SIM_TIME u64LastTime;                 //!< Last written time stamp
+  U32      u32Changes;                  //!< Value changes written
+} S_SIM_VCD;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+BOOL Sim_Vcd_Open( S_SIM_VCD* psVcd, const char* pcFile );
+void Sim_Vcd_Close( S_SIM_VCD* psVcd );
+
+
+#endif // SIM_VCD_H_INCLUDED
+/******************************<EOF>**********************************/
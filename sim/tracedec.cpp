@@ -0,0 +1,250 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file tracedec.cpp
+*
+* \brief Decoder of the firmware trace ring -- prints the timeline of a SWIM memory dump or of a
+*        simulator snapshot (kbdsim -t)
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "trace.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define TICK_US             ( 5001.0 / 16.0 )  //!< Sampling tick: TIM2 period at 16 MHz
+#define HEADER_SIZE         offsetof( S_TRACE_BLOCK, au8Data )
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief A decoded record
+struct S_RECORD
+{
+  U8   u8Event;
+  U8   u8Argument;
+  U32  u32Delta;    //!< Ticks since the previous record
+  bool bInexact;    //!< The delta was rounded down by the encoding
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+static const char* const gapcEventName[ TRACE_EVENT_COUNT ] =
+{
+  "none", "boot", "key", "fifo full", "sync lost", "retransmit", "resync", "reset"
+};
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static bool        Decode( const std::vector<U8>& rau8Block, std::vector<S_RECORD>& rasRecord, unsigned& ruLost );
+static std::string Describe( const S_RECORD& rsRecord );
+static void        Usage( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Decodes the records of the ring, from the oldest to the newest
+ * \param  rau8Block: bytes of the block, starting at TRACE_BLOCK_ADDRESS
+ * \param  rasRecord: the records
+ * \param  ruLost: records overwritten before the dump
+ * \return false, if the block is not a valid trace ring
+ * \note   The magic tells the byte order: big-endian on the STM8, host order in the simulator.
+ *********************************************************************/
+static bool Decode( const std::vector<U8>& rau8Block, std::vector<S_RECORD>& rasRecord, unsigned& ruLost )
+{
+  bool bValid = false;
+  U16  u16Magic;
+  U8   u8Size, u8Index;
+
+  if( rau8Block.size() >= HEADER_SIZE )
+  {
+    u16Magic = (U16)( ( rau8Block[ 0 ] << 8u ) | rau8Block[ 1 ] );
+    u8Size = rau8Block[ offsetof( S_TRACE_BLOCK, u8Size ) ];
+    u8Index = rau8Block[ offsetof( S_TRACE_BLOCK, u8Tail ) ];
+    bValid = ( ( TRACE_MAGIC == u16Magic ) || ( ( ( TRACE_MAGIC >> 8u ) | ( ( TRACE_MAGIC & 0xFFu ) << 8u ) ) == u16Magic ) )
+          && ( TRACE_VERSION == rau8Block[ offsetof( S_TRACE_BLOCK, u8Version ) ] )
+          && ( 0u != u8Size ) && ( rau8Block.size() >= ( HEADER_SIZE + u8Size ) )
+          && ( u8Index < u8Size ) && ( rau8Block[ offsetof( S_TRACE_BLOCK, u8Head ) ] < u8Size );
+  }
+
+  if( true == bValid )
+  {
+    const U8* pu8Data = &rau8Block[ HEADER_SIZE ];
+    const U8  u8Head = rau8Block[ offsetof( S_TRACE_BLOCK, u8Head ) ];
+    unsigned  uUsed = ( u8Head + u8Size - u8Index ) % u8Size;
+
+    ruLost = rau8Block[ offsetof( S_TRACE_BLOCK, u8Lost ) ];
+    while( ( true == bValid ) && ( 0u != uUsed ) )
+    {
+      S_RECORD sRecord;
+      U8 au8Byte[ 3 ];
+      U8 u8Length = ( TRACE_DELTA_EXTENDED == ( pu8Data[ u8Index ] & 0x0Fu ) ) ? 3u : 2u;
+
+      if( u8Length > uUsed )
+      {
+        bValid = false;  // truncated record -- the dump was taken in the middle of a write
+      }
+      else
+      {
+        for( U8 u8Byte = 0u; u8Byte < u8Length; u8Byte++ )
+        {
+          au8Byte[ u8Byte ] = pu8Data[ u8Index ];
+          u8Index = (U8)( ( u8Index + 1u ) % u8Size );
+        }
+        uUsed -= u8Length;
+
+        sRecord.u8Event = au8Byte[ 0 ] >> 4u;
+        sRecord.u8Argument = au8Byte[ u8Length - 1u ];
+        sRecord.u32Delta = au8Byte[ 0 ] & 0x0Fu;
+        sRecord.bInexact = false;
+        if( 3u == u8Length )
+        {
+          if( 0u == ( au8Byte[ 1 ] & TRACE_DELTA_SCALED ) )
+          {
+            sRecord.u32Delta = TRACE_DELTA_EXTENDED + au8Byte[ 1 ];
+          }
+          else
+          {
+            sRecord.u32Delta = (U32)( au8Byte[ 1 ] & ~TRACE_DELTA_SCALED ) << TRACE_DELTA_SCALE_SHIFT;
+            sRecord.bInexact = true;
+          }
+        }
+        rasRecord.push_back( sRecord );
+      }
+    }
+  }
+
+  return bValid;
+}
+
+/*! *******************************************************************
+ * \brief  Text of a record
+ * \param  rsRecord: the record
+ * \return Name and argument of the event
+ *********************************************************************/
+static std::string Describe( const S_RECORD& rsRecord )
+{
+  char acText[ 64 ];
+
+  switch( rsRecord.u8Event )
+  {
+    case TRACE_EVENT_BOOT:
+      snprintf( acText, sizeof( acText ), "boot, trace version %u", rsRecord.u8Argument );
+      break;
+    case TRACE_EVENT_KEY:
+      snprintf( acText, sizeof( acText ), "key ROW%u COL%u %s", ( rsRecord.u8Argument >> 4u ) & 0x07u,
+                rsRecord.u8Argument & 0x0Fu, ( 0u != ( rsRecord.u8Argument & 0x80u ) ) ? "released" : "pressed" );
+      break;
+    case TRACE_EVENT_FIFO_FULL:
+      snprintf( acText, sizeof( acText ), "fifo full, key code %02X dropped", rsRecord.u8Argument );
+      break;
+    case TRACE_EVENT_SYNC_LOST:
+      snprintf( acText, sizeof( acText ), "sync lost, key code %02X%s not acknowledged", rsRecord.u8Argument >> 1u,
+                ( 0u != ( rsRecord.u8Argument & 0x01u ) ) ? "u" : "d" );
+      break;
+    default:
+      snprintf( acText, sizeof( acText ), "%s (%02X)",
+                ( rsRecord.u8Event < TRACE_EVENT_COUNT ) ? gapcEventName[ rsRecord.u8Event ] : "unknown", rsRecord.u8Argument );
+      break;
+  }
+
+  return std::string( acText );
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: tracedec [-r] dump_file\n"
+                   "  -r  the file is a RAM dump from address 0, the ring is read at 0x%04X\n", TRACE_BLOCK_ADDRESS );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+int main( int argc, char* argv[] )
+{
+  bool bRamDump = false;
+  const char* pcFile = NULL;
+  std::vector<S_RECORD> asRecord;
+  unsigned uLost = 0u;
+  U32  u32Ticks = 0u;
+  bool bInexact = false;
+
+  for( int iArg = 1; iArg < argc; iArg++ )
+  {
+    if( 0 == strcmp( argv[ iArg ], "-r" ) )
+    {
+      bRamDump = true;
+    }
+    else if( NULL == pcFile )
+    {
+      pcFile = argv[ iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  if( NULL == pcFile )
+  {
+    Usage();
+  }
+
+  std::ifstream sFile( pcFile, std::ios::binary );
+  std::vector<U8> au8Block( ( std::istreambuf_iterator<char>( sFile ) ), std::istreambuf_iterator<char>() );
+
+  if( true == bRamDump )
+  {
+    au8Block.erase( au8Block.begin(), au8Block.begin() + std::min<size_t>( au8Block.size(), TRACE_BLOCK_ADDRESS ) );
+  }
+  if( false == Decode( au8Block, asRecord, uLost ) )
+  {
+    fprintf( stderr, "tracedec: %s: no valid trace ring\n", pcFile );
+    return EXIT_FAILURE;
+  }
+
+  // the time of the first record is counted from the boot only, if nothing was overwritten
+  printf( "%u records, %u overwritten%s\n", (unsigned)asRecord.size(), uLost,
+          ( 0u != uLost ) ? " -- times are relative to the oldest record" : "" );
+  for( size_t uRecord = 0u; uRecord < asRecord.size(); uRecord++ )
+  {
+    if( ( 0u != uRecord ) || ( 0u == uLost ) )
+    {
+      u32Ticks += asRecord[ uRecord ].u32Delta;
+      bInexact = bInexact || asRecord[ uRecord ].bInexact;
+    }
+    printf( "%c%10.3f ms  %6lu  %s\n", ( true == bInexact ) ? '~' : ' ', u32Ticks * TICK_US / 1000.0,
+            (unsigned long)u32Ticks, Describe( asRecord[ uRecord ] ).c_str() );
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/******************************<EOF>**********************************/
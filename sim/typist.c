@@ -0,0 +1,445 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file typist.c
+*
+* \brief Host simulation -- synthetic typist: loads the scancode FIFO and the handshake with realistic key
+*        streams, and reports queueing delay, FIFO occupancy and overflows
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "latency.h"
+#include "sim.h"
+#include "sim_cia.h"
+#include "sim_vcd.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define TYPIST_BOOT_TIME      SIM_S( 1 )     //!< Power-up and init key stream, before the first key
+#define TYPIST_DRAIN_TIME     SIM_S( 1 )     //!< Run after the last key, until the FIFO is empty
+#define TYPIST_SAMPLE_PERIOD  SIM_MS( 1 )    //!< FIFO occupancy sampling
+#define TYPIST_LEAD           SIM_MS( 10 )   //!< A character is planned this long before its first edge
+#define TYPIST_SHIFT_LEAD     SIM_MS( 15 )   //!< Shift pressed before the key
+#define TYPIST_SHIFT_LAG      SIM_MS( 10 )   //!< Shift released after the key
+#define TYPIST_HOLD_MIN       SIM_MS( 60 )   //!< Key hold time: 60..120 ms
+#define TYPIST_HOLD_SPAN      60u
+#define TYPIST_BURST_PERIOD   SIM_MS( 35 )   //!< Rollover burst: presses 35 ms apart, each held for 140 ms
+#define TYPIST_BURST_HOLD     SIM_MS( 140 )
+#define TYPIST_REPRESS_GAP    SIM_MS( 5 )    //!< A key can be pressed again this long after it settled released (default)
+#define TYPIST_FIFO_SIZE      20u            //!< Same as SCANCODE_FIFO_SIZE in amiga_key.c
+#define TYPIST_RAW_SYNC       0xFFu          //!< Byte of the synchronization pulses
+#define TYPIST_RAW_LOST_SYNC  0xF3u          //!< "Last key code bad" (0xF9) as shifted in
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Configuration and state of the typist
+typedef struct
+{
+  // Configuration
+  U32        u32Wpm;             //!< Words (5 characters) per minute
+  U32        u32Seconds;         //!< Length of the session
+  U32        u32CapitalPct;      //!< Words starting with a capital letter (shift chord)
+  U32        u32BurstPct;        //!< Words typed as an n-key rollover burst
+  SIM_TIME   u64Bounce;          //!< Contact chatter of every edge
+  SIM_TIME   u64RepressGap;      //!< A key can be pressed again this long after it settled released
+
+  // State
+  SIM_TIME   u64End;             //!< No new characters after this time
+  const char* pcWord;            //!< Word being typed, NULL: space comes
+  BOOL       bCapital;
+  BOOL       bBurst;
+  char       cPrevious;
+  SIM_TIME   au64FreeAt[ SIM_ROW_COUNT ][ SIM_COL_COUNT ];  //!< The key can be pressed again at this time
+  U8         u8ShiftRow, u8ShiftColumn;
+
+  // Results
+  U32        u32Characters;
+  U32        u32Presses;         //!< Key presses including the shift
+  U32        u32Accepted;        //!< Scancodes put into the FIFO
+  U32        u32Rejected;        //!< AmigaKey_RegisterScanCode() calls refused, because the FIFO was full
+  U32        u32Acknowledged;    //!< Scancodes removed from the FIFO after the handshake
+  U32        u32Delivered;       //!< Key codes received by the computer (without sync and "last code bad")
+  U32        au32Occupancy[ TYPIST_FIFO_SIZE + 1u ];  //!< Samples per FIFO fill level
+  U32        u32OccupancySamples;
+} S_TYPIST;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Constants
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Common English words -- realistic digraphs and hand alternation
+static const char* const gcapcWords[] =
+{
+  "the", "of", "and", "to", "in", "is", "you", "that", "it", "he", "was", "for", "on", "are", "as", "with",
+  "his", "they", "at", "be", "this", "have", "from", "or", "one", "had", "by", "word", "but", "not", "what",
+  "all", "were", "we", "when", "your", "can", "said", "there", "use", "an", "each", "which", "she", "do",
+  "how", "their", "if", "will", "up", "other", "about", "out", "many", "then", "them", "these", "so", "some",
+  "her", "would", "make", "like", "him", "into", "time", "has", "look", "two", "more", "write", "go", "see",
+  "number", "no", "way", "could", "people", "my", "than", "first", "water", "been", "call", "who", "oil",
+  "its", "now", "find", "long", "down", "day", "did", "get", "come", "made", "may", "part", "amiga", "keyboard"
+};
+
+static const char gcacLeftHand[] = "qwertasdfgzxcvb";
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static S_TYPIST  gsTypist;
+static S_SIM_CIA gsCia;
+static S_SIM_VCD gsVcd;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U32      Random( U32 u32Range );
+static BOOL     IsLeftHand( char cChar );
+static SIM_TIME GetInterval( char cPrevious, char cNext );
+static char     NextCharacter( void );
+static void     TypeCharacter( void* pvContext, SIM_TIME u64Time );
+static void     SampleOccupancy( void* pvContext, SIM_TIME u64Time );
+static U32      GetPercentileUs( const S_LATENCY_STAGE* psStage, U32 u32Percent );
+static void     Usage( void );
+BOOL            __real_AmigaKey_RegisterScanCode( U8 u8Code, BOOL bIsPressed );
+void            __real_Latency_Acknowledge( U8 u8Slot );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Random number in 0..u32Range-1
+ *********************************************************************/
+static U32 Random( U32 u32Range )
+{
+  return ( 0u != u32Range ) ? ( ( ( (U32)Sim_Keys_Random() << 15u ) | Sim_Keys_Random() ) % u32Range ) : 0u;
+}
+
+static BOOL IsLeftHand( char cChar )
+{
+  return ( NULL != strchr( gcacLeftHand, cChar ) ) ? TRUE : FALSE;
+}
+
+/*! *******************************************************************
+ * \brief  Time between two presses -- digraph model
+ * \param  cPrevious: previous character
+ * \param  cNext: next character
+ * \return Interval around the mean of the WPM: alternating hands are faster, the same key is slower
+ *********************************************************************/
+static SIM_TIME GetInterval( char cPrevious, char cNext )
+{
+  SIM_TIME u64Mean = SIM_MS( 12000u ) / gsTypist.u32Wpm;  // 60 s / ( 5 characters * WPM )
+  U32 u32FactorPct = 100u;
+
+  if( cPrevious == cNext )
+  {
+    u32FactorPct = 150u;
+  }
+  else if( ( ' ' == cPrevious ) || ( ' ' == cNext ) || ( IsLeftHand( cPrevious ) != IsLeftHand( cNext ) ) )
+  {
+    u32FactorPct = 95u;
+  }
+  else
+  {
+    u32FactorPct = 120u;
+  }
+  u32FactorPct = ( u32FactorPct * ( 70u + Random( 61u ) ) ) / 100u;  // +-30 % jitter
+
+  return ( u64Mean * u32FactorPct ) / 100u;
+}
+
+/*! *******************************************************************
+ * \brief  Next character of the text -- random words separated by spaces
+ *********************************************************************/
+static char NextCharacter( void )
+{
+  char cRet = ' ';
+
+  if( NULL == gsTypist.pcWord )
+  {
+    gsTypist.pcWord = gcapcWords[ Random( sizeof( gcapcWords ) / sizeof( gcapcWords[ 0 ] ) ) ];
+    gsTypist.bCapital = ( Random( 100u ) < gsTypist.u32CapitalPct ) ? TRUE : FALSE;
+    gsTypist.bBurst = ( Random( 100u ) < gsTypist.u32BurstPct ) ? TRUE : FALSE;
+  }
+  else
+  {
+    cRet = *gsTypist.pcWord++;
+    if( '\0' == *gsTypist.pcWord )
+    {
+      gsTypist.pcWord = NULL;
+    }
+  }
+
+  return cRet;
+}
+
+/*! *******************************************************************
+ * \brief  Event: plans the edges of the next character, and the event of the one after
+ *********************************************************************/
+static void TypeCharacter( void* pvContext, SIM_TIME u64Time )
+{
+  char     cChar = NextCharacter();
+  BOOL     bFirst = ( ( ' ' == gsTypist.cPrevious ) && ( ' ' != cChar ) ) ? TRUE : FALSE;  // words are separated by one space
+  BOOL     bShift = FALSE;
+  BOOL     bBurst = ( ( TRUE == gsTypist.bBurst ) && ( ' ' != cChar ) ) ? TRUE : FALSE;
+  SIM_TIME u64Press = u64Time + TYPIST_LEAD + gsTypist.u64Bounce;
+  SIM_TIME u64Hold = ( TRUE == bBurst ) ? TYPIST_BURST_HOLD : ( TYPIST_HOLD_MIN + SIM_MS( Random( TYPIST_HOLD_SPAN ) ) );
+  SIM_TIME u64Release;
+  U8       u8ScanCode, u8Row, u8Column;
+
+  (void)pvContext;
+  if( ( TRUE == Sim_Keys_FromChar( cChar, &u8ScanCode, &bShift ) ) && ( TRUE == Sim_Keys_Find( u8ScanCode, &u8Row, &u8Column ) ) )
+  {
+    bShift = ( ( TRUE == bFirst ) && ( TRUE == gsTypist.bCapital ) ) ? TRUE : FALSE;
+    if( TRUE == bShift )
+    {
+      u64Press = ( u64Press > gsTypist.au64FreeAt[ gsTypist.u8ShiftRow ][ gsTypist.u8ShiftColumn ] ) ? u64Press : gsTypist.au64FreeAt[ gsTypist.u8ShiftRow ][ gsTypist.u8ShiftColumn ];
+      Sim_Keys_ScheduleEdge( u64Press, gsTypist.u8ShiftRow, gsTypist.u8ShiftColumn, TRUE, gsTypist.u64Bounce );
+      u64Press += TYPIST_SHIFT_LEAD;
+      gsTypist.u32Presses++;
+    }
+
+    // a held key cannot be pressed again -- the next press waits for the release
+    u64Press = ( u64Press > gsTypist.au64FreeAt[ u8Row ][ u8Column ] ) ? u64Press : gsTypist.au64FreeAt[ u8Row ][ u8Column ];
+    u64Release = u64Press + u64Hold;
+    Sim_Keys_ScheduleEdge( u64Press, u8Row, u8Column, TRUE, gsTypist.u64Bounce );
+    Sim_Keys_ScheduleEdge( u64Release, u8Row, u8Column, FALSE, gsTypist.u64Bounce );
+    gsTypist.au64FreeAt[ u8Row ][ u8Column ] = u64Release + gsTypist.u64Bounce + gsTypist.u64RepressGap;
+    gsTypist.u32Presses++;
+    gsTypist.u32Characters++;
+
+    if( TRUE == bShift )
+    {
+      Sim_Keys_ScheduleEdge( u64Release + TYPIST_SHIFT_LAG, gsTypist.u8ShiftRow, gsTypist.u8ShiftColumn, FALSE, gsTypist.u64Bounce );
+      gsTypist.au64FreeAt[ gsTypist.u8ShiftRow ][ gsTypist.u8ShiftColumn ] = u64Release + TYPIST_SHIFT_LAG + gsTypist.u64Bounce + gsTypist.u64RepressGap;
+    }
+  }
+
+  // the next character is planned before its first edge, including the chatter
+  u64Press += ( TRUE == bBurst ) ? TYPIST_BURST_PERIOD : GetInterval( cChar, ( NULL != gsTypist.pcWord ) ? *gsTypist.pcWord : ' ' );
+  u64Press -= TYPIST_LEAD + gsTypist.u64Bounce;
+  gsTypist.cPrevious = cChar;
+  if( u64Press < gsTypist.u64End )
+  {
+    Sim_Event_Schedule( ( u64Press > u64Time ) ? u64Press : u64Time, TypeCharacter, NULL );
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Event: samples the FIFO fill level, and collects the codes received by the computer
+ *********************************************************************/
+static void SampleOccupancy( void* pvContext, SIM_TIME u64Time )
+{
+  S_SIM_CIA_CODE sCode;
+  U32 u32Level = gsTypist.u32Accepted - gsTypist.u32Acknowledged;
+
+  (void)pvContext;
+  gsTypist.au32Occupancy[ ( u32Level <= TYPIST_FIFO_SIZE ) ? u32Level : TYPIST_FIFO_SIZE ]++;
+  gsTypist.u32OccupancySamples++;
+  while( TRUE == Sim_Cia_Read( &gsCia, &sCode ) )
+  {
+    if( ( TYPIST_RAW_SYNC != sCode.u8Raw ) && ( TYPIST_RAW_LOST_SYNC != sCode.u8Raw ) )
+    {
+      gsTypist.u32Delivered++;
+    }
+  }
+  Sim_Event_Schedule( u64Time + TYPIST_SAMPLE_PERIOD, SampleOccupancy, NULL );
+}
+
+/*! *******************************************************************
+ * \brief  Upper bound of a percentile from the log2 histogram of the firmware
+ * \param  psStage: histogram
+ * \param  u32Percent: 0..100
+ * \return Upper edge of the bucket in us
+ *********************************************************************/
+static U32 GetPercentileUs( const S_LATENCY_STAGE* psStage, U32 u32Percent )
+{
+  U32 u32Sum = 0u;
+  U32 u32Ret = 0u;
+  U8  u8Bucket;
+
+  for( u8Bucket = 0u; u8Bucket < LATENCY_BUCKET_COUNT; u8Bucket++ )
+  {
+    u32Sum += psStage->au16Bucket[ u8Bucket ];
+    if( ( 0u == u32Ret ) && ( ( u32Sum * 100u ) >= ( psStage->u16Count * u32Percent ) ) && ( 0u != u32Sum ) )
+    {
+      u32Ret = ( u8Bucket < ( LATENCY_BUCKET_COUNT - 1u ) ) ? ( ( 1u << u8Bucket ) - 1u ) : psStage->u32MaxUs;
+    }
+  }
+
+  return ( u32Ret < psStage->u32MaxUs ) ? u32Ret : psStage->u32MaxUs;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: typist [-w wpm] [-t seconds] [-c capital_pct] [-r rollover_burst_pct] [-b bounce_us]\n"
+                   "              [-p repress_gap_ms] [-s seed] [-a ack_width_us] [-d ack_delay_us] [-g vcd_file]\n" );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Counts the scancodes put into the FIFO (linked with --wrap)
+ *********************************************************************/
+BOOL __wrap_AmigaKey_RegisterScanCode( U8 u8Code, BOOL bIsPressed )
+{
+  BOOL bRet = __real_AmigaKey_RegisterScanCode( u8Code, bIsPressed );
+
+  if( TRUE == bRet )
+  {
+    gsTypist.u32Accepted++;
+  }
+  else
+  {
+    gsTypist.u32Rejected++;
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Counts the scancodes removed from the FIFO (linked with --wrap, called by AmigaKey_Cycle())
+ *********************************************************************/
+void __wrap_Latency_Acknowledge( U8 u8Slot )
+{
+  gsTypist.u32Acknowledged++;
+  __real_Latency_Acknowledge( u8Slot );
+}
+
+int main( int argc, char* argv[] )
+{
+  const S_LATENCY_STAGE* psQueue = &gsLatencyBlock.asStage[ LATENCY_STAGE_QUEUE ];
+  const S_LATENCY_STAGE* psTotal = &gsLatencyBlock.asStage[ LATENCY_STAGE_TOTAL ];
+  U32 u32Expected;
+  U32 u32Level;
+  U32 u32Max = 0u;
+  const char* pcVcd = NULL;
+  double dSum = 0.0;
+  int iArg;
+
+  gsTypist.u32Wpm = 60u;
+  gsTypist.u32Seconds = 60u;
+  gsTypist.u32CapitalPct = 10u;
+  gsTypist.u32BurstPct = 10u;
+  gsTypist.u64Bounce = SIM_US( 1500u );
+  gsTypist.u64RepressGap = TYPIST_REPRESS_GAP;
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-w" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsTypist.u32Wpm = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-t" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsTypist.u32Seconds = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-c" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsTypist.u32CapitalPct = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-r" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsTypist.u32BurstPct = (U32)strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-b" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsTypist.u64Bounce = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-p" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsTypist.u64RepressGap = SIM_MS( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-s" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      Sim_Keys_Seed( (U32)strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-a" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsCia.u64AckWidth = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-d" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      gsCia.u64AckDelay = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-g" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcVcd = argv[ ++iArg ];
+    }
+    else
+    {
+      Usage();
+    }
+  }
+  if( 0u == gsTypist.u32Wpm )
+  {
+    Usage();
+  }
+
+  gsTypist.u32Accepted = 2u;  // the init key stream is registered inside amiga_key.c, the wrapper does not see it
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &gsCia );
+  if( ( NULL != pcVcd ) && ( FALSE == Sim_Vcd_Open( &gsVcd, pcVcd ) ) )
+  {
+    fprintf( stderr, "typist: cannot write %s\n", pcVcd );
+  }
+  Sim_RunUntil( TYPIST_BOOT_TIME );  // the keymap is loaded by now
+  Sim_Keys_Find( SIM_SCANCODE_LSHIFT, &gsTypist.u8ShiftRow, &gsTypist.u8ShiftColumn );
+  gsTypist.u64End = TYPIST_BOOT_TIME + SIM_S( gsTypist.u32Seconds );
+  gsTypist.cPrevious = ' ';
+  Sim_Event_Schedule( Sim_GetTime(), TypeCharacter, NULL );
+  Sim_Event_Schedule( Sim_GetTime(), SampleOccupancy, NULL );
+  Sim_RunUntil( gsTypist.u64End + TYPIST_DRAIN_TIME );
+  SampleOccupancy( NULL, Sim_GetTime() );  // collects the last codes
+  Sim_Vcd_Close( &gsVcd );
+
+  for( u32Level = 0u; u32Level <= TYPIST_FIFO_SIZE; u32Level++ )
+  {
+    dSum += (double)gsTypist.au32Occupancy[ u32Level ] * u32Level;
+    u32Max = ( 0u != gsTypist.au32Occupancy[ u32Level ] ) ? u32Level : u32Max;
+  }
+  u32Expected = 2u + ( 2u * gsTypist.u32Presses );  // init key stream, then a press and a release per key
+
+  printf( "typist:         %lu WPM target, %.1f WPM typed, %lu %% capitals, %lu %% rollover bursts, %.1f ms bounce\n",
+          (unsigned long)gsTypist.u32Wpm, gsTypist.u32Characters / 5.0 / ( gsTypist.u32Seconds / 60.0 ),
+          (unsigned long)gsTypist.u32CapitalPct, (unsigned long)gsTypist.u32BurstPct, SIM_TO_US( gsTypist.u64Bounce ) / 1000.0 );
+  printf( "keystrokes:     %lu characters, %lu presses\n", (unsigned long)gsTypist.u32Characters, (unsigned long)gsTypist.u32Presses );
+  printf( "key codes:      %lu expected, %lu delivered (%+ld)\n", (unsigned long)u32Expected,
+          (unsigned long)gsTypist.u32Delivered, (long)gsTypist.u32Delivered - (long)u32Expected );
+  printf( "fifo:           %lu accepted, %lu refused full (%.2f per 1000 presses)\n", (unsigned long)gsTypist.u32Accepted,
+          (unsigned long)gsTypist.u32Rejected, ( 0u != gsTypist.u32Presses ) ? ( 1000.0 * gsTypist.u32Rejected / gsTypist.u32Presses ) : 0.0 );
+  printf( "occupancy:      mean %.2f, max %lu of %u |", dSum / (double)gsTypist.u32OccupancySamples, (unsigned long)u32Max, TYPIST_FIFO_SIZE );
+  for( u32Level = 0u; u32Level <= u32Max; u32Level++ )
+  {
+    printf( " %.1f%%", 100.0 * gsTypist.au32Occupancy[ u32Level ] / gsTypist.u32OccupancySamples );
+  }
+  printf( "\n" );
+  printf( "queueing delay: p50 <= %lu us, p99 <= %lu us, max %lu us (%u codes)\n", (unsigned long)GetPercentileUs( psQueue, 50u ),
+          (unsigned long)GetPercentileUs( psQueue, 99u ), (unsigned long)psQueue->u32MaxUs, psQueue->u16Count );
+  printf( "sample->ack:    p50 <= %lu us, p99 <= %lu us, max %lu us\n", (unsigned long)GetPercentileUs( psTotal, 50u ),
+          (unsigned long)GetPercentileUs( psTotal, 99u ), (unsigned long)psTotal->u32MaxUs );
+  printf( "port:           %lu bytes, %lu acks (%lu missed), %lu sync bytes\n", (unsigned long)gsCia.sStats.u32Bytes,
+          (unsigned long)gsCia.sStats.u32Acks, (unsigned long)gsCia.sStats.u32AcksMissed, (unsigned long)gsCia.sStats.u32SyncBytes );
+
+  return ( u32Expected == gsTypist.u32Delivered ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/
@@ -0,0 +1,398 @@
+/*! *******************************************************************************************************
+* Copyright (c) 2018 Kristóf Szabolcs Horváth
+*
+* All rights reserved
+*
+* \file update.c
+*
+* \brief Host simulation -- in-system update: the bootloader is powered up with the boot chord held, and the virtual
+*        computer sends a new application over KCLK and KDAT, block by block. The programmed flash is compared with
+*        the image, and the throughput of the transfer is reported.
+*
+* \author Kristóf Sz. Horváth
+*
+**********************************************************************************************************/
+
+//--------------------------------------------------------------------------------------------------------/
+// Include files
+//--------------------------------------------------------------------------------------------------------/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "layout.h"
+#include "keymap.h"
+#include "boot/boot.h"
+#include "sim.h"
+#include "sim_cia.h"
+#include "intrinsics.h"
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Definitions
+//--------------------------------------------------------------------------------------------------------/
+#define UPDATE_READY_TIMEOUT  SIM_S( 3 )     //!< Power-up --> BOOT_REPLY_READY
+#define UPDATE_REPLY_TIMEOUT  SIM_MS( 50 )   //!< End of a frame --> answer, the frame is sent again after it
+#define UPDATE_START_TIMEOUT  SIM_MS( 10 )   //!< Answer of BOOT_CMD_RUN --> start of the application
+#define UPDATE_POLL           SIM_US( 5 )    //!< Step of the virtual computer, while it waits
+#define UPDATE_TRIES          8u             //!< Frames sent at most for a block
+#define UPDATE_BIT_PERIOD     10u            //!< Default, us
+#define UPDATE_OLD_FILL       0x5Au          //!< Application in the flash before the update
+
+// Amiga key codes of the boot chord
+#define UPDATE_SCANCODE_LAMIGA 0x66u
+#define UPDATE_SCANCODE_RAMIGA 0x67u
+#define UPDATE_SCANCODE_ESC    0x45u
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Types
+//--------------------------------------------------------------------------------------------------------/
+//! \brief Counters of the transfer
+typedef struct
+{
+  U32      u32Frames;     //!< Frames sent, with the repeated ones
+  U32      u32BadCrc;     //!< Answered with BOOT_REPLY_BAD_CRC
+  U32      u32NoAnswer;   //!< Not answered in UPDATE_REPLY_TIMEOUT
+  U32      u32Refused;    //!< Answered with BOOT_REPLY_REFUSED
+  SIM_TIME u64Wire;       //!< Time of shifting out the frames
+  SIM_TIME u64Answer;     //!< End of the frames --> answers (programming, CRC, reply, handshake)
+} S_UPDATE_STATS;
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Global variables
+//--------------------------------------------------------------------------------------------------------/
+static SIM_TIME gu64Started = SIM_NEVER;  //!< The bootloader started the application
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static function declarations
+//--------------------------------------------------------------------------------------------------------/
+static U16  Crc16( const U8* pu8Data, U8 u8Length );
+static void SetChord( BOOL bPressed );
+static BOOL WaitReply( S_SIM_CIA* psCia, SIM_TIME u64Timeout, U8* pu8Reply );
+static U8   SendFrame( S_SIM_CIA* psCia, U8 u8Command, U8 u8Block, const U8* pu8Data, SIM_TIME u64BitPeriod,
+                       U32 u32CorruptEvery, S_UPDATE_STATS* psStats );
+static void Usage( void );
+
+// Called by the bootloader instead of the reset vector of the application (-DBOOT_START_HOOK)
+void Update_StartApplication( void );
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Static functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  CRC-16/CCITT-FALSE, as in boot.c
+ * \param  pu8Data: the bytes
+ * \param  u8Length: number of bytes
+ * \return The CRC
+ *********************************************************************/
+static U16 Crc16( const U8* pu8Data, U8 u8Length )
+{
+  U16 u16Crc = BOOT_CRC_INIT;
+  U8  u8Index;
+  U8  u8Bit;
+
+  for( u8Index = 0u; u8Index < u8Length; u8Index++ )
+  {
+    u16Crc ^= (U16)pu8Data[ u8Index ] << 8u;
+    for( u8Bit = 0u; u8Bit < 8u; u8Bit++ )
+    {
+      u16Crc = ( 0u != ( u16Crc & 0x8000u ) ) ? (U16)( ( u16Crc << 1u ) ^ BOOT_CRC_POLY ) : (U16)( u16Crc << 1u );
+    }
+  }
+
+  return u16Crc;
+}
+
+/*! *******************************************************************
+ * \brief  Presses or releases the keys of the boot chord (LAYOUT_CHORD_BOOT of the layouts)
+ * \param  bPressed: TRUE to press
+ * \return -
+ *********************************************************************/
+static void SetChord( BOOL bPressed )
+{
+  static const U8 cau8Chord[] = { UPDATE_SCANCODE_LAMIGA, UPDATE_SCANCODE_RAMIGA, UPDATE_SCANCODE_ESC };
+  U8 u8Index;
+  U8 u8Position;
+
+  // the bootloader builds no keymap in RAM, so Sim_Keys_Find() is not used: the position table of the layout
+  for( u8Index = 0u; u8Index < sizeof( cau8Chord ); u8Index++ )
+  {
+    u8Position = Keymap_FindKey( cau8Chord[ u8Index ] );
+    if( LAYOUT_NO_KEY != u8Position )
+    {
+      Sim_SetKey( LAYOUT_POSITION_ROW( u8Position ), LAYOUT_POSITION_COL( u8Position ), bPressed );
+    }
+  }
+}
+
+/*! *******************************************************************
+ * \brief  Runs the keyboard until it answers -- the synchronization bytes are skipped
+ * \param  psCia: the port
+ * \param  u64Timeout: from now
+ * \param  pu8Reply: the answer (BOOT_REPLY_x) is put here
+ * \return TRUE, if there was an answer; the handshake of it is over too
+ *********************************************************************/
+static BOOL WaitReply( S_SIM_CIA* psCia, SIM_TIME u64Timeout, U8* pu8Reply )
+{
+  S_SIM_CIA_CODE sCode;
+  SIM_TIME u64End = Sim_GetTime() + u64Timeout;
+  BOOL     bRet = FALSE;
+
+  while( ( FALSE == bRet ) && ( Sim_GetTime() < u64End ) )
+  {
+    Sim_RunFor( UPDATE_POLL );
+    while( ( FALSE == bRet ) && ( TRUE == Sim_Cia_Read( psCia, &sCode ) ) )
+    {
+      if( 0xFFu != sCode.u8Raw )
+      {
+        *pu8Reply = sCode.u8Raw;
+        bRet = TRUE;
+      }
+    }
+  }
+  if( TRUE == bRet )
+  {
+    Sim_RunFor( psCia->u64AckDelay + psCia->u64AckWidth );  // KDAT is released, before the next frame
+  }
+
+  return bRet;
+}
+
+/*! *******************************************************************
+ * \brief  Sends a frame until it is executed or refused
+ * \param  psCia: the port
+ * \param  u8Command: BOOT_CMD_x
+ * \param  u8Block: block of the application
+ * \param  pu8Data: BOOT_BLOCK_SIZE bytes for BOOT_CMD_WRITE, NULL otherwise
+ * \param  u64BitPeriod: of the serial port
+ * \param  u32CorruptEvery: every Nth frame is damaged on the wire (0: none)
+ * \param  psStats: counters
+ * \return The last answer, 0 if there was none
+ *********************************************************************/
+static U8 SendFrame( S_SIM_CIA* psCia, U8 u8Command, U8 u8Block, const U8* pu8Data, SIM_TIME u64BitPeriod,
+                     U32 u32CorruptEvery, S_UPDATE_STATS* psStats )
+{
+  U8       au8Frame[ BOOT_FRAME_MAX ];
+  U8       u8Length = 2u;
+  U8       u8Reply = 0u;
+  U8       u8Try;
+  U16      u16Crc;
+  SIM_TIME u64Start;
+
+  au8Frame[ 0 ] = u8Command;
+  au8Frame[ 1 ] = u8Block;
+  if( NULL != pu8Data )
+  {
+    memcpy( &au8Frame[ 2 ], pu8Data, BOOT_BLOCK_SIZE );
+    u8Length += BOOT_BLOCK_SIZE;
+  }
+  u16Crc = Crc16( au8Frame, u8Length );
+  au8Frame[ u8Length++ ] = (U8)( u16Crc >> 8u );
+  au8Frame[ u8Length++ ] = (U8)u16Crc;
+
+  for( u8Try = 0u; ( u8Try < UPDATE_TRIES ) && ( BOOT_REPLY_ACK != u8Reply ) && ( BOOT_REPLY_REFUSED != u8Reply ); u8Try++ )
+  {
+    psStats->u32Frames++;
+    if( ( 0u != u32CorruptEvery ) && ( 0u == ( psStats->u32Frames % u32CorruptEvery ) ) )
+    {
+      au8Frame[ u8Length - 3u ] ^= 0x10u;  // one bit flipped on the wire
+      Sim_Cia_Send( psCia, au8Frame, u8Length, u64BitPeriod );
+      au8Frame[ u8Length - 3u ] ^= 0x10u;
+    }
+    else
+    {
+      Sim_Cia_Send( psCia, au8Frame, u8Length, u64BitPeriod );
+    }
+
+    u64Start = Sim_GetTime();
+    while( TRUE == Sim_Cia_IsSending( psCia ) )
+    {
+      Sim_RunFor( UPDATE_POLL );
+    }
+    psStats->u64Wire += Sim_GetTime() - u64Start;
+
+    u64Start = Sim_GetTime();
+    if( FALSE == WaitReply( psCia, UPDATE_REPLY_TIMEOUT, &u8Reply ) )
+    {
+      u8Reply = 0u;
+      psStats->u32NoAnswer++;
+    }
+    psStats->u64Answer += Sim_GetTime() - u64Start;
+    psStats->u32BadCrc  += ( BOOT_REPLY_BAD_CRC == u8Reply ) ? 1u : 0u;
+    psStats->u32Refused += ( BOOT_REPLY_REFUSED == u8Reply ) ? 1u : 0u;
+  }
+
+  return u8Reply;
+}
+
+static void Usage( void )
+{
+  fprintf( stderr, "usage: update [-i image.bin] [-s size] [-r seed] [-b bit_us] [-e every] [-a ack_us]\n"
+                   "  -i  application image, linked at 0x%04X (default: random bytes)\n"
+                   "  -s  size of the random image in bytes (default %u, the whole application area)\n"
+                   "  -b  bit period of the serial port of the computer (default %u us)\n"
+                   "  -e  every Nth frame is damaged on the wire (default 0: none)\n"
+                   "  -a  length of the handshake of the computer (default %u us)\n",
+           (unsigned)BOOT_APP_ADDRESS, (unsigned)( BOOT_APP_BLOCKS * BOOT_BLOCK_SIZE ), UPDATE_BIT_PERIOD,
+           (unsigned)( SIM_CIA_ACK_WIDTH / SIM_US( 1 ) ) );
+  exit( EXIT_FAILURE );
+}
+
+
+//--------------------------------------------------------------------------------------------------------/
+// Public functions
+//--------------------------------------------------------------------------------------------------------/
+/*! *******************************************************************
+ * \brief  Start of the application -- runs in the firmware context, the simulated CPU stops here
+ * \param  -
+ * \return -
+ *********************************************************************/
+void Update_StartApplication( void )
+{
+  gu64Started = Sim_GetTime();
+  Sim_Halt();
+}
+
+int main( int argc, char* argv[] )
+{
+  static S_SIM_CIA      sCia;
+  static U8             au8Image[ BOOT_APP_BLOCKS * BOOT_BLOCK_SIZE ];
+  static S_UPDATE_STATS sStats;
+  const char* pcImage = NULL;
+  FILE*    psFile;
+  U32      u32Size = sizeof( au8Image );
+  U32      u32Seed = 1u;
+  U32      u32BitUs = UPDATE_BIT_PERIOD;
+  U32      u32CorruptEvery = 0u;
+  U32      u32Index;
+  U8       u8Blocks;
+  U8       u8Block;
+  U8       u8Reply = 0u;
+  SIM_TIME u64Ready;
+  SIM_TIME u64Start;
+  SIM_TIME u64End;
+  BOOL     bOk = TRUE;
+  BOOL     bRange;
+  U32      u32Operations;
+  int      iArg;
+
+  for( iArg = 1; iArg < argc; iArg++ )
+  {
+    if( ( 0 == strcmp( argv[ iArg ], "-i" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      pcImage = argv[ ++iArg ];
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-s" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Size = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-r" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32Seed = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-b" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32BitUs = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-e" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      u32CorruptEvery = strtoul( argv[ ++iArg ], NULL, 0 );
+    }
+    else if( ( 0 == strcmp( argv[ iArg ], "-a" ) ) && ( ( iArg + 1 ) < argc ) )
+    {
+      sCia.u64AckWidth = SIM_US( strtoul( argv[ ++iArg ], NULL, 0 ) );
+    }
+    else
+    {
+      Usage();
+    }
+  }
+
+  // the image: the first byte is the INT opcode of the reset vector, that marks a complete application
+  if( NULL != pcImage )
+  {
+    psFile = fopen( pcImage, "rb" );
+    if( NULL == psFile )
+    {
+      perror( pcImage );
+      return EXIT_FAILURE;
+    }
+    u32Size = (U32)fread( au8Image, 1u, sizeof( au8Image ), psFile );
+    fclose( psFile );
+  }
+  else
+  {
+    u32Size = ( ( 0u != u32Size ) && ( u32Size <= sizeof( au8Image ) ) ) ? u32Size : sizeof( au8Image );
+    srand( u32Seed );
+    for( u32Index = 0u; u32Index < u32Size; u32Index++ )
+    {
+      au8Image[ u32Index ] = (U8)rand();
+    }
+    au8Image[ 0 ] = BOOT_APP_MARK;
+  }
+  if( ( 0u == u32BitUs ) || ( 0u == u32Size ) )
+  {
+    Usage();
+  }
+  u8Blocks = (U8)( ( u32Size + BOOT_BLOCK_SIZE - 1u ) / BOOT_BLOCK_SIZE );
+
+  // a complete application is in the flash already: the bootloader waits only because of the chord
+  Sim_Board_Reset();
+  Sim_Cia_Connect( &sCia );
+  memset( &gsSimMemory.au8Flash[ BOOT_SIZE ], UPDATE_OLD_FILL, SIM_FLASH_SIZE - BOOT_SIZE );
+  gsSimMemory.au8Flash[ BOOT_SIZE ] = BOOT_APP_MARK;
+  SetChord( TRUE );
+  if( ( FALSE == WaitReply( &sCia, UPDATE_READY_TIMEOUT, &u8Reply ) ) || ( BOOT_REPLY_READY != u8Reply ) )
+  {
+    fprintf( stderr, "update: the bootloader did not answer (0x%02X)\n", u8Reply );
+    return EXIT_FAILURE;
+  }
+  u64Ready = Sim_GetTime();
+  SetChord( FALSE );
+
+  // the first block after the application is refused without touching the flash, the transfer is counted without it
+  u32Operations = gsSimMemory.u32ProgramOperations;
+  u8Reply = SendFrame( &sCia, BOOT_CMD_WRITE, BOOT_APP_BLOCKS, au8Image, SIM_US( u32BitUs ), 0u, &sStats );
+  bRange = ( ( BOOT_REPLY_REFUSED == u8Reply ) && ( u32Operations == gsSimMemory.u32ProgramOperations ) ) ? TRUE : FALSE;
+  memset( &sStats, 0x00u, sizeof( sStats ) );
+
+  // block 0 first (the bootloader keeps it), the rest in order, then the start
+  u64Start = Sim_GetTime();
+  for( u8Block = 0u; ( u8Block < u8Blocks ) && ( TRUE == bOk ); u8Block++ )
+  {
+    u8Reply = SendFrame( &sCia, BOOT_CMD_WRITE, u8Block, &au8Image[ u8Block * BOOT_BLOCK_SIZE ], SIM_US( u32BitUs ),
+                         u32CorruptEvery, &sStats );
+    bOk = ( BOOT_REPLY_ACK == u8Reply ) ? TRUE : FALSE;
+  }
+  if( TRUE == bOk )
+  {
+    u8Reply = SendFrame( &sCia, BOOT_CMD_RUN, 0u, NULL, SIM_US( u32BitUs ), u32CorruptEvery, &sStats );
+    bOk = ( BOOT_REPLY_ACK == u8Reply ) ? TRUE : FALSE;
+  }
+  u64End = Sim_GetTime();
+  Sim_RunFor( UPDATE_START_TIMEOUT );
+
+  bOk = ( ( TRUE == bOk ) && ( 0 == memcmp( &gsSimMemory.au8Flash[ BOOT_SIZE ], au8Image, u32Size ) ) ) ? TRUE : FALSE;
+  printf( "image:          %lu bytes, %u blocks at 0x%04X (%s)\n", (unsigned long)u32Size, u8Blocks, (unsigned)BOOT_APP_ADDRESS,
+          ( NULL != pcImage ) ? pcImage : "random" );
+  printf( "serial port:    %lu us bit period, %.0f us handshake\n", (unsigned long)u32BitUs, SIM_TO_US( sCia.u64AckWidth ) );
+  printf( "bootloader:     ready %.1f ms after power-up, with the boot chord held\n", SIM_TO_US( u64Ready ) / 1000.0 );
+  printf( "frames:         %lu sent, %lu bad CRC, %lu unanswered, %lu refused\n", (unsigned long)sStats.u32Frames,
+          (unsigned long)sStats.u32BadCrc, (unsigned long)sStats.u32NoAnswer, (unsigned long)sStats.u32Refused );
+  printf( "transfer:       %.1f ms, %.0f bytes/s\n", SIM_TO_US( u64End - u64Start ) / 1000.0,
+          ( u64End > u64Start ) ? ( 1e6 * u32Size / SIM_TO_US( u64End - u64Start ) ) : 0.0 );
+  printf( "per frame:      %.2f ms on the wire, %.2f ms programming and answer\n",
+          SIM_TO_US( sStats.u64Wire ) / 1000.0 / sStats.u32Frames, SIM_TO_US( sStats.u64Answer ) / 1000.0 / sStats.u32Frames );
+  printf( "application:    %s, %s\n", ( TRUE == bOk ) ? "programmed as the image" : "DIFFERENT FROM THE IMAGE",
+          ( SIM_NEVER != gu64Started ) ? "started" : "NOT STARTED" );
+  printf( "range:          block %u at 0x%04X, after the application, %s\n", BOOT_APP_BLOCKS, (unsigned)BOOT_APP_END,
+          ( TRUE == bRange ) ? "refused -- ok" : "NOT REFUSED" );
+
+  return ( ( TRUE == bOk ) && ( TRUE == bRange ) && ( SIM_NEVER != gu64Started ) ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************<EOF>**********************************/